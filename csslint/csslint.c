@@ -27,6 +27,8 @@
 #include <libxml/xpath.h>
 
 #include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 /**
@@ -41,6 +43,9 @@ struct Options {
         gboolean display_help;
         gboolean evaluate;
         gboolean dump_location;
+        gboolean mem_stats;
+        gboolean stats;
+        guint bench_runs;
         gchar *author_sheet_path;
         gchar *user_sheet_path;
         gchar *ua_sheet_path;
@@ -63,7 +68,13 @@ static void display_version (void);
 
 static void display_usage (void);
 
-static enum CRStatus cssom_parse (guchar * a_file_uri);
+static enum CRStatus cssom_parse (guchar * a_file_uri,
+                                  gboolean a_mem_stats);
+
+static enum CRStatus bench (gchar * a_css_path, gchar * a_xml_path,
+                             guint a_nb_runs);
+
+static enum CRStatus dump_stats (guchar * a_file_uri);
 
 static enum CRStatus get_and_dump_node_style (xmlNode * a_node,
                                               CRSelEng * a_sel_eng,
@@ -182,6 +193,35 @@ parse_cmd_line (int a_argc, char **a_argv, struct Options *a_options)
 
                         }
                         a_options->evaluate = TRUE;
+                } else if (!strcmp (a_argv[i], "--mem-stats")) {
+                        a_options->mem_stats = TRUE;
+                } else if (!strcmp (a_argv[i], "--stats")) {
+                        a_options->stats = TRUE;
+                } else if (!strcmp (a_argv[i], "--bench")) {
+                        gchar *end = NULL;
+                        guint64 nb_runs = 0;
+
+                        i++;
+                        if (i < a_argc)
+                                nb_runs = g_ascii_strtoull (a_argv[i],
+                                                            &end, 10);
+                        if (!nb_runs || nb_runs > G_MAXUINT || *end) {
+                                g_print ("--bench should be followed by a number of runs\n");
+                                display_usage ();
+                                exit (-1);
+                        }
+                        a_options->bench_runs = nb_runs;
+                        if (i + 1 < a_argc
+                            && !strcmp (a_argv[i + 1], "--xml")) {
+                                i += 2;
+                                if (i >= a_argc
+                                    || a_argv[i][0] == '-') {
+                                        g_print ("--xml should be followed by a path to the xml document\n");
+                                        display_usage ();
+                                        exit (-1);
+                                }
+                                a_options->xml_path = a_argv[i];
+                        }
                 } else if (!strcmp (a_argv[i], "--dump-location")) {
                         a_options->dump_location = TRUE;
                         a_options->use_cssom = FALSE;
@@ -227,20 +267,48 @@ display_usage (void)
         g_print ("Usage: csslint <path to a css file>\n");
         g_print ("\t| csslint -v|--version\n");
         g_print ("\t| csslint --dump-location <path to a css file>\n");
+        g_print ("\t| csslint --mem-stats <path to a css file>\n");
+        g_print ("\t| csslint --stats <path to a css file>\n");
+        g_print ("\t| csslint --bench <N> [--xml <path>] <path to a css file>\n");
         g_print ("\t| csslint <--evaluate | -e> [--author-sheet <path> --user-sheet <path> --ua-sheet <path>\n\t   ] --xml <path> --xpath <xpath expression>\n");
 }
 
 /**
- *The test of the cr_input_read_byte() method.
- *Reads the each byte of a_file_uri using the
- *cr_input_read_byte() method. Each byte is send to
- *stdout.
+ *Displays the memory used by a stylesheet, per category.
+ *@param a_sheet the stylesheet.
+ */
+static void
+dump_mem_usage (CRStyleSheet * a_sheet)
+{
+        CRMemUsage usage;
+        gulong total = 0;
+        guint i = 0;
+
+        memset (&usage, 0, sizeof (CRMemUsage));
+        if (cr_stylesheet_get_memory_usage (a_sheet, &usage) != CR_OK)
+                return;
+        total = cr_mem_usage_get_total (&usage);
+        for (i = 0; i < CR_MEM_NB_CATEGORIES; i++) {
+                if (!usage.bytes[i])
+                        continue;
+                g_print ("%-14s %10lu bytes %5.1f%%\n",
+                         cr_mem_category_to_string (i), usage.bytes[i],
+                         100.0 * usage.bytes[i] / total);
+        }
+        g_print ("%-14s %10lu bytes\n", "total", total);
+}
+
+/**
+ *Parses a_file_uri into a stylesheet and dumps it, or
+ *the memory it uses.
  *@param a_file_uri the file to read.
+ *@param a_mem_stats if TRUE, the memory used by the
+ *stylesheet is displayed instead of the stylesheet.
  *@return CR_OK upon successfull completion of the
  *function, an error code otherwise.
  */
 static enum CRStatus
-cssom_parse (guchar * a_file_uri)
+cssom_parse (guchar * a_file_uri, gboolean a_mem_stats)
 {
         enum CRStatus status = CR_OK;
         CROMParser *parser = NULL;
@@ -252,8 +320,12 @@ cssom_parse (guchar * a_file_uri)
         status = cr_om_parser_parse_file (parser,
                                           a_file_uri, CR_ASCII, &stylesheet);
         if (status == CR_OK && stylesheet) {
-                cr_stylesheet_dump (stylesheet, stdout);
-                g_print ("\n");
+                if (a_mem_stats == TRUE) {
+                        dump_mem_usage (stylesheet);
+                } else {
+                        cr_stylesheet_dump (stylesheet, stdout);
+                        g_print ("\n");
+                }
                 cr_stylesheet_destroy (stylesheet);
         }
         cr_om_parser_destroy (parser);
@@ -261,6 +333,484 @@ cssom_parse (guchar * a_file_uri)
         return status;
 }
 
+/**
+ *Reads a whole file into memory.
+ *@param a_path the path of the file.
+ *@param a_buf out parameter. The content of the file,
+ *to be freed with g_free().
+ *@param a_len out parameter. The length of *a_buf.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+read_file (gchar * a_path, guchar ** a_buf, gulong * a_len)
+{
+        FILE *file = NULL;
+        GString *content = NULL;
+        gchar chunk[4096];
+        size_t len = 0;
+
+        g_return_val_if_fail (a_path && a_buf && a_len,
+                              CR_BAD_PARAM_ERROR);
+
+        file = fopen (a_path, "rb");
+        if (!file) {
+                g_printerr ("Error: Could not open file %s\n", a_path);
+                return CR_ERROR;
+        }
+        content = g_string_new (NULL);
+        while ((len = fread (chunk, 1, sizeof (chunk), file)) > 0)
+                g_string_append_len (content, chunk, len);
+        if (ferror (file)) {
+                g_printerr ("Error: Could not read file %s\n", a_path);
+                fclose (file);
+                g_string_free (content, TRUE);
+                return CR_ERROR;
+        }
+        fclose (file);
+        *a_len = content->len;
+        *a_buf = (guchar *) g_string_free (content, FALSE);
+        return CR_OK;
+}
+
+/***************************
+ *The --bench mode
+ ***************************/
+
+/**
+ *The phases timed by the --bench mode.
+ */
+enum BenchPhase {
+        BENCH_PARSE,
+        BENCH_STYLE,
+        BENCH_TOTAL,
+        BENCH_NB_PHASES
+};
+
+static const gchar *bench_phase_names[BENCH_NB_PHASES] = {
+        "parse",
+        "style",
+        "total"
+};
+
+static enum CRStatus
+bench_style_handler (CRSelEng * a_sel_eng, xmlNode * a_node,
+                     CRStyle * a_style, gpointer a_user_data)
+{
+        return CR_OK;
+}
+
+/**
+ *Parses a stylesheet and, if a document is given, styles
+ *every element of the document with it.
+ *@param a_buf the stylesheet.
+ *@param a_len the length of a_buf.
+ *@param a_doc the document to style, or NULL.
+ *@param a_times out parameter. The time each phase took,
+ *in microseconds.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+bench_run (guchar * a_buf, gulong a_len, xmlDoc * a_doc,
+           gint64 * a_times)
+{
+        CROMParser *parser = NULL;
+        CRStyleSheet *sheet = NULL;
+        CRCascade *cascade = NULL;
+        CRSelEng *sel_eng = NULL;
+        gint64 start = 0,
+                style_start = 0;
+        enum CRStatus status = CR_OK;
+
+        start = g_get_monotonic_time ();
+        parser = cr_om_parser_new (NULL);
+        if (!parser)
+                return CR_OUT_OF_MEMORY_ERROR;
+        status = cr_om_parser_parse_buf (parser, a_buf, a_len,
+                                         CR_ASCII, &sheet);
+        cr_om_parser_destroy (parser);
+        style_start = g_get_monotonic_time ();
+        a_times[BENCH_PARSE] = style_start - start;
+        a_times[BENCH_STYLE] = 0;
+        if (status != CR_OK || !sheet) {
+                g_printerr ("Error: Could not parse the stylesheet\n");
+                if (sheet)
+                        cr_stylesheet_destroy (sheet);
+                return (status == CR_OK) ? CR_ERROR : status;
+        }
+        if (a_doc) {
+                /*the cascade holds the only reference to the sheet*/
+                cascade = cr_cascade_new (sheet, NULL, NULL);
+                if (cascade)
+                        sheet = NULL;
+                sel_eng = cr_sel_eng_new ();
+                if (!cascade || !sel_eng) {
+                        status = CR_OUT_OF_MEMORY_ERROR;
+                        goto cleanup;
+                }
+                status = cr_sel_eng_style_document
+                        (sel_eng, cascade, a_doc, bench_style_handler,
+                         NULL);
+                if (status != CR_OK)
+                        g_printerr ("Error: Could not style the document\n");
+                a_times[BENCH_STYLE] = g_get_monotonic_time ()
+                        - style_start;
+        }
+        a_times[BENCH_TOTAL] = a_times[BENCH_PARSE] + a_times[BENCH_STYLE];
+
+ cleanup:
+        if (sel_eng)
+                cr_sel_eng_destroy (sel_eng);
+        if (cascade)
+                cr_cascade_destroy (cascade);
+        if (sheet)
+                cr_stylesheet_destroy (sheet);
+        return status;
+}
+
+static int
+compare_times (gconstpointer a_time0, gconstpointer a_time1)
+{
+        gint64 time0 = *(gint64 const *) a_time0,
+                time1 = *(gint64 const *) a_time1;
+
+        return (time0 > time1) - (time0 < time1);
+}
+
+/**
+ *Returns the time at a given percentile of sorted times,
+ *using the nearest rank method.
+ *@param a_times the times, sorted.
+ *@param a_nb_times the number of times.
+ *@param a_percentile the percentile, in ]0, 100].
+ *@return the time, in microseconds.
+ */
+static gint64
+get_percentile (gint64 * a_times, guint a_nb_times, guint a_percentile)
+{
+        guint64 rank = ((guint64) a_nb_times * a_percentile + 99) / 100;
+
+        return a_times[rank ? rank - 1 : 0];
+}
+
+/**
+ *Parses a stylesheet a_nb_runs times and, if a document is
+ *given, styles it as many times, then displays the min,
+ *the median and the 99th percentile of the time of each phase.
+ *The files are read once, before the first run.
+ *@param a_css_path the stylesheet.
+ *@param a_xml_path the document, or NULL.
+ *@param a_nb_runs the number of runs.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+bench (gchar * a_css_path, gchar * a_xml_path, guint a_nb_runs)
+{
+        guchar *buf = NULL;
+        gulong len = 0;
+        xmlDoc *xml_doc = NULL;
+        gint64 *samples[BENCH_NB_PHASES];
+        gint64 times[BENCH_NB_PHASES];
+        guint i = 0,
+                phase = 0;
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_css_path && a_nb_runs, CR_BAD_PARAM_ERROR);
+
+        memset (samples, 0, sizeof (samples));
+        status = read_file (a_css_path, &buf, &len);
+        if (status != CR_OK)
+                return status;
+        if (a_xml_path) {
+                xml_doc = xmlParseFile (a_xml_path);
+                if (!xml_doc) {
+                        g_printerr ("Error: Could not parse file %s\n",
+                                    a_xml_path);
+                        status = CR_ERROR;
+                        goto cleanup;
+                }
+        }
+        for (phase = 0; phase < BENCH_NB_PHASES; phase++)
+                samples[phase] = g_new0 (gint64, a_nb_runs);
+
+        for (i = 0; i < a_nb_runs; i++) {
+                status = bench_run (buf, len, xml_doc, times);
+                if (status != CR_OK)
+                        goto cleanup;
+                for (phase = 0; phase < BENCH_NB_PHASES; phase++)
+                        samples[phase][i] = times[phase];
+        }
+
+        g_print ("%u runs of %s%s%s\n", a_nb_runs, a_css_path,
+                 a_xml_path ? " against " : "",
+                 a_xml_path ? a_xml_path : "");
+        g_print ("%-6s %12s %12s %12s\n", "phase", "min (ms)",
+                 "median (ms)", "p99 (ms)");
+        for (phase = 0; phase < BENCH_NB_PHASES; phase++) {
+                if (phase == BENCH_STYLE && !xml_doc)
+                        continue;
+                qsort (samples[phase], a_nb_runs, sizeof (gint64),
+                       compare_times);
+                g_print ("%-6s %12.3f %12.3f %12.3f\n",
+                         bench_phase_names[phase],
+                         samples[phase][0] / 1000.0,
+                         get_percentile (samples[phase], a_nb_runs,
+                                         50) / 1000.0,
+                         get_percentile (samples[phase], a_nb_runs,
+                                         99) / 1000.0);
+        }
+
+ cleanup:
+        for (phase = 0; phase < BENCH_NB_PHASES; phase++)
+                g_free (samples[phase]);
+        if (xml_doc)
+                xmlFreeDoc (xml_doc);
+        g_free (buf);
+        return status;
+}
+
+/***************************
+ *The --stats mode
+ ***************************/
+
+/**
+ *The number of buckets of the selector histograms.
+ *The last bucket holds everything that does not fit
+ *in the others.
+ */
+#define NB_HISTO_BUCKETS 8
+
+/**
+ *What the --stats mode counts in a stylesheet.
+ */
+struct SheetStats {
+        gulong nb_statements[AT_FONT_FACE_RULE_STMT + 1];
+        gulong nb_selectors;
+        gulong nb_declarations;
+        /*selectors per number of simple selectors, from 1*/
+        gulong nb_simple_sels[NB_HISTO_BUCKETS];
+        /*selectors per number of additional selectors, from 0*/
+        gulong nb_add_sels[NB_HISTO_BUCKETS];
+        /*unknown property name -> number of declarations*/
+        GHashTable *unknown_props;
+};
+
+struct UnknownProp {
+        gchar const *name;
+        guint count;
+};
+
+static const gchar *statement_type_names[AT_FONT_FACE_RULE_STMT + 1] = {
+        "at-rules",
+        "rulesets",
+        "@import",
+        "@media",
+        "@page",
+        "@charset",
+        "@font-face"
+};
+
+static void
+stats_count_decls (struct SheetStats *a_stats, CRDeclaration * a_decls,
+                   gboolean a_check_props)
+{
+        CRDeclaration *cur = NULL;
+        gchar const *name = NULL;
+        guint count = 0;
+
+        for (cur = a_decls; cur; cur = cur->next) {
+                a_stats->nb_declarations++;
+                if (!a_check_props || cur->prop_id != PROP_ID_NOT_KNOWN
+                    || !cur->property)
+                        continue;
+                name = cr_string_peek_raw_str (cur->property);
+                if (!name)
+                        continue;
+                count = GPOINTER_TO_UINT (g_hash_table_lookup
+                                          (a_stats->unknown_props, name));
+                g_hash_table_insert (a_stats->unknown_props,
+                                     (gpointer) name,
+                                     GUINT_TO_POINTER (count + 1));
+        }
+}
+
+static void
+stats_count_selectors (struct SheetStats *a_stats, CRSelector * a_sels)
+{
+        CRSelector *cur = NULL;
+        CRSimpleSel *simple_sel = NULL;
+        CRAdditionalSel *add_sel = NULL;
+        guint nb_simple_sels = 0,
+                nb_add_sels = 0;
+
+        for (cur = a_sels; cur; cur = cur->next) {
+                nb_simple_sels = 0;
+                nb_add_sels = 0;
+                for (simple_sel = cur->simple_sel; simple_sel;
+                     simple_sel = simple_sel->next) {
+                        nb_simple_sels++;
+                        for (add_sel = simple_sel->add_sel; add_sel;
+                             add_sel = add_sel->next)
+                                nb_add_sels++;
+                }
+                if (!nb_simple_sels)
+                        continue;
+                a_stats->nb_selectors++;
+                a_stats->nb_simple_sels[MIN (nb_simple_sels,
+                                             NB_HISTO_BUCKETS) - 1]++;
+                a_stats->nb_add_sels[MIN (nb_add_sels,
+                                          NB_HISTO_BUCKETS - 1)]++;
+        }
+}
+
+static void
+stats_count_statements (struct SheetStats *a_stats, CRStatement * a_stmts)
+{
+        CRStatement *cur = NULL;
+
+        for (cur = a_stmts; cur; cur = cur->next) {
+                if (cur->type > AT_FONT_FACE_RULE_STMT)
+                        continue;
+                a_stats->nb_statements[cur->type]++;
+                switch (cur->type) {
+                case RULESET_STMT:
+                        if (!cur->kind.ruleset)
+                                break;
+                        stats_count_selectors
+                                (a_stats, cur->kind.ruleset->sel_list);
+                        stats_count_decls
+                                (a_stats, cur->kind.ruleset->decl_list,
+                                 TRUE);
+                        break;
+                case AT_MEDIA_RULE_STMT:
+                        if (cur->kind.media_rule)
+                                stats_count_statements
+                                        (a_stats,
+                                         cur->kind.media_rule->rulesets);
+                        break;
+                case AT_PAGE_RULE_STMT:
+                        if (cur->kind.page_rule)
+                                stats_count_decls
+                                        (a_stats,
+                                         cur->kind.page_rule->decl_list,
+                                         TRUE);
+                        break;
+                case AT_FONT_FACE_RULE_STMT:
+                        /*font descriptors are not properties*/
+                        if (cur->kind.font_face_rule)
+                                stats_count_decls
+                                        (a_stats,
+                                         cur->kind.font_face_rule->decl_list,
+                                         FALSE);
+                        break;
+                default:
+                        break;
+                }
+        }
+}
+
+static void
+dump_histogram (gchar const * a_title, gulong * a_buckets,
+                guint a_first, gulong a_total)
+{
+        guint i = 0;
+
+        g_print ("%s:\n", a_title);
+        for (i = 0; i < NB_HISTO_BUCKETS; i++) {
+                g_print ("  %2u%-2s %10lu %5.1f%%\n", a_first + i,
+                         (i == NB_HISTO_BUCKETS - 1) ? "+" : "",
+                         a_buckets[i],
+                         a_total ? 100.0 * a_buckets[i] / a_total : 0.0);
+        }
+}
+
+static int
+compare_unknown_props (gconstpointer a_prop0, gconstpointer a_prop1)
+{
+        struct UnknownProp const *prop0 = a_prop0,
+                *prop1 = a_prop1;
+
+        if (prop0->count != prop1->count)
+                return (prop0->count < prop1->count) ? 1 : -1;
+        return strcmp (prop0->name, prop1->name);
+}
+
+/**
+ *Parses a_file_uri into a stylesheet and displays the
+ *number of statements, selectors and declarations it has,
+ *histograms of the complexity of its selectors and the
+ *properties it uses that libcroco does not know.
+ *@param a_file_uri the file to read.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+dump_stats (guchar * a_file_uri)
+{
+        enum CRStatus status = CR_OK;
+        CRStyleSheet *stylesheet = NULL;
+        struct SheetStats stats;
+        struct UnknownProp *props = NULL;
+        GHashTableIter iter;
+        gpointer key = NULL,
+                value = NULL;
+        guint i = 0,
+                nb_props = 0;
+
+        g_return_val_if_fail (a_file_uri, CR_BAD_PARAM_ERROR);
+
+        status = cr_om_parser_simply_parse_file (a_file_uri, CR_ASCII,
+                                                 &stylesheet);
+        if (status != CR_OK || !stylesheet) {
+                g_printerr ("Error: Could not parse file %s\n",
+                            (gchar *) a_file_uri);
+                if (stylesheet)
+                        cr_stylesheet_destroy (stylesheet);
+                return (status == CR_OK) ? CR_ERROR : status;
+        }
+
+        memset (&stats, 0, sizeof (struct SheetStats));
+        stats.unknown_props = g_hash_table_new (g_str_hash, g_str_equal);
+        stats_count_statements (&stats, stylesheet->statements);
+
+        g_print ("statements:\n");
+        for (i = 0; i <= AT_FONT_FACE_RULE_STMT; i++) {
+                g_print ("  %-12s %10lu\n", statement_type_names[i],
+                         stats.nb_statements[i]);
+        }
+        g_print ("%-14s %10lu\n", "selectors", stats.nb_selectors);
+        g_print ("%-14s %10lu\n", "declarations", stats.nb_declarations);
+        dump_histogram ("simple selectors per selector",
+                        stats.nb_simple_sels, 1, stats.nb_selectors);
+        dump_histogram ("additional selectors per selector",
+                        stats.nb_add_sels, 0, stats.nb_selectors);
+
+        nb_props = g_hash_table_size (stats.unknown_props);
+        g_print ("unknown properties: %u\n", nb_props);
+        if (nb_props) {
+                props = g_new0 (struct UnknownProp, nb_props);
+                i = 0;
+                g_hash_table_iter_init (&iter, stats.unknown_props);
+                while (g_hash_table_iter_next (&iter, &key, &value)) {
+                        props[i].name = key;
+                        props[i].count = GPOINTER_TO_UINT (value);
+                        i++;
+                }
+                qsort (props, nb_props, sizeof (struct UnknownProp),
+                       compare_unknown_props);
+                for (i = 0; i < nb_props; i++)
+                        g_print ("  %-24s %6u\n", props[i].name,
+                                 props[i].count);
+                g_free (props);
+        }
+
+        g_hash_table_destroy (stats.unknown_props);
+        cr_stylesheet_destroy (stylesheet);
+        return CR_OK;
+}
+
 static enum CRStatus
 get_and_dump_node_style (xmlNode * a_node,
                          CRSelEng * a_sel_eng, CRCascade * a_cascade)
@@ -993,8 +1543,18 @@ main (int argc, char **argv)
                                  options.author_sheet_path,
                                  options.user_sheet_path,
                                  options.ua_sheet_path, options.xpath);
+                } else if (options.css_files_list != NULL
+                           && (options.bench_runs || options.stats)) {
+                        if (options.bench_runs)
+                                status = bench (options.css_files_list[0],
+                                                options.xml_path,
+                                                options.bench_runs);
+                        if (status == CR_OK && options.stats == TRUE)
+                                status = dump_stats
+                                        ((guchar *) options.css_files_list[0]);
                 } else if (options.css_files_list != NULL) {
-                        status = cssom_parse ((guchar *) options.css_files_list[0]);
+                        status = cssom_parse ((guchar *) options.css_files_list[0],
+                                              options.mem_stats);
                 }
         } else if (options.dump_location == TRUE) {
                 if (options.css_files_list) {
@@ -23,6 +23,8 @@
  */
 
 #include "cr-additional-sel.h"
+#include "cr-stats-priv.h"
+#include "cr-allocator-priv.h"
 #include "string.h"
 
 /**
@@ -47,7 +49,7 @@ cr_additional_sel_new (void)
 {
         CRAdditionalSel *result = NULL;
 
-        result = g_try_malloc (sizeof (CRAdditionalSel));
+        result = cr_allocator_alloc (sizeof (CRAdditionalSel));
 
         if (result == NULL) {
                 cr_utils_trace_debug ("Out of memory");
@@ -55,6 +57,7 @@ cr_additional_sel_new (void)
         }
 
         memset (result, 0, sizeof (CRAdditionalSel));
+        cr_stats_count_alloc (CR_STATS_ADDITIONAL_SEL);
 
         return result;
 }
@@ -496,5 +499,5 @@ cr_additional_sel_destroy (CRAdditionalSel * a_this)
                 cr_additional_sel_destroy (a_this->next);
         }
 
-        g_free (a_this);
+        cr_allocator_free (a_this);
 }
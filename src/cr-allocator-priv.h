@@ -0,0 +1,46 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+/**
+ *@file
+ *The functions the library allocates and frees the
+ *objects of the object model with. They are not installed.
+ */
+
+#ifndef __CR_ALLOCATOR_PRIV_H__
+#define __CR_ALLOCATOR_PRIV_H__
+
+#include "cr-allocator.h"
+
+G_BEGIN_DECLS
+
+extern const CRAllocator gv_cr_glib_allocator ;
+
+gpointer cr_allocator_alloc (gsize a_size) ;
+
+gpointer cr_allocator_alloc0 (gsize a_size) ;
+
+void cr_allocator_free (gpointer a_mem) ;
+
+G_END_DECLS
+
+#endif /*__CR_ALLOCATOR_PRIV_H__*/
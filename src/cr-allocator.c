@@ -0,0 +1,238 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <string.h>
+#include "cr-allocator-priv.h"
+
+/**
+ *@CRAllocator:
+ *
+ *The allocator the constructors and the destructors of the
+ *object model use is the current allocator of the calling
+ *thread: the last one pushed by cr_allocator_push(), or else
+ *the default one, or else glib.
+ *A parser, an OM parser or a selection engine which has been
+ *given an allocator pushes it during each of its public calls,
+ *so that the objects it builds come from it.
+ *
+ *Each block remembers the allocator it comes from, so that
+ *an object is given back to it whatever the allocator of the
+ *thread that destroys the object is.
+ */
+
+/*
+ *What precedes each block cr_allocator_alloc() returns.
+ *The members other than allocator keep the block
+ *aligned as malloc() does.
+ */
+typedef union {
+        CRAllocator const *allocator;
+        gdouble align_double;
+        gint64 align_int64;
+        gpointer align_pointers[2];
+} CRAllocHeader;
+
+static gpointer
+glib_alloc (gsize a_size, gpointer a_user_data)
+{
+        return g_try_malloc (a_size);
+}
+
+static void
+glib_free (gpointer a_mem, gpointer a_user_data)
+{
+        g_free (a_mem);
+}
+
+/**
+ *The allocator that hands the allocations over to glib.
+ *The objects that outlive the calls that build them, like
+ *the values the declarations decode lazily, are allocated with it.
+ */
+const CRAllocator gv_cr_glib_allocator = {
+        glib_alloc,
+        glib_free,
+        NULL
+};
+
+/**
+ *The allocator set by cr_allocator_set_default().
+ */
+static CRAllocator const *gv_default_allocator = NULL;
+
+/**
+ *The number of allocators pushed, in all the threads.
+ *While it is zero, an allocation does not even look
+ *the allocator of the thread up.
+ */
+static gint gv_nb_pushed_allocators = 0;
+
+/**
+ *The allocator pushed by the calling thread.
+ */
+static GPrivate gv_current_allocator = G_PRIVATE_INIT (NULL);
+
+/**
+ * cr_allocator_set_default:
+ *@a_allocator: the allocator to use when none has been pushed,
+ *or NULL to use glib. It is not copied and must stay valid
+ *until it is replaced.
+ *
+ *Sets the allocator of the whole library. The allocator
+ *replaced must stay valid until the objects allocated
+ *with it are destroyed.
+ */
+void
+cr_allocator_set_default (CRAllocator const *a_allocator)
+{
+        g_return_if_fail (!a_allocator
+                          || (a_allocator->alloc && a_allocator->free));
+
+        gv_default_allocator = a_allocator;
+}
+
+/**
+ * cr_allocator_get_current:
+ *
+ *Returns the allocator the calling thread allocates the
+ *objects with, or NULL if it is glib.
+ */
+CRAllocator const *
+cr_allocator_get_current (void)
+{
+        CRAllocator const *result = NULL;
+
+        if (g_atomic_int_get (&gv_nb_pushed_allocators))
+                result = g_private_get (&gv_current_allocator);
+        if (!result)
+                result = gv_default_allocator;
+        return result;
+}
+
+/**
+ * cr_allocator_push:
+ *@a_allocator: the allocator to use, or NULL to use
+ *the default one.
+ *
+ *Makes the calling thread allocate the objects with
+ *@a_allocator, until cr_allocator_pop() is called.
+ *
+ *Returns the allocator pushed before, to be passed
+ *to cr_allocator_pop().
+ */
+CRAllocator const *
+cr_allocator_push (CRAllocator const *a_allocator)
+{
+        CRAllocator const *result = NULL;
+
+        g_return_val_if_fail (!a_allocator
+                              || (a_allocator->alloc && a_allocator->free),
+                              NULL);
+
+        result = g_private_get (&gv_current_allocator);
+        g_private_set (&gv_current_allocator, (gpointer) a_allocator);
+        g_atomic_int_inc (&gv_nb_pushed_allocators);
+        return result;
+}
+
+/**
+ * cr_allocator_pop:
+ *@a_prev: what the matching call to cr_allocator_push() returned.
+ *
+ *Makes the calling thread go back to the allocator
+ *it used before the matching cr_allocator_push().
+ */
+void
+cr_allocator_pop (CRAllocator const *a_prev)
+{
+        g_private_set (&gv_current_allocator, (gpointer) a_prev);
+        g_atomic_int_dec_and_test (&gv_nb_pushed_allocators);
+}
+
+/**
+ * cr_allocator_alloc:
+ *@a_size: the number of bytes to allocate.
+ *
+ *Allocates a block with the current allocator.
+ *
+ *Returns the block, or NULL if it can't be allocated.
+ */
+gpointer
+cr_allocator_alloc (gsize a_size)
+{
+        CRAllocator const *allocator = cr_allocator_get_current ();
+        CRAllocHeader *header = NULL;
+
+        g_return_val_if_fail (a_size <= G_MAXSIZE - sizeof (CRAllocHeader),
+                              NULL);
+
+        if (G_LIKELY (!allocator))
+                header = g_try_malloc (sizeof (CRAllocHeader) + a_size);
+        else
+                header = allocator->alloc (sizeof (CRAllocHeader) + a_size,
+                                           allocator->user_data);
+        if (!header)
+                return NULL;
+        header->allocator = allocator;
+        return header + 1;
+}
+
+/**
+ * cr_allocator_alloc0:
+ *@a_size: the number of bytes to allocate.
+ *
+ *Allocates a block filled with zeros with the current allocator.
+ *
+ *Returns the block, or NULL if it can't be allocated.
+ */
+gpointer
+cr_allocator_alloc0 (gsize a_size)
+{
+        gpointer result = cr_allocator_alloc (a_size);
+
+        if (result)
+                memset (result, 0, a_size);
+        return result;
+}
+
+/**
+ * cr_allocator_free:
+ *@a_mem: the block to free, or NULL.
+ *
+ *Gives a block returned by cr_allocator_alloc() back to
+ *the allocator it has been allocated with, which need
+ *not be the current one.
+ */
+void
+cr_allocator_free (gpointer a_mem)
+{
+        CRAllocHeader *header = NULL;
+
+        if (!a_mem)
+                return;
+        header = (CRAllocHeader *) a_mem - 1;
+        if (G_LIKELY (!header->allocator))
+                g_free (header);
+        else
+                header->allocator->free (header,
+                                         header->allocator->user_data);
+}
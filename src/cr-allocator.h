@@ -0,0 +1,74 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+/**
+ *@file
+ *The declaration of the #CRAllocator class, through which
+ *the objects of the object model are allocated.
+ */
+
+#ifndef __CR_ALLOCATOR_H__
+#define __CR_ALLOCATOR_H__
+
+#include <glib.h>
+#include "cr-utils.h"
+
+G_BEGIN_DECLS
+
+typedef struct _CRAllocator CRAllocator ;
+
+/**
+ *The functions the objects of the object model (tokens,
+ *strings, terms, selectors, declarations, statements,
+ *stylesheets, cascades, property lists, styles and the like)
+ *are allocated and freed with.
+ *The glib containers those objects hold and the strings
+ *they point to are still allocated by glib.
+ */
+struct _CRAllocator
+{
+        /*
+         *Returns a block of a_size bytes aligned as malloc()
+         *does, or NULL if it can't be allocated.
+         */
+        gpointer (*alloc) (gsize a_size, gpointer a_user_data) ;
+
+        /*
+         *Frees a block returned by alloc. It may be
+         *left empty, for an arena freed as a whole.
+         */
+        void (*free) (gpointer a_mem, gpointer a_user_data) ;
+
+        gpointer user_data ;
+} ;
+
+void cr_allocator_set_default (CRAllocator const *a_allocator) ;
+
+CRAllocator const * cr_allocator_get_current (void) ;
+
+CRAllocator const * cr_allocator_push (CRAllocator const *a_allocator) ;
+
+void cr_allocator_pop (CRAllocator const *a_prev) ;
+
+G_END_DECLS
+
+#endif /*__CR_ALLOCATOR_H__*/
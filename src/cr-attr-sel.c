@@ -22,6 +22,7 @@
 
 #include <stdio.h>
 #include "cr-attr-sel.h"
+#include "cr-allocator-priv.h"
 
 /**
  * CRAttrSel:
@@ -43,7 +44,9 @@ cr_attr_sel_new (void)
 {
         CRAttrSel *result = NULL;
 
-        result = g_malloc0 (sizeof (CRAttrSel));
+        result = cr_allocator_alloc0 (sizeof (CRAttrSel));
+        if (!result)
+                cr_utils_trace_info ("Out of memory");
 
         return result;
 }
@@ -228,7 +231,7 @@ cr_attr_sel_destroy (CRAttrSel * a_this)
         }
 
         if (a_this) {
-                g_free (a_this);
+                cr_allocator_free (a_this);
                 a_this = NULL;
         }
 }
@@ -28,21 +28,41 @@
 
 #include <string.h>
 #include "cr-cascade.h"
+#include "cr-allocator-priv.h"
 
 #define PRIVATE(a_this) ((a_this)->priv)
 
 struct _CRCascadePriv {
  /**
-	 *the 3 style sheets of the cascade:
-	 *author, user, and useragent sheet.
+	 *the style sheets of the cascade, one ordered
+	 *list of sheets per origin: author, user, and useragent.
 	 *Intended to be addressed by
 	 *sheets[ORIGIN_AUTHOR] or sheets[ORIGIN_USER]
 	 *of sheets[ORIGIN_UA] ;
 	 */
-        CRStyleSheet *sheets[3];
+        GList *sheets[NB_ORIGINS];
         guint ref_count;
+
+        /*
+         *changes each time the set of sheets of
+         *the cascade changes. See cr_cascade_get_generation().
+         */
+        guint generation;
 };
 
+/*
+ *the last generation number given to a cascade.
+ *Generation numbers are unique across cascades.
+ */
+static volatile gint gv_last_generation = 0;
+
+static void
+new_generation (CRCascade * a_this)
+{
+        PRIVATE (a_this)->generation =
+                (guint) g_atomic_int_add (&gv_last_generation, 1) + 1;
+}
+
 /**
  * cr_cascade_new:
  *@a_author_sheet: the author origin style sheet.  May be NULL.
@@ -66,20 +86,21 @@ cr_cascade_new (CRStyleSheet * a_author_sheet,
 {
         CRCascade *result = NULL;
 
-        result = g_try_malloc (sizeof (CRCascade));
+        result = cr_allocator_alloc (sizeof (CRCascade));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
         memset (result, 0, sizeof (CRCascade));
 
-        PRIVATE (result) = g_try_malloc (sizeof (CRCascadePriv));
+        PRIVATE (result) = cr_allocator_alloc (sizeof (CRCascadePriv));
         if (!PRIVATE (result)) {
                 cr_utils_trace_info ("Out of memory");
-                g_free (result);
+                cr_allocator_free (result);
                 return NULL;
         }
         memset (PRIVATE (result), 0, sizeof (CRCascadePriv));
+        new_generation (result);
 
         if (a_author_sheet) {
                 cr_cascade_set_sheet (result, a_author_sheet, ORIGIN_AUTHOR);
@@ -101,7 +122,8 @@ cr_cascade_new (CRStyleSheet * a_author_sheet,
  *defined in the css2 spec in chapter 6.4.
  *Gets a given origin sheet.
  *
- *Gets a sheet, part of the cascade.
+ *Gets a sheet, part of the cascade. If several sheets have
+ *been given for a_origin, this is the first one.
  *Note that the returned stylesheet
  *is refcounted so if the caller wants
  *to manage it's lifecycle, it must use
@@ -117,7 +139,52 @@ cr_cascade_get_sheet (CRCascade * a_this, enum CRStyleOrigin a_origin)
                               && a_origin >= ORIGIN_UA
                               && a_origin < NB_ORIGINS, NULL);
 
-        return PRIVATE (a_this)->sheets[a_origin];
+        if (!PRIVATE (a_this)->sheets[a_origin])
+                return NULL;
+        return PRIVATE (a_this)->sheets[a_origin]->data;
+}
+
+/**
+ * cr_cascade_get_nb_sheets:
+ *@a_this: the current instance of #CRCascade.
+ *@a_origin: the origin of the style sheets as
+ *defined in the css2 spec in chapter 6.4.
+ *
+ *Returns the number of sheets of origin a_origin.
+ */
+guint
+cr_cascade_get_nb_sheets (CRCascade * a_this, enum CRStyleOrigin a_origin)
+{
+        g_return_val_if_fail (a_this
+                              && a_origin >= ORIGIN_UA
+                              && a_origin < NB_ORIGINS, 0);
+
+        return g_list_length (PRIVATE (a_this)->sheets[a_origin]);
+}
+
+/**
+ * cr_cascade_get_sheet_nth:
+ *@a_this: the current instance of #CRCascade.
+ *@a_origin: the origin of the style sheet as
+ *defined in the css2 spec in chapter 6.4.
+ *@a_index: the position of the sheet among the sheets
+ *of origin a_origin, starting at 0.
+ *
+ *Gets one of the sheets of a given origin, in the order they
+ *have been added to the cascade. Like for cr_cascade_get_sheet(),
+ *the returned stylesheet belongs to the cascade.
+ *
+ *Returns the style sheet, or NULL if it does not exist.
+ */
+CRStyleSheet *
+cr_cascade_get_sheet_nth (CRCascade * a_this, enum CRStyleOrigin a_origin,
+                          guint a_index)
+{
+        g_return_val_if_fail (a_this
+                              && a_origin >= ORIGIN_UA
+                              && a_origin < NB_ORIGINS, NULL);
+
+        return g_list_nth_data (PRIVATE (a_this)->sheets[a_origin], a_index);
 }
 
 /**
@@ -126,7 +193,8 @@ cr_cascade_get_sheet (CRCascade * a_this, enum CRStyleOrigin a_origin)
  *@a_sheet: the stylesheet to set.
  *@a_origin: the origin of the stylesheet.
  *
- *Sets a stylesheet in the cascade
+ *Sets a stylesheet in the cascade. a_sheet replaces all
+ *the sheets of origin a_origin.
  *
  *Returns CR_OK upon successfull completion, an error
  *code otherwise.
@@ -135,16 +203,154 @@ enum CRStatus
 cr_cascade_set_sheet (CRCascade * a_this,
                       CRStyleSheet * a_sheet, enum CRStyleOrigin a_origin)
 {
+        GList *cur = NULL;
+
         g_return_val_if_fail (a_this
                               && a_sheet
                               && a_origin >= ORIGIN_UA
                               && a_origin < NB_ORIGINS, CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->sheets[a_origin])
-                cr_stylesheet_unref (PRIVATE (a_this)->sheets[a_origin]);
-        PRIVATE (a_this)->sheets[a_origin] = a_sheet;
         cr_stylesheet_ref (a_sheet);
+        for (cur = PRIVATE (a_this)->sheets[a_origin]; cur; cur = cur->next) {
+                cr_stylesheet_unref (cur->data);
+        }
+        g_list_free (PRIVATE (a_this)->sheets[a_origin]);
+        PRIVATE (a_this)->sheets[a_origin] = g_list_append (NULL, a_sheet);
         a_sheet->origin = a_origin;
+        new_generation (a_this);
+        return CR_OK;
+}
+
+/**
+ * cr_cascade_append_sheet:
+ *@a_this: the current instance of #CRCascade.
+ *@a_sheet: the stylesheet to add.
+ *@a_origin: the origin of the stylesheet.
+ *
+ *Adds a stylesheet after the other sheets of origin a_origin.
+ *Within an origin, the rules of a sheet come after the rules of
+ *the sheets added before it: they win over them when they have
+ *the same weight and specificity, as if all the sheets of the
+ *origin had been concatenated.
+ *The reference count of a_sheet is increased.
+ *
+ *Returns CR_OK upon successfull completion, an error
+ *code otherwise.
+ */
+enum CRStatus
+cr_cascade_append_sheet (CRCascade * a_this,
+                         CRStyleSheet * a_sheet, enum CRStyleOrigin a_origin)
+{
+        g_return_val_if_fail (a_this
+                              && a_sheet
+                              && a_origin >= ORIGIN_UA
+                              && a_origin < NB_ORIGINS, CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->sheets[a_origin] = g_list_append
+                (PRIVATE (a_this)->sheets[a_origin], a_sheet);
+        cr_stylesheet_ref (a_sheet);
+        a_sheet->origin = a_origin;
+        new_generation (a_this);
+        return CR_OK;
+}
+
+/**
+ * cr_cascade_get_generation:
+ *@a_this: the current instance of #CRCascade.
+ *
+ *Gets the generation number of the cascade. It changes each
+ *time sheets are set or added, and when cr_cascade_invalidate()
+ *is called. No two cascades share a generation number, so
+ *it can be used to tell whether data derived from the
+ *cascade, like the rule index of a #CRSelEng, is still valid.
+ *
+ *Returns the generation number of the cascade.
+ */
+guint
+cr_cascade_get_generation (CRCascade * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), 0);
+
+        return PRIVATE (a_this)->generation;
+}
+
+/**
+ * cr_cascade_invalidate:
+ *@a_this: the current instance of #CRCascade.
+ *
+ *Tells the cascade that one of its sheets has been modified,
+ *e.g. that statements have been added to it. The data derived
+ *from the cascade is built again the next time it is needed.
+ */
+void
+cr_cascade_invalidate (CRCascade * a_this)
+{
+        g_return_if_fail (a_this && PRIVATE (a_this));
+
+        new_generation (a_this);
+}
+
+/**
+ *Tells whether a_sheet is in one of the lists of sheets of
+ *a_this that come before a_link, which is in the list of
+ *a_origin.
+ */
+static gboolean
+sheet_is_listed_before (CRCascade const * a_this,
+                        enum CRStyleOrigin a_origin, GList const * a_link)
+{
+        GList const *cur = NULL;
+        enum CRStyleOrigin origin = 0;
+
+        for (origin = 0; origin <= a_origin; origin++) {
+                for (cur = PRIVATE (a_this)->sheets[origin];
+                     cur && cur != a_link; cur = cur->next) {
+                        if (cur->data == a_link->data)
+                                return TRUE;
+                }
+        }
+        return FALSE;
+}
+
+/**
+ * cr_cascade_get_memory_usage:
+ *@a_this: the current instance of #CRCascade.
+ *@a_usage: the memory usage the bytes used are added to, so
+ *that the usage of several objects can be summed. Clear it
+ *before the first call.
+ *
+ *Estimates the memory used by the cascade and by its sheets,
+ *per category. A sheet set more than once is counted once.
+ *The rule index a #CRSelEng builds for the cascade is
+ *counted by cr_sel_eng_get_memory_usage().
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_cascade_get_memory_usage (CRCascade const * a_this, CRMemUsage * a_usage)
+{
+        enum CRStyleOrigin origin = 0;
+        GList const *cur = NULL;
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_usage,
+                              CR_BAD_PARAM_ERROR);
+
+        a_usage->bytes[CR_MEM_OTHER] += sizeof (CRCascade)
+                + sizeof (CRCascadePriv);
+        for (origin = 0; origin < NB_ORIGINS; origin++) {
+                for (cur = PRIVATE (a_this)->sheets[origin]; cur;
+                     cur = cur->next) {
+                        a_usage->bytes[CR_MEM_OTHER] += sizeof (GList);
+                        if (!cur->data
+                            || sheet_is_listed_before (a_this, origin, cur))
+                                continue;
+                        status = cr_stylesheet_get_memory_usage
+                                (cur->data, a_usage);
+                        if (status != CR_OK)
+                                return status;
+                }
+        }
         return CR_OK;
 }
 
@@ -198,18 +404,18 @@ cr_cascade_destroy (CRCascade * a_this)
 
         if (PRIVATE (a_this)) {
                 gulong i = 0;
+                GList *cur = NULL;
 
-                for (i = 0; PRIVATE (a_this)->sheets && i < NB_ORIGINS; i++) {
-                        if (PRIVATE (a_this)->sheets[i]) {
-                                if (cr_stylesheet_unref
-                                    (PRIVATE (a_this)->sheets[i])
-                                    == TRUE) {
-                                        PRIVATE (a_this)->sheets[i] = NULL;
-                                }
+                for (i = 0; i < NB_ORIGINS; i++) {
+                        for (cur = PRIVATE (a_this)->sheets[i]; cur;
+                             cur = cur->next) {
+                                cr_stylesheet_unref (cur->data);
                         }
+                        g_list_free (PRIVATE (a_this)->sheets[i]);
+                        PRIVATE (a_this)->sheets[i] = NULL;
                 }
-                g_free (PRIVATE (a_this));
+                cr_allocator_free (PRIVATE (a_this));
                 PRIVATE (a_this) = NULL;
         }
-        g_free (a_this);
+        cr_allocator_free (a_this);
 }
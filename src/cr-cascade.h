@@ -59,10 +59,28 @@ CRCascade * cr_cascade_new (CRStyleSheet *a_author_sheet,
 CRStyleSheet * cr_cascade_get_sheet (CRCascade *a_this,
                                      enum CRStyleOrigin a_origin) ;
 
+guint cr_cascade_get_nb_sheets (CRCascade *a_this,
+                                enum CRStyleOrigin a_origin) ;
+
+CRStyleSheet * cr_cascade_get_sheet_nth (CRCascade *a_this,
+                                         enum CRStyleOrigin a_origin,
+                                         guint a_index) ;
+
 enum CRStatus cr_cascade_set_sheet (CRCascade *a_this,
                                     CRStyleSheet *a_sheet,
                                     enum CRStyleOrigin a_origin) ;
 
+enum CRStatus cr_cascade_append_sheet (CRCascade *a_this,
+                                       CRStyleSheet *a_sheet,
+                                       enum CRStyleOrigin a_origin) ;
+
+guint cr_cascade_get_generation (CRCascade *a_this) ;
+
+void cr_cascade_invalidate (CRCascade *a_this) ;
+
+enum CRStatus cr_cascade_get_memory_usage (CRCascade const *a_this,
+                                           CRMemUsage *a_usage) ;
+
 void cr_cascade_ref (CRCascade *a_this) ;
 
 void cr_cascade_unref (CRCascade *a_this) ;
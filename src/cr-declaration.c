@@ -26,6 +26,8 @@
 #include "cr-declaration.h"
 #include "cr-statement.h"
 #include "cr-parser.h"
+#include "cr-stats-priv.h"
+#include "cr-allocator-priv.h"
 
 /**
  *@CRDeclaration:
@@ -33,6 +35,91 @@
  *The definition of the #CRDeclaration class.
  */
 
+typedef struct _CRPropertyDesc CRPropertyDesc;
+
+struct _CRPropertyDesc {
+        const gchar *name;
+        enum CRPropertyID prop_id;
+};
+
+static CRPropertyDesc gv_prop_table[] = {
+        {"padding-top", PROP_ID_PADDING_TOP},
+        {"padding-right", PROP_ID_PADDING_RIGHT},
+        {"padding-bottom", PROP_ID_PADDING_BOTTOM},
+        {"padding-left", PROP_ID_PADDING_LEFT},
+        {"padding", PROP_ID_PADDING},
+        {"border-top-width", PROP_ID_BORDER_TOP_WIDTH},
+        {"border-right-width", PROP_ID_BORDER_RIGHT_WIDTH},
+        {"border-bottom-width", PROP_ID_BORDER_BOTTOM_WIDTH},
+        {"border-left-width", PROP_ID_BORDER_LEFT_WIDTH},
+        {"border-width", PROP_ID_BORDER_WIDTH},
+        {"border-top-style", PROP_ID_BORDER_TOP_STYLE},
+        {"border-right-style", PROP_ID_BORDER_RIGHT_STYLE},
+        {"border-bottom-style", PROP_ID_BORDER_BOTTOM_STYLE},
+        {"border-left-style", PROP_ID_BORDER_LEFT_STYLE},
+        {"border-style", PROP_ID_BORDER_STYLE},
+        {"border-top", PROP_ID_BORDER_TOP},
+        {"border-right", PROP_ID_BORDER_RIGHT},
+        {"border-bottom", PROP_ID_BORDER_BOTTOM},
+        {"border-left", PROP_ID_BORDER_LEFT},
+        {"border", PROP_ID_BORDER},
+        {"margin-top", PROP_ID_MARGIN_TOP},
+        {"margin-right", PROP_ID_MARGIN_RIGHT},
+        {"margin-bottom", PROP_ID_MARGIN_BOTTOM},
+        {"margin-left", PROP_ID_MARGIN_LEFT},
+        {"margin", PROP_ID_MARGIN},
+        {"display", PROP_ID_DISPLAY},
+        {"position", PROP_ID_POSITION},
+        {"top", PROP_ID_TOP},
+        {"right", PROP_ID_RIGHT},
+        {"bottom", PROP_ID_BOTTOM},
+        {"left", PROP_ID_LEFT},
+        {"float", PROP_ID_FLOAT},
+        {"width", PROP_ID_WIDTH},
+        {"color", PROP_ID_COLOR},
+        {"border-top-color", PROP_ID_BORDER_TOP_COLOR},
+        {"border-right-color", PROP_ID_BORDER_RIGHT_COLOR},
+        {"border-bottom-color", PROP_ID_BORDER_BOTTOM_COLOR},
+        {"border-left-color", PROP_ID_BORDER_LEFT_COLOR},
+        {"background-color", PROP_ID_BACKGROUND_COLOR},
+        {"font-family", PROP_ID_FONT_FAMILY},
+        {"font-size", PROP_ID_FONT_SIZE},
+        {"font-style", PROP_ID_FONT_STYLE},
+        {"font-weight", PROP_ID_FONT_WEIGHT},
+	{"white-space", PROP_ID_WHITE_SPACE},
+        /*must be the last one */
+        {NULL, 0}
+};
+
+/**
+ *A the key/value pair of this hash table
+ *are:
+ *key => name of the the css propertie found in gv_prop_table
+ *value => matching property id found in gv_prop_table.
+ *So this hash table is here just to retrieval of a property id
+ *from a property name.
+ */
+static GHashTable *gv_prop_hash = NULL;
+
+/**
+ * clear_typed_value:
+ *@a_value: the decoded value to free. Set to NULL.
+ *
+ *Frees a decoded value and what it owns. The decoded values are
+ *allocated with the glib allocator, see cr_style_set_style_from_decl().
+ */
+static void
+clear_typed_value (CRDeclValue ** a_value)
+{
+        if (!*a_value)
+                return;
+        if ((*a_value)->type == DECL_VALUE_FONT_FAMILY
+            && (*a_value)->content.font_family)
+                cr_font_family_destroy ((*a_value)->content.font_family);
+        g_free (*a_value);
+        *a_value = NULL;
+}
+
 /**
  * dump:
  *@a_this: the current instance of #CRDeclaration.
@@ -56,6 +143,45 @@ dump (CRDeclaration const * a_this, FILE * a_fp, glong a_indent)
         }
 }
 
+/**
+ * cr_declaration_get_prop_id:
+ *@a_prop: the name of the property.
+ *
+ *Several threads can look property ids up at once:
+ *gv_prop_hash is built by the first of them, the
+ *others wait for it.
+ *
+ *Returns the id of the property named a_prop, or
+ *PROP_ID_NOT_KNOWN if libcroco doesn't support it.
+ */
+enum CRPropertyID
+cr_declaration_get_prop_id (const guchar * a_prop)
+{
+        GHashTable *prop_hash = NULL;
+        gpointer raw_id = NULL;
+        gulong i = 0;
+
+        g_return_val_if_fail (a_prop, PROP_ID_NOT_KNOWN);
+
+        if (g_once_init_enter (&gv_prop_hash)) {
+                prop_hash = g_hash_table_new (g_str_hash, g_str_equal);
+                /*load gv_prop_hash from gv_prop_table */
+                for (i = 0; gv_prop_table[i].name; i++) {
+                        g_hash_table_insert
+                                (prop_hash,
+                                 (gpointer) gv_prop_table[i].name,
+                                 GINT_TO_POINTER (gv_prop_table[i].prop_id));
+                }
+                g_once_init_leave (&gv_prop_hash, prop_hash);
+        }
+
+        raw_id = g_hash_table_lookup (gv_prop_hash, a_prop);
+        if (!raw_id) {
+                return PROP_ID_NOT_KNOWN;
+        }
+        return GPOINTER_TO_INT (raw_id);
+}
+
 /**
  * cr_declaration_new:
  * @a_statement: the statement this declaration belongs to. can be NULL.
@@ -86,13 +212,17 @@ cr_declaration_new (CRStatement * a_statement,
                                           || (a_statement->type
                                               == AT_PAGE_RULE_STMT)), NULL);
 
-        result = g_try_malloc (sizeof (CRDeclaration));
+        result = cr_allocator_alloc (sizeof (CRDeclaration));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
         memset (result, 0, sizeof (CRDeclaration));
+        cr_stats_count_alloc (CR_STATS_DECLARATION);
         result->property = a_property;
+        if (a_property->stryng && a_property->stryng->str)
+                result->prop_id = cr_declaration_get_prop_id
+                        ((const guchar *) a_property->stryng->str);
         result->value = a_value;
 
         if (a_value) {
@@ -769,6 +899,7 @@ void
 cr_declaration_destroy (CRDeclaration * a_this)
 {
         CRDeclaration *cur = NULL;
+        CRLonghand *longhand = NULL;
 
         g_return_if_fail (a_this);
 
@@ -783,7 +914,7 @@ cr_declaration_destroy (CRDeclaration * a_this)
          * Meanwhile, free each property/value pair contained in the list.
          */
         for (; cur; cur = cur->prev) {
-                g_free (cur->next);
+                cr_allocator_free (cur->next);
                 cur->next = NULL;
 
                 if (cur->property) {
@@ -795,7 +926,17 @@ cr_declaration_destroy (CRDeclaration * a_this)
                         cr_term_destroy (cur->value);
                         cur->value = NULL;
                 }
+
+                clear_typed_value (&cur->typed_value);
+                if (cur->longhands) {
+                        for (longhand = cur->longhands;
+                             longhand->value; longhand++) {
+                                clear_typed_value (&longhand->typed_value);
+                        }
+                        g_free (cur->longhands);
+                        cur->longhands = NULL;
+                }
         }
 
-        g_free (a_this);
+        cr_allocator_free (a_this);
 }
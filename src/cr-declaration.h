@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include "cr-utils.h"
 #include "cr-term.h"
+#include "cr-fonts.h"
 #include "cr-parsing-location.h"
 
 G_BEGIN_DECLS
@@ -38,6 +39,117 @@ G_BEGIN_DECLS
 /*forward declaration of what is defined in cr-statement.h*/
 typedef struct _CRStatement CRStatement ;
 
+/**
+ *A property ID.
+ *Each supported css property has an ID which is
+ *an entry into a property "population" jump table.
+ *each entry of the property population jump table
+ *contains code to tranform the literal form of
+ *a property value into a strongly typed value.
+ */
+enum CRPropertyID {
+        PROP_ID_NOT_KNOWN = 0,
+        PROP_ID_PADDING_TOP,
+        PROP_ID_PADDING_RIGHT,
+        PROP_ID_PADDING_BOTTOM,
+        PROP_ID_PADDING_LEFT,
+        PROP_ID_PADDING,
+        PROP_ID_BORDER_TOP_WIDTH,
+        PROP_ID_BORDER_RIGHT_WIDTH,
+        PROP_ID_BORDER_BOTTOM_WIDTH,
+        PROP_ID_BORDER_LEFT_WIDTH,
+        PROP_ID_BORDER_WIDTH,
+        PROP_ID_BORDER_TOP_STYLE,
+        PROP_ID_BORDER_RIGHT_STYLE,
+        PROP_ID_BORDER_BOTTOM_STYLE,
+        PROP_ID_BORDER_LEFT_STYLE,
+        PROP_ID_BORDER_STYLE,
+        PROP_ID_BORDER_TOP_COLOR,
+        PROP_ID_BORDER_RIGHT_COLOR,
+        PROP_ID_BORDER_BOTTOM_COLOR,
+        PROP_ID_BORDER_LEFT_COLOR,
+        PROP_ID_BORDER_TOP,
+        PROP_ID_BORDER_RIGHT,
+        PROP_ID_BORDER_BOTTOM,
+        PROP_ID_BORDER_LEFT,
+        PROP_ID_BORDER,
+        PROP_ID_MARGIN_TOP,
+        PROP_ID_MARGIN_RIGHT,
+        PROP_ID_MARGIN_BOTTOM,
+        PROP_ID_MARGIN_LEFT,
+        PROP_ID_MARGIN,
+        PROP_ID_DISPLAY,
+        PROP_ID_POSITION,
+        PROP_ID_TOP,
+        PROP_ID_RIGHT,
+        PROP_ID_BOTTOM,
+        PROP_ID_LEFT,
+        PROP_ID_FLOAT,
+        PROP_ID_WIDTH,
+        PROP_ID_COLOR,
+        PROP_ID_BACKGROUND_COLOR,
+        PROP_ID_FONT_FAMILY,
+        PROP_ID_FONT_SIZE,
+        PROP_ID_FONT_STYLE,
+        PROP_ID_FONT_WEIGHT,
+	PROP_ID_WHITE_SPACE,
+        /*should be the last one. */
+        NB_PROP_IDS
+};
+
+/**
+ *The kind of a decoded property value.
+ */
+enum CRDeclValueType
+{
+	/*the value is invalid and leaves the style untouched*/
+	DECL_VALUE_NONE = 0,
+	DECL_VALUE_NUM,
+	/*only the type of content.num is set*/
+	DECL_VALUE_NUM_TYPE,
+	DECL_VALUE_RGB,
+	/*only the inherit flag of the color is set*/
+	DECL_VALUE_RGB_INHERIT,
+	DECL_VALUE_KEYWORD,
+	DECL_VALUE_FONT_SIZE,
+	DECL_VALUE_FONT_FAMILY
+} ;
+
+/**
+ *The value of a property, decoded once from its terms
+ *so that it can be stored into any number of #CRStyle
+ *without being interpreted again.
+ */
+typedef struct _CRDeclValue CRDeclValue ;
+struct _CRDeclValue
+{
+	enum CRDeclValueType type ;
+	union
+	{
+		CRNum num ;
+		CRRgb rgb ;
+		/*the value of an enum of cr-style.h*/
+		gint keyword ;
+		CRFontSize font_size ;
+		CRFontFamily *font_family ;
+	} content ;
+} ;
+
+/**
+ *A longhand property a shorthand declaration
+ *(margin, padding, border ...) expands to.
+ *The value is a term of the value of the shorthand
+ *declaration, which keeps owning it.
+ */
+typedef struct _CRLonghand CRLonghand ;
+struct _CRLonghand
+{
+	enum CRPropertyID prop_id ;
+	CRTerm *value ;
+	/*the decoded value, NULL until the longhand is applied*/
+	CRDeclValue *typed_value ;
+} ;
+
 /**
  *The abstraction of a css declaration defined by the
  *css2 spec in chapter 4.
@@ -67,10 +179,34 @@ struct _CRDeclaration
 	glong ref_count ;
 
 	CRParsingLocation location ;
+
+	/*
+	 *The three fields below take the place of the reserved
+	 *pointers rfu0, rfu1 and rfu2, in that order, so that the
+	 *size of the struct and the offsets of rfu3 don't change.
+	 */
+
+	/*
+	 *if the declaration is a shorthand, the longhands
+	 *it expands to, terminated by an entry which value
+	 *is NULL. Computed the first time the declaration is
+	 *applied to a style, see cr_style_expand_shorthand().
+	 */
+	CRLonghand *longhands ;
+
+	/*
+	 *the decoded value, built the first time the
+	 *declaration is applied to a style.
+	 */
+	CRDeclValue *typed_value ;
+
+	/*
+	 *the id of the property, resolved when the
+	 *declaration is built.
+	 */
+	enum CRPropertyID prop_id ;
+
 	/*reserved for future usage*/	
-	gpointer rfu0 ;	
-	gpointer rfu1 ;
-	gpointer rfu2 ;
 	gpointer rfu3 ;
 } ;
 
@@ -79,6 +215,8 @@ CRDeclaration * cr_declaration_new (CRStatement *a_statement,
 				    CRString *a_property, 
 				    CRTerm *a_value) ;
 
+enum CRPropertyID cr_declaration_get_prop_id (const guchar *a_prop) ;
+
 
 CRDeclaration * cr_declaration_parse_from_buf (CRStatement *a_statement,
 					       const guchar *a_str,
@@ -46,17 +46,24 @@ static struct CREncAlias gv_default_aliases[] = {
         {"UTF-16", CR_UTF_16},
         {"UTF_16", CR_UTF_16},
         {"UTF16", CR_UTF_16},
+        {"UTF-16LE", CR_UTF_16},
+        {"UTF-16BE", CR_UTF_16},
         {"UCS1", CR_UCS_1},
         {"UCS-1", CR_UCS_1},
         {"UCS_1", CR_UCS_1},
         {"ISO-8859-1", CR_UCS_1},
         {"ISO_8859-1", CR_UCS_1},
+        {"LATIN1", CR_UCS_1},
         {"UCS-1", CR_UCS_1},
         {"UCS_1", CR_UCS_1},
         {"UCS4", CR_UCS_4},
         {"UCS-4", CR_UCS_4},
         {"UCS_4", CR_UCS_4},
+        {"UTF-32", CR_UCS_4},
+        {"UTF-32LE", CR_UCS_4},
+        {"UTF-32BE", CR_UCS_4},
         {"ASCII", CR_ASCII},
+        {"US-ASCII", CR_ASCII},
         {0, 0}
 };
 
@@ -70,6 +77,15 @@ static CREncHandler gv_default_enc_handlers[] = {
         {CR_ASCII, cr_utils_ucs1_to_utf8, cr_utils_utf8_to_ucs1,
          cr_utils_ucs1_str_len_as_utf8, cr_utils_utf8_str_len_as_ucs1},
 
+        /*
+         *the byte order of these is found out from the input, see
+         *cr_enc_handler_get_decoder (). The big endian decoders
+         *are the ones used when the input says nothing.
+         */
+        {CR_UTF_16, cr_utils_utf16be_to_utf8, NULL, NULL, NULL},
+
+        {CR_UCS_4, cr_utils_ucs4be_to_utf8, NULL, NULL, NULL},
+
         {0, NULL, NULL, NULL, NULL}
 };
 
@@ -127,9 +143,163 @@ cr_enc_handler_resolve_enc_alias (const guchar * a_alias_name,
                 }
         }
 
+        g_free (alias_name_up);
         return status;
 }
 
+/*
+ *The number of bytes of the longest utf8 encoding
+ *of a character the decoders produce.
+ */
+#define CR_ENC_MAX_UTF8_CHAR_SIZE 4
+
+/*
+ *The size of the smallest output buffer
+ *cr_enc_handler_convert_input () allocates.
+ */
+#define CR_ENC_MIN_OUT_SIZE 64
+
+/**
+ * cr_enc_handler_get_decoder:
+ *@a_this: the encoding handler of the input.
+ *@a_in: the beginning of the input.
+ *@a_in_len: the length of @a_in.
+ *@a_bom_len: out parameter. The length of the byte order
+ *mark found at the beginning of @a_in, which must be skipped.
+ *
+ *Gets the function that decodes an input, given its
+ *encoding and its first bytes. For utf16 and ucs4, the byte
+ *order mark if any, or else the position of the zero bytes
+ *around the first (ascii) character, tells the byte order.
+ *The function returned consumes whole characters only, so that
+ *an input can be decoded a chunk at a time.
+ *
+ *Returns the decoding function, NULL if @a_this has none.
+ */
+CREncInputFunc
+cr_enc_handler_get_decoder (CREncHandler * a_this, const guchar * a_in,
+                            gulong a_in_len, gulong * a_bom_len)
+{
+        g_return_val_if_fail (a_this && (a_in || !a_in_len) && a_bom_len,
+                              NULL);
+
+        *a_bom_len = 0;
+        switch (a_this->encoding) {
+        case CR_UTF_16:
+                if (a_in_len < 2)
+                        return cr_utils_utf16be_to_utf8;
+                if (a_in[0] == 0xFE && a_in[1] == 0xFF) {
+                        *a_bom_len = 2;
+                        return cr_utils_utf16be_to_utf8;
+                }
+                if (a_in[0] == 0xFF && a_in[1] == 0xFE) {
+                        *a_bom_len = 2;
+                        return cr_utils_utf16le_to_utf8;
+                }
+                if (a_in[0] && !a_in[1])
+                        return cr_utils_utf16le_to_utf8;
+                return cr_utils_utf16be_to_utf8;
+        case CR_UCS_4:
+                if (a_in_len < 4)
+                        return cr_utils_ucs4be_to_utf8;
+                if (!a_in[0] && !a_in[1] && a_in[2] == 0xFE
+                    && a_in[3] == 0xFF) {
+                        *a_bom_len = 4;
+                        return cr_utils_ucs4be_to_utf8;
+                }
+                if (a_in[0] == 0xFF && a_in[1] == 0xFE && !a_in[2]
+                    && !a_in[3]) {
+                        *a_bom_len = 4;
+                        return cr_utils_ucs4le_to_utf8;
+                }
+                if (a_in[0] && !a_in[3])
+                        return cr_utils_ucs4le_to_utf8;
+                return cr_utils_ucs4be_to_utf8;
+        default:
+                return a_this->decode_input;
+        }
+}
+
+/**
+ * cr_enc_handler_sniff_encoding:
+ *@a_buf: the beginning of a style sheet.
+ *@a_len: the length of @a_buf.
+ *@a_enc: out parameter. The encoding of the style sheet.
+ *@a_bom_len: out parameter. The length of the utf8 byte order
+ *mark found at the beginning of @a_buf, if @a_enc is #CR_UTF_8.
+ *The byte order marks of the other encodings are left to their
+ *decoders.
+ *
+ *Finds out the encoding of a style sheet from its first bytes,
+ *as described by the css2.1 spec, chapter 4.4: a byte order
+ *mark, else the zero bytes around the first character (which
+ *css requires to be something else than U+0000), else the name
+ *of the encoding given by the '@charset' rule. Falls back to utf8.
+ *
+ *Returns CR_OK upon successfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_enc_handler_sniff_encoding (const guchar * a_buf, gulong a_len,
+                               enum CREncoding *a_enc, gulong * a_bom_len)
+{
+        static const gchar charset[] = "@charset \"";
+        guchar name[32];
+        gulong i = 0;
+
+        g_return_val_if_fail ((a_buf || !a_len) && a_enc && a_bom_len,
+                              CR_BAD_PARAM_ERROR);
+
+        *a_enc = CR_UTF_8;
+        *a_bom_len = 0;
+
+        if (a_len >= 4
+            && ((!a_buf[0] && !a_buf[1] && a_buf[2] == 0xFE
+                 && a_buf[3] == 0xFF)
+                || (a_buf[0] == 0xFF && a_buf[1] == 0xFE && !a_buf[2]
+                    && !a_buf[3])
+                || (!a_buf[0] && !a_buf[1] && !a_buf[2] && a_buf[3])
+                || (a_buf[0] && !a_buf[1] && !a_buf[2] && !a_buf[3]))) {
+                *a_enc = CR_UCS_4;
+                return CR_OK;
+        }
+        if (a_len >= 2
+            && ((a_buf[0] == 0xFE && a_buf[1] == 0xFF)
+                || (a_buf[0] == 0xFF && a_buf[1] == 0xFE)
+                || (!a_buf[0] && a_buf[1])
+                || (a_buf[0] && !a_buf[1]))) {
+                *a_enc = CR_UTF_16;
+                return CR_OK;
+        }
+        if (a_len >= 3 && a_buf[0] == 0xEF && a_buf[1] == 0xBB
+            && a_buf[2] == 0xBF) {
+                *a_bom_len = 3;
+                return CR_OK;
+        }
+
+        if (a_len < sizeof (charset) - 1
+            || strncmp ((const gchar *) a_buf, charset,
+                        sizeof (charset) - 1))
+                return CR_OK;
+        a_buf += sizeof (charset) - 1;
+        a_len -= sizeof (charset) - 1;
+        for (i = 0; i < a_len && i < sizeof (name) - 1
+             && a_buf[i] != '"'; i++) {
+                name[i] = a_buf[i];
+        }
+        if (i == a_len || a_buf[i] != '"')
+                return CR_OK;
+        name[i] = 0;
+        if (cr_enc_handler_resolve_enc_alias (name, a_enc) != CR_OK
+            || *a_enc == CR_UTF_16 || *a_enc == CR_UCS_4) {
+                /*
+                 *unknown, or not an encoding
+                 *the '@charset' rule could be written in.
+                 */
+                *a_enc = CR_UTF_8;
+        }
+        return CR_OK;
+}
+
 /**
  * cr_enc_handler_convert_input:
  *@a_this: the current instance of #CREncHandler.
@@ -141,7 +311,11 @@ cr_enc_handler_resolve_enc_alias (const guchar * a_alias_name,
  *Must be freed by the buffer.
  *@a_out_len: output parameter. The length of the output buffer.
  *
- *Converts a raw input buffer into an utf8 buffer.
+ *Converts a raw input buffer into an utf8 buffer, in one pass:
+ *the output buffer is sized after the length of the input, and
+ *grown if the input turns out to need more room.
+ *A byte order mark at the beginning of an utf16 or ucs4 input
+ *is skipped.
  *
  *Returns CR_OK upon successfull completion, an error code otherwise.
  */
@@ -152,6 +326,15 @@ cr_enc_handler_convert_input (CREncHandler * a_this,
                               guchar ** a_out, gulong * a_out_len)
 {
         enum CRStatus status = CR_OK;
+        CREncInputFunc decode = NULL;
+        guchar *out = NULL,
+                *tmp = NULL;
+        gulong in_len = 0,
+                in_index = 0,
+                out_size = 0,
+                out_index = 0,
+                consumed = 0,
+                written = 0;
 
         g_return_val_if_fail (a_this && a_in && a_in_len && a_out,
                               CR_BAD_PARAM_ERROR);
@@ -159,26 +342,54 @@ cr_enc_handler_convert_input (CREncHandler * a_this,
         if (a_this->decode_input == NULL)
                 return CR_OK;
 
-        if (a_this->enc_str_len_as_utf8) {
-                status = a_this->enc_str_len_as_utf8 (a_in,
-                                                      &a_in[*a_in_len - 1],
-                                                      a_out_len);
+        in_len = *a_in_len;
+        decode = cr_enc_handler_get_decoder (a_this, a_in, in_len,
+                                             &in_index);
 
-                g_return_val_if_fail (status == CR_OK, status);
-        } else {
-                *a_out_len = *a_in_len;
+        /*style sheets are mostly ascii, which does not grow in utf8 */
+        out_size = in_len + in_len / 8 + CR_ENC_MIN_OUT_SIZE;
+        out = g_try_malloc (out_size);
+        if (!out) {
+                cr_utils_trace_info ("Out of memory");
+                return CR_OUT_OF_MEMORY_ERROR;
         }
 
-        *a_out = g_malloc0 (*a_out_len);
-
-        status = a_this->decode_input (a_in, a_in_len, *a_out, a_out_len);
+        while (in_index < in_len) {
+                consumed = in_len - in_index;
+                written = out_size - out_index;
+                status = decode (&a_in[in_index], &consumed,
+                                 &out[out_index], &written);
+                in_index += consumed;
+                out_index += written;
+                if (status != CR_OK || in_index == in_len)
+                        break;
+                if (out_size - out_index >= CR_ENC_MAX_UTF8_CHAR_SIZE) {
+                        /*the input ends in the middle of a character */
+                        status = CR_ENCODING_ERROR;
+                        break;
+                }
+                tmp = g_try_realloc (out, out_size * 2);
+                if (!tmp) {
+                        cr_utils_trace_info ("Out of memory");
+                        status = CR_OUT_OF_MEMORY_ERROR;
+                        break;
+                }
+                out = tmp;
+                out_size *= 2;
+        }
 
         if (status != CR_OK) {
-                g_free (*a_out);
-                *a_out = NULL;
+                g_free (out);
+                return status;
         }
-
-        g_return_val_if_fail (status == CR_OK, status);
-
+        /*give the room the input did not need back */
+        if (out_index && out_index < out_size) {
+                tmp = g_try_realloc (out, out_index);
+                if (tmp)
+                        out = tmp;
+        }
+        *a_in_len = in_index;
+        *a_out = out;
+        *a_out_len = out_index;
         return CR_OK;
 }
@@ -89,6 +89,18 @@ cr_enc_handler_convert_input (CREncHandler *a_this,
                               guchar **a_out,
                               gulong *a_out_len) ;
 
+CREncInputFunc
+cr_enc_handler_get_decoder (CREncHandler *a_this,
+                            const guchar *a_in,
+                            gulong a_in_len,
+                            gulong *a_bom_len) ;
+
+enum CRStatus
+cr_enc_handler_sniff_encoding (const guchar *a_buf,
+                               gulong a_len,
+                               enum CREncoding *a_enc,
+                               gulong *a_bom_len) ;
+
 G_END_DECLS
 
 #endif /*__CR_ENC_HANDLER_H__*/
@@ -24,6 +24,7 @@
  */
 
 #include "cr-fonts.h"
+#include "cr-allocator-priv.h"
 #include <string.h>
 
 static enum CRStatus
@@ -155,7 +156,7 @@ cr_font_family_new (enum CRFontFamilyType a_type, guchar * a_name)
 {
         CRFontFamily *result = NULL;
 
-        result = g_try_malloc (sizeof (CRFontFamily));
+        result = cr_allocator_alloc (sizeof (CRFontFamily));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -297,26 +298,18 @@ cr_font_family_prepend (CRFontFamily * a_this,
 enum CRStatus
 cr_font_family_destroy (CRFontFamily * a_this)
 {
-        CRFontFamily *cur_ff = NULL;
+        CRFontFamily *cur_ff = NULL,
+                *next_ff = NULL;
 
         g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
 
-        for (cur_ff = a_this; cur_ff && cur_ff->next; cur_ff = cur_ff->next) ;
-
-        for (; cur_ff; cur_ff = cur_ff->prev) {
-                if (a_this->name) {
-                        g_free (a_this->name);
-                        a_this->name = NULL;
-                }
-
-                if (cur_ff->next) {
-                        g_free (cur_ff->next);
-
-                }
-
-                if (cur_ff->prev == NULL) {
-                        g_free (a_this);
+        for (cur_ff = a_this; cur_ff; cur_ff = next_ff) {
+                next_ff = cur_ff->next;
+                if (cur_ff->name) {
+                        g_free (cur_ff->name);
+                        cur_ff->name = NULL;
                 }
+                cr_allocator_free (cur_ff);
         }
 
         return CR_OK;
@@ -336,7 +329,7 @@ cr_font_size_new (void)
 {
         CRFontSize *result = NULL;
 
-        result = g_try_malloc (sizeof (CRFontSize));
+        result = cr_allocator_alloc (sizeof (CRFontSize));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
@@ -905,7 +898,7 @@ cr_font_size_destroy (CRFontSize * a_font_size)
 {
         g_return_if_fail (a_font_size);
 
-        g_free (a_font_size) ;
+        cr_allocator_free (a_font_size) ;
 }
 
 /*******************************************************
@@ -922,7 +915,7 @@ cr_font_size_adjust_new (void)
 {
         CRFontSizeAdjust *result = NULL;
 
-        result = g_try_malloc (sizeof (CRFontSizeAdjust));
+        result = cr_allocator_alloc (sizeof (CRFontSizeAdjust));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
@@ -74,6 +74,37 @@ struct _CRInputPriv {
          */
         guint ref_count;
         gboolean free_in_buf;
+
+        /*
+         *When the input is decoded on demand (see
+         *cr_input_new_from_buf_streaming()), the function that
+         *decodes it, and the raw input buffer.
+         *in_buf is then a window on the utf8 input: window_start is
+         *the index of the first byte of the window, nb_bytes is the
+         *index of the byte next to the last decoded one and
+         *in_buf_size is the capacity of the window.
+         */
+        CREncInputFunc decode;
+        guchar *raw_buf;
+        gulong raw_len;
+        gulong raw_index;
+        gboolean free_raw_buf;
+        gulong window_start;
+
+        /*
+         *The raw index at which a few utf8 indexes start,
+         *in increasing order, so that the window can be moved
+         *back when the parser seeks backwards.
+         */
+        GArray *checkpoints;
+};
+
+/**
+ *A point where decoding can start over.
+ */
+struct CRInputCheckpoint {
+        gulong raw_index;
+        gulong index;
 };
 
 #define PRIVATE(object) (object)->priv
@@ -83,8 +114,40 @@ struct _CRInputPriv {
  **************************/
 #define CR_INPUT_MEM_CHUNK_SIZE 1024 * 4
 
+/*
+ *The number of raw bytes decoded at once by a streamed input,
+ *and the initial capacity of its window.
+ */
+#define CR_INPUT_DECODE_CHUNK_SIZE (1024 * 4)
+#define CR_INPUT_WINDOW_SIZE (CR_INPUT_DECODE_CHUNK_SIZE * 4)
+
+/*
+ *The number of bytes kept before the current position
+ *when the window slides, so that short backtracks of the
+ *parser do not need to decode again.
+ */
+#define CR_INPUT_WINDOW_HISTORY 1024
+
+/*
+ *The number of bytes wanted in the window when reading
+ *a character: the size of the longest utf8 sequence.
+ */
+#define CR_INPUT_CHAR_LOOKAHEAD 6
+
 static CRInput *cr_input_new_real (void);
 
+static gboolean decode_chunk (CRInput const * a_this, gulong a_keep_from);
+
+static void rewind_window (CRInput const * a_this, gulong a_index);
+
+static gulong fill_window (CRInput const * a_this, gulong a_index,
+                           gulong a_len, gulong a_keep_from);
+
+static gulong get_window (CRInput const * a_this, gulong a_index,
+                          gulong a_len);
+
+static gulong get_input_len (CRInput const * a_this);
+
 static CRInput *
 cr_input_new_real (void)
 {
@@ -108,6 +171,178 @@ cr_input_new_real (void)
         return result;
 }
 
+/**
+ *Decodes the next chunk of the raw input of a streamed input
+ *at the end of its window. If the window is full, the bytes
+ *located before a_keep_from are dropped, or else the window grows.
+ *@param a_this the current instance of #CRInput.
+ *@param a_keep_from the index of the first byte that must stay
+ *in the window.
+ *@return TRUE if some bytes got decoded, FALSE otherwise.
+ */
+static gboolean
+decode_chunk (CRInput const * a_this, gulong a_keep_from)
+{
+        CRInputPriv *priv = PRIVATE (a_this);
+        struct CRInputCheckpoint checkpoint,
+                *last = NULL;
+        guchar *new_buf = NULL;
+        gulong in_len = 0,
+                out_len = 0,
+                room = 0,
+                drop = 0;
+        enum CRStatus status = CR_OK;
+
+        room = priv->in_buf_size - (priv->nb_bytes - priv->window_start);
+        if (room < CR_INPUT_DECODE_CHUNK_SIZE
+            && a_keep_from > priv->window_start) {
+                drop = MIN (a_keep_from, priv->nb_bytes)
+                        - priv->window_start;
+                memmove (priv->in_buf, priv->in_buf + drop,
+                         priv->nb_bytes - priv->window_start - drop);
+                priv->window_start += drop;
+                room += drop;
+        }
+        if (room < CR_INPUT_DECODE_CHUNK_SIZE) {
+                new_buf = g_try_realloc (priv->in_buf,
+                                         priv->in_buf_size * 2);
+                if (!new_buf) {
+                        cr_utils_trace_info ("Out of memory");
+                        return FALSE;
+                }
+                priv->in_buf = new_buf;
+                room += priv->in_buf_size;
+                priv->in_buf_size *= 2;
+        }
+
+        last = &g_array_index (priv->checkpoints, struct CRInputCheckpoint,
+                               priv->checkpoints->len - 1);
+        if (priv->raw_index >= last->raw_index + CR_INPUT_DECODE_CHUNK_SIZE) {
+                checkpoint.raw_index = priv->raw_index;
+                checkpoint.index = priv->nb_bytes;
+                g_array_append_val (priv->checkpoints, checkpoint);
+        }
+
+        in_len = MIN (CR_INPUT_DECODE_CHUNK_SIZE,
+                      priv->raw_len - priv->raw_index);
+        out_len = room;
+        status = priv->decode (priv->raw_buf + priv->raw_index, &in_len,
+                               priv->in_buf + priv->nb_bytes
+                               - priv->window_start, &out_len);
+        if (status != CR_OK || !in_len) {
+                cr_utils_trace_info ("Could not decode the input");
+                priv->raw_index = priv->raw_len;
+                return FALSE;
+        }
+        priv->raw_index += in_len;
+        priv->nb_bytes += out_len;
+        return TRUE;
+}
+
+/**
+ *Empties the window of a streamed input and moves it back
+ *to the last checkpoint located before a given index.
+ *@param a_this the current instance of #CRInput.
+ *@param a_index the index the window must be able to reach.
+ */
+static void
+rewind_window (CRInput const * a_this, gulong a_index)
+{
+        CRInputPriv *priv = PRIVATE (a_this);
+        struct CRInputCheckpoint *checkpoint = NULL;
+        guint lo = 0,
+                hi = priv->checkpoints->len,
+                mid = 0;
+
+        /*the first checkpoint has the index 0*/
+        while (hi - lo > 1) {
+                mid = (lo + hi) / 2;
+                checkpoint = &g_array_index (priv->checkpoints,
+                                             struct CRInputCheckpoint, mid);
+                if (checkpoint->index <= a_index)
+                        lo = mid;
+                else
+                        hi = mid;
+        }
+        checkpoint = &g_array_index (priv->checkpoints,
+                                     struct CRInputCheckpoint, lo);
+        priv->raw_index = checkpoint->raw_index;
+        priv->window_start = checkpoint->index;
+        priv->nb_bytes = checkpoint->index;
+}
+
+/**
+ *Decodes a streamed input until a_len bytes starting at
+ *a_index are in the window, or the raw input is exhausted.
+ *@param a_this the current instance of #CRInput.
+ *@param a_index the index of the first byte wanted.
+ *@param a_len the number of bytes wanted.
+ *@param a_keep_from the index of the first byte that must stay
+ *in the window.
+ *@return the number of bytes available in the window from a_index.
+ */
+static gulong
+fill_window (CRInput const * a_this, gulong a_index, gulong a_len,
+             gulong a_keep_from)
+{
+        CRInputPriv *priv = PRIVATE (a_this);
+
+        if (a_index < priv->window_start)
+                rewind_window (a_this, a_index);
+        if (a_keep_from > a_index)
+                a_keep_from = a_index;
+        while (priv->raw_index < priv->raw_len
+               && (a_index >= priv->nb_bytes
+                   || priv->nb_bytes - a_index < a_len)) {
+                if (decode_chunk (a_this, a_keep_from) == FALSE)
+                        break;
+        }
+        return a_index < priv->nb_bytes ? priv->nb_bytes - a_index : 0;
+}
+
+/**
+ *Makes sure a given part of the input is in memory.
+ *@param a_this the current instance of #CRInput.
+ *@param a_index the index of the first byte wanted.
+ *@param a_len the number of bytes wanted.
+ *@return the number of bytes available in memory from a_index,
+ *which can be less than a_len at the end of the input. The bytes
+ *start at in_buf[a_index - window_start].
+ */
+static gulong
+get_window (CRInput const * a_this, gulong a_index, gulong a_len)
+{
+        CRInputPriv *priv = PRIVATE (a_this);
+        gulong keep_from = 0;
+
+        if (!priv->decode) {
+                return a_index < priv->nb_bytes ?
+                        priv->nb_bytes - a_index : 0;
+        }
+        keep_from = MIN (a_index, priv->next_byte_index);
+        keep_from = keep_from > CR_INPUT_WINDOW_HISTORY ?
+                keep_from - CR_INPUT_WINDOW_HISTORY : 0;
+        return fill_window (a_this, a_index, a_len, keep_from);
+}
+
+/**
+ *Gets the length of the utf8 input. A streamed input
+ *gets decoded up to its end.
+ *@param a_this the current instance of #CRInput.
+ *@return the length of the input, in bytes.
+ */
+static gulong
+get_input_len (CRInput const * a_this)
+{
+        CRInputPriv *priv = PRIVATE (a_this);
+
+        while (priv->decode && priv->raw_index < priv->raw_len) {
+                if (decode_chunk (a_this, priv->nb_bytes) == FALSE)
+                        break;
+        }
+        return priv->nb_bytes;
+}
+
 /****************
  *Public methods
  ***************/
@@ -117,7 +352,9 @@ cr_input_new_real (void)
  *@a_buf: the memory buffer to create the input stream from.
  *The #CRInput keeps this pointer so user should not free it !.
  *@a_len: the size of the input buffer.
- *@a_enc: the buffer's encoding.
+ *@a_enc: the buffer's encoding. If set to #CR_AUTO, the encoding
+ *is found out from the byte order mark or from the '@charset' rule
+ *at the beginning of the buffer, see cr_enc_handler_sniff_encoding ().
  *@a_free_buf: if set to TRUE, this a_buf will be freed
  *at the destruction of this instance. If set to false, it is up
  *to the caller to free it.
@@ -134,13 +371,21 @@ cr_input_new_from_buf (guchar * a_buf,
         CRInput *result = NULL;
         enum CRStatus status = CR_OK;
         CREncHandler *enc_handler = NULL;
-        gulong len = a_len;
+        gulong len = a_len,
+                bom_len = 0;
 
         g_return_val_if_fail (a_buf, NULL);
 
         result = cr_input_new_real ();
         g_return_val_if_fail (result, NULL);
 
+        if (a_enc == CR_AUTO) {
+                status = cr_enc_handler_sniff_encoding (a_buf, a_len,
+                                                        &a_enc, &bom_len);
+                if (status != CR_OK)
+                        goto error;
+        }
+
         /*transform the encoding in utf8 */
         if (a_enc != CR_UTF_8) {
                 enc_handler = cr_enc_handler_get_instance (a_enc);
@@ -165,6 +410,8 @@ cr_input_new_from_buf (guchar * a_buf,
                 PRIVATE (result)->in_buf_size = a_len;
                 PRIVATE (result)->nb_bytes = a_len;
                 PRIVATE (result)->free_in_buf = a_free_buf;
+                /*skip the utf8 byte order mark, if any*/
+                PRIVATE (result)->next_byte_index = bom_len;
         }
         PRIVATE (result)->line = 1;
         PRIVATE (result)->col =  0;
@@ -179,6 +426,90 @@ cr_input_new_from_buf (guchar * a_buf,
         return NULL;
 }
 
+/**
+ * cr_input_new_from_buf_streaming:
+ *@a_buf: the memory buffer to create the input stream from.
+ *The #CRInput keeps this pointer so user should not free it !.
+ *@a_len: the size of the input buffer.
+ *@a_enc: the buffer's encoding. #CR_AUTO is supported, as in
+ *cr_input_new_from_buf().
+ *@a_free_buf: if set to TRUE, this a_buf will be freed
+ *at the destruction of this instance. If set to false, it is up
+ *to the caller to free it.
+ *
+ *Same as cr_input_new_from_buf() but a buffer which is not
+ *in utf8 is not converted as a whole. It is decoded a chunk at a
+ *time, into a window that slides while the input is read, so
+ *that the memory used does not depend on the size of the buffer.
+ *Seeking backwards decodes again from the closest chunk.
+ *Note that the addresses returned by cr_input_get_byte_addr()
+ *are then only valid until the next read or seek, and that an
+ *invalid byte sequence ends the input instead of making the
+ *creation fail.
+ *
+ *Returns the newly built instance of #CRInput.
+ */
+CRInput *
+cr_input_new_from_buf_streaming (guchar * a_buf,
+                                 gulong a_len,
+                                 enum CREncoding a_enc,
+                                 gboolean a_free_buf)
+{
+        CRInput *result = NULL;
+        CREncHandler *enc_handler = NULL;
+        CREncInputFunc decode = NULL;
+        struct CRInputCheckpoint checkpoint;
+        enum CREncoding enc = a_enc;
+        gulong bom_len = 0;
+
+        g_return_val_if_fail (a_buf, NULL);
+
+        if (enc == CR_AUTO
+            && cr_enc_handler_sniff_encoding (a_buf, a_len, &enc,
+                                              &bom_len) != CR_OK) {
+                return NULL;
+        }
+        if (enc == CR_UTF_8) {
+                return cr_input_new_from_buf (a_buf, a_len, a_enc,
+                                              a_free_buf);
+        }
+
+        enc_handler = cr_enc_handler_get_instance (enc);
+        if (!enc_handler) {
+                return NULL;
+        }
+        decode = cr_enc_handler_get_decoder (enc_handler, a_buf, a_len,
+                                             &bom_len);
+        if (!decode) {
+                return NULL;
+        }
+
+        result = cr_input_new_real ();
+        g_return_val_if_fail (result, NULL);
+
+        PRIVATE (result)->in_buf = g_try_malloc (CR_INPUT_WINDOW_SIZE);
+        PRIVATE (result)->checkpoints =
+                g_array_new (FALSE, FALSE, sizeof (struct CRInputCheckpoint));
+        if (!PRIVATE (result)->in_buf || !PRIVATE (result)->checkpoints) {
+                cr_utils_trace_info ("Out of memory");
+                cr_input_destroy (result);
+                return NULL;
+        }
+        checkpoint.raw_index = bom_len;
+        checkpoint.index = 0;
+        g_array_append_val (PRIVATE (result)->checkpoints, checkpoint);
+
+        PRIVATE (result)->in_buf_size = CR_INPUT_WINDOW_SIZE;
+        PRIVATE (result)->decode = decode;
+        PRIVATE (result)->raw_buf = a_buf;
+        PRIVATE (result)->raw_len = a_len;
+        PRIVATE (result)->raw_index = bom_len;
+        PRIVATE (result)->free_raw_buf = a_free_buf;
+        PRIVATE (result)->line = 1;
+        PRIVATE (result)->col = 0;
+        return result;
+}
+
 /**
  * cr_input_new_from_uri:
  *@a_file_uri: the file to create *the input stream from.
@@ -291,6 +622,17 @@ cr_input_destroy (CRInput * a_this)
                         PRIVATE (a_this)->in_buf = NULL;
                 }
 
+                if (PRIVATE (a_this)->raw_buf
+                    && PRIVATE (a_this)->free_raw_buf) {
+                        g_free (PRIVATE (a_this)->raw_buf);
+                        PRIVATE (a_this)->raw_buf = NULL;
+                }
+
+                if (PRIVATE (a_this)->checkpoints) {
+                        g_array_free (PRIVATE (a_this)->checkpoints, TRUE);
+                        PRIVATE (a_this)->checkpoints = NULL;
+                }
+
                 g_free (PRIVATE (a_this));
                 PRIVATE (a_this) = NULL;
         }
@@ -359,8 +701,9 @@ cr_input_end_of_input (CRInput const * a_this, gboolean * a_end_of_input)
         g_return_val_if_fail (a_this && PRIVATE (a_this)
                               && a_end_of_input, CR_BAD_PARAM_ERROR);
 
-        *a_end_of_input = (PRIVATE (a_this)->next_byte_index
-                           >= PRIVATE (a_this)->in_buf_size) ? TRUE : FALSE;
+        *a_end_of_input = get_window
+                (a_this, PRIVATE (a_this)->next_byte_index, 1) ?
+                FALSE : TRUE;
 
         return CR_OK;
 }
@@ -370,12 +713,24 @@ cr_input_end_of_input (CRInput const * a_this, gboolean * a_end_of_input)
  *@a_this: the current instance of #CRInput.
  *
  *Returns the number of bytes left in the input stream
- *before the end, -1 in case of error.
+ *before the end, -1 in case of error. Note that an input
+ *created by cr_input_new_from_buf_streaming() has to decode
+ *the rest of its buffer to know it.
  */
 glong
 cr_input_get_nb_bytes_left (CRInput const * a_this)
 {
+        gulong len = 0;
+
         g_return_val_if_fail (a_this && PRIVATE (a_this), -1);
+
+        if (PRIVATE (a_this)->decode) {
+                if (PRIVATE (a_this)->end_of_input)
+                        return 0;
+                len = get_input_len (a_this);
+                return PRIVATE (a_this)->next_byte_index < len ?
+                        len - PRIVATE (a_this)->next_byte_index : 0;
+        }
         g_return_val_if_fail (PRIVATE (a_this)->nb_bytes
                               <= PRIVATE (a_this)->in_buf_size, -1);
         g_return_val_if_fail (PRIVATE (a_this)->next_byte_index
@@ -409,22 +764,24 @@ cr_input_read_byte (CRInput * a_this, guchar * a_byte)
         g_return_val_if_fail (a_this && PRIVATE (a_this)
                               && a_byte, CR_BAD_PARAM_ERROR);
 
-        g_return_val_if_fail (PRIVATE (a_this)->next_byte_index <=
+        g_return_val_if_fail (PRIVATE (a_this)->decode
+                              || PRIVATE (a_this)->next_byte_index <=
                               PRIVATE (a_this)->nb_bytes, CR_BAD_PARAM_ERROR);
 
         if (PRIVATE (a_this)->end_of_input == TRUE)
                 return CR_END_OF_INPUT_ERROR;
 
-        nb_bytes_left = cr_input_get_nb_bytes_left (a_this);
+        nb_bytes_left = get_window
+                (a_this, PRIVATE (a_this)->next_byte_index, 2);
 
         if (nb_bytes_left < 1) {
                 return CR_END_OF_INPUT_ERROR;
         }
 
-        *a_byte = PRIVATE (a_this)->in_buf[PRIVATE (a_this)->next_byte_index];
+        *a_byte = PRIVATE (a_this)->in_buf[PRIVATE (a_this)->next_byte_index
+                                           - PRIVATE (a_this)->window_start];
 
-        if (PRIVATE (a_this)->nb_bytes -
-            PRIVATE (a_this)->next_byte_index < 2) {
+        if (nb_bytes_left < 2) {
                 PRIVATE (a_this)->end_of_input = TRUE;
         } else {
                 PRIVATE (a_this)->next_byte_index++;
@@ -457,7 +814,9 @@ cr_input_read_char (CRInput * a_this, guint32 * a_char)
         if (PRIVATE (a_this)->end_of_input == TRUE)
                 return CR_END_OF_INPUT_ERROR;
 
-        nb_bytes_left = cr_input_get_nb_bytes_left (a_this);
+        nb_bytes_left = get_window (a_this,
+                                    PRIVATE (a_this)->next_byte_index,
+                                    CR_INPUT_CHAR_LOOKAHEAD);
 
         if (nb_bytes_left < 1) {
                 return CR_END_OF_INPUT_ERROR;
@@ -466,7 +825,8 @@ cr_input_read_char (CRInput * a_this, guint32 * a_char)
         status = cr_utils_read_char_from_utf8_buf
                 (PRIVATE (a_this)->in_buf
                  +
-                 PRIVATE (a_this)->next_byte_index,
+                 (PRIVATE (a_this)->next_byte_index
+                  - PRIVATE (a_this)->window_start),
                  nb_bytes_left, a_char, &consumed);
 
         if (status == CR_OK) {
@@ -761,12 +1121,12 @@ cr_input_peek_char (CRInput const * a_this, guint32 * a_char)
         g_return_val_if_fail (a_this && PRIVATE (a_this)
                               && a_char, CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->next_byte_index >=
-            PRIVATE (a_this)->in_buf_size) {
+        if (PRIVATE (a_this)->end_of_input == TRUE)
                 return CR_END_OF_INPUT_ERROR;
-        }
 
-        nb_bytes_left = cr_input_get_nb_bytes_left (a_this);
+        nb_bytes_left = get_window (a_this,
+                                    PRIVATE (a_this)->next_byte_index,
+                                    CR_INPUT_CHAR_LOOKAHEAD);
 
         if (nb_bytes_left < 1) {
                 return CR_END_OF_INPUT_ERROR;
@@ -774,7 +1134,8 @@ cr_input_peek_char (CRInput const * a_this, guint32 * a_char)
 
         status = cr_utils_read_char_from_utf8_buf
                 (PRIVATE (a_this)->in_buf +
-                 PRIVATE (a_this)->next_byte_index,
+                 (PRIVATE (a_this)->next_byte_index
+                  - PRIVATE (a_this)->window_start),
                  nb_bytes_left, a_char, &consumed);
 
         return status;
@@ -812,6 +1173,8 @@ cr_input_peek_byte (CRInput const * a_this, enum CRSeekPos a_origin,
         switch (a_origin) {
 
         case CR_SEEK_CUR:
+                if (PRIVATE (a_this)->next_byte_index + a_offset < 1)
+                        return CR_END_OF_INPUT_ERROR;
                 abs_offset = PRIVATE (a_this)->next_byte_index - 1 + a_offset;
                 break;
 
@@ -820,16 +1183,17 @@ cr_input_peek_byte (CRInput const * a_this, enum CRSeekPos a_origin,
                 break;
 
         case CR_SEEK_END:
-                abs_offset = PRIVATE (a_this)->in_buf_size - 1 - a_offset;
+                abs_offset = get_input_len (a_this) - 1 - a_offset;
                 break;
 
         default:
                 return CR_BAD_PARAM_ERROR;
         }
 
-        if (abs_offset < PRIVATE (a_this)->in_buf_size) {
+        if (get_window (a_this, abs_offset, 1)) {
 
-                *a_byte = PRIVATE (a_this)->in_buf[abs_offset];
+                *a_byte = PRIVATE (a_this)->in_buf
+                        [abs_offset - PRIVATE (a_this)->window_start];
 
                 return CR_OK;
 
@@ -879,7 +1243,9 @@ cr_input_peek_byte2 (CRInput const * a_this, gulong a_offset, gboolean * a_eof)
  *from the beginning of the stream.
  *
  *Gets the memory address of the byte located at a given offset
- *in the input stream.
+ *in the input stream. For an input created by
+ *cr_input_new_from_buf_streaming(), the address is only valid
+ *until the next read or seek.
  *
  *Returns the address, otherwise NULL if an error occurred.
  */
@@ -888,11 +1254,12 @@ cr_input_get_byte_addr (CRInput * a_this, gulong a_offset)
 {
         g_return_val_if_fail (a_this && PRIVATE (a_this), NULL);
 
-        if (a_offset >= PRIVATE (a_this)->nb_bytes) {
+        if (!get_window (a_this, a_offset, 1)) {
                 return NULL;
         }
 
-        return &PRIVATE (a_this)->in_buf[a_offset];
+        return &PRIVATE (a_this)->in_buf[a_offset
+                                         - PRIVATE (a_this)->window_start];
 }
 
 /**
@@ -955,7 +1322,7 @@ cr_input_seek_index (CRInput * a_this, enum CRSeekPos a_origin, gint a_pos)
                 break;
 
         case CR_SEEK_END:
-                abs_offset = PRIVATE (a_this)->in_buf_size - 1 - a_pos;
+                abs_offset = get_input_len (a_this) - 1 - a_pos;
                 break;
 
         default:
@@ -963,7 +1330,7 @@ cr_input_seek_index (CRInput * a_this, enum CRSeekPos a_origin, gint a_pos)
         }
 
         if ((abs_offset > 0)
-            && (gulong) abs_offset < PRIVATE (a_this)->nb_bytes) {
+            && get_window (a_this, abs_offset, 1)) {
 
                 /*update the input stream's internal state */
                 PRIVATE (a_this)->next_byte_index = abs_offset + 1;
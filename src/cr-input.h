@@ -64,6 +64,10 @@ CRInput *
 cr_input_new_from_buf (guchar *a_buf, gulong a_len,
                        enum CREncoding a_enc, gboolean a_free_buf) ;
 CRInput *
+cr_input_new_from_buf_streaming (guchar *a_buf, gulong a_len,
+                                 enum CREncoding a_enc,
+                                 gboolean a_free_buf) ;
+CRInput *
 cr_input_new_from_uri (const gchar *a_file_uri, 
                        enum CREncoding a_enc) ;
 
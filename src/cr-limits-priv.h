@@ -0,0 +1,83 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+/**
+ *@file
+ *The declaration of what the parser, the tokenizer and the
+ *selection engine have spent of their limits. It is not installed.
+ */
+
+#ifndef __CR_LIMITS_PRIV_H__
+#define __CR_LIMITS_PRIV_H__
+
+#include "cr-limits.h"
+#include "cr-tknzr.h"
+
+G_BEGIN_DECLS
+
+typedef struct _CRLimitsState CRLimitsState ;
+
+/**
+ *The limits of a parser or of an engine and
+ *what has been spent of them so far.
+ *The engines of the worker threads of a parallel walk
+ *share the state of the engine that splits the document,
+ *so the counts, the steps and the status are only changed
+ *with the g_atomic_* () functions.
+ */
+struct _CRLimitsState
+{
+        CRLimits limits ;
+        gsize nb_tokens ;
+        gsize nb_match_attempts ;
+        /*only changed by the parser, which owns its state*/
+        guint depth ;
+        /*the steps left before the next look at the clock*/
+        gint nb_steps_to_check ;
+        /*an enum CRStatus. Once not CR_OK, every step fails with it*/
+        gint status ;
+        gint ref_count ;
+} ;
+
+CRLimitsState * cr_limits_state_new (CRLimits const *a_limits) ;
+
+void cr_limits_state_ref (CRLimitsState *a_this) ;
+
+gboolean cr_limits_state_unref (CRLimitsState *a_this) ;
+
+enum CRStatus cr_limits_state_get_status (CRLimitsState *a_this) ;
+
+enum CRStatus cr_limits_state_check (CRLimitsState *a_this) ;
+
+enum CRStatus cr_limits_state_step (CRLimitsState *a_this,
+                                    gsize *a_count, gulong a_max) ;
+
+enum CRStatus cr_limits_state_stop (CRLimitsState *a_this,
+                                    enum CRStatus a_status) ;
+
+void cr_limits_state_destroy (CRLimitsState *a_this) ;
+
+void cr_tknzr_set_limits (CRTknzr *a_this, CRLimitsState *a_limits) ;
+
+G_END_DECLS
+
+#endif /*__CR_LIMITS_PRIV_H__*/
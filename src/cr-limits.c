@@ -0,0 +1,229 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <string.h>
+#include "cr-limits-priv.h"
+
+/**
+ *@CRLimits:
+ *
+ *The limits that bound the work of a parser or of a selection
+ *engine fed with untrusted stylesheets or documents.
+ *The counts are checked at each token or match attempt; the
+ *deadline and the cancel flag only every check_interval of
+ *them, so that a call with limits costs about the same as
+ *one without.
+ */
+
+/**
+ * cr_limits_set_timeout:
+ *@a_this: the current instance of #CRLimits.
+ *@a_msec: the number of milliseconds from now to stop at,
+ *or zero for no deadline.
+ *
+ *Sets the deadline of @a_this.
+ */
+void
+cr_limits_set_timeout (CRLimits * a_this, gulong a_msec)
+{
+        g_return_if_fail (a_this);
+
+        if (a_msec)
+                a_this->deadline = g_get_monotonic_time ()
+                        + (gint64) a_msec * 1000;
+        else
+                a_this->deadline = 0;
+}
+
+/**
+ * cr_limits_state_new:
+ *@a_limits: the limits. They are copied.
+ *
+ *Returns a new state with nothing spent of @a_limits and
+ *a reference count of one, or NULL if the system is out of memory.
+ */
+CRLimitsState *
+cr_limits_state_new (CRLimits const * a_limits)
+{
+        CRLimitsState *result = NULL;
+
+        g_return_val_if_fail (a_limits, NULL);
+
+        result = g_try_malloc (sizeof (CRLimitsState));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (CRLimitsState));
+        memcpy (&result->limits, a_limits, sizeof (CRLimits));
+        if (!result->limits.check_interval)
+                result->limits.check_interval =
+                        CR_LIMITS_DEFAULT_CHECK_INTERVAL;
+        result->nb_steps_to_check = result->limits.check_interval;
+        result->status = CR_OK;
+        result->ref_count = 1;
+        return result;
+}
+
+/**
+ * cr_limits_state_ref:
+ *@a_this: the current instance of #CRLimitsState.
+ *
+ *Increases the reference count of @a_this, from any thread.
+ */
+void
+cr_limits_state_ref (CRLimitsState * a_this)
+{
+        g_return_if_fail (a_this);
+
+        g_atomic_int_inc (&a_this->ref_count);
+}
+
+/**
+ * cr_limits_state_unref:
+ *@a_this: the current instance of #CRLimitsState.
+ *
+ *Decreases the reference count of @a_this, and
+ *destroys it when the count reaches zero.
+ *
+ *Returns TRUE if @a_this has been destroyed, FALSE otherwise.
+ */
+gboolean
+cr_limits_state_unref (CRLimitsState * a_this)
+{
+        g_return_val_if_fail (a_this, FALSE);
+
+        if (!g_atomic_int_dec_and_test (&a_this->ref_count))
+                return FALSE;
+        cr_limits_state_destroy (a_this);
+        return TRUE;
+}
+
+/**
+ * cr_limits_state_get_status:
+ *@a_this: the current instance of #CRLimitsState.
+ *
+ *Returns CR_OK if the work may go on, or the
+ *status the work has been stopped with.
+ */
+enum CRStatus
+cr_limits_state_get_status (CRLimitsState * a_this)
+{
+        g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
+
+        return g_atomic_int_get (&a_this->status);
+}
+
+/**
+ * cr_limits_state_stop:
+ *@a_this: the current instance of #CRLimitsState.
+ *@a_status: why the work stops.
+ *
+ *Makes all the steps that follow fail. The first
+ *reason given is kept.
+ *
+ *Returns the status the steps fail with.
+ */
+enum CRStatus
+cr_limits_state_stop (CRLimitsState * a_this, enum CRStatus a_status)
+{
+        g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
+
+        g_atomic_int_compare_and_exchange (&a_this->status, CR_OK,
+                                           a_status);
+        return g_atomic_int_get (&a_this->status);
+}
+
+/**
+ * cr_limits_state_check:
+ *@a_this: the current instance of #CRLimitsState.
+ *
+ *Looks at the cancel flag and at the deadline.
+ *
+ *Returns CR_OK if the work may go on, an error code otherwise.
+ */
+enum CRStatus
+cr_limits_state_check (CRLimitsState * a_this)
+{
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
+
+        status = g_atomic_int_get (&a_this->status);
+        if (status != CR_OK)
+                return status;
+        if (a_this->limits.cancel_flag
+            && g_atomic_int_get (a_this->limits.cancel_flag))
+                return cr_limits_state_stop (a_this, CR_CANCELLED_ERROR);
+        if (a_this->limits.deadline
+            && g_get_monotonic_time () >= a_this->limits.deadline)
+                return cr_limits_state_stop (a_this,
+                                             CR_LIMIT_EXCEEDED_ERROR);
+        return CR_OK;
+}
+
+/**
+ * cr_limits_state_step:
+ *@a_this: the current instance of #CRLimitsState.
+ *@a_count: the count to increment, a field of @a_this.
+ *@a_max: the maximum of @a_count, or zero for no maximum,
+ *in which case nothing is counted.
+ *
+ *Counts a token or a match attempt, and looks at the cancel
+ *flag and at the deadline if it is time to. The threads that
+ *share @a_this spend the same count, and all stop as soon as
+ *one of them stops.
+ *
+ *Returns CR_OK if the work may go on, an error code otherwise.
+ */
+enum CRStatus
+cr_limits_state_step (CRLimitsState * a_this, gsize * a_count,
+                      gulong a_max)
+{
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_this && a_count, CR_BAD_PARAM_ERROR);
+
+        status = g_atomic_int_get (&a_this->status);
+        if (status != CR_OK)
+                return status;
+        if (a_max && (gsize) g_atomic_pointer_add (a_count, 1) >= a_max)
+                return cr_limits_state_stop (a_this,
+                                             CR_LIMIT_EXCEEDED_ERROR);
+        if (!g_atomic_int_dec_and_test (&a_this->nb_steps_to_check))
+                return CR_OK;
+        g_atomic_int_set (&a_this->nb_steps_to_check,
+                          (gint) a_this->limits.check_interval);
+        return cr_limits_state_check (a_this);
+}
+
+/**
+ * cr_limits_state_destroy:
+ *@a_this: the instance to destroy, whatever its reference count.
+ */
+void
+cr_limits_state_destroy (CRLimitsState * a_this)
+{
+        g_return_if_fail (a_this);
+
+        g_free (a_this);
+}
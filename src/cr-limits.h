@@ -0,0 +1,90 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+/**
+ *@file
+ *The declaration of the limits that bound the work
+ *of the parser and of the selection engine.
+ */
+
+#ifndef __CR_LIMITS_H__
+#define __CR_LIMITS_H__
+
+#include <glib.h>
+#include "cr-utils.h"
+
+G_BEGIN_DECLS
+
+typedef struct _CRLimits CRLimits ;
+
+/**
+ *The limits a #CRParser or a #CRSelEng stops at, see
+ *cr_parser_set_limits() and cr_sel_eng_set_limits().
+ *A field set to zero means no limit; a #CRLimits filled
+ *with zeros limits nothing.
+ *A call that reaches a count or the deadline stops and
+ *returns CR_LIMIT_EXCEEDED_ERROR; one that sees the cancel
+ *flag set stops and returns CR_CANCELLED_ERROR.
+ */
+struct _CRLimits
+{
+        /*the bytes of input the parser accepts*/
+        gulong max_bytes ;
+        /*the tokens the parser reads, backtracking included*/
+        gulong max_tokens ;
+        /*
+         *the nesting depth of the blocks, parenthesis
+         *and functions the parser goes into
+         */
+        guint max_depth ;
+        /*the simple selectors a selector is made of*/
+        guint max_selector_length ;
+        /*the selectors the engine tests against an element*/
+        gulong max_match_attempts ;
+        /*
+         *the time to stop at, as returned by
+         *g_get_monotonic_time(). See cr_limits_set_timeout().
+         */
+        gint64 deadline ;
+        /*
+         *if not NULL, set it to a non zero value with
+         *g_atomic_int_set(), from any thread, to cancel.
+         */
+        gint *cancel_flag ;
+        /*
+         *the tokens or match attempts between two looks
+         *at the deadline and at the cancel flag, or zero
+         *for CR_LIMITS_DEFAULT_CHECK_INTERVAL.
+         */
+        guint check_interval ;
+} ;
+
+/**
+ *The default of the check_interval field of #CRLimits.
+ */
+#define CR_LIMITS_DEFAULT_CHECK_INTERVAL 256
+
+void cr_limits_set_timeout (CRLimits *a_this, gulong a_msec) ;
+
+G_END_DECLS
+
+#endif /*__CR_LIMITS_H__*/
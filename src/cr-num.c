@@ -30,6 +30,8 @@
  */
 
 #include "cr-num.h"
+#include "cr-stats-priv.h"
+#include "cr-allocator-priv.h"
 #include "string.h"
 
 /**
@@ -45,7 +47,7 @@ cr_num_new (void)
 {
         CRNum *result = NULL;
 
-        result = g_try_malloc (sizeof (CRNum));
+        result = cr_allocator_alloc (sizeof (CRNum));
 
         if (result == NULL) {
                 cr_utils_trace_info ("Out of memory");
@@ -53,6 +55,7 @@ cr_num_new (void)
         }
 
         memset (result, 0, sizeof (CRNum));
+        cr_stats_count_alloc (CR_STATS_NUM);
 
         return result;
 }
@@ -309,5 +312,5 @@ cr_num_destroy (CRNum * a_this)
 {
         g_return_if_fail (a_this);
 
-        g_free (a_this);
+        cr_allocator_free (a_this);
 }
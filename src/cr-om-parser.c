@@ -35,6 +35,9 @@
 
 struct _CROMParserPriv {
         CRParser *parser;
+        CRAllocator const *allocator;
+        /*a copy of what cr_om_parser_set_limits() got, or NULL*/
+        CRLimits *limits;
 };
 
 #define PRIVATE(a_this) ((a_this)->priv)
@@ -836,6 +839,88 @@ cr_om_parser_new (CRInput * a_input)
         return NULL;
 }
 
+/**
+ * cr_om_parser_set_allocator:
+ *@a_this: the current instance of #CROMParser.
+ *@a_allocator: the allocator, or NULL to use the current
+ *allocator of the calling thread. It is not copied.
+ *
+ *Makes the parser allocate the stylesheets and cascades it
+ *builds, and all the objects they hold, with @a_allocator,
+ *which must stay valid until they are destroyed.
+ *
+ *Returns CR_OK upon successfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_om_parser_set_allocator (CROMParser * a_this,
+                            CRAllocator const * a_allocator)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->allocator = a_allocator;
+        if (PRIVATE (a_this)->parser)
+                return cr_parser_set_allocator (PRIVATE (a_this)->parser,
+                                                a_allocator);
+        return CR_OK;
+}
+
+/**
+ * cr_om_parser_set_limits:
+ *@a_this: the current instance of #CROMParser.
+ *@a_limits: the limits, or NULL to remove them. They are copied.
+ *
+ *Sets the limits of the parsing, see cr_parser_set_limits().
+ *The limits are shared by all the stylesheets parsed until
+ *they are set again: once one of the parsings stops, the
+ *ones that follow fail at once.
+ *
+ *Returns CR_OK upon successfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_om_parser_set_limits (CROMParser * a_this, CRLimits const * a_limits)
+{
+        CRLimits *limits = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
+
+        if (a_limits) {
+                limits = g_try_malloc (sizeof (CRLimits));
+                if (!limits) {
+                        cr_utils_trace_info ("Out of memory");
+                        return CR_OUT_OF_MEMORY_ERROR;
+                }
+                memcpy (limits, a_limits, sizeof (CRLimits));
+        }
+        if (PRIVATE (a_this)->limits)
+                g_free (PRIVATE (a_this)->limits);
+        PRIVATE (a_this)->limits = limits;
+        if (PRIVATE (a_this)->parser)
+                return cr_parser_set_limits (PRIVATE (a_this)->parser,
+                                             limits);
+        return CR_OK;
+}
+
+/**
+ *Destroys the stylesheet the SAC handler of a_this has
+ *built during a parsing a limit stopped.
+ */
+static void
+discard_stopped_result (CROMParser * a_this)
+{
+        CRDocHandler *sac_handler = NULL;
+        CRStyleSheet *result = NULL;
+        CRStyleSheet **resultptr = &result;
+
+        cr_parser_get_sac_handler (PRIVATE (a_this)->parser, &sac_handler);
+        if (!sac_handler
+            || cr_doc_handler_get_result (sac_handler,
+                                          (gpointer *) resultptr) != CR_OK
+            || !result)
+                return;
+        cr_doc_handler_set_result (sac_handler, NULL);
+        cr_stylesheet_destroy (result);
+}
+
 /**
  * cr_om_parser_parse_buf:
  *@a_this: the current instance of #CROMParser.
@@ -861,6 +946,11 @@ cr_om_parser_parse_buf (CROMParser * a_this,
 
         if (!PRIVATE (a_this)->parser) {
                 PRIVATE (a_this)->parser = cr_parser_new (NULL);
+                cr_parser_set_allocator (PRIVATE (a_this)->parser,
+                                         PRIVATE (a_this)->allocator);
+                if (PRIVATE (a_this)->limits)
+                        cr_parser_set_limits (PRIVATE (a_this)->parser,
+                                              PRIVATE (a_this)->limits);
         }
 
         status = cr_parser_parse_buf (PRIVATE (a_this)->parser,
@@ -881,6 +971,9 @@ cr_om_parser_parse_buf (CROMParser * a_this,
 
                 if (result)
                         *a_result = result;
+        } else if (status == CR_LIMIT_EXCEEDED_ERROR
+                   || status == CR_CANCELLED_ERROR) {
+                discard_stopped_result (a_this);
         }
 
         return status;
@@ -951,6 +1044,11 @@ cr_om_parser_parse_file (CROMParser * a_this,
         if (!PRIVATE (a_this)->parser) {
                 PRIVATE (a_this)->parser = cr_parser_new_from_file
                         (a_file_uri, a_enc);
+                cr_parser_set_allocator (PRIVATE (a_this)->parser,
+                                         PRIVATE (a_this)->allocator);
+                if (PRIVATE (a_this)->limits)
+                        cr_parser_set_limits (PRIVATE (a_this)->parser,
+                                              PRIVATE (a_this)->limits);
         }
 
         status = cr_parser_parse_file (PRIVATE (a_this)->parser,
@@ -970,6 +1068,9 @@ cr_om_parser_parse_file (CROMParser * a_this,
                 g_return_val_if_fail (status == CR_OK, status);
                 if (result)
                         *a_result = result;
+        } else if (status == CR_LIMIT_EXCEEDED_ERROR
+                   || status == CR_CANCELLED_ERROR) {
+                discard_stopped_result (a_this);
         }
 
         return status;
@@ -1041,10 +1142,14 @@ cr_om_parser_parse_paths_to_cascade (CROMParser * a_this,
         CRStyleSheet *sheets[3];
         guchar *paths[3];
         CRCascade *result = NULL;
+        CRAllocator const *prev_allocator = NULL;
         gint i = 0;
 
         g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
 
+        if (PRIVATE (a_this)->allocator)
+                prev_allocator = cr_allocator_push
+                        (PRIVATE (a_this)->allocator);
         memset (sheets, 0, sizeof (CRStyleSheet*) * 3);
         paths[0] = (guchar *) a_author_path;
         paths[1] = (guchar *) a_user_path;
@@ -1058,6 +1163,10 @@ cr_om_parser_parse_paths_to_cascade (CROMParser * a_this,
                                 cr_stylesheet_unref (sheets[i]);
                                 sheets[i] = NULL;
                         }
+                        /*a parsing that stops is no missing sheet*/
+                        if (status == CR_LIMIT_EXCEEDED_ERROR
+                            || status == CR_CANCELLED_ERROR)
+                                goto stopped;
                         continue;
                 }
         }
@@ -1067,10 +1176,22 @@ cr_om_parser_parse_paths_to_cascade (CROMParser * a_this,
                         cr_stylesheet_unref (sheets[i]);
                         sheets[i] = 0;
                 }
-                return CR_ERROR;
         }
+        if (PRIVATE (a_this)->allocator)
+                cr_allocator_pop (prev_allocator);
+        if (!result)
+                return CR_ERROR;
         *a_result = result;
         return CR_OK;
+
+ stopped:
+        for (i = 0; i < 3; i++) {
+                if (sheets[i])
+                        cr_stylesheet_unref (sheets[i]);
+        }
+        if (PRIVATE (a_this)->allocator)
+                cr_allocator_pop (prev_allocator);
+        return status;
 }
 
 /**
@@ -1130,6 +1251,11 @@ cr_om_parser_destroy (CROMParser * a_this)
                 PRIVATE (a_this)->parser = NULL;
         }
 
+        if (PRIVATE (a_this)->limits) {
+                g_free (PRIVATE (a_this)->limits);
+                PRIVATE (a_this)->limits = NULL;
+        }
+
         if (PRIVATE (a_this)) {
                 g_free (PRIVATE (a_this));
                 PRIVATE (a_this) = NULL;
@@ -57,6 +57,12 @@ struct _CROMParser
 
 CROMParser * cr_om_parser_new (CRInput *a_input) ;
 
+enum CRStatus cr_om_parser_set_allocator (CROMParser *a_this,
+                                          CRAllocator const *a_allocator) ;
+
+enum CRStatus cr_om_parser_set_limits (CROMParser *a_this,
+                                       CRLimits const *a_limits) ;
+
 
 enum CRStatus cr_om_parser_simply_parse_file (const guchar *a_file_path,
                                               enum CREncoding a_enc,
@@ -29,12 +29,17 @@
  *The definition of the #CRParser class.
  */
 
+#include "config.h"
 #include "string.h"
 #include "cr-parser.h"
 #include "cr-num.h"
 #include "cr-term.h"
 #include "cr-simple-sel.h"
 #include "cr-attr-sel.h"
+#include "cr-statement.h"
+#include "cr-trace-priv.h"
+#include "cr-stats-priv.h"
+#include "cr-limits-priv.h"
 
 /*
  *Random notes: 
@@ -130,6 +135,25 @@ struct _CRParserPriv {
         gboolean resolve_import;
         gboolean is_case_sensitive;
         gboolean use_core_grammar;
+
+        /**
+         *Whether the statistics below are gathered.
+         *See cr_parser_set_stats_enabled().
+         */
+        gboolean stats_enabled;
+        CRParserStats stats;
+
+        /**
+         *The allocator of the objects the parser builds,
+         *or NULL. See cr_parser_set_allocator().
+         */
+        CRAllocator const *allocator;
+
+        /**
+         *The limits of the parsing and what has been
+         *spent of them, or NULL. See cr_parser_set_limits().
+         */
+        CRLimitsState *limits;
 };
 
 #define PRIVATE(obj) ((obj)->priv)
@@ -608,6 +632,30 @@ cr_parser_clear_errors (CRParser * a_this)
         return CR_OK;
 }
 
+#ifndef CROCO_DISABLE_TRACEPOINTS
+/**
+ *Gets the index of the next byte the tokenizer
+ *of the parser will read, for the tracepoints.
+ *Unlike cr_tknzr_get_cur_pos(), it leaves the token
+ *cache alone, so it is one token ahead when a token
+ *has been ungot.
+ *@param a_this the current instance of #CRParser.
+ *@return the index, or 0 if there is no input.
+ */
+static gulong
+cr_parser_get_byte_index (CRParser * a_this)
+{
+        CRInput *input = NULL;
+        CRInputPos pos;
+
+        if (cr_tknzr_get_input (PRIVATE (a_this)->tknzr, &input) != CR_OK
+            || !input
+            || cr_input_get_cur_pos (input, &pos) != CR_OK)
+                return 0;
+        return pos.next_byte_index;
+}
+#endif
+
 /**
  * cr_parser_try_to_skip_spaces_and_comments:
  *@a_this: the current instance of #CRParser.
@@ -663,6 +711,53 @@ cr_parser_try_to_skip_spaces_and_comments (CRParser * a_this)
  *parsing routines
  *************************************/
 
+/**
+ *Returns TRUE if a limit stopped the parsing. The parsing
+ *routines then unwind as they do at the end of the input.
+ *@param a_this the current instance of #CRParser.
+ */
+static gboolean
+cr_parser_limits_stopped (CRParser const * a_this)
+{
+        return PRIVATE (a_this)->limits
+                && PRIVATE (a_this)->limits->status != CR_OK;
+}
+
+/**
+ *Counts a level of nesting the parser goes into against the
+ *max_depth limit. Each call that succeeds is to be followed
+ *by a call to cr_parser_leave_nesting().
+ *@param a_this the current instance of #CRParser.
+ *@return CR_OK if the parser may go deeper, an error code otherwise.
+ */
+static enum CRStatus
+cr_parser_enter_nesting (CRParser * a_this)
+{
+        CRLimitsState *limits = PRIVATE (a_this)->limits;
+
+        if (!limits)
+                return CR_OK;
+        if (limits->limits.max_depth
+            && limits->depth >= limits->limits.max_depth) {
+                cr_limits_state_stop (limits, CR_LIMIT_EXCEEDED_ERROR);
+                return CR_END_OF_INPUT_ERROR;
+        }
+        limits->depth++;
+        return CR_OK;
+}
+
+/**
+ *Ends what cr_parser_enter_nesting() started.
+ *@param a_this the current instance of #CRParser.
+ */
+static void
+cr_parser_leave_nesting (CRParser * a_this)
+{
+        /*the limits may have been set again meanwhile*/
+        if (PRIVATE (a_this)->limits && PRIVATE (a_this)->limits->depth)
+                PRIVATE (a_this)->limits->depth--;
+}
+
 /**
  *Parses a css stylesheet following the core css grammar.
  *This is mainly done for test purposes.
@@ -715,7 +810,8 @@ cr_parser_parse_stylesheet_core (CRParser * a_this)
                 cr_parser_clear_errors (a_this);
                 if (status == CR_OK) {
                         goto continue_parsing;
-                } else if (status == CR_END_OF_INPUT_ERROR) {
+                } else if (status == CR_END_OF_INPUT_ERROR
+                           || cr_parser_limits_stopped (a_this)) {
                         goto done;
                 } else {
                         goto error;
@@ -967,6 +1063,10 @@ cr_parser_parse_block_core (CRParser * a_this)
 
         g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
 
+        status = cr_parser_enter_nesting (a_this);
+        if (status != CR_OK)
+                return status;
+
         RECORD_INITIAL_POS (a_this, &init_pos);
 
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, &token);
@@ -1013,8 +1113,10 @@ cr_parser_parse_block_core (CRParser * a_this)
                 token = NULL;
         }
 
-        if (status == CR_OK)
+        if (status == CR_OK) {
+                cr_parser_leave_nesting (a_this);
                 return CR_OK;
+        }
 
       error:
         if (token) {
@@ -1023,6 +1125,7 @@ cr_parser_parse_block_core (CRParser * a_this)
         }
 
         cr_tknzr_set_cur_pos (PRIVATE (a_this)->tknzr, &init_pos);
+        cr_parser_leave_nesting (a_this);
 
         return status;
 }
@@ -1174,6 +1277,10 @@ cr_parser_parse_any_core (CRParser * a_this)
 
         g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
 
+        status = cr_parser_enter_nesting (a_this);
+        if (status != CR_OK)
+                return status;
+
         RECORD_INITIAL_POS (a_this, &init_pos);
 
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, &token1);
@@ -1292,6 +1399,7 @@ cr_parser_parse_any_core (CRParser * a_this)
                 token2 = NULL;
         }
 
+        cr_parser_leave_nesting (a_this);
         return CR_OK;
 
       error:
@@ -1307,6 +1415,7 @@ cr_parser_parse_any_core (CRParser * a_this)
         }
 
         cr_tknzr_set_cur_pos (PRIVATE (a_this)->tknzr, &init_pos);
+        cr_parser_leave_nesting (a_this);
         return status;
 }
 
@@ -1933,6 +2042,7 @@ cr_parser_parse_simple_sels (CRParser * a_this,
         CRInputPos init_pos;
         CRSimpleSel *sel = NULL;
         guint32 cur_char = 0;
+        guint length = 0;
 
         g_return_val_if_fail (a_this                               
                               && PRIVATE (a_this)
@@ -1945,6 +2055,7 @@ cr_parser_parse_simple_sels (CRParser * a_this,
         CHECK_PARSING_STATUS (status, FALSE);
 
         *a_sel = cr_simple_sel_append_simple_sel (*a_sel, sel);
+        length = 1;
 
         for (;;) {
                 guint32 next_char = 0;
@@ -1978,6 +2089,18 @@ cr_parser_parse_simple_sels (CRParser * a_this,
                         *a_sel = cr_simple_sel_append_simple_sel (*a_sel, 
                                                                   sel) ;
                 }
+                /*
+                 *past the limit, the tokenizer reports the end of
+                 *the input, which drops the ruleset being parsed.
+                 */
+                if (PRIVATE (a_this)->limits
+                    && PRIVATE (a_this)->limits->limits.max_selector_length
+                    && ++length > PRIVATE (a_this)->limits->limits.
+                    max_selector_length) {
+                        cr_limits_state_stop (PRIVATE (a_this)->limits,
+                                              CR_LIMIT_EXCEEDED_ERROR);
+                        break;
+                }
         }
         cr_parser_clear_errors (a_this);
         return CR_OK;
@@ -2137,6 +2260,10 @@ cr_parser_parse_function (CRParser * a_this,
                               && a_func_name,
                               CR_BAD_PARAM_ERROR);
 
+        status = cr_parser_enter_nesting (a_this);
+        if (status != CR_OK)
+                return status;
+
         RECORD_INITIAL_POS (a_this, &init_pos);
 
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, &token);
@@ -2174,6 +2301,7 @@ cr_parser_parse_function (CRParser * a_this,
         }
 
         cr_parser_clear_errors (a_this);
+        cr_parser_leave_nesting (a_this);
         return CR_OK;
 
       error:
@@ -2194,6 +2322,7 @@ cr_parser_parse_function (CRParser * a_this,
         }
 
         cr_tknzr_set_cur_pos (PRIVATE (a_this)->tknzr, &init_pos);
+        cr_parser_leave_nesting (a_this);
 
         return status;
 }
@@ -2691,7 +2820,8 @@ cr_parser_parse_stylesheet (CRParser * a_this)
                 token = NULL;
         }
 
-        if (status == CR_END_OF_INPUT_ERROR || status == CR_OK) {
+        if (status == CR_END_OF_INPUT_ERROR || status == CR_OK
+            || cr_parser_limits_stopped (a_this)) {
 
                 if (PRIVATE (a_this)->sac_handler
                     && PRIVATE (a_this)->sac_handler->end_document) {
@@ -2962,6 +3092,133 @@ cr_parser_get_use_core_grammar (CRParser const * a_this,
         return CR_OK;
 }
 
+/**
+ * cr_parser_set_stats_enabled:
+ *@a_this: the current instance of #CRParser.
+ *@a_enabled: whether to gather statistics.
+ *
+ *Makes the parser count the tokens it reads, the tokens it puts
+ *back, the moves of its tokenizer, the objects allocated and the
+ *time spent by cr_parser_parse() and the functions that call it.
+ *The statistics are not gathered by default; when they are not,
+ *they cost the parser nothing but a test per token.
+ *See cr_parser_get_stats().
+ *
+ *Returns CR_OK upon succesful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_parser_set_stats_enabled (CRParser * a_this, gboolean a_enabled)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->stats_enabled = a_enabled;
+        if (PRIVATE (a_this)->tknzr) {
+                cr_tknzr_set_stats (PRIVATE (a_this)->tknzr,
+                                    a_enabled == TRUE ?
+                                    &PRIVATE (a_this)->stats : NULL);
+        }
+
+        return CR_OK;
+}
+
+/**
+ * cr_parser_get_stats:
+ *@a_this: the current instance of #CRParser.
+ *@a_stats: out parameter. The statistics gathered since the
+ *last call to cr_parser_reset_stats().
+ *
+ *Returns CR_OK upon succesful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_parser_get_stats (CRParser const * a_this, CRParserStats * a_stats)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_stats, CR_BAD_PARAM_ERROR);
+
+        memcpy (a_stats, &PRIVATE (a_this)->stats, sizeof (CRParserStats));
+
+        return CR_OK;
+}
+
+/**
+ * cr_parser_reset_stats:
+ *@a_this: the current instance of #CRParser.
+ *
+ *Sets all the statistics of the parser to zero.
+ *
+ *Returns CR_OK upon succesful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_parser_reset_stats (CRParser * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
+
+        memset (&PRIVATE (a_this)->stats, 0, sizeof (CRParserStats));
+
+        return CR_OK;
+}
+
+/**
+ * cr_parser_set_allocator:
+ *@a_this: the current instance of #CRParser.
+ *@a_allocator: the allocator, or NULL to use the current
+ *allocator of the calling thread. It is not copied.
+ *
+ *Makes cr_parser_parse() and the functions that call it
+ *allocate the objects they build, and the SAC handler builds,
+ *with @a_allocator, which must stay valid until the
+ *objects are destroyed.
+ *
+ *Returns CR_OK upon succesful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_parser_set_allocator (CRParser * a_this, CRAllocator const * a_allocator)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->allocator = a_allocator;
+
+        return CR_OK;
+}
+
+/**
+ * cr_parser_set_limits:
+ *@a_this: the current instance of #CRParser.
+ *@a_limits: the limits, or NULL to remove them. They are copied.
+ *
+ *Bounds the bytes and the tokens cr_parser_parse() and the
+ *functions that call it read, the nesting depth they go
+ *into and the length of the selectors, and sets a deadline
+ *or a cancel flag they stop at.
+ *A call that stops reports the end of the document to the
+ *SAC handler and returns CR_LIMIT_EXCEEDED_ERROR or
+ *CR_CANCELLED_ERROR. The tokens are counted from the call
+ *to this function on, and so do the calls that follow a
+ *stop fail at once, until the limits are set again.
+ *
+ *Returns CR_OK upon succesful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_parser_set_limits (CRParser * a_this, CRLimits const * a_limits)
+{
+        CRLimitsState *limits = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
+
+        if (a_limits) {
+                limits = cr_limits_state_new (a_limits);
+                if (!limits)
+                        return CR_OUT_OF_MEMORY_ERROR;
+        }
+        if (PRIVATE (a_this)->limits)
+                cr_limits_state_unref (PRIVATE (a_this)->limits);
+        PRIVATE (a_this)->limits = limits;
+        if (PRIVATE (a_this)->tknzr)
+                cr_tknzr_set_limits (PRIVATE (a_this)->tknzr, limits);
+
+        return CR_OK;
+}
+
 /**
  * cr_parser_parse_file:
  *@a_this: a pointer to the current instance of #CRParser.
@@ -3341,6 +3598,8 @@ cr_parser_parse_ruleset (CRParser * a_this)
         g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
 
         RECORD_INITIAL_POS (a_this, &init_pos);
+        CR_TRACE (statement__begin, CR_TRACE_STATEMENT_BEGIN,
+                  init_pos.next_byte_index, RULESET_STMT);
 
         status = cr_parser_parse_selector (a_this, &selector);
         CHECK_PARSING_STATUS (status, FALSE);
@@ -3484,6 +3743,8 @@ cr_parser_parse_ruleset (CRParser * a_this)
         cr_parser_clear_errors (a_this);
         PRIVATE (a_this)->state = RULESET_PARSED_STATE;
 
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  cr_parser_get_byte_index (a_this), CR_OK);
         return CR_OK;
 
  error:
@@ -3510,6 +3771,8 @@ cr_parser_parse_ruleset (CRParser * a_this)
         }
 
         cr_tknzr_set_cur_pos (PRIVATE (a_this)->tknzr, &init_pos);
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  init_pos.next_byte_index, status);
 
         return status;
 }
@@ -3557,6 +3820,8 @@ cr_parser_parse_import (CRParser * a_this,
                               CR_BAD_PARAM_ERROR);
 
         RECORD_INITIAL_POS (a_this, &init_pos);
+        CR_TRACE (statement__begin, CR_TRACE_STATEMENT_BEGIN,
+                  init_pos.next_byte_index, AT_IMPORT_RULE_STMT);
 
         if (BYTE (a_this, 1, NULL) == '@'
             && BYTE (a_this, 2, NULL) == 'i'
@@ -3643,6 +3908,8 @@ cr_parser_parse_import (CRParser * a_this,
         cr_parser_clear_errors (a_this);
         PRIVATE (a_this)->state = IMPORT_PARSED_STATE;
 
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  cr_parser_get_byte_index (a_this), CR_OK);
         return CR_OK;
 
       error:
@@ -3681,6 +3948,8 @@ cr_parser_parse_import (CRParser * a_this,
         }
 
         cr_tknzr_set_cur_pos (PRIVATE (a_this)->tknzr, &init_pos);
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  init_pos.next_byte_index, status);
 
         return status;
 }
@@ -3717,6 +3986,8 @@ cr_parser_parse_media (CRParser * a_this)
                               CR_BAD_PARAM_ERROR);
 
         RECORD_INITIAL_POS (a_this, &init_pos);
+        CR_TRACE (statement__begin, CR_TRACE_STATEMENT_BEGIN,
+                  init_pos.next_byte_index, AT_MEDIA_RULE_STMT);
 
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, 
                                           &token);
@@ -3826,6 +4097,8 @@ cr_parser_parse_media (CRParser * a_this)
         cr_parser_clear_errors (a_this);
         PRIVATE (a_this)->state = MEDIA_PARSED_STATE;
 
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  cr_parser_get_byte_index (a_this), CR_OK);
         return CR_OK;
 
       error:
@@ -3852,6 +4125,8 @@ cr_parser_parse_media (CRParser * a_this)
         }
 
         cr_tknzr_set_cur_pos (PRIVATE (a_this)->tknzr, &init_pos);
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  init_pos.next_byte_index, status);
 
         return status;
 }
@@ -3886,6 +4161,8 @@ cr_parser_parse_page (CRParser * a_this)
         g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
 
         RECORD_INITIAL_POS (a_this, &init_pos);
+        CR_TRACE (statement__begin, CR_TRACE_STATEMENT_BEGIN,
+                  init_pos.next_byte_index, AT_PAGE_RULE_STMT);
 
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, 
                                           &token) ;
@@ -4080,6 +4357,8 @@ cr_parser_parse_page (CRParser * a_this)
         cr_parser_clear_errors (a_this);
         PRIVATE (a_this)->state = PAGE_PARSED_STATE;
 
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  cr_parser_get_byte_index (a_this), CR_OK);
         return CR_OK;
 
  error:
@@ -4104,6 +4383,8 @@ cr_parser_parse_page (CRParser * a_this)
                 css_expression = NULL;
         }
         cr_tknzr_set_cur_pos (PRIVATE (a_this)->tknzr, &init_pos);
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  init_pos.next_byte_index, status);
         return status;
 }
 
@@ -4135,6 +4416,8 @@ cr_parser_parse_charset (CRParser * a_this, CRString ** a_value,
                               CR_BAD_PARAM_ERROR);
 
         RECORD_INITIAL_POS (a_this, &init_pos);
+        CR_TRACE (statement__begin, CR_TRACE_STATEMENT_BEGIN,
+                  init_pos.next_byte_index, AT_CHARSET_RULE_STMT);
 
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, &token);
 
@@ -4174,6 +4457,8 @@ cr_parser_parse_charset (CRParser * a_this, CRString ** a_value,
         }
 
         PRIVATE (a_this)->state = CHARSET_PARSED_STATE;
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  cr_parser_get_byte_index (a_this), CR_OK);
         return CR_OK;
 
  error:
@@ -4194,6 +4479,8 @@ cr_parser_parse_charset (CRParser * a_this, CRString ** a_value,
         }
 
         cr_tknzr_set_cur_pos (PRIVATE (a_this)->tknzr, &init_pos);
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  init_pos.next_byte_index, status);
 
         return status;
 }
@@ -4228,6 +4515,8 @@ cr_parser_parse_font_face (CRParser * a_this)
         g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
 
         RECORD_INITIAL_POS (a_this, &init_pos);
+        CR_TRACE (statement__begin, CR_TRACE_STATEMENT_BEGIN,
+                  init_pos.next_byte_index, AT_FONT_FACE_RULE_STMT);
 
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, &token);
         ENSURE_PARSING_COND (status == CR_OK
@@ -4340,6 +4629,8 @@ cr_parser_parse_font_face (CRParser * a_this)
         }
         cr_parser_clear_errors (a_this);
         PRIVATE (a_this)->state = FONT_FACE_PARSED_STATE;
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  cr_parser_get_byte_index (a_this), CR_OK);
         return CR_OK;
 
       error:
@@ -4356,6 +4647,8 @@ cr_parser_parse_font_face (CRParser * a_this)
                 css_expression = NULL;
         }
         cr_tknzr_set_cur_pos (PRIVATE (a_this)->tknzr, &init_pos);
+        CR_TRACE (statement__end, CR_TRACE_STATEMENT_END,
+                  init_pos.next_byte_index, status);
         return status;
 }
 
@@ -4373,15 +4666,47 @@ enum CRStatus
 cr_parser_parse (CRParser * a_this)
 {
         enum CRStatus status = CR_ERROR;
+        gint64 start = 0;
+        gulong *prev_counters = NULL;
+        CRAllocator const *prev_allocator = NULL;
 
         g_return_val_if_fail (a_this && PRIVATE (a_this)
                               && PRIVATE (a_this)->tknzr, CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->use_core_grammar == FALSE) {
+        if (PRIVATE (a_this)->allocator)
+                prev_allocator = cr_allocator_push
+                        (PRIVATE (a_this)->allocator);
+        if (PRIVATE (a_this)->stats_enabled == TRUE) {
+                start = g_get_monotonic_time ();
+                prev_counters = cr_stats_push_alloc_counters
+                        (PRIVATE (a_this)->stats.nb_allocs);
+        }
+
+        CR_TRACE (parse__begin, CR_TRACE_PARSE_BEGIN,
+                  cr_parser_get_byte_index (a_this), 0);
+
+        if (PRIVATE (a_this)->limits
+            && cr_limits_state_check (PRIVATE (a_this)->limits) != CR_OK) {
+                status = PRIVATE (a_this)->limits->status;
+        } else if (PRIVATE (a_this)->use_core_grammar == FALSE) {
                 status = cr_parser_parse_stylesheet (a_this);
         } else {
                 status = cr_parser_parse_stylesheet_core (a_this);
         }
+        if (PRIVATE (a_this)->limits
+            && PRIVATE (a_this)->limits->status != CR_OK)
+                status = PRIVATE (a_this)->limits->status;
+
+        CR_TRACE (parse__end, CR_TRACE_PARSE_END,
+                  cr_parser_get_byte_index (a_this), status);
+
+        if (PRIVATE (a_this)->stats_enabled == TRUE) {
+                cr_stats_pop_alloc_counters (prev_counters);
+                PRIVATE (a_this)->stats.parse_time +=
+                        (g_get_monotonic_time () - start) / 1e6;
+        }
+        if (PRIVATE (a_this)->allocator)
+                cr_allocator_pop (prev_allocator);
 
         return status;
 }
@@ -4399,13 +4724,20 @@ cr_parser_set_tknzr (CRParser * a_this, CRTknzr * a_tknzr)
         g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
 
         if (PRIVATE (a_this)->tknzr) {
+                cr_tknzr_set_stats (PRIVATE (a_this)->tknzr, NULL);
+                cr_tknzr_set_limits (PRIVATE (a_this)->tknzr, NULL);
                 cr_tknzr_unref (PRIVATE (a_this)->tknzr);
         }
 
         PRIVATE (a_this)->tknzr = a_tknzr;
 
-        if (a_tknzr)
+        if (a_tknzr) {
                 cr_tknzr_ref (a_tknzr);
+                if (PRIVATE (a_this)->stats_enabled == TRUE)
+                        cr_tknzr_set_stats (a_tknzr,
+                                            &PRIVATE (a_this)->stats);
+                cr_tknzr_set_limits (a_tknzr, PRIVATE (a_this)->limits);
+        }
 
         return CR_OK;
 }
@@ -4500,6 +4832,8 @@ cr_parser_destroy (CRParser * a_this)
         g_return_if_fail (a_this && PRIVATE (a_this));
 
         if (PRIVATE (a_this)->tknzr) {
+                cr_tknzr_set_stats (PRIVATE (a_this)->tknzr, NULL);
+                cr_tknzr_set_limits (PRIVATE (a_this)->tknzr, NULL);
                 if (cr_tknzr_unref (PRIVATE (a_this)->tknzr) == TRUE)
                         PRIVATE (a_this)->tknzr = NULL;
         }
@@ -4514,6 +4848,11 @@ cr_parser_destroy (CRParser * a_this)
                 PRIVATE (a_this)->err_stack = NULL;
         }
 
+        if (PRIVATE (a_this)->limits) {
+                cr_limits_state_unref (PRIVATE (a_this)->limits);
+                PRIVATE (a_this)->limits = NULL;
+        }
+
         if (PRIVATE (a_this)) {
                 g_free (PRIVATE (a_this));
                 PRIVATE (a_this) = NULL;
@@ -29,6 +29,8 @@
 #include "cr-tknzr.h"
 #include "cr-utils.h"
 #include "cr-doc-handler.h"
+#include "cr-allocator.h"
+#include "cr-limits.h"
 
 G_BEGIN_DECLS
 
@@ -84,6 +86,20 @@ enum CRStatus cr_parser_set_use_core_grammar (CRParser *a_this,
 enum CRStatus cr_parser_get_use_core_grammar (CRParser const *a_this,
                                               gboolean *a_use_core_grammar) ;
 
+enum CRStatus cr_parser_set_stats_enabled (CRParser *a_this,
+                                           gboolean a_enabled) ;
+
+enum CRStatus cr_parser_get_stats (CRParser const *a_this,
+                                   CRParserStats *a_stats) ;
+
+enum CRStatus cr_parser_reset_stats (CRParser *a_this) ;
+
+enum CRStatus cr_parser_set_allocator (CRParser *a_this,
+                                       CRAllocator const *a_allocator) ;
+
+enum CRStatus cr_parser_set_limits (CRParser *a_this,
+                                    CRLimits const *a_limits) ;
+
 enum CRStatus cr_parser_parse (CRParser *a_this) ;
         
 enum CRStatus cr_parser_parse_file (CRParser *a_this, 
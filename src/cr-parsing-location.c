@@ -23,6 +23,7 @@
 
 #include <string.h>
 #include "cr-parsing-location.h"
+#include "cr-allocator-priv.h"
 
 /**
  *@CRParsingLocation:
@@ -43,7 +44,7 @@ cr_parsing_location_new (void)
 {
 	CRParsingLocation * result = NULL ;
 
-	result = g_try_malloc (sizeof (CRParsingLocation)) ;
+	result = cr_allocator_alloc (sizeof (CRParsingLocation)) ;
 	if (!result) {
 		cr_utils_trace_info ("Out of memory error") ;
 		return NULL ;
@@ -167,6 +168,6 @@ void
 cr_parsing_location_destroy (CRParsingLocation *a_this)
 {
 	g_return_if_fail (a_this) ;
-	g_free (a_this) ;
+	cr_allocator_free (a_this) ;
 }
 
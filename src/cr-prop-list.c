@@ -21,6 +21,8 @@
 
 #include <string.h>
 #include "cr-prop-list.h"
+#include "cr-stats-priv.h"
+#include "cr-allocator-priv.h"
 
 #define PRIVATE(a_obj) (a_obj)->priv
 
@@ -43,19 +45,20 @@ cr_prop_list_allocate (void)
 {
         CRPropList *result = NULL;
 
-        result = g_try_malloc (sizeof (CRPropList));
+        result = cr_allocator_alloc (sizeof (CRPropList));
         if (!result) {
                 cr_utils_trace_info ("could not allocate CRPropList");
                 return NULL;
         }
         memset (result, 0, sizeof (CRPropList));
-        PRIVATE (result) = g_try_malloc (sizeof (CRPropListPriv));
+        PRIVATE (result) = cr_allocator_alloc (sizeof (CRPropListPriv));
         if (!result) {
                 cr_utils_trace_info ("could not allocate CRPropListPriv");
-                g_free (result);
+                cr_allocator_free (result);
                 return NULL;
         }
         memset (PRIVATE (result), 0, sizeof (CRPropListPriv));
+        cr_stats_count_alloc (CR_STATS_PROP_LIST);
         return result;
 }
 
@@ -396,9 +399,9 @@ cr_prop_list_destroy (CRPropList * a_this)
                 if (tail && PRIVATE (tail))
                         PRIVATE (tail)->next = NULL;
                 PRIVATE (cur)->prev = NULL;
-                g_free (PRIVATE (cur));
+                cr_allocator_free (PRIVATE (cur));
                 PRIVATE (cur) = NULL;
-                g_free (cur);
+                cr_allocator_free (cur);
                 cur = tail;
         }
 }
@@ -22,6 +22,7 @@
  */
 
 #include "cr-pseudo.h"
+#include "cr-allocator-priv.h"
 
 /**
  *@CRPseudo:
@@ -39,7 +40,9 @@ cr_pseudo_new (void)
 {
         CRPseudo *result = NULL;
 
-        result = g_malloc0 (sizeof (CRPseudo));
+        result = cr_allocator_alloc0 (sizeof (CRPseudo));
+        if (!result)
+                cr_utils_trace_info ("Out of memory");
 
         return result;
 }
@@ -163,5 +166,5 @@ cr_pseudo_destroy (CRPseudo * a_this)
                 a_this->extra = NULL;
         }
 
-        g_free (a_this);
+        cr_allocator_free (a_this);
 }
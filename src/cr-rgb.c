@@ -29,6 +29,7 @@
 #include "cr-rgb.h"
 #include "cr-term.h"
 #include "cr-parser.h"
+#include "cr-allocator-priv.h"
 
 static const CRRgb gv_standard_colors[] = {
         {(const guchar*)"aliceblue",   240, 248, 255, FALSE, FALSE, FALSE, {0,0,0}},
@@ -193,7 +194,7 @@ cr_rgb_new (void)
 {
         CRRgb *result = NULL;
 
-        result = g_try_malloc (sizeof (CRRgb));
+        result = cr_allocator_alloc (sizeof (CRRgb));
 
         if (result == NULL) {
                 cr_utils_trace_info ("No more memory");
@@ -632,7 +633,7 @@ void
 cr_rgb_destroy (CRRgb * a_this)
 {
         g_return_if_fail (a_this);
-        g_free (a_this);
+        cr_allocator_free (a_this);
 }
 
 /**
@@ -21,8 +21,13 @@
  * See  COPYRIGHTS file for copyright informations.
  */
 
+#include "config.h"
 #include <string.h>
+#include <stdlib.h>
 #include "cr-sel-eng.h"
+#include "cr-trace-priv.h"
+#include "cr-stats-priv.h"
+#include "cr-limits-priv.h"
 
 /**
  *@CRSelEng:
@@ -54,23 +59,241 @@ struct _CRSelEngPriv {
         CRStatement *cur_stmt;
         GList *pcs_handlers;
         gint pcs_handlers_size;
+
+        /**
+         *The ancestor filter. It is only
+         *allocated during a cr_sel_eng_style_document()
+         *walk and holds the names, ids and classes of the
+         *ancestors of filtered_node.
+         */
+        guint8 *ancestor_filter;
+        xmlNode *filtered_node;
+
+        /**
+         *a cache of the ancestor hashes of the selectors
+         *evaluated during the current document walk.
+         *key => CRSimpleSel*, value => struct CRSelAncestorHashes*
+         */
+        GHashTable *sel_hashes;
+
+        /**
+         *The style sharing cache. It is only allocated
+         *during a document walk and holds the elements
+         *styled last, with their style.
+         */
+        struct CRSharedStyle *shared_styles;
+        guint shared_styles_next;
+
+        /**
+         *What, apart from its name, id, class and parent
+         *style, the style of an element depends on, given
+         *the selectors of the cascade being walked.
+         *shared_attrs holds the names of the attributes
+         *used in attribute selectors.
+         */
+        GPtrArray *shared_attrs;
+        gboolean share_first_child;
+        gboolean share_lang;
+        gboolean sharing_disabled;
+
+        /**
+         *The failures of descendant selector lookups seen
+         *during the current document walk.
+         *key => struct CRMatchMemoKey*, value => unused.
+         */
+        GHashTable *match_memo;
+
+        /**
+         *The rule tree of the current document walk.
+         *See struct CRRuleNode.
+         */
+        struct CRRuleNode *rule_tree;
+
+        /**
+         *The rule index of the cascade matched against, and the
+         *scratch arrays used to match an element, kept from one
+         *element to the other. The index points to the selectors
+         *and the statements of the sheets, which the caller may
+         *change or free between two calls: it only lives for one
+         *public call, or for one document walk.
+         */
+        struct CRRuleIndex *rule_index;
+        GPtrArray *candidates;
+        GArray *matched_rules;
+        GArray *blocks;
+
+        /**
+         *If TRUE, the inherited properties of the styles built
+         *during a document walk are only resolved when read.
+         */
+        gboolean lazy_resolution;
+
+        /**
+         *The statistics, see cr_sel_eng_set_stats_enabled().
+         *in_stats_phase is set during the outermost public
+         *call being timed; the allocations are counted in
+         *stats.nb_allocs until it returns.
+         */
+        gboolean stats_enabled;
+        CRSelEngStats stats;
+        gboolean in_stats_phase;
+        gulong *stats_prev_counters;
+
+        /**
+         *The selector profile, see
+         *cr_sel_eng_set_selector_profiling().
+         *key => CRSelector*, value => struct CRSelProfile*.
+         *nb_sel_steps counts the simple selectors tested
+         *while profiling.
+         */
+        gboolean profile_selectors;
+        GHashTable *sel_profiles;
+        gulong nb_sel_steps;
+
+        /**
+         *The allocator of the styles and property lists
+         *the engine builds, or NULL.
+         *See cr_sel_eng_set_allocator().
+         */
+        CRAllocator const *allocator;
+
+        /**
+         *The limits of the matching and what has been
+         *spent of them, or NULL. See cr_sel_eng_set_limits().
+         */
+        CRLimitsState *limits;
 } ;
 
-static gboolean class_add_sel_matches_node (CRAdditionalSel * a_add_sel,
+/**
+ *The ancestor filter is a counting bloom filter.
+ *Each counter is a byte; a counter that reaches
+ *the maximum value sticks to it so that the filter
+ *never gives false negatives.
+ */
+#define ANCESTOR_FILTER_SIZE (1 << 12)
+#define ANCESTOR_FILTER_MASK (ANCESTOR_FILTER_SIZE - 1)
+#define ANCESTOR_FILTER_COUNTER_MAX 0xff
+
+/**
+ *The max number of ancestor hashes kept per selector.
+ *Checking a few of them is enough to reject most
+ *of the selectors that can't match.
+ */
+#define SEL_MAX_ANCESTOR_HASHES 8
+
+enum CRAncestorHashKind {
+        ANCESTOR_HASH_NAME = 1,
+        ANCESTOR_HASH_ID,
+        ANCESTOR_HASH_CLASS
+};
+
+struct CRSelAncestorHashes {
+        guint len;
+        guint hashes[SEL_MAX_ANCESTOR_HASHES];
+};
+
+/**
+ *The number of elements the style sharing cache
+ *remembers. The elements that share a style are
+ *most of the time siblings that are close to
+ *each other, so a few entries are enough.
+ */
+#define STYLE_SHARING_CACHE_SIZE 16
+
+struct CRSharedStyle {
+        xmlNode *node;
+        CRStyle *style;
+};
+
+/**
+ *A key of the match memo: the selector that ends with
+ *the simple selector sel matches neither node nor any of
+ *the ancestors of node.
+ */
+struct CRMatchMemoKey {
+        CRSimpleSel *sel;
+        xmlNode *node;
+};
+
+/**
+ *The max number of entries of the match memo. It is emptied
+ *when it grows bigger, to bound the memory used by a walk.
+ */
+#define MATCH_MEMO_MAX_SIZE (1 << 16)
+
+/**
+ *A selector of the rule index, with the ruleset it belongs to.
+ */
+struct CRRuleIndexEntry {
+        CRSelector *sel;
+        CRStatement *ruleset;
+        /*the position of the ruleset in the cascade*/
+        gulong order;
+};
+
+/**
+ *The rulesets of all the sheets of a cascade, merged in
+ *cascade order. Each selector is filed under the id, a class
+ *or the element name required by its rightmost simple selector,
+ *hashed like in the ancestor filter; selectors that require
+ *none of them are universal. An element can only be matched by
+ *the selectors filed under its own id, classes and name, and
+ *by the universal ones.
+ *The index is not modified once built, so the engines of the
+ *workers of a parallel walk share the index of the main engine.
+ */
+struct CRRuleIndex {
+        gint ref_count;
+        CRCascade *cascade;
+        guint generation;
+        /*key => hash, value => GArray of struct CRRuleIndexEntry*/
+        GHashTable *buckets;
+        GArray *universal;
+};
+
+/**
+ *A ruleset matched by an element, with the specificity of the
+ *most specific of its selectors that matched.
+ */
+struct CRMatchedRule {
+        CRStatement *ruleset;
+        gulong specificity;
+        gulong order;
+};
+
+/**
+ *What the engine spent on a selector while profiling.
+ *The text and the location of the selector are copied
+ *so that the profile outlives the stylesheets.
+ */
+struct CRSelProfile {
+        gchar *text;
+        CRParsingLocation location;
+        /*the times the ancestor filter told it could not match*/
+        gulong nb_filtered;
+        /*the times it has been matched, and has matched*/
+        gulong nb_attempts;
+        gulong nb_matches;
+        /*the simple selectors tested while matching it*/
+        gulong nb_steps;
+};
+
+static gboolean class_add_sel_matches_node (CRSelEng * a_this,
+                                            CRAdditionalSel * a_add_sel,
                                             xmlNode * a_node);
 
-static gboolean id_add_sel_matches_node (CRAdditionalSel * a_add_sel,
+static gboolean id_add_sel_matches_node (CRSelEng * a_this,
+                                         CRAdditionalSel * a_add_sel,
                                          xmlNode * a_node);
 
-static gboolean attr_add_sel_matches_node (CRAdditionalSel * a_add_sel,
+static gboolean attr_add_sel_matches_node (CRSelEng * a_this,
+                                           CRAdditionalSel * a_add_sel,
                                            xmlNode * a_node);
 
 static enum CRStatus sel_matches_node_real (CRSelEng * a_this,
                                             CRSimpleSel * a_sel,
                                             xmlNode * a_node,
-                                            gboolean * a_result,
-                                            gboolean a_eval_sel_list_from_end,
-                                            gboolean a_recurse);
+                                            gboolean * a_result);
 
 static enum CRStatus cr_sel_eng_get_matched_rulesets_real (CRSelEng * a_this,
                                                            CRStyleSheet *
@@ -78,12 +301,10 @@ static enum CRStatus cr_sel_eng_get_matched_rulesets_real (CRSelEng * a_this,
                                                            xmlNode * a_node,
                                                            CRStatement **
                                                            a_rulesets,
+                                                           gulong *
+                                                           a_specificities,
                                                            gulong * a_len);
 
-static enum CRStatus put_css_properties_in_props_list (CRPropList ** a_props,
-                                                       CRStatement *
-                                                       a_ruleset);
-
 static gboolean pseudo_class_add_sel_matches_node (CRSelEng * a_this,
                                                    CRAdditionalSel *
                                                    a_add_sel,
@@ -105,10 +326,28 @@ static xmlNode *get_prev_element_node (xmlNode * a_node);
 
 static xmlNode *get_next_parent_element_node (xmlNode * a_node);
 
+static gboolean sel_may_match_ancestors (CRSelEng * a_this,
+                                         CRSimpleSel * a_sel,
+                                         xmlNode * a_node);
+
 /* Quick strcmp.  Test only for == 0 or != 0, not < 0 or > 0.  */
 #define strqcmp(str,lit,lit_len) \
   (strlen (str) != (lit_len) || memcmp (str, lit, lit_len))
 
+/**
+ *Returns the value of an attribute of a node, counting
+ *the lookup if the statistics of the engine are enabled.
+ *@return the value, to be freed with xmlFree(), or NULL
+ *if the node has no such attribute.
+ */
+static xmlChar *
+get_prop (CRSelEng * a_this, xmlNode * a_node, const xmlChar * a_name)
+{
+        if (PRIVATE (a_this)->stats_enabled == TRUE)
+                PRIVATE (a_this)->stats.nb_get_props++;
+        return xmlGetProp (a_node, a_name);
+}
+
 static gboolean
 lang_pseudo_class_handler (CRSelEng * a_this,
                            CRAdditionalSel * a_sel, xmlNode * a_node)
@@ -136,7 +375,7 @@ lang_pseudo_class_handler (CRSelEng * a_this,
             || a_sel->content.pseudo->extra->stryng->len < 2)
                 return FALSE;
         for (; node; node = get_next_parent_element_node (node)) {
-                val = xmlGetProp (node, (const xmlChar *) "lang");
+                val = get_prop (a_this, node, (const xmlChar *) "lang");
                 if (val
                     && !strqcmp ((const char *) val,
                                  a_sel->content.pseudo->extra->stryng->str,
@@ -211,11 +450,13 @@ pseudo_class_add_sel_matches_node (CRSelEng * a_this,
  *the xml node given in argument, FALSE otherwise.
  */
 static gboolean
-class_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
+class_add_sel_matches_node (CRSelEng * a_this,
+                            CRAdditionalSel * a_add_sel, xmlNode * a_node)
 {
         gboolean result = FALSE;
         xmlChar *klass = NULL,
-                *cur = NULL;
+                *cur = NULL,
+                *start = NULL;
 
         g_return_val_if_fail (a_add_sel
                               && a_add_sel->type == CLASS_ADD_SELECTOR
@@ -225,27 +466,22 @@ class_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
                               && a_node, FALSE);
 
         if (xmlHasProp (a_node, (const xmlChar *) "class")) {
-                klass = xmlGetProp (a_node, (const xmlChar *) "class");
-                for (cur = klass; cur && *cur; cur++) {
-                        while (cur && *cur
-                               && cr_utils_is_white_space (*cur) 
-                               == TRUE)
+                klass = get_prop (a_this, a_node, (const xmlChar *) "class");
+                for (cur = klass; cur && *cur && result == FALSE;) {
+                        while (*cur && cr_utils_is_white_space (*cur) == TRUE)
                                 cur++;
-
-                        if (!strncmp ((const char *) cur, 
-                                      a_add_sel->content.class_name->stryng->str,
-                                      a_add_sel->content.class_name->stryng->len)) {
-                                cur += a_add_sel->content.class_name->stryng->len;
-                                if ((cur && !*cur)
-                                    || cr_utils_is_white_space (*cur) == TRUE)
-                                        result = TRUE;
-                        } else {  /* if it doesn't match,  */
-                                /*   then skip to next whitespace character to try again */
-                                while (cur && *cur && !(cr_utils_is_white_space(*cur) == TRUE)) 
-                                        cur++;
-                        }
-                        if (cur && !*cur)
-                                break ;
+                        if (!*cur)
+                                break;
+                        for (start = cur;
+                             *cur && cr_utils_is_white_space (*cur) == FALSE;
+                             cur++) ;
+                        /*class names are whole white space separated words*/
+                        if ((gulong) (cur - start)
+                            == a_add_sel->content.class_name->stryng->len
+                            && !strncmp ((const char *) start,
+                                         a_add_sel->content.class_name->stryng->str,
+                                         cur - start))
+                                result = TRUE;
                 }
         }
         if (klass) {
@@ -263,7 +499,8 @@ class_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
  *@param a_node the xml node to consider.
  */
 static gboolean
-id_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
+id_add_sel_matches_node (CRSelEng * a_this,
+                         CRAdditionalSel * a_add_sel, xmlNode * a_node)
 {
         gboolean result = FALSE;
         xmlChar *id = NULL;
@@ -279,7 +516,7 @@ id_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
                               && a_node, FALSE);
 
         if (xmlHasProp (a_node, (const xmlChar *) "id")) {
-                id = xmlGetProp (a_node, (const xmlChar *) "id");
+                id = get_prop (a_this, a_node, (const xmlChar *) "id");
                 if (!strqcmp ((const char *) id, a_add_sel->content.id_name->stryng->str,
                               a_add_sel->content.id_name->stryng->len)) {
                         result = TRUE;
@@ -302,7 +539,8 @@ id_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
  *FALSE otherwise.
  */
 static gboolean
-attr_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
+attr_add_sel_matches_node (CRSelEng * a_this,
+                           CRAdditionalSel * a_add_sel, xmlNode * a_node)
 {
         CRAttrSel *cur_sel = NULL;
 
@@ -341,8 +579,8 @@ attr_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
                                      (const xmlChar *) cur_sel->name->stryng->str))
                                         return FALSE;
 
-                                value = xmlGetProp 
-                                        (a_node,
+                                value = get_prop
+                                        (a_this, a_node,
                                          (const xmlChar *) cur_sel->name->stryng->str);
 
                                 if (value
@@ -368,8 +606,8 @@ attr_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
                                     (a_node, 
                                      (const xmlChar *) cur_sel->name->stryng->str))
                                         return FALSE;
-                                value = xmlGetProp 
-                                        (a_node,
+                                value = get_prop
+                                        (a_this, a_node,
                                          (const xmlChar *) cur_sel->name->stryng->str);
 
                                 if (!value)
@@ -431,8 +669,8 @@ attr_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
                                     (a_node, 
                                      (const xmlChar *) cur_sel->name->stryng->str))
                                         return FALSE;
-                                value = xmlGetProp 
-                                        (a_node,
+                                value = get_prop
+                                        (a_this, a_node,
                                          (const xmlChar *) cur_sel->name->stryng->str);
 
                                 /*
@@ -507,7 +745,7 @@ additional_selector_matches_node (CRSelEng * a_this,
                     && cur_add_sel->content.class_name
                     && cur_add_sel->content.class_name->stryng
                     && cur_add_sel->content.class_name->stryng->str) {
-                        if (class_add_sel_matches_node (cur_add_sel,
+                        if (class_add_sel_matches_node (a_this, cur_add_sel,
                                                         a_node) == FALSE) {
                                 return FALSE;
                         }
@@ -516,7 +754,8 @@ additional_selector_matches_node (CRSelEng * a_this,
                            && cur_add_sel->content.id_name
                            && cur_add_sel->content.id_name->stryng
                            && cur_add_sel->content.id_name->stryng->str) {
-                        if (id_add_sel_matches_node (cur_add_sel, a_node) == FALSE) {
+                        if (id_add_sel_matches_node (a_this, cur_add_sel,
+                                                     a_node) == FALSE) {
                                 return FALSE;
                         }
                         continue ;
@@ -527,8 +766,8 @@ additional_selector_matches_node (CRSelEng * a_this,
                          *against an attribute additionnal selector
                          *and an xml node.
                          */
-                        if (attr_add_sel_matches_node (cur_add_sel, a_node)
-                            == FALSE) {
+                        if (attr_add_sel_matches_node (a_this, cur_add_sel,
+                                                       a_node) == FALSE) {
                                 return FALSE;
                         }
                         continue ;
@@ -603,193 +842,634 @@ get_next_parent_element_node (xmlNode * a_node)
         return cur_node;
 }
 
+static guint
+ancestor_hash (const gchar * a_str, gulong a_len,
+               enum CRAncestorHashKind a_kind)
+{
+        guint hash = 5381 + a_kind;
+        gulong i = 0;
+
+        for (i = 0; i < a_len; i++) {
+                hash = (hash << 5) + hash + (guchar) a_str[i];
+        }
+        /*mix the bits so that both filter indexes are usable*/
+        hash ^= hash >> 16;
+        hash *= 0x45d9f3b;
+        hash ^= hash >> 16;
+        return hash;
+}
+
+static void
+ancestor_filter_add (guint8 * a_filter, guint a_hash)
+{
+        guint idx[2];
+        gint i = 0;
+
+        idx[0] = a_hash & ANCESTOR_FILTER_MASK;
+        idx[1] = (a_hash >> 16) & ANCESTOR_FILTER_MASK;
+        for (i = 0; i < 2; i++) {
+                if (a_filter[idx[i]] < ANCESTOR_FILTER_COUNTER_MAX)
+                        a_filter[idx[i]]++;
+        }
+}
+
+static void
+ancestor_filter_remove (guint8 * a_filter, guint a_hash)
+{
+        guint idx[2];
+        gint i = 0;
+
+        idx[0] = a_hash & ANCESTOR_FILTER_MASK;
+        idx[1] = (a_hash >> 16) & ANCESTOR_FILTER_MASK;
+        for (i = 0; i < 2; i++) {
+                if (a_filter[idx[i]]
+                    && a_filter[idx[i]] < ANCESTOR_FILTER_COUNTER_MAX)
+                        a_filter[idx[i]]--;
+        }
+}
+
+static gboolean
+ancestor_filter_may_contain (guint8 * a_filter, guint a_hash)
+{
+        return a_filter[a_hash & ANCESTOR_FILTER_MASK]
+                && a_filter[(a_hash >> 16) & ANCESTOR_FILTER_MASK];
+}
+
 /**
- *Evaluate a selector (a simple selectors list) and says
- *if it matches the xml node given in parameter.
- *The algorithm used here is the following:
- *Walk the combinator separated list of simple selectors backward, starting
- *from the end of the list. For each simple selector, looks if
- *if matches the current node.
- *
- *@param a_this the selection engine.
- *@param a_sel the simple selection list.
- *@param a_node the xml node.
- *@param a_result out parameter. Set to true if the
- *selector matches the xml node, FALSE otherwise.
- *@param a_recurse if set to TRUE, the function will walk to
- *the next simple selector (after the evaluation of the current one) 
- *and recursively evaluate it. Must be usually set to TRUE unless you
- *know what you are doing.
+ *Computes the hashes an element contributes to the
+ *ancestor filter: its name, its id and each of its classes.
+ *@param a_node the xml element node to consider.
+ *@param a_len out parameter. The number of hashes returned.
+ *@return the newly allocated array of hashes. Must be
+ *freed with g_free().
  */
-static enum CRStatus
-sel_matches_node_real (CRSelEng * a_this, CRSimpleSel * a_sel,
-                       xmlNode * a_node, gboolean * a_result,
-                       gboolean a_eval_sel_list_from_end,
-                       gboolean a_recurse)
+static guint *
+node_ancestor_hashes_new (CRSelEng * a_this, xmlNode * a_node,
+                          gulong * a_len)
+{
+        xmlChar *id = NULL,
+                *klass = NULL,
+                *cur = NULL,
+                *start = NULL;
+        guint *result = NULL;
+        gulong len = 0,
+                max = 2;
+
+        g_return_val_if_fail (a_node && a_len, NULL);
+
+        klass = get_prop (a_this, a_node, (const xmlChar *) "class");
+        if (klass)
+                max += strlen ((const char *) klass) / 2 + 1;
+        result = g_try_malloc (max * sizeof (guint));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                goto cleanup;
+        }
+        result[len++] = ancestor_hash ((const gchar *) a_node->name,
+                                       strlen ((const char *) a_node->name),
+                                       ANCESTOR_HASH_NAME);
+        id = get_prop (a_this, a_node, (const xmlChar *) "id");
+        if (id) {
+                result[len++] = ancestor_hash
+                        ((const gchar *) id, strlen ((const char *) id),
+                         ANCESTOR_HASH_ID);
+        }
+        for (cur = klass; cur && *cur && len < max;) {
+                while (*cur && cr_utils_is_white_space (*cur) == TRUE)
+                        cur++;
+                if (!*cur)
+                        break;
+                for (start = cur;
+                     *cur && cr_utils_is_white_space (*cur) == FALSE;
+                     cur++) ;
+                result[len++] = ancestor_hash ((const gchar *) start,
+                                               cur - start,
+                                               ANCESTOR_HASH_CLASS);
+        }
+
+ cleanup:
+        if (id) {
+                xmlFree (id);
+                id = NULL;
+        }
+        if (klass) {
+                xmlFree (klass);
+                klass = NULL;
+        }
+        *a_len = result ? len : 0;
+        return result;
+}
+
+static void
+sel_ancestor_hashes_add_simple_sel (struct CRSelAncestorHashes *a_hashes,
+                                    CRSimpleSel * a_sel)
+{
+        CRAdditionalSel *cur = NULL;
+
+        if ((a_sel->type_mask & TYPE_SELECTOR)
+            && a_sel->name && a_sel->name->stryng
+            && a_sel->name->stryng->str
+            && a_hashes->len < SEL_MAX_ANCESTOR_HASHES) {
+                a_hashes->hashes[a_hashes->len++] = ancestor_hash
+                        (a_sel->name->stryng->str, a_sel->name->stryng->len,
+                         ANCESTOR_HASH_NAME);
+        }
+        for (cur = a_sel->add_sel;
+             cur && a_hashes->len < SEL_MAX_ANCESTOR_HASHES;
+             cur = cur->next) {
+                if (cur->type == ID_ADD_SELECTOR
+                    && cur->content.id_name
+                    && cur->content.id_name->stryng
+                    && cur->content.id_name->stryng->str) {
+                        a_hashes->hashes[a_hashes->len++] = ancestor_hash
+                                (cur->content.id_name->stryng->str,
+                                 cur->content.id_name->stryng->len,
+                                 ANCESTOR_HASH_ID);
+                } else if (cur->type == CLASS_ADD_SELECTOR
+                           && cur->content.class_name
+                           && cur->content.class_name->stryng
+                           && cur->content.class_name->stryng->str) {
+                        a_hashes->hashes[a_hashes->len++] = ancestor_hash
+                                (cur->content.class_name->stryng->str,
+                                 cur->content.class_name->stryng->len,
+                                 ANCESTOR_HASH_CLASS);
+                }
+        }
+}
+
+/**
+ *Gets the hashes of the names, ids and classes a selector
+ *requires to be present among the ancestors of the node it
+ *matches.
+ *Every simple selector that stands on the left side of a
+ *descendant or child combinator designates an ancestor of the
+ *subject of the selector, even when a '+' combinator sits in
+ *between, because the parent of a sibling is still an ancestor.
+ *The result is cached for the duration of the document walk.
+ */
+static struct CRSelAncestorHashes *
+get_sel_ancestor_hashes (CRSelEng * a_this, CRSimpleSel * a_sel)
 {
+        struct CRSelAncestorHashes *result = NULL;
         CRSimpleSel *cur_sel = NULL;
-        xmlNode *cur_node = NULL;
 
-        g_return_val_if_fail (a_this && PRIVATE (a_this)
-                              && a_this && a_node
-                              && a_result, CR_BAD_PARAM_ERROR);
+        result = g_hash_table_lookup (PRIVATE (a_this)->sel_hashes, a_sel);
+        if (result)
+                return result;
 
-        *a_result = FALSE;
+        result = g_try_malloc (sizeof (struct CRSelAncestorHashes));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (struct CRSelAncestorHashes));
+
+        for (cur_sel = a_sel; cur_sel && cur_sel->next;
+             cur_sel = cur_sel->next) ;
+        for (; cur_sel && cur_sel->prev; cur_sel = cur_sel->prev) {
+                if (cur_sel->combinator == COMB_WS
+                    || cur_sel->combinator == COMB_GT) {
+                        sel_ancestor_hashes_add_simple_sel
+                                (result, cur_sel->prev);
+                }
+        }
+        g_hash_table_insert (PRIVATE (a_this)->sel_hashes, a_sel, result);
+        return result;
+}
+
+/**
+ *Quickly rejects the selectors that cannot match a_node
+ *because one of the names, ids or classes they require from the
+ *ancestors of a_node is not in the ancestor filter.
+ *@return FALSE if the selector cannot match a_node, TRUE if it
+ *may match it.
+ */
+static gboolean
+sel_may_match_ancestors (CRSelEng * a_this, CRSimpleSel * a_sel,
+                         xmlNode * a_node)
+{
+        struct CRSelAncestorHashes *hashes = NULL;
+        guint i = 0;
+
+        if (!PRIVATE (a_this)->ancestor_filter
+            || PRIVATE (a_this)->filtered_node != a_node)
+                return TRUE;
+
+        hashes = get_sel_ancestor_hashes (a_this, a_sel);
+        if (!hashes)
+                return TRUE;
+        for (i = 0; i < hashes->len; i++) {
+                if (ancestor_filter_may_contain
+                    (PRIVATE (a_this)->ancestor_filter,
+                     hashes->hashes[i]) == FALSE)
+                        return FALSE;
+        }
+        return TRUE;
+}
+
+static guint
+match_memo_key_hash (gconstpointer a_key)
+{
+        const struct CRMatchMemoKey *key = a_key;
+
+        return g_direct_hash (key->sel) ^ (g_direct_hash (key->node) * 31);
+}
+
+static gboolean
+match_memo_key_equal (gconstpointer a_key, gconstpointer a_other)
+{
+        const struct CRMatchMemoKey *key = a_key,
+                *other = a_other;
+
+        return key->sel == other->sel && key->node == other->node;
+}
+
+static GHashTable *
+match_memo_new (void)
+{
+        return g_hash_table_new_full (match_memo_key_hash,
+                                      match_memo_key_equal, g_free, NULL);
+}
+
+static gboolean
+match_memo_has_failed (GHashTable * a_memo, CRSimpleSel * a_sel,
+                       xmlNode * a_node)
+{
+        struct CRMatchMemoKey key;
+
+        if (!a_memo)
+                return FALSE;
+        key.sel = a_sel;
+        key.node = a_node;
+        return g_hash_table_lookup_extended (a_memo, &key, NULL, NULL);
+}
 
+static void
+match_memo_add_failure (GHashTable * a_memo, CRSimpleSel * a_sel,
+                        xmlNode * a_node)
+{
+        struct CRMatchMemoKey *key = NULL;
+
+        key = g_try_malloc (sizeof (struct CRMatchMemoKey));
+        if (!key)
+                return;
+        key->sel = a_sel;
+        key->node = a_node;
+        if (g_hash_table_size (a_memo) >= MATCH_MEMO_MAX_SIZE)
+                g_hash_table_remove_all (a_memo);
+        g_hash_table_insert (a_memo, key, NULL);
+}
+
+/**
+ *Tests if a simple selector, regardless of the
+ *ones that precede it, matches a_node.
+ */
+static gboolean
+simple_sel_matches_node (CRSelEng * a_this, CRSimpleSel * a_sel,
+                         xmlNode * a_node)
+{
         if (a_node->type != XML_ELEMENT_NODE)
-                return CR_OK;
+                return FALSE;
 
-        if (a_eval_sel_list_from_end == TRUE) {
-                /*go and get the last simple selector of the list */
-                for (cur_sel = a_sel;
-                     cur_sel && cur_sel->next; cur_sel = cur_sel->next) ;
-        } else {
-                cur_sel = a_sel;
+        if (((a_sel->type_mask & TYPE_SELECTOR)
+             && (a_sel->name
+                 && a_sel->name->stryng
+                 && a_sel->name->stryng->str)
+             && (!strcmp (a_sel->name->stryng->str,
+                          (const char *) a_node->name)))
+            || (a_sel->type_mask & UNIVERSAL_SELECTOR)) {
+                if (!a_sel->add_sel)
+                        return TRUE;
+                return additional_selector_matches_node
+                        (a_this, a_sel->add_sel, a_node);
+        }
+        if (!(a_sel->type_mask & TYPE_SELECTOR)
+            && !(a_sel->type_mask & UNIVERSAL_SELECTOR)
+            && a_sel->add_sel) {
+                return additional_selector_matches_node
+                        (a_this, a_sel->add_sel, a_node);
         }
+        return FALSE;
+}
 
-        for (cur_node = a_node; cur_sel; cur_sel = cur_sel->prev) {
-                if (((cur_sel->type_mask & TYPE_SELECTOR)
-                     && (cur_sel->name 
-                         && cur_sel->name->stryng
-                         && cur_sel->name->stryng->str)
-                     && (!strcmp (cur_sel->name->stryng->str,
-                                  (const char *) cur_node->name)))
-                    || (cur_sel->type_mask & UNIVERSAL_SELECTOR)) {
-                        /*
-                         *this simple selector
-                         *matches the current xml node
-                         *Let's see if the preceding
-                         *simple selectors also match
-                         *their xml node counterpart.
-                         */
-                        if (cur_sel->add_sel) {
-                                if (additional_selector_matches_node (a_this, cur_sel->add_sel, 
-                                                                      cur_node) == TRUE) {
-                                        goto walk_a_step_in_expr;
-                                } else {
-                                        goto done;
-                                }
-                        } else {
-                                goto walk_a_step_in_expr;
-                        }                                
-                } 
-                if (!(cur_sel->type_mask & TYPE_SELECTOR)
-                    && !(cur_sel->type_mask & UNIVERSAL_SELECTOR)) {
-                        if (!cur_sel->add_sel) {
-                                goto done;
-                        }
-                        if (additional_selector_matches_node
-                            (a_this, cur_sel->add_sel, cur_node)
-                            == TRUE) {
-                                goto walk_a_step_in_expr;
-                        } else {
-                                goto done;
-                        }
-                } else {
-                        goto done ;
-                }
+static gboolean sel_matches_ancestor (CRSelEng * a_this,
+                                      CRSimpleSel * a_sel,
+                                      xmlNode * a_node,
+                                      GHashTable ** a_memo);
 
-        walk_a_step_in_expr:
-                if (a_recurse == FALSE) {
-                        *a_result = TRUE;
-                        goto done;
+/**
+ *Tests if the selector that ends with the simple
+ *selector a_sel matches a_node.
+ *The simple selectors are evaluated from a_sel backward,
+ *following the combinators up and back in the xml tree.
+ *@param a_reached_by the combinator a_node has been reached
+ *by, NO_COMBINATOR if it is the element being matched. Only
+ *used by the statistics.
+ *@param a_memo the failures of the descendant selector
+ *lookups. If *a_memo is NULL, it is allocated when the
+ *first failure is recorded.
+ */
+static gboolean
+sel_matches_node_from (CRSelEng * a_this, CRSimpleSel * a_sel,
+                       xmlNode * a_node, enum Combinator a_reached_by,
+                       GHashTable ** a_memo)
+{
+        CRSimpleSel *cur_sel = NULL;
+        xmlNode *cur_node = a_node;
+        enum Combinator reached_by = a_reached_by;
+        gboolean matches = FALSE;
+
+        for (cur_sel = a_sel; cur_sel; cur_sel = cur_sel->prev) {
+                matches = simple_sel_matches_node (a_this, cur_sel,
+                                                   cur_node);
+                if (PRIVATE (a_this)->profile_selectors == TRUE)
+                        PRIVATE (a_this)->nb_sel_steps++;
+                if (PRIVATE (a_this)->stats_enabled == TRUE) {
+                        PRIVATE (a_this)->stats.nb_match_attempts
+                                [reached_by]++;
+                        if (matches == TRUE)
+                                PRIVATE (a_this)->stats.nb_match_hits
+                                        [reached_by]++;
                 }
+                if (matches == FALSE)
+                        return FALSE;
+                if (!cur_sel->prev)
+                        return TRUE;
 
                 /*
                  *here, depending on the combinator of cur_sel
                  *choose the axis of the xml tree traversal
                  *and walk one step in the xml tree.
                  */
-                if (!cur_sel->prev)
-                        break;
-
                 switch (cur_sel->combinator) {
                 case NO_COMBINATOR:
                         break;
 
                 case COMB_WS:  /*descendant selector */
-                {
-                        xmlNode *n = NULL;
-                        enum CRStatus status = CR_OK;
-                        gboolean matches = FALSE;
-
-                        /*
-                         *walk the xml tree upward looking for a parent
-                         *node that matches the preceding selector.
-                         */
-                        for (n = cur_node->parent; n; n = n->parent) {
-                                status = sel_matches_node_real
-                                        (a_this, cur_sel->prev,
-                                         n, &matches, FALSE, TRUE);
-
-                                if (status != CR_OK)
-                                        goto done;
-
-                                if (matches == TRUE) {
-                                        cur_node = n ;
-                                        break;
-                                }
-                        }
-
-                        if (!n) {
-                                /*
-                                 *didn't find any ancestor that matches
-                                 *the previous simple selector.
-                                 */
-                                goto done;
-                        }
                         /*
-                         *in this case, the preceding simple sel
-                         *will have been interpreted twice, which
-                         *is a cpu and mem waste ... I need to find
-                         *another way to do this. Anyway, this is
-                         *my first attempt to write this function and
-                         *I am a bit clueless.
+                         *the preceding simple selectors may match
+                         *any ancestor: this is where we backtrack.
                          */
-                        break;
-                }
+                        return sel_matches_ancestor (a_this, cur_sel->prev,
+                                                     cur_node, a_memo);
 
                 case COMB_PLUS:
                         cur_node = get_prev_element_node (cur_node);
                         if (!cur_node)
-                                goto done;
+                                return FALSE;
+                        reached_by = COMB_PLUS;
                         break;
 
                 case COMB_GT:
                         cur_node = get_next_parent_element_node (cur_node);
                         if (!cur_node)
-                                goto done;
+                                return FALSE;
+                        reached_by = COMB_GT;
                         break;
 
                 default:
-                        goto done;
+                        return FALSE;
                 }
-                continue;
         }
-
-        /*
-         *if we reached this point, it means the selector matches
-         *the xml node.
-         */
-        *a_result = TRUE;
-
- done:
-        return CR_OK;
+        return TRUE;
 }
 
-
 /**
- *Returns  array of the ruleset statements that matches the
- *given xml node.
- *The engine keeps in memory the last statement he
- *visited during the match. So, the next call
+ *Tests if the selector that ends with the simple
+ *selector a_sel matches an ancestor of a_node.
+ *The ancestors are tried from the parent of a_node up to the
+ *root. When none of them matches, the failure is recorded for
+ *each of them, so that no other lookup of the walk tries
+ *them again: this keeps the matching of chains of descendant
+ *selectors linear in the depth of the tree.
+ */
+static gboolean
+sel_matches_ancestor (CRSelEng * a_this, CRSimpleSel * a_sel,
+                      xmlNode * a_node, GHashTable ** a_memo)
+{
+        xmlNode *cur_node = NULL,
+                *stop_node = NULL;
+
+        for (cur_node = a_node->parent; cur_node;
+             cur_node = cur_node->parent) {
+                if (cur_node->type != XML_ELEMENT_NODE)
+                        continue;
+                if (match_memo_has_failed (*a_memo, a_sel, cur_node)) {
+                        stop_node = cur_node;
+                        break;
+                }
+                if (sel_matches_node_from (a_this, a_sel, cur_node,
+                                           COMB_WS, a_memo) == TRUE)
+                        return TRUE;
+        }
+
+        if (!*a_memo) {
+                *a_memo = match_memo_new ();
+        }
+        for (cur_node = a_node->parent; cur_node != stop_node;
+             cur_node = cur_node->parent) {
+                if (cur_node->type != XML_ELEMENT_NODE)
+                        continue;
+                match_memo_add_failure (*a_memo, a_sel, cur_node);
+        }
+        return FALSE;
+}
+
+/**
+ *Evaluate a selector (a simple selectors list) and says
+ *if it matches the xml node given in parameter.
+ *The algorithm used here is the following:
+ *Walk the combinator separated list of simple selectors backward, starting
+ *from the end of the list. For each simple selector, looks if
+ *if matches the current node. For descendant selectors, try
+ *the ancestors one after the other until the rest of the
+ *selector matches.
+ *
+ *@param a_this the selection engine.
+ *@param a_sel the simple selection list.
+ *@param a_node the xml node.
+ *@param a_result out parameter. Set to true if the
+ *selector matches the xml node, FALSE otherwise.
+ */
+static enum CRStatus
+sel_matches_node_real (CRSelEng * a_this, CRSimpleSel * a_sel,
+                       xmlNode * a_node, gboolean * a_result)
+{
+        CRSimpleSel *cur_sel = NULL;
+        GHashTable *memo = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_this && a_node
+                              && a_result, CR_BAD_PARAM_ERROR);
+
+        *a_result = FALSE;
+
+        if (a_node->type != XML_ELEMENT_NODE || !a_sel)
+                return CR_OK;
+
+        /*go and get the last simple selector of the list */
+        for (cur_sel = a_sel;
+             cur_sel && cur_sel->next; cur_sel = cur_sel->next) ;
+
+        /*
+         *outside of a document walk, the failures
+         *are only remembered for this call.
+         */
+        memo = PRIVATE (a_this)->match_memo;
+        *a_result = sel_matches_node_from (a_this, cur_sel, a_node,
+                                           NO_COMBINATOR, &memo);
+        if (!PRIVATE (a_this)->match_memo && memo) {
+                g_hash_table_destroy (memo);
+        }
+        return CR_OK;
+}
+
+static void
+sel_profile_free (gpointer a_profile)
+{
+        struct CRSelProfile *profile = a_profile;
+
+        g_free (profile->text);
+        g_free (profile);
+}
+
+/**
+ *Returns the profile of a_sel, creating it if needed.
+ *@return the profile, NULL if it could not be allocated.
+ */
+static struct CRSelProfile *
+sel_profile_get (CRSelEng * a_this, CRSelector * a_sel)
+{
+        struct CRSelProfile *result = NULL;
+
+        result = g_hash_table_lookup (PRIVATE (a_this)->sel_profiles, a_sel);
+        if (result)
+                return result;
+        result = g_try_malloc (sizeof (struct CRSelProfile));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (struct CRSelProfile));
+        result->text = (gchar *) cr_simple_sel_to_string (a_sel->simple_sel);
+        cr_parsing_location_copy (&result->location,
+                                  &a_sel->simple_sel->location);
+        g_hash_table_insert (PRIVATE (a_this)->sel_profiles, a_sel, result);
+        return result;
+}
+
+/**
+ *Tests if a selector of a ruleset matches a_node, asking the
+ *ancestor filter first, and records what it took in the
+ *selector profile if the engine is profiling.
+ *@param a_sel the selector. Only a_sel->simple_sel is
+ *tested, not the selectors that follow it in the list.
+ *@param a_result out parameter. Set to TRUE if the
+ *selector matches a_node, FALSE otherwise.
+ */
+static enum CRStatus
+selector_matches_node (CRSelEng * a_this, CRSelector * a_sel,
+                       xmlNode * a_node, gboolean * a_result)
+{
+        struct CRSelProfile *profile = NULL;
+        gulong nb_steps = 0;
+        enum CRStatus status = CR_OK;
+
+        if (PRIVATE (a_this)->limits) {
+                status = cr_limits_state_step
+                        (PRIVATE (a_this)->limits,
+                         &PRIVATE (a_this)->limits->nb_match_attempts,
+                         PRIVATE (a_this)->limits->limits.max_match_attempts);
+                if (status != CR_OK) {
+                        *a_result = FALSE;
+                        return status;
+                }
+        }
+        if (PRIVATE (a_this)->profile_selectors == TRUE)
+                profile = sel_profile_get (a_this, a_sel);
+
+        if (sel_may_match_ancestors (a_this, a_sel->simple_sel,
+                                     a_node) == FALSE) {
+                if (profile)
+                        profile->nb_filtered++;
+                *a_result = FALSE;
+                return CR_OK;
+        }
+        nb_steps = PRIVATE (a_this)->nb_sel_steps;
+        status = cr_sel_eng_matches_node (a_this, a_sel->simple_sel,
+                                          a_node, a_result);
+        if (profile) {
+                profile->nb_attempts++;
+                if (status == CR_OK && *a_result == TRUE)
+                        profile->nb_matches++;
+                profile->nb_steps += PRIVATE (a_this)->nb_sel_steps - nb_steps;
+        }
+        return status;
+}
+
+/**
+ *Adds the selector profile of a_other, the engine
+ *of a worker thread, to the one of a_this.
+ */
+static void
+sel_profile_merge (CRSelEng * a_this, CRSelEng * a_other)
+{
+        GHashTableIter iter;
+        gpointer key = NULL,
+                value = NULL;
+        struct CRSelProfile *profile = NULL,
+                *other = NULL;
+
+        g_hash_table_iter_init (&iter, PRIVATE (a_other)->sel_profiles);
+        while (g_hash_table_iter_next (&iter, &key, &value)) {
+                other = value;
+                profile = g_hash_table_lookup
+                        (PRIVATE (a_this)->sel_profiles, key);
+                if (!profile) {
+                        g_hash_table_iter_steal (&iter);
+                        g_hash_table_insert (PRIVATE (a_this)->sel_profiles,
+                                             key, other);
+                        continue;
+                }
+                profile->nb_filtered += other->nb_filtered;
+                profile->nb_attempts += other->nb_attempts;
+                profile->nb_matches += other->nb_matches;
+                profile->nb_steps += other->nb_steps;
+        }
+}
+
+/**
+ *Sorts the selector profiles by decreasing number of steps,
+ *then of attempts, then by location.
+ */
+static gint
+compare_sel_profiles (gconstpointer a_one, gconstpointer a_two)
+{
+        const struct CRSelProfile *one = *(struct CRSelProfile * const *) a_one,
+                *two = *(struct CRSelProfile * const *) a_two;
+
+        if (one->nb_steps != two->nb_steps)
+                return one->nb_steps < two->nb_steps ? 1 : -1;
+        if (one->nb_attempts != two->nb_attempts)
+                return one->nb_attempts < two->nb_attempts ? 1 : -1;
+        if (one->location.byte_offset != two->location.byte_offset)
+                return one->location.byte_offset
+                        < two->location.byte_offset ? -1 : 1;
+        return g_strcmp0 (one->text, two->text);
+}
+
+
+/**
+ *Returns  array of the ruleset statements that matches the
+ *given xml node.
+ *The engine keeps in memory the last statement he
+ *visited during the match. So, the next call
  *to this function will eventually return a rulesets list starting
  *from the last ruleset statement visited during the previous call.
  *The enable users to get matching rulesets in an incremental way.
- *Note that for each statement returned, 
- *the engine calculates the specificity of the selector
- *that matched the xml node and stores it in the "specifity" field
- *of the statement structure.
+ *A ruleset is returned once, even if several of its selectors
+ *match the xml node, along with the highest specificity of
+ *these selectors. The engine doesn't write into the stylesheet.
  *
  *@param a_sel_eng the current selection engine
  *@param a_node the xml node for which the request
@@ -799,6 +1479,10 @@ sel_matches_node_real (CRSelEng * a_this, CRSimpleSel * a_sel,
  *returned array of rulesets statements that match the xml node
  *given in parameter. The caller allocates the array before calling this
  *function.
+ *@param a_specificities out parameter. An array of the
+ *same length as a_rulesets, allocated by the caller. The specificity
+ *each returned statement has been matched with is stored at the
+ *index of the statement.
  *@param a_len in/out parameter the length (in sizeof (#CRStatement*)) 
  *of the returned array.
  *(the length of a_rulesets, more precisely).
@@ -820,22 +1504,38 @@ cr_sel_eng_get_matched_rulesets_real (CRSelEng * a_this,
                                       CRStyleSheet * a_stylesheet,
                                       xmlNode * a_node,
                                       CRStatement ** a_rulesets,
+                                      gulong * a_specificities,
                                       gulong * a_len)
 {
         CRStatement *cur_stmt = NULL;
         CRSelector *sel_list = NULL,
                 *cur_sel = NULL;
-        gboolean matches = FALSE;
+        gboolean matches = FALSE,
+                stmt_matches = FALSE;
         enum CRStatus status = CR_OK;
-        gulong i = 0;
+        gulong i = 0,
+                specificity = 0;
 
         g_return_val_if_fail (a_this
                               && a_stylesheet
-                              && a_node && a_rulesets, CR_BAD_PARAM_ERROR);
+                              && a_node && a_rulesets
+                              && a_specificities, CR_BAD_PARAM_ERROR);
+
+        if (PRIVATE (a_this)->limits) {
+                status = cr_limits_state_get_status
+                        (PRIVATE (a_this)->limits);
+                if (status != CR_OK)
+                        return status;
+        }
+
+        CR_TRACE (match__begin, CR_TRACE_MATCH_BEGIN,
+                  xmlGetLineNo (a_node), 0);
 
         if (!a_stylesheet->statements) {
                 *a_rulesets = NULL;
                 *a_len = 0;
+                CR_TRACE (match__end, CR_TRACE_MATCH_END,
+                          xmlGetLineNo (a_node), 0);
                 return CR_OK;
         }
 
@@ -905,49 +1605,57 @@ cr_sel_eng_get_matched_rulesets_real (CRSelEng * a_this,
                  *now, we have a comma separated selector list to look in.
                  *let's walk it and try to match the xml_node
                  *on each item of the list.
+                 *For the cascade computing algorithm
+                 *(which is gonna take place later)
+                 *we must keep the specificity
+                 *(css2 spec chap 6.4.1) of the most specific
+                 *selector that matched the current xml node.
                  */
+                stmt_matches = FALSE;
+                specificity = 0;
                 for (cur_sel = sel_list; cur_sel; cur_sel = cur_sel->next) {
                         if (!cur_sel->simple_sel)
                                 continue;
+                        if (stmt_matches == TRUE
+                            && cur_sel->specificity <= specificity)
+                                continue;
 
-                        status = cr_sel_eng_matches_node
-                                (a_this, cur_sel->simple_sel,
-                                 a_node, &matches);
+                        status = selector_matches_node
+                                (a_this, cur_sel, a_node, &matches);
+                        if (status == CR_LIMIT_EXCEEDED_ERROR
+                            || status == CR_CANCELLED_ERROR) {
+                                /*the next call starts over*/
+                                PRIVATE (a_this)->sheet = NULL;
+                                PRIVATE (a_this)->cur_stmt = NULL;
+                                *a_len = i;
+                                CR_TRACE (match__end, CR_TRACE_MATCH_END,
+                                          xmlGetLineNo (a_node), i);
+                                return status;
+                        }
 
                         if (status == CR_OK && matches == TRUE) {
-                                /*
-                                 *bingo!!! we found one ruleset that
-                                 *matches that fucking node.
-                                 *lets put it in the out array.
-                                 */
-
-                                if (i < *a_len) {
-                                        a_rulesets[i] = cur_stmt;
-                                        i++;
-
-                                        /*
-                                         *For the cascade computing algorithm
-                                         *(which is gonna take place later)
-                                         *we must compute the specificity
-                                         *(css2 spec chap 6.4.1) of the selector
-                                         *that matched the current xml node
-                                         *and store it in the css2 statement
-                                         *(statement == ruleset here).
-                                         */
-                                        status = cr_simple_sel_compute_specificity (cur_sel->simple_sel);
-
-                                        g_return_val_if_fail (status == CR_OK,
-                                                              CR_ERROR);
-                                        cur_stmt->specificity =
-                                                cur_sel->simple_sel->
-                                                specificity;
-                                } else
-                                {
-                                        *a_len = i;
-                                        return CR_OUTPUT_TOO_SHORT_ERROR;
-                                }
+                                stmt_matches = TRUE;
+                                specificity = cur_sel->specificity;
                         }
                 }
+                if (stmt_matches == FALSE)
+                        continue;
+
+                /*
+                 *bingo!!! we found one ruleset that
+                 *matches that fucking node.
+                 *lets put it in the out array.
+                 */
+                if (i < *a_len) {
+                        a_rulesets[i] = cur_stmt;
+                        a_specificities[i] = specificity;
+                        i++;
+                } else {
+                        *a_len = i;
+                        CR_TRACE (match__end, CR_TRACE_MATCH_END,
+                                  xmlGetLineNo (a_node), i);
+                        return CR_OUTPUT_TOO_SHORT_ERROR;
+                }
         }
 
         /*
@@ -959,239 +1667,1681 @@ cr_sel_eng_get_matched_rulesets_real (CRSelEng * a_this,
         g_return_val_if_fail (!PRIVATE (a_this)->cur_stmt, CR_ERROR);
         PRIVATE (a_this)->sheet = NULL;
         *a_len = i;
+        CR_TRACE (match__end, CR_TRACE_MATCH_END, xmlGetLineNo (a_node), i);
         return CR_OK;
 }
 
-static enum CRStatus
-put_css_properties_in_props_list (CRPropList ** a_props, CRStatement * a_stmt)
+static void
+rule_index_bucket_free (gpointer a_bucket)
 {
-        CRPropList *props = NULL,
-                *pair = NULL,
-                *tmp_props = NULL;
-        CRDeclaration *cur_decl = NULL;
-
-        g_return_val_if_fail (a_props && a_stmt
-                              && a_stmt->type == RULESET_STMT
-                              && a_stmt->kind.ruleset, CR_BAD_PARAM_ERROR);
-
-        props = *a_props;
-
-        for (cur_decl = a_stmt->kind.ruleset->decl_list;
-             cur_decl; cur_decl = cur_decl->next) {
-                CRDeclaration *decl;
-
-                decl = NULL;
-                pair = NULL;
-
-                if (!cur_decl->property 
-                    || !cur_decl->property->stryng
-                    || !cur_decl->property->stryng->str)
-                        continue;
-                /*
-                 *First, test if the property is not
-                 *already present in our properties list
-                 *If yes, apply the cascading rules to
-                 *compute the precedence. If not, insert
-                 *the property into the list
-                 */
-                cr_prop_list_lookup_prop (props,
-                                          cur_decl->property, 
-                                          &pair);
-
-                if (!pair) {
-                        tmp_props = cr_prop_list_append2
-                                (props, cur_decl->property, cur_decl);
-                        if (tmp_props) {
-                                props = tmp_props;
-                                tmp_props = NULL;
-                        }
-                        continue;
-                }
-
-                /*
-                 *A property with the same name already exists.
-                 *We must apply here 
-                 *some cascading rules
-                 *to compute the precedence.
-                 */
-                cr_prop_list_get_decl (pair, &decl);
-                g_return_val_if_fail (decl, CR_ERROR);
-
-                /*
-                 *first, look at the origin.
-                 *6.4.1 says: 
-                 *"for normal declarations, 
-                 *author style sheets override user 
-                 *style sheets which override 
-                 *the default style sheet."
-                 */
-                if (decl->parent_statement
-                    && decl->parent_statement->parent_sheet
-                    && (decl->parent_statement->parent_sheet->origin
-                        < a_stmt->parent_sheet->origin)) {
-                        /*
-                         *if the already selected declaration
-                         *is marked as being !important the current
-                         *declaration must not overide it 
-                         *(unless the already selected declaration 
-                         *has an UA origin)
-                         */
-                        if (decl->important == TRUE
-                            && decl->parent_statement->parent_sheet->origin
-                            != ORIGIN_UA) {
-                                continue;
-                        }
-                        tmp_props = cr_prop_list_unlink (props, pair);
-                        if (props) {
-                                cr_prop_list_destroy (pair);
-                        }
-                        props = tmp_props;
-                        tmp_props = NULL;
-                        props = cr_prop_list_append2
-                                (props, cur_decl->property, cur_decl);
+        g_array_free (a_bucket, TRUE);
+}
 
-                        continue;
-                } else if (decl->parent_statement
-                           && decl->parent_statement->parent_sheet
-                           && (decl->parent_statement->
-                               parent_sheet->origin
-                               > a_stmt->parent_sheet->origin)) {
-                        cr_utils_trace_info
-                                ("We should not reach this line\n");
-                        continue;
+/**
+ *Computes the key a selector is filed under in the rule index.
+ *@param a_sel the selector to consider.
+ *@param a_key out parameter. The key.
+ *@return TRUE if the selector has a key, FALSE if it is universal.
+ */
+static gboolean
+rule_index_get_key (CRSelector * a_sel, guint * a_key)
+{
+        CRSimpleSel *sel = NULL;
+        CRAdditionalSel *cur = NULL;
+        CRString *klass = NULL;
+
+        for (sel = a_sel->simple_sel; sel->next; sel = sel->next) ;
+
+        for (cur = sel->add_sel; cur; cur = cur->next) {
+                if (cur->type == ID_ADD_SELECTOR
+                    && cur->content.id_name
+                    && cur->content.id_name->stryng
+                    && cur->content.id_name->stryng->str) {
+                        *a_key = ancestor_hash
+                                (cur->content.id_name->stryng->str,
+                                 cur->content.id_name->stryng->len,
+                                 ANCESTOR_HASH_ID);
+                        return TRUE;
                 }
-
-                /*
-                 *A property with the same
-                 *name and the same origin already exists.
-                 *shit. This is lasting longer than expected ...
-                 *Luckily, the spec says in 6.4.1:
-                 *"more specific selectors will override 
-                 *more general ones"
-                 *and
-                 *"if two rules have the same weight, 
-                 *origin and specificity, 
-                 *the later specified wins"
-                 */
-                if (a_stmt->specificity
-                    >= decl->parent_statement->specificity) {
-                        if (decl->important == TRUE)
-                                continue;
-                        props = cr_prop_list_unlink (props, pair);
-                        if (pair) {
-                                cr_prop_list_destroy (pair);
-                                pair = NULL;
-                        }
-                        props = cr_prop_list_append2 (props,
-                                                      cur_decl->property,
-                                                      cur_decl);
+                if (!klass && cur->type == CLASS_ADD_SELECTOR
+                    && cur->content.class_name
+                    && cur->content.class_name->stryng
+                    && cur->content.class_name->stryng->str) {
+                        klass = cur->content.class_name;
                 }
         }
-        /*TODO: this may leak. Check this out */
-        *a_props = props;
-
-        return CR_OK;
+        if (klass) {
+                *a_key = ancestor_hash (klass->stryng->str,
+                                        klass->stryng->len,
+                                        ANCESTOR_HASH_CLASS);
+                return TRUE;
+        }
+        if ((sel->type_mask & TYPE_SELECTOR)
+            && sel->name && sel->name->stryng && sel->name->stryng->str) {
+                *a_key = ancestor_hash (sel->name->stryng->str,
+                                        sel->name->stryng->len,
+                                        ANCESTOR_HASH_NAME);
+                return TRUE;
+        }
+        return FALSE;
 }
 
 static void
-set_style_from_props (CRStyle * a_style, CRPropList * a_props)
+rule_index_destroy (struct CRRuleIndex *a_this)
 {
-        CRPropList *cur = NULL;
-        CRDeclaration *decl = NULL;
-
-        for (cur = a_props; cur; cur = cr_prop_list_get_next (cur)) {
-                cr_prop_list_get_decl (cur, &decl);
-                cr_style_set_style_from_decl (a_style, decl);
-                decl = NULL;
+        if (a_this->buckets) {
+                g_hash_table_destroy (a_this->buckets);
+                a_this->buckets = NULL;
+        }
+        if (a_this->universal) {
+                g_array_free (a_this->universal, TRUE);
+                a_this->universal = NULL;
         }
+        g_free (a_this);
 }
 
-/****************************************
- *PUBLIC METHODS
- ****************************************/
+static void
+rule_index_unref (struct CRRuleIndex *a_this)
+{
+        if (g_atomic_int_dec_and_test (&a_this->ref_count))
+                rule_index_destroy (a_this);
+}
 
 /**
- * cr_sel_eng_new:
- *Creates a new instance of #CRSelEng.
- *
- *Returns the newly built instance of #CRSelEng of
- *NULL if an error occurs.
+ *Builds the rule index of a cascade.
+ *@param a_cascade the cascade to index.
+ *@return the new index, with a reference count of 1, or NULL
+ *if the system is out of memory.
  */
-CRSelEng *
-cr_sel_eng_new (void)
+static struct CRRuleIndex *
+rule_index_new (CRCascade * a_cascade)
 {
-        CRSelEng *result = NULL;
+        struct CRRuleIndex *result = NULL;
+        struct CRRuleIndexEntry entry;
+        enum CRStyleOrigin origin = 0;
+        CRStyleSheet *sheet = NULL;
+        CRStatement *cur_stmt = NULL;
+        CRSelector *cur_sel = NULL;
+        GArray *bucket = NULL;
+        gulong order = 0;
+        guint i = 0,
+                key = 0;
 
-        result = g_try_malloc (sizeof (CRSelEng));
+        result = g_try_malloc (sizeof (struct CRRuleIndex));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
-        memset (result, 0, sizeof (CRSelEng));
+        memset (result, 0, sizeof (struct CRRuleIndex));
+        result->ref_count = 1;
+        result->cascade = a_cascade;
+        result->generation = cr_cascade_get_generation (a_cascade);
+        result->buckets = g_hash_table_new_full
+                (g_direct_hash, g_direct_equal, NULL,
+                 rule_index_bucket_free);
+        result->universal = g_array_new
+                (FALSE, FALSE, sizeof (struct CRRuleIndexEntry));
 
-        PRIVATE (result) = g_try_malloc (sizeof (CRSelEngPriv));
-        if (!PRIVATE (result)) {
-                cr_utils_trace_info ("Out of memory");
-                g_free (result);
-                return NULL;
+        for (origin = ORIGIN_UA; origin < NB_ORIGINS; origin++) {
+                for (i = 0;
+                     (sheet = cr_cascade_get_sheet_nth (a_cascade, origin, i));
+                     i++) {
+                        for (cur_stmt = sheet->statements; cur_stmt;
+                             cur_stmt = cur_stmt->next) {
+                                if (cur_stmt->type != RULESET_STMT
+                                    || !cur_stmt->kind.ruleset)
+                                        continue;
+                                for (cur_sel = cur_stmt->kind.ruleset->sel_list;
+                                     cur_sel; cur_sel = cur_sel->next) {
+                                        if (!cur_sel->simple_sel)
+                                                continue;
+                                        entry.sel = cur_sel;
+                                        entry.ruleset = cur_stmt;
+                                        entry.order = order;
+                                        if (rule_index_get_key (cur_sel, &key)
+                                            == FALSE) {
+                                                g_array_append_val
+                                                        (result->universal,
+                                                         entry);
+                                                continue;
+                                        }
+                                        bucket = g_hash_table_lookup
+                                                (result->buckets,
+                                                 GUINT_TO_POINTER (key));
+                                        if (!bucket) {
+                                                bucket = g_array_new
+                                                        (FALSE, FALSE,
+                                                         sizeof (struct CRRuleIndexEntry));
+                                                g_hash_table_insert
+                                                        (result->buckets,
+                                                         GUINT_TO_POINTER (key),
+                                                         bucket);
+                                        }
+                                        g_array_append_val (bucket, entry);
+                                }
+                                order++;
+                        }
+                }
         }
-        memset (PRIVATE (result), 0, sizeof (CRSelEngPriv));
-        cr_sel_eng_register_pseudo_class_sel_handler
-                (result, (guchar *) "first-child",
-                 IDENT_PSEUDO, (CRPseudoClassSelectorHandler)
-                 first_child_pseudo_class_handler);
-        cr_sel_eng_register_pseudo_class_sel_handler
-                (result, (guchar *) "lang",
-                 FUNCTION_PSEUDO, (CRPseudoClassSelectorHandler)
-                 lang_pseudo_class_handler);
-
         return result;
 }
 
 /**
- * cr_sel_eng_register_pseudo_class_sel_handler:
- *@a_this: the current instance of #CRSelEng
- *@a_pseudo_class_sel_name: the name of the pseudo class selector.
- *@a_pseudo_class_type: the type of the pseudo class selector.
- *@a_handler: the actual handler or callback to be called during
- *the selector evaluation process.
- *
- *Adds a new handler entry in the handlers entry table.
- *
- *Returns CR_OK, upon successful completion, an error code otherwise.
+ *Returns the rule index of a_cascade, building it if the engine
+ *has none for the current generation of the cascade.
+ *The index must be dropped by release_rule_index() before the
+ *public call that needed it returns.
  */
-enum CRStatus
-cr_sel_eng_register_pseudo_class_sel_handler (CRSelEng * a_this,
-                                              guchar * a_name,
-                                              enum CRPseudoType a_type,
-                                              CRPseudoClassSelectorHandler
-                                              a_handler)
+static struct CRRuleIndex *
+get_rule_index (CRSelEng * a_this, CRCascade * a_cascade)
 {
-        struct CRPseudoClassSelHandlerEntry *handler_entry = NULL;
-        GList *list = NULL;
-
-        g_return_val_if_fail (a_this && PRIVATE (a_this)
-                              && a_handler && a_name, CR_BAD_PARAM_ERROR);
-
-        handler_entry = g_try_malloc
-                (sizeof (struct CRPseudoClassSelHandlerEntry));
-        if (!handler_entry) {
-                return CR_OUT_OF_MEMORY_ERROR;
-        }
-        memset (handler_entry, 0,
-                sizeof (struct CRPseudoClassSelHandlerEntry));
-        handler_entry->name = (guchar *) g_strdup ((const gchar *) a_name);
-        handler_entry->type = a_type;
-        handler_entry->handler = a_handler;
-        list = g_list_append (PRIVATE (a_this)->pcs_handlers, handler_entry);
-        if (!list) {
-                return CR_OUT_OF_MEMORY_ERROR;
+        struct CRRuleIndex *index = PRIVATE (a_this)->rule_index;
+
+        if (index && index->cascade == a_cascade
+            && index->generation == cr_cascade_get_generation (a_cascade))
+                return index;
+        if (index) {
+                rule_index_unref (index);
+                PRIVATE (a_this)->rule_index = NULL;
         }
-        PRIVATE (a_this)->pcs_handlers = list;
-        return CR_OK;
+        PRIVATE (a_this)->rule_index = rule_index_new (a_cascade);
+        return PRIVATE (a_this)->rule_index;
 }
 
-enum CRStatus
+/**
+ *Drops the rule index at the end of a public call, unless
+ *the call is made during a document walk, which keeps the
+ *index until style_document_walk_end().
+ */
+static void
+release_rule_index (CRSelEng * a_this)
+{
+        if (PRIVATE (a_this)->rule_tree || !PRIVATE (a_this)->rule_index)
+                return;
+        rule_index_unref (PRIVATE (a_this)->rule_index);
+        PRIVATE (a_this)->rule_index = NULL;
+}
+
+static void
+add_rule_index_candidates (GPtrArray * a_candidates, GArray * a_bucket)
+{
+        guint i = 0;
+
+        for (i = 0; a_bucket && i < a_bucket->len; i++) {
+                g_ptr_array_add (a_candidates,
+                                 &g_array_index (a_bucket,
+                                                 struct CRRuleIndexEntry, i));
+        }
+}
+
+static int
+compare_rule_index_entries (gconstpointer a_one, gconstpointer a_two)
+{
+        struct CRRuleIndexEntry const *one =
+                *(struct CRRuleIndexEntry * const *) a_one;
+        struct CRRuleIndexEntry const *two =
+                *(struct CRRuleIndexEntry * const *) a_two;
+
+        if (one->order != two->order)
+                return one->order < two->order ? -1 : 1;
+        if (one != two)
+                return one < two ? -1 : 1;
+        return 0;
+}
+
+/**
+ *Gets the rulesets of the cascade that match a_node, in
+ *cascade order.
+ *@param a_this the current selection engine.
+ *@param a_cascade the cascade to take the rulesets from.
+ *@param a_node the xml node to consider.
+ *@param a_rules out parameter. The array of struct CRMatchedRule
+ *the matched rulesets are put in. It is emptied first.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+get_matched_rules_from_index (CRSelEng * a_this, CRCascade * a_cascade,
+                              xmlNode * a_node, GArray * a_rules)
+{
+        struct CRRuleIndex *index = NULL;
+        struct CRRuleIndexEntry *entry = NULL,
+                *prev_entry = NULL;
+        struct CRMatchedRule *last_rule = NULL,
+                rule;
+        GPtrArray *candidates = PRIVATE (a_this)->candidates;
+        guint *hashes = NULL;
+        gulong nb_hashes = 0,
+                i = 0;
+        gboolean matches = FALSE;
+        enum CRStatus status = CR_OK;
+
+        g_array_set_size (a_rules, 0);
+        if (a_node->type != XML_ELEMENT_NODE)
+                return CR_OK;
+        if (PRIVATE (a_this)->limits) {
+                status = cr_limits_state_get_status
+                        (PRIVATE (a_this)->limits);
+                if (status != CR_OK)
+                        return status;
+        }
+
+        CR_TRACE (match__begin, CR_TRACE_MATCH_BEGIN,
+                  xmlGetLineNo (a_node), 0);
+        index = get_rule_index (a_this, a_cascade);
+        if (!index) {
+                status = CR_OUT_OF_MEMORY_ERROR;
+                goto cleanup;
+        }
+
+        g_ptr_array_set_size (candidates, 0);
+        hashes = node_ancestor_hashes_new (a_this, a_node, &nb_hashes);
+        if (!hashes) {
+                status = CR_OUT_OF_MEMORY_ERROR;
+                goto cleanup;
+        }
+        for (i = 0; i < nb_hashes; i++) {
+                add_rule_index_candidates
+                        (candidates,
+                         g_hash_table_lookup (index->buckets,
+                                              GUINT_TO_POINTER (hashes[i])));
+        }
+        g_free (hashes);
+        add_rule_index_candidates (candidates, index->universal);
+        /*candidates->pdata is NULL if no rule may match*/
+        if (candidates->len > 1)
+                qsort (candidates->pdata, candidates->len,
+                       sizeof (gpointer), compare_rule_index_entries);
+
+        for (i = 0; i < candidates->len; i++) {
+                entry = g_ptr_array_index (candidates, i);
+                /*an element may have the same class twice*/
+                if (entry == prev_entry)
+                        continue;
+                prev_entry = entry;
+                if (last_rule && last_rule->ruleset == entry->ruleset
+                    && entry->sel->specificity <= last_rule->specificity)
+                        continue;
+                status = selector_matches_node (a_this, entry->sel, a_node,
+                                                &matches);
+                if (status == CR_LIMIT_EXCEEDED_ERROR
+                    || status == CR_CANCELLED_ERROR)
+                        goto cleanup;
+                if (status != CR_OK || matches == FALSE) {
+                        status = CR_OK;
+                        continue;
+                }
+                if (last_rule && last_rule->ruleset == entry->ruleset) {
+                        last_rule->specificity = entry->sel->specificity;
+                        continue;
+                }
+                rule.ruleset = entry->ruleset;
+                rule.specificity = entry->sel->specificity;
+                rule.order = entry->order;
+                g_array_append_val (a_rules, rule);
+                last_rule = &g_array_index (a_rules, struct CRMatchedRule,
+                                            a_rules->len - 1);
+        }
+
+ cleanup:
+        CR_TRACE (match__end, CR_TRACE_MATCH_END,
+                  xmlGetLineNo (a_node), a_rules->len);
+        return status;
+}
+
+/**
+ *Grows the arrays of matched statements and of their
+ *specificities by a_chunck_size entries.
+ */
+static enum CRStatus
+grow_matched_tabs (CRStatement *** a_stmts, gulong ** a_specificities,
+                   gulong * a_size, gulong a_chunck_size)
+{
+        CRStatement **stmts = NULL;
+        gulong *specificities = NULL;
+
+        stmts = g_try_realloc (*a_stmts, (*a_size + a_chunck_size)
+                               * sizeof (CRStatement *));
+        if (!stmts) {
+                cr_utils_trace_info ("Out of memory");
+                return CR_ERROR;
+        }
+        *a_stmts = stmts;
+        specificities = g_try_realloc (*a_specificities,
+                                       (*a_size + a_chunck_size)
+                                       * sizeof (gulong));
+        if (!specificities) {
+                cr_utils_trace_info ("Out of memory");
+                return CR_ERROR;
+        }
+        *a_specificities = specificities;
+        *a_size += a_chunck_size;
+        return CR_OK;
+}
+
+/**
+ *The declaration that currently wins the cascade for a property.
+ */
+struct CRCascadedDecl {
+        CRDeclaration *decl;
+        /*
+         *the order in which the winners have been elected.
+         *A declaration that overrides another one is
+         *ranked after all the current winners.
+         */
+        gulong rank;
+};
+
+/**
+ *The winning declarations of the cascade for an xml node.
+ *Properties known by libcroco are indexed by their
+ *#CRPropertyID. The other ones are looked up by name in a side
+ *table that is only allocated when such a property shows up.
+ */
+struct CRCascadeTable {
+        struct CRCascadedDecl known[NB_PROP_IDS];
+        GHashTable *unknown;
+        gulong next_rank;
+};
+
+static void
+cascade_table_init (struct CRCascadeTable *a_table)
+{
+        memset (a_table, 0, sizeof (struct CRCascadeTable));
+}
+
+static void
+cascade_table_clear (struct CRCascadeTable *a_table)
+{
+        if (a_table->unknown) {
+                g_hash_table_destroy (a_table->unknown);
+                a_table->unknown = NULL;
+        }
+}
+
+/**
+ *Returns the slot of the table that holds the winning declaration
+ *of the property of a_decl, or NULL if the system is out of memory.
+ *The slot is empty if no declaration of that property has been
+ *seen yet.
+ */
+static struct CRCascadedDecl *
+cascade_table_get_slot (struct CRCascadeTable *a_table,
+                        CRDeclaration * a_decl)
+{
+        struct CRCascadedDecl *slot = NULL;
+        gchar *name = a_decl->property->stryng->str;
+
+        if (a_decl->prop_id != PROP_ID_NOT_KNOWN)
+                return &a_table->known[a_decl->prop_id];
+
+        if (!a_table->unknown) {
+                a_table->unknown = g_hash_table_new_full
+                        (g_str_hash, g_str_equal, NULL, g_free);
+                if (!a_table->unknown) {
+                        cr_utils_trace_info ("Out of memory");
+                        return NULL;
+                }
+        }
+        slot = g_hash_table_lookup (a_table->unknown, name);
+        if (slot)
+                return slot;
+        slot = g_try_malloc (sizeof (struct CRCascadedDecl));
+        if (!slot) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (slot, 0, sizeof (struct CRCascadedDecl));
+        g_hash_table_insert (a_table->unknown, name, slot);
+        return slot;
+}
+
+static void
+cascade_table_elect (struct CRCascadeTable *a_table,
+                     struct CRCascadedDecl *a_slot,
+                     CRDeclaration * a_decl)
+{
+        a_slot->decl = a_decl;
+        a_slot->rank = a_table->next_rank++;
+}
+
+/**
+ *Returns the precedence level of the declarations of a given
+ *origin and weight. 6.4.1 of the css2 spec says:
+ *"for normal declarations, author style sheets override user 
+ *style sheets which override the default style sheet. For 
+ *"!important" declarations, user style sheets override author 
+ *style sheets which override the default style sheet."
+ *!important declarations of the default (UA) style sheet have
+ *no extra weight.
+ */
+static guint
+cascade_level (enum CRStyleOrigin a_origin, gboolean a_important)
+{
+        if (a_important == FALSE || a_origin == ORIGIN_UA)
+                return a_origin;
+        if (a_origin == ORIGIN_AUTHOR)
+                return NB_ORIGINS;
+        return NB_ORIGINS + 1;
+}
+
+/**
+ *The normal or the !important declarations of a matched ruleset,
+ *with the key that gives their place in the cascade.
+ */
+struct CRCascadeBlock {
+        CRStatement *stmt;
+        gboolean important;
+        /*the sort key: level, then specificity, then source order.*/
+        guint level;
+        gulong specificity;
+        gulong order;
+};
+
+static int
+compare_cascade_blocks (gconstpointer a_one, gconstpointer a_two)
+{
+        struct CRCascadeBlock const *one = a_one;
+        struct CRCascadeBlock const *two = a_two;
+
+        if (one->level != two->level)
+                return one->level < two->level ? -1 : 1;
+        if (one->specificity != two->specificity)
+                return one->specificity < two->specificity ? -1 : 1;
+        if (one->order != two->order)
+                return one->order < two->order ? -1 : 1;
+        return 0;
+}
+
+static void
+cascade_block_init (struct CRCascadeBlock *a_block, CRStatement * a_stmt,
+                    gulong a_specificity, gulong a_order,
+                    gboolean a_important)
+{
+        a_block->stmt = a_stmt;
+        a_block->important = a_important;
+        a_block->level = cascade_level (a_stmt->parent_sheet->origin,
+                                        a_important);
+        a_block->specificity = a_specificity;
+        a_block->order = a_order;
+}
+
+/**
+ *Runs the declarations of a block through the cascade.
+ *As the blocks are put in increasing order of precedence,
+ *each declaration simply overrides the one of the same
+ *property that is already in the table.
+ *@param a_table the cascade table to update.
+ *@param a_block the block to put.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+cascade_table_put_block (struct CRCascadeTable *a_table,
+                         struct CRCascadeBlock *a_block)
+{
+        CRDeclaration *cur_decl = NULL;
+        struct CRCascadedDecl *slot = NULL;
+        gboolean is_ua = FALSE;
+
+        is_ua = a_block->stmt->parent_sheet->origin == ORIGIN_UA;
+        for (cur_decl = a_block->stmt->kind.ruleset->decl_list;
+             cur_decl; cur_decl = cur_decl->next) {
+                if (!cur_decl->property 
+                    || !cur_decl->property->stryng
+                    || !cur_decl->property->stryng->str)
+                        continue;
+                if (!is_ua && cur_decl->important != a_block->important)
+                        continue;
+                slot = cascade_table_get_slot (a_table, cur_decl);
+                if (!slot)
+                        return CR_OUT_OF_MEMORY_ERROR;
+                cascade_table_elect (a_table, slot, cur_decl);
+        }
+        return CR_OK;
+}
+
+static int
+compare_cascaded_decls_by_rank (gconstpointer a_one, gconstpointer a_two)
+{
+        struct CRCascadedDecl const *one =
+                *(struct CRCascadedDecl * const *) a_one;
+        struct CRCascadedDecl const *two =
+                *(struct CRCascadedDecl * const *) a_two;
+
+        if (one->rank < two->rank)
+                return -1;
+        return one->rank > two->rank ? 1 : 0;
+}
+
+/**
+ *Sets the properties of a_style from the declarations that
+ *won the cascade, in the order they have been elected.
+ *Properties libcroco doesn't know are not part of a #CRStyle
+ *and are skipped.
+ */
+static void
+set_style_from_cascade_table (CRStyle * a_style,
+                              struct CRCascadeTable *a_table)
+{
+        struct CRCascadedDecl *winners[NB_PROP_IDS];
+        gulong nb_winners = 0,
+                i = 0;
+
+        for (i = 0; i < NB_PROP_IDS; i++) {
+                if (a_table->known[i].decl)
+                        winners[nb_winners++] = &a_table->known[i];
+        }
+        CR_TRACE (cascade__begin, CR_TRACE_CASCADE_BEGIN, nb_winners, 0);
+        qsort (winners, nb_winners, sizeof (struct CRCascadedDecl *),
+               compare_cascaded_decls_by_rank);
+        for (i = 0; i < nb_winners; i++) {
+                cr_style_set_style_from_decl (a_style, winners[i]->decl);
+        }
+        CR_TRACE (cascade__end, CR_TRACE_CASCADE_END, nb_winners, CR_OK);
+}
+
+/**
+ *Builds the list of the declarations that won the cascade,
+ *in the order they have been elected.
+ *@param a_table the cascade table.
+ *@param a_props out parameter. The resulting list, NULL if
+ *no declaration won the cascade.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+cascade_table_to_prop_list (struct CRCascadeTable *a_table,
+                            CRPropList ** a_props)
+{
+        struct CRCascadedDecl **winners = NULL;
+        CRPropList *props = NULL,
+                *tmp_props = NULL;
+        GHashTableIter iter;
+        gpointer value = NULL;
+        gulong nb_winners = 0,
+                i = 0;
+
+        winners = g_try_malloc ((NB_PROP_IDS
+                                 + (a_table->unknown ?
+                                    g_hash_table_size (a_table->unknown) : 0))
+                                * sizeof (struct CRCascadedDecl *));
+        if (!winners) {
+                cr_utils_trace_info ("Out of memory");
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+        for (i = 0; i < NB_PROP_IDS; i++) {
+                if (a_table->known[i].decl)
+                        winners[nb_winners++] = &a_table->known[i];
+        }
+        if (a_table->unknown) {
+                g_hash_table_iter_init (&iter, a_table->unknown);
+                while (g_hash_table_iter_next (&iter, NULL, &value)) {
+                        winners[nb_winners++] = value;
+                }
+        }
+        CR_TRACE (cascade__begin, CR_TRACE_CASCADE_BEGIN, nb_winners, 0);
+        qsort (winners, nb_winners, sizeof (struct CRCascadedDecl *),
+               compare_cascaded_decls_by_rank);
+        for (i = 0; i < nb_winners; i++) {
+                tmp_props = cr_prop_list_append2
+                        (props, winners[i]->decl->property,
+                         winners[i]->decl);
+                if (!tmp_props) {
+                        cr_utils_trace_info ("Out of memory");
+                        if (props)
+                                cr_prop_list_destroy (props);
+                        g_free (winners);
+                        CR_TRACE (cascade__end, CR_TRACE_CASCADE_END,
+                                  i, CR_OUT_OF_MEMORY_ERROR);
+                        return CR_OUT_OF_MEMORY_ERROR;
+                }
+                props = tmp_props;
+        }
+        g_free (winners);
+        CR_TRACE (cascade__end, CR_TRACE_CASCADE_END, nb_winners, CR_OK);
+        *a_props = props;
+        return CR_OK;
+}
+
+/**
+ *A node of the rule tree.
+ *The path from the root of the tree to a node is a sequence of
+ *declaration blocks, in the order they are run through the
+ *cascade. Elements that match the same sequence get the same
+ *specified values: they are computed for the first of them and
+ *kept in the node, so that the other ones only have to copy
+ *them and resolve what they inherit from their parent.
+ */
+struct CRRuleNode {
+        CRStatement *stmt;
+        gboolean important;
+        struct CRRuleNode *children;
+        struct CRRuleNode *next;
+        /*the specified style of the path, NULL until it is computed.*/
+        CRStyle *style;
+};
+
+/**
+ *Gets the declaration blocks of the rulesets of the cascade that
+ *match a_node, sorted in the order they must be run through
+ *the cascade.
+ *@param a_this the current selection engine.
+ *@param a_cascade the cascade to take the rulesets from.
+ *@param a_node the xml node to consider.
+ *@param a_blocks out parameter. The sorted blocks. They belong to
+ *the engine and are only valid until the next match.
+ *@param a_nb_blocks out parameter. The length of *a_blocks.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+get_matched_cascade_blocks (CRSelEng * a_this, CRCascade * a_cascade,
+                            xmlNode * a_node,
+                            struct CRCascadeBlock **a_blocks,
+                            gulong * a_nb_blocks)
+{
+        GArray *rules = PRIVATE (a_this)->matched_rules,
+                *blocks = PRIVATE (a_this)->blocks;
+        struct CRMatchedRule *rule = NULL;
+        struct CRCascadeBlock block;
+        CRDeclaration *cur_decl = NULL;
+        enum CRStatus status = CR_OK;
+        guint i = 0;
+
+        g_array_set_size (blocks, 0);
+        status = get_matched_rules_from_index (a_this, a_cascade, a_node,
+                                               rules);
+        if (status != CR_OK) {
+                if (status != CR_LIMIT_EXCEEDED_ERROR
+                    && status != CR_CANCELLED_ERROR)
+                        cr_utils_trace_info ("Error while running "
+                                             "selector engine");
+                return status;
+        }
+
+        /*
+         *Sort the normal and the !important declarations of the
+         *matched rulesets by precedence.
+         */
+        for (i = 0; i < rules->len; i++) {
+                rule = &g_array_index (rules, struct CRMatchedRule, i);
+                if (!rule->ruleset->parent_sheet)
+                        continue;
+                cascade_block_init (&block, rule->ruleset,
+                                    rule->specificity, rule->order, FALSE);
+                g_array_append_val (blocks, block);
+                if (rule->ruleset->parent_sheet->origin == ORIGIN_UA)
+                        continue;
+                for (cur_decl = rule->ruleset->kind.ruleset->decl_list;
+                     cur_decl; cur_decl = cur_decl->next) {
+                        if (cur_decl->important == TRUE)
+                                break;
+                }
+                if (cur_decl) {
+                        cascade_block_init (&block, rule->ruleset,
+                                            rule->specificity, rule->order,
+                                            TRUE);
+                        g_array_append_val (blocks, block);
+                }
+        }
+        /*blocks->data is NULL if no rule matched*/
+        if (blocks->len > 1)
+                qsort (blocks->data, blocks->len,
+                       sizeof (struct CRCascadeBlock),
+                       compare_cascade_blocks);
+        *a_blocks = (struct CRCascadeBlock *) blocks->data;
+        *a_nb_blocks = blocks->len;
+        return CR_OK;
+}
+
+/**
+ *Runs the rulesets of the cascade that match a_node through
+ *a_table.
+ *@param a_this the current selection engine.
+ *@param a_cascade the cascade to take the rulesets from.
+ *@param a_node the xml node to consider.
+ *@param a_table the cascade table to fill.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+get_matched_cascade_table (CRSelEng * a_this, CRCascade * a_cascade,
+                           xmlNode * a_node,
+                           struct CRCascadeTable *a_table)
+{
+        struct CRCascadeBlock *blocks = NULL;
+        gulong nb_blocks = 0,
+                i = 0;
+        enum CRStatus status = CR_OK;
+
+        status = get_matched_cascade_blocks (a_this, a_cascade, a_node,
+                                             &blocks, &nb_blocks);
+        for (i = 0; status == CR_OK && i < nb_blocks; i++) {
+                status = cascade_table_put_block (a_table, &blocks[i]);
+        }
+        return status;
+}
+
+static struct CRRuleNode *
+rule_node_new (CRStatement * a_stmt, gboolean a_important)
+{
+        struct CRRuleNode *result = NULL;
+
+        result = g_try_malloc (sizeof (struct CRRuleNode));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (struct CRRuleNode));
+        result->stmt = a_stmt;
+        result->important = a_important;
+        return result;
+}
+
+static void
+rule_node_destroy (struct CRRuleNode *a_this)
+{
+        struct CRRuleNode *cur = NULL,
+                *next = NULL;
+
+        for (cur = a_this->children; cur; cur = next) {
+                next = cur->next;
+                rule_node_destroy (cur);
+        }
+        if (a_this->style) {
+                cr_style_destroy (a_this->style);
+                a_this->style = NULL;
+        }
+        g_free (a_this);
+}
+
+/**
+ *Walks down the rule tree along a sequence of declaration
+ *blocks, adding the nodes that are missing.
+ *@param a_root the root of the rule tree.
+ *@param a_blocks the sorted declaration blocks.
+ *@param a_nb_blocks the length of a_blocks.
+ *@return the node at the end of the path, or NULL if the
+ *system is out of memory.
+ */
+static struct CRRuleNode *
+rule_tree_get_node (struct CRRuleNode *a_root,
+                    struct CRCascadeBlock *a_blocks, gulong a_nb_blocks)
+{
+        struct CRRuleNode *cur_node = a_root,
+                *child = NULL;
+        gulong i = 0;
+
+        for (i = 0; i < a_nb_blocks; i++) {
+                for (child = cur_node->children; child; child = child->next) {
+                        if (child->stmt == a_blocks[i].stmt
+                            && child->important == a_blocks[i].important)
+                                break;
+                }
+                if (!child) {
+                        child = rule_node_new (a_blocks[i].stmt,
+                                               a_blocks[i].important);
+                        if (!child)
+                                return NULL;
+                        child->next = cur_node->children;
+                        cur_node->children = child;
+                }
+                cur_node = child;
+        }
+        return cur_node;
+}
+
+/**
+ *Computes the style of an element during a document walk.
+ *The ancestors of a_node must be in the ancestor filter.
+ *@param a_this the current selection engine.
+ *@param a_cascade the cascade to take the rules from.
+ *@param a_node the xml element node to style.
+ *@param a_parent_style the style of the parent element, NULL
+ *if a_node is the root element.
+ *@param a_style out parameter. The computed style. Its reference
+ *count is set to 1.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+style_document_node (CRSelEng * a_this, CRCascade * a_cascade,
+                     xmlNode * a_node, CRStyle * a_parent_style,
+                     CRStyle ** a_style)
+{
+        enum CRStatus status = CR_OK;
+        struct CRCascadeTable table;
+        struct CRCascadeBlock *blocks = NULL;
+        struct CRRuleNode *rule_node = NULL;
+        gulong nb_blocks = 0,
+                i = 0;
+        CRStyle *style = NULL;
+
+        PRIVATE (a_this)->filtered_node = a_node;
+        status = get_matched_cascade_blocks (a_this, a_cascade, a_node,
+                                             &blocks, &nb_blocks);
+        PRIVATE (a_this)->filtered_node = NULL;
+        if (status != CR_OK)
+                goto cleanup;
+
+        /*
+         *The root element starts from the initial values of
+         *the properties rather than from their default values,
+         *and is styled once: it is kept out of the rule tree.
+         */
+        if (a_parent_style && PRIVATE (a_this)->rule_tree) {
+                rule_node = rule_tree_get_node
+                        (PRIVATE (a_this)->rule_tree, blocks, nb_blocks);
+                if (!rule_node) {
+                        status = CR_OUT_OF_MEMORY_ERROR;
+                        goto cleanup;
+                }
+        }
+        if (rule_node && rule_node->style) {
+                style = cr_style_dup (rule_node->style);
+        } else {
+                style = cr_style_new (a_parent_style ? FALSE : TRUE);
+                if (style) {
+                        cascade_table_init (&table);
+                        for (i = 0; status == CR_OK && i < nb_blocks; i++) {
+                                status = cascade_table_put_block
+                                        (&table, &blocks[i]);
+                        }
+                        if (status == CR_OK)
+                                set_style_from_cascade_table (style, &table);
+                        cascade_table_clear (&table);
+                        if (status == CR_OK && rule_node)
+                                rule_node->style = cr_style_dup (style);
+                }
+        }
+        if (!style) {
+                cr_utils_trace_info ("Out of memory");
+                status = CR_OUT_OF_MEMORY_ERROR;
+                goto cleanup;
+        }
+        cr_style_ref (style);
+        if (status != CR_OK)
+                goto cleanup;
+        style->parent_style = a_parent_style;
+        if (a_parent_style && !PRIVATE (a_this)->lazy_resolution) {
+                status = cr_style_resolve_inherited_properties (style);
+                if (status != CR_OK)
+                        goto cleanup;
+        }
+        *a_style = style;
+        style = NULL;
+
+ cleanup:
+        if (style) {
+                cr_style_unref (style);
+                style = NULL;
+        }
+        return status;
+}
+
+/**
+ *Loads the ancestor filter of the engine with the
+ *names, ids and classes of the ancestors of a_node.
+ */
+static void
+ancestor_filter_load (CRSelEng * a_this, xmlNode * a_node)
+{
+        xmlNode *cur_node = NULL;
+        guint *hashes = NULL;
+        gulong nb_hashes = 0,
+                i = 0;
+
+        memset (PRIVATE (a_this)->ancestor_filter, 0, ANCESTOR_FILTER_SIZE);
+        for (cur_node = a_node->parent; cur_node;
+             cur_node = cur_node->parent) {
+                if (cur_node->type != XML_ELEMENT_NODE)
+                        continue;
+                hashes = node_ancestor_hashes_new (a_this, cur_node,
+                                                   &nb_hashes);
+                for (i = 0; hashes && i < nb_hashes; i++) {
+                        ancestor_filter_add
+                                (PRIVATE (a_this)->ancestor_filter,
+                                 hashes[i]);
+                }
+                if (hashes) {
+                        g_free (hashes);
+                        hashes = NULL;
+                }
+        }
+}
+
+static void
+style_sharing_add_attr (CRSelEng * a_this, const gchar * a_name)
+{
+        guint i = 0;
+
+        for (i = 0; i < PRIVATE (a_this)->shared_attrs->len; i++) {
+                if (!strcmp (g_ptr_array_index
+                             (PRIVATE (a_this)->shared_attrs, i), a_name))
+                        return;
+        }
+        g_ptr_array_add (PRIVATE (a_this)->shared_attrs, (gpointer) a_name);
+}
+
+/**
+ *Looks at what the selectors of a ruleset depend on,
+ *for the style sharing cache.
+ */
+static void
+style_sharing_scan_ruleset (CRSelEng * a_this, CRStatement * a_ruleset)
+{
+        CRSelector *cur_sel = NULL;
+        CRSimpleSel *cur_simple_sel = NULL;
+        CRAdditionalSel *cur_add_sel = NULL;
+        CRAttrSel *cur_attr_sel = NULL;
+        CRPseudo *pseudo = NULL;
+        CRPseudoClassSelectorHandler handler = NULL;
+
+        if (!a_ruleset->kind.ruleset)
+                return;
+        for (cur_sel = a_ruleset->kind.ruleset->sel_list; cur_sel;
+             cur_sel = cur_sel->next) {
+                for (cur_simple_sel = cur_sel->simple_sel; cur_simple_sel;
+                     cur_simple_sel = cur_simple_sel->next) {
+                        /*
+                         *the style would depend on the preceding
+                         *sibling of the element or of its ancestors.
+                         */
+                        if (cur_simple_sel->combinator == COMB_PLUS)
+                                PRIVATE (a_this)->sharing_disabled = TRUE;
+
+                        for (cur_add_sel = cur_simple_sel->add_sel;
+                             cur_add_sel; cur_add_sel = cur_add_sel->next) {
+                                switch (cur_add_sel->type) {
+                                case ATTRIBUTE_ADD_SELECTOR:
+                                        for (cur_attr_sel = cur_add_sel->content.attr_sel;
+                                             cur_attr_sel;
+                                             cur_attr_sel = cur_attr_sel->next) {
+                                                if (cur_attr_sel->name
+                                                    && cur_attr_sel->name->stryng
+                                                    && cur_attr_sel->name->stryng->str)
+                                                        style_sharing_add_attr
+                                                                (a_this, cur_attr_sel->name->stryng->str);
+                                        }
+                                        break;
+
+                                case PSEUDO_CLASS_ADD_SELECTOR:
+                                        pseudo = cur_add_sel->content.pseudo;
+                                        handler = NULL;
+                                        if (!pseudo || !pseudo->name
+                                            || !pseudo->name->stryng
+                                            || !pseudo->name->stryng->str
+                                            || cr_sel_eng_get_pseudo_class_selector_handler
+                                            (a_this, (guchar *) pseudo->name->stryng->str,
+                                             pseudo->type, &handler) != CR_OK
+                                            || !handler) {
+                                                /*never matches*/
+                                                break;
+                                        }
+                                        if (handler == (CRPseudoClassSelectorHandler)
+                                            first_child_pseudo_class_handler) {
+                                                PRIVATE (a_this)->share_first_child = TRUE;
+                                        } else if (handler == (CRPseudoClassSelectorHandler)
+                                                   lang_pseudo_class_handler) {
+                                                PRIVATE (a_this)->share_lang = TRUE;
+                                        } else {
+                                                /*
+                                                 *we don't know what a
+                                                 *custom handler looks at.
+                                                 */
+                                                PRIVATE (a_this)->sharing_disabled = TRUE;
+                                        }
+                                        break;
+
+                                default:
+                                        break;
+                                }
+                        }
+                }
+        }
+}
+
+/**
+ *Sets up the style sharing cache for a walk
+ *of a document with the rules of a_cascade.
+ */
+static enum CRStatus
+style_sharing_init (CRSelEng * a_this, CRCascade * a_cascade)
+{
+        enum CRStyleOrigin origin = 0;
+        CRStyleSheet *sheet = NULL;
+        CRStatement *cur_stmt = NULL,
+                *cur_ruleset = NULL;
+        guint i = 0;
+
+        PRIVATE (a_this)->shared_styles = g_try_malloc
+                (STYLE_SHARING_CACHE_SIZE * sizeof (struct CRSharedStyle));
+        if (!PRIVATE (a_this)->shared_styles) {
+                cr_utils_trace_info ("Out of memory");
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+        memset (PRIVATE (a_this)->shared_styles, 0,
+                STYLE_SHARING_CACHE_SIZE * sizeof (struct CRSharedStyle));
+        PRIVATE (a_this)->shared_styles_next = 0;
+        PRIVATE (a_this)->shared_attrs = g_ptr_array_new ();
+        PRIVATE (a_this)->share_first_child = FALSE;
+        PRIVATE (a_this)->share_lang = FALSE;
+        PRIVATE (a_this)->sharing_disabled = FALSE;
+
+        for (origin = ORIGIN_UA; origin < NB_ORIGINS; origin++) {
+                for (i = 0;
+                     (sheet = cr_cascade_get_sheet_nth (a_cascade, origin, i));
+                     i++) {
+                        for (cur_stmt = sheet->statements; cur_stmt;
+                             cur_stmt = cur_stmt->next) {
+                                if (cur_stmt->type == RULESET_STMT) {
+                                        style_sharing_scan_ruleset (a_this,
+                                                                    cur_stmt);
+                                } else if (cur_stmt->type == AT_MEDIA_RULE_STMT
+                                           && cur_stmt->kind.media_rule) {
+                                        for (cur_ruleset = cur_stmt->kind.media_rule->rulesets;
+                                             cur_ruleset;
+                                             cur_ruleset = cur_ruleset->next) {
+                                                if (cur_ruleset->type == RULESET_STMT)
+                                                        style_sharing_scan_ruleset
+                                                                (a_this, cur_ruleset);
+                                        }
+                                }
+                        }
+                }
+        }
+        return CR_OK;
+}
+
+/**
+ *Releases the reference the walk holds on a_style.
+ *If a_style is about to be destroyed, the cache entries
+ *whose parent style it is are dropped first, so that a style
+ *allocated later at the same address is not mistaken for it.
+ */
+static void
+style_sharing_release (CRSelEng * a_this, CRStyle * a_style)
+{
+        struct CRSharedStyle *entry = NULL;
+        CRStyle *style = NULL;
+        guint i = 0;
+
+        if (g_atomic_int_get (&a_style->ref_count) == 1
+            && PRIVATE (a_this)->shared_styles) {
+                for (i = 0; i < STYLE_SHARING_CACHE_SIZE; i++) {
+                        entry = &PRIVATE (a_this)->shared_styles[i];
+                        if (!entry->style
+                            || entry->style->parent_style != a_style)
+                                continue;
+                        style = entry->style;
+                        entry->style = NULL;
+                        entry->node = NULL;
+                        style_sharing_release (a_this, style);
+                }
+        }
+        cr_style_unref (a_style);
+}
+
+static gboolean
+node_props_are_equal (CRSelEng * a_this, xmlNode * a_node,
+                      xmlNode * a_other, const xmlChar * a_name)
+{
+        xmlChar *val = NULL,
+                *other_val = NULL;
+        gboolean result = FALSE;
+
+        val = get_prop (a_this, a_node, a_name);
+        other_val = get_prop (a_this, a_other, a_name);
+        if (!val || !other_val)
+                result = (val == other_val);
+        else
+                result = !strcmp ((const char *) val,
+                                  (const char *) other_val);
+        if (val)
+                xmlFree (val);
+        if (other_val)
+                xmlFree (other_val);
+        return result;
+}
+
+/**
+ *Tests if a_node and a_other are alike under the selectors of
+ *the cascade, so that a_node can take the style of a_other.
+ *Their parents must have the same style.
+ */
+static gboolean
+nodes_can_share_style (CRSelEng * a_this, xmlNode * a_node,
+                       xmlNode * a_other)
+{
+        guint i = 0;
+
+        if (strcmp ((const char *) a_node->name,
+                    (const char *) a_other->name))
+                return FALSE;
+        if (PRIVATE (a_this)->share_first_child == TRUE
+            && (!get_prev_element_node (a_node))
+            != (!get_prev_element_node (a_other)))
+                return FALSE;
+        if (!node_props_are_equal (a_this, a_node, a_other,
+                                   (const xmlChar *) "class")
+            || !node_props_are_equal (a_this, a_node, a_other,
+                                      (const xmlChar *) "id"))
+                return FALSE;
+        if (PRIVATE (a_this)->share_lang == TRUE
+            && !node_props_are_equal (a_this, a_node, a_other,
+                                      (const xmlChar *) "lang"))
+                return FALSE;
+        for (i = 0; i < PRIVATE (a_this)->shared_attrs->len; i++) {
+                if (!node_props_are_equal
+                    (a_this, a_node, a_other, g_ptr_array_index
+                     (PRIVATE (a_this)->shared_attrs, i)))
+                        return FALSE;
+        }
+        return TRUE;
+}
+
+/**
+ *Looks for a recently styled element a_node can
+ *share its style with.
+ *@return the style to share, NULL if none was found.
+ */
+static CRStyle *
+style_sharing_lookup (CRSelEng * a_this, xmlNode * a_node,
+                      CRStyle * a_parent_style)
+{
+        struct CRSharedStyle *entry = NULL;
+        guint i = 0;
+
+        if (!PRIVATE (a_this)->shared_styles
+            || PRIVATE (a_this)->sharing_disabled == TRUE
+            || !a_parent_style)
+                return NULL;
+        for (i = 0; i < STYLE_SHARING_CACHE_SIZE; i++) {
+                entry = &PRIVATE (a_this)->shared_styles[i];
+                if (entry->style
+                    && entry->style->parent_style == a_parent_style
+                    && nodes_can_share_style (a_this, a_node, entry->node))
+                        return entry->style;
+        }
+        return NULL;
+}
+
+/**
+ *Remembers the style of a_node, evicting the oldest entry
+ *of the cache.
+ */
+static void
+style_sharing_insert (CRSelEng * a_this, xmlNode * a_node,
+                      CRStyle * a_style)
+{
+        struct CRSharedStyle *entry = NULL;
+        CRStyle *evicted = NULL;
+
+        if (!PRIVATE (a_this)->shared_styles
+            || PRIVATE (a_this)->sharing_disabled == TRUE)
+                return;
+        entry = &PRIVATE (a_this)->shared_styles
+                [PRIVATE (a_this)->shared_styles_next];
+        PRIVATE (a_this)->shared_styles_next =
+                (PRIVATE (a_this)->shared_styles_next + 1)
+                % STYLE_SHARING_CACHE_SIZE;
+        evicted = entry->style;
+        cr_style_ref (a_style);
+        entry->style = a_style;
+        entry->node = a_node;
+        if (evicted)
+                style_sharing_release (a_this, evicted);
+}
+
+/**
+ *Allocates the state the engine needs during a
+ *walk of a document with the rules of a_cascade.
+ */
+static enum CRStatus
+style_document_walk_begin (CRSelEng * a_this, CRCascade * a_cascade)
+{
+        PRIVATE (a_this)->ancestor_filter =
+                g_try_malloc (ANCESTOR_FILTER_SIZE);
+        PRIVATE (a_this)->sel_hashes = g_hash_table_new_full
+                (g_direct_hash, g_direct_equal, NULL, g_free);
+        if (!PRIVATE (a_this)->ancestor_filter
+            || !PRIVATE (a_this)->sel_hashes) {
+                cr_utils_trace_info ("Out of memory");
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+        memset (PRIVATE (a_this)->ancestor_filter, 0, ANCESTOR_FILTER_SIZE);
+        PRIVATE (a_this)->match_memo = match_memo_new ();
+        PRIVATE (a_this)->rule_tree = rule_node_new (NULL, FALSE);
+        if (!PRIVATE (a_this)->rule_tree)
+                return CR_OUT_OF_MEMORY_ERROR;
+        return style_sharing_init (a_this, a_cascade);
+}
+
+/**
+ *Frees what style_document_walk_begin() allocated.
+ */
+static void
+style_document_walk_end (CRSelEng * a_this)
+{
+        guint i = 0;
+
+        if (PRIVATE (a_this)->shared_styles) {
+                for (i = 0; i < STYLE_SHARING_CACHE_SIZE; i++) {
+                        if (PRIVATE (a_this)->shared_styles[i].style)
+                                cr_style_unref (PRIVATE (a_this)->
+                                                shared_styles[i].style);
+                }
+                g_free (PRIVATE (a_this)->shared_styles);
+                PRIVATE (a_this)->shared_styles = NULL;
+        }
+        if (PRIVATE (a_this)->shared_attrs) {
+                g_ptr_array_free (PRIVATE (a_this)->shared_attrs, TRUE);
+                PRIVATE (a_this)->shared_attrs = NULL;
+        }
+        if (PRIVATE (a_this)->match_memo) {
+                g_hash_table_destroy (PRIVATE (a_this)->match_memo);
+                PRIVATE (a_this)->match_memo = NULL;
+        }
+        if (PRIVATE (a_this)->rule_tree) {
+                rule_node_destroy (PRIVATE (a_this)->rule_tree);
+                PRIVATE (a_this)->rule_tree = NULL;
+        }
+        release_rule_index (a_this);
+        if (PRIVATE (a_this)->ancestor_filter) {
+                g_free (PRIVATE (a_this)->ancestor_filter);
+                PRIVATE (a_this)->ancestor_filter = NULL;
+        }
+        if (PRIVATE (a_this)->sel_hashes) {
+                g_hash_table_destroy (PRIVATE (a_this)->sel_hashes);
+                PRIVATE (a_this)->sel_hashes = NULL;
+        }
+        PRIVATE (a_this)->filtered_node = NULL;
+}
+
+/**
+ *Styles the element a_node and, recursively, its subtree.
+ *The ancestors of a_node must be in the ancestor filter.
+ */
+static enum CRStatus
+style_document_element (CRSelEng * a_this, CRCascade * a_cascade,
+                        xmlNode * a_node, CRStyle * a_parent_style,
+                        CRSelEngStyleHandler a_handler,
+                        gpointer a_user_data)
+{
+        enum CRStatus status = CR_OK;
+        xmlNode *cur_node = NULL;
+        CRStyle *style = NULL;
+        guint *hashes = NULL;
+        gulong nb_hashes = 0,
+                i = 0;
+
+        style = style_sharing_lookup (a_this, a_node, a_parent_style);
+        if (style) {
+                cr_style_ref (style);
+        } else {
+                status = style_document_node (a_this, a_cascade, a_node,
+                                              a_parent_style, &style);
+                if (status != CR_OK)
+                        return status;
+                style_sharing_insert (a_this, a_node, style);
+        }
+
+        status = a_handler (a_this, a_node, style, a_user_data);
+        if (status != CR_OK || !a_node->children)
+                goto cleanup;
+
+        /*
+         *a_node becomes an ancestor of the
+         *nodes we are about to style.
+         */
+        hashes = node_ancestor_hashes_new (a_this, a_node, &nb_hashes);
+        for (i = 0; hashes && i < nb_hashes; i++) {
+                ancestor_filter_add (PRIVATE (a_this)->ancestor_filter,
+                                     hashes[i]);
+        }
+        for (cur_node = a_node->children; cur_node;
+             cur_node = cur_node->next) {
+                if (cur_node->type != XML_ELEMENT_NODE)
+                        continue;
+                status = style_document_element (a_this, a_cascade,
+                                                 cur_node, style,
+                                                 a_handler, a_user_data);
+                if (status != CR_OK)
+                        break;
+        }
+        for (i = 0; hashes && i < nb_hashes; i++) {
+                ancestor_filter_remove (PRIVATE (a_this)->ancestor_filter,
+                                        hashes[i]);
+        }
+        if (hashes) {
+                g_free (hashes);
+                hashes = NULL;
+        }
+
+ cleanup:
+        style_sharing_release (a_this, style);
+        style = NULL;
+        return status;
+}
+
+/**
+ *A subtree to style in a worker thread
+ *of cr_sel_eng_style_document_parallel().
+ */
+struct CRStyleTask {
+        xmlNode *node;
+        /*owned by the thread that split the document*/
+        CRStyle *parent_style;
+};
+
+/**
+ *The number of subtrees the document is split into, per
+ *worker thread. Having more subtrees than threads keeps all
+ *the threads busy when the subtrees are not of the same size.
+ */
+#define STYLE_TASKS_PER_THREAD 4
+
+static struct CRStyleTask *
+style_task_new (xmlNode * a_node, CRStyle * a_parent_style)
+{
+        struct CRStyleTask *result = NULL;
+
+        result = g_try_malloc (sizeof (struct CRStyleTask));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (struct CRStyleTask));
+        result->node = a_node;
+        result->parent_style = a_parent_style;
+        return result;
+}
+
+/**
+ *The state shared by the worker threads
+ *of cr_sel_eng_style_document_parallel().
+ */
+struct CRStyleTaskCtxt {
+        CRCascade *cascade;
+        CRSelEngStyleHandler handler;
+        gpointer user_data;
+        /*the engines that are not used by a worker right now*/
+        GAsyncQueue *engines;
+        GMutex lock;
+        enum CRStatus status;
+        gint failed;
+};
+
+/**
+ *Makes the allocator of the engine, if it has one,
+ *the current allocator of the calling thread.
+ *@return what to pass to sel_eng_pop_allocator().
+ */
+static CRAllocator const *
+sel_eng_push_allocator (CRSelEng * a_this)
+{
+        if (!PRIVATE (a_this)->allocator)
+                return NULL;
+        return cr_allocator_push (PRIVATE (a_this)->allocator);
+}
+
+/**
+ *Ends what sel_eng_push_allocator() started.
+ *@param a_prev what sel_eng_push_allocator() returned.
+ */
+static void
+sel_eng_pop_allocator (CRSelEng * a_this, CRAllocator const * a_prev)
+{
+        if (PRIVATE (a_this)->allocator)
+                cr_allocator_pop (a_prev);
+}
+
+/**
+ *Styles the subtree of a task. Run by the worker threads.
+ */
+static void
+style_task_run (gpointer a_task, gpointer a_ctxt)
+{
+        struct CRStyleTask *task = a_task;
+        struct CRStyleTaskCtxt *ctxt = a_ctxt;
+        CRSelEng *engine = NULL;
+        gulong *prev_counters = NULL;
+        CRAllocator const *prev_allocator = NULL;
+        enum CRStatus status = CR_OK;
+
+        if (g_atomic_int_get (&ctxt->failed)) {
+                g_free (task);
+                return;
+        }
+
+        /*
+         *there are as many engines as worker threads so this
+         *never waits.
+         */
+        engine = g_async_queue_pop (ctxt->engines);
+        if (PRIVATE (engine)->stats_enabled == TRUE)
+                prev_counters = cr_stats_push_alloc_counters
+                        (PRIVATE (engine)->stats.nb_allocs);
+        prev_allocator = sel_eng_push_allocator (engine);
+        ancestor_filter_load (engine, task->node);
+        status = style_document_element (engine, ctxt->cascade,
+                                         task->node, task->parent_style,
+                                         ctxt->handler, ctxt->user_data);
+        sel_eng_pop_allocator (engine, prev_allocator);
+        if (PRIVATE (engine)->stats_enabled == TRUE)
+                cr_stats_pop_alloc_counters (prev_counters);
+        g_async_queue_push (ctxt->engines, engine);
+
+        if (status != CR_OK) {
+                g_mutex_lock (&ctxt->lock);
+                if (ctxt->status == CR_OK)
+                        ctxt->status = status;
+                g_mutex_unlock (&ctxt->lock);
+                g_atomic_int_set (&ctxt->failed, 1);
+        }
+        g_free (task);
+}
+
+/**
+ *Starts timing a public call of the engine, and counting the
+ *allocations it makes, if the statistics are enabled and no
+ *outer call of the engine is being timed already.
+ *@return the time the call started at, to be passed to
+ *stats_phase_end(), or 0 if the call is not timed.
+ */
+static gint64
+stats_phase_begin (CRSelEng * a_this)
+{
+        if (PRIVATE (a_this)->stats_enabled == FALSE
+            || PRIVATE (a_this)->in_stats_phase == TRUE)
+                return 0;
+        PRIVATE (a_this)->in_stats_phase = TRUE;
+        PRIVATE (a_this)->stats_prev_counters =
+                cr_stats_push_alloc_counters
+                (PRIVATE (a_this)->stats.nb_allocs);
+        return g_get_monotonic_time ();
+}
+
+/**
+ *Ends what stats_phase_begin() started.
+ *@param a_start what stats_phase_begin() returned.
+ *@param a_time the time counter to add the duration
+ *of the call to, in seconds.
+ */
+static void
+stats_phase_end (CRSelEng * a_this, gint64 a_start, gdouble * a_time)
+{
+        if (!a_start)
+                return;
+        cr_stats_pop_alloc_counters (PRIVATE (a_this)->stats_prev_counters);
+        PRIVATE (a_this)->stats_prev_counters = NULL;
+        PRIVATE (a_this)->in_stats_phase = FALSE;
+        *a_time += (g_get_monotonic_time () - a_start) / 1e6;
+}
+
+/**
+ *Adds the counters of the statistics of a_other,
+ *the engine of a worker thread, to the ones of a_this.
+ *The times are not added: the worker threads
+ *run while the walk of a_this is being timed.
+ */
+static void
+stats_merge (CRSelEng * a_this, CRSelEng * a_other)
+{
+        CRSelEngStats *stats = &PRIVATE (a_this)->stats,
+                *other = &PRIVATE (a_other)->stats;
+        guint i = 0;
+
+        for (i = 0; i < CR_STATS_NB_COMBINATORS; i++) {
+                stats->nb_match_attempts[i] += other->nb_match_attempts[i];
+                stats->nb_match_hits[i] += other->nb_match_hits[i];
+        }
+        stats->nb_get_props += other->nb_get_props;
+        for (i = 0; i < CR_STATS_NB_OBJECT_TYPES; i++) {
+                stats->nb_allocs[i] += other->nb_allocs[i];
+        }
+}
+
+/**
+ *Builds an engine that matches like a_this does, to be
+ *used by a worker thread.
+ */
+static CRSelEng *
+clone_for_worker (CRSelEng * a_this, CRCascade * a_cascade)
+{
+        CRSelEng *result = NULL;
+        GList *cur = NULL;
+        struct CRPseudoClassSelHandlerEntry *entry = NULL;
+        struct CRRuleIndex *index = NULL;
+
+        result = cr_sel_eng_new ();
+        if (!result)
+                return NULL;
+        cr_sel_eng_unregister_all_pseudo_class_sel_handlers (result);
+        for (cur = PRIVATE (a_this)->pcs_handlers; cur; cur = cur->next) {
+                entry = cur->data;
+                if (cr_sel_eng_register_pseudo_class_sel_handler
+                    (result, entry->name, entry->type,
+                     entry->handler) != CR_OK)
+                        goto error;
+        }
+        PRIVATE (result)->case_sensitive = PRIVATE (a_this)->case_sensitive;
+        PRIVATE (result)->lazy_resolution =
+                PRIVATE (a_this)->lazy_resolution;
+        PRIVATE (result)->stats_enabled = PRIVATE (a_this)->stats_enabled;
+        PRIVATE (result)->allocator = PRIVATE (a_this)->allocator;
+        /*
+         *the workers spend the match attempts of a_this, and
+         *stop all together as soon as one of them stops
+         */
+        if (PRIVATE (a_this)->limits) {
+                cr_limits_state_ref (PRIVATE (a_this)->limits);
+                PRIVATE (result)->limits = PRIVATE (a_this)->limits;
+        }
+        if (PRIVATE (a_this)->profile_selectors == TRUE
+            && cr_sel_eng_set_selector_profiling (result, TRUE) != CR_OK)
+                goto error;
+        index = get_rule_index (a_this, a_cascade);
+        if (!index)
+                goto error;
+        g_atomic_int_inc (&index->ref_count);
+        PRIVATE (result)->rule_index = index;
+        if (style_document_walk_begin (result, a_cascade) != CR_OK)
+                goto error;
+        return result;
+
+ error:
+        style_document_walk_end (result);
+        cr_sel_eng_destroy (result);
+        return NULL;
+}
+
+/****************************************
+ *PUBLIC METHODS
+ ****************************************/
+
+/**
+ * cr_sel_eng_new:
+ *Creates a new instance of #CRSelEng.
+ *
+ *Returns the newly built instance of #CRSelEng of
+ *NULL if an error occurs.
+ */
+CRSelEng *
+cr_sel_eng_new (void)
+{
+        CRSelEng *result = NULL;
+
+        result = g_try_malloc (sizeof (CRSelEng));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (CRSelEng));
+
+        PRIVATE (result) = g_try_malloc (sizeof (CRSelEngPriv));
+        if (!PRIVATE (result)) {
+                cr_utils_trace_info ("Out of memory");
+                g_free (result);
+                return NULL;
+        }
+        memset (PRIVATE (result), 0, sizeof (CRSelEngPriv));
+        PRIVATE (result)->candidates = g_ptr_array_new ();
+        PRIVATE (result)->matched_rules = g_array_new
+                (FALSE, FALSE, sizeof (struct CRMatchedRule));
+        PRIVATE (result)->blocks = g_array_new
+                (FALSE, FALSE, sizeof (struct CRCascadeBlock));
+        cr_sel_eng_register_pseudo_class_sel_handler
+                (result, (guchar *) "first-child",
+                 IDENT_PSEUDO, (CRPseudoClassSelectorHandler)
+                 first_child_pseudo_class_handler);
+        cr_sel_eng_register_pseudo_class_sel_handler
+                (result, (guchar *) "lang",
+                 FUNCTION_PSEUDO, (CRPseudoClassSelectorHandler)
+                 lang_pseudo_class_handler);
+
+        return result;
+}
+
+/**
+ * cr_sel_eng_register_pseudo_class_sel_handler:
+ *@a_this: the current instance of #CRSelEng
+ *@a_pseudo_class_sel_name: the name of the pseudo class selector.
+ *@a_pseudo_class_type: the type of the pseudo class selector.
+ *@a_handler: the actual handler or callback to be called during
+ *the selector evaluation process.
+ *
+ *Adds a new handler entry in the handlers entry table.
+ *
+ *Returns CR_OK, upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_register_pseudo_class_sel_handler (CRSelEng * a_this,
+                                              guchar * a_name,
+                                              enum CRPseudoType a_type,
+                                              CRPseudoClassSelectorHandler
+                                              a_handler)
+{
+        struct CRPseudoClassSelHandlerEntry *handler_entry = NULL;
+        GList *list = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_handler && a_name, CR_BAD_PARAM_ERROR);
+
+        handler_entry = g_try_malloc
+                (sizeof (struct CRPseudoClassSelHandlerEntry));
+        if (!handler_entry) {
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+        memset (handler_entry, 0,
+                sizeof (struct CRPseudoClassSelHandlerEntry));
+        handler_entry->name = (guchar *) g_strdup ((const gchar *) a_name);
+        handler_entry->type = a_type;
+        handler_entry->handler = a_handler;
+        list = g_list_append (PRIVATE (a_this)->pcs_handlers, handler_entry);
+        if (!list) {
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+        PRIVATE (a_this)->pcs_handlers = list;
+        return CR_OK;
+}
+
+enum CRStatus
 cr_sel_eng_unregister_pseudo_class_sel_handler (CRSelEng * a_this,
                                                 guchar * a_name,
                                                 enum CRPseudoType a_type)
@@ -1293,263 +3443,987 @@ cr_sel_eng_get_pseudo_class_selector_handler (CRSelEng * a_this,
 }
 
 /**
- * cr_sel_eng_matches_node:
- *@a_this: the selection engine.
- *@a_sel: the simple selector against which the xml node 
- *is going to be matched.
- *@a_node: the node against which the selector is going to be matched.
- *@a_result: out parameter. The result of the match. Is set to
- *TRUE if the selector matches the node, FALSE otherwise. This value
- *is considered if and only if this functions returns CR_OK.
+ * cr_sel_eng_matches_node:
+ *@a_this: the selection engine.
+ *@a_sel: the simple selector against which the xml node 
+ *is going to be matched.
+ *@a_node: the node against which the selector is going to be matched.
+ *@a_result: out parameter. The result of the match. Is set to
+ *TRUE if the selector matches the node, FALSE otherwise. This value
+ *is considered if and only if this functions returns CR_OK.
+ *
+ *Evaluates a chained list of simple selectors (known as a css2 selector).
+ *Says wheter if this selector matches the xml node given in parameter or
+ *not.
+ *
+ *Returns the CR_OK if the selection ran correctly, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_matches_node (CRSelEng * a_this, CRSimpleSel * a_sel,
+                         xmlNode * a_node, gboolean * a_result)
+{
+        enum CRStatus status = CR_OK;
+        gint64 start = 0;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_this && a_node
+                              && a_result, CR_BAD_PARAM_ERROR);
+
+        if (a_node->type != XML_ELEMENT_NODE) {
+                *a_result = FALSE;
+                return CR_OK;
+        }
+
+        start = stats_phase_begin (a_this);
+        status = sel_matches_node_real (a_this, a_sel, a_node, a_result);
+        stats_phase_end (a_this, start, &PRIVATE (a_this)->stats.match_time);
+        return status;
+}
+
+/**
+ * cr_sel_eng_get_matched_rulesets:
+ *@a_this: the current instance of the selection engine.
+ *@a_sheet: the stylesheet that holds the selectors.
+ *@a_node: the xml node to consider during the walk thru
+ *the stylesheet.
+ *@a_rulesets: out parameter. A pointer to an array of
+ *rulesets statement pointers. *a_rulesets is allocated by
+ *this function and must be freed by the caller. However, the caller
+ *must not alter the rulesets statements pointer because they
+ *point to statements that are still in the css stylesheet.
+ *@a_len: the length of *a_ruleset.
+ *
+ *Returns an array of pointers to selectors that matches
+ *the xml node given in parameter.
+ *For each returned statement, the specificity of the most specific
+ *of its selectors that match the xml node is also stored in the
+ *"specificity" field of the statement. Use
+ *cr_sel_eng_get_matched_rulesets_with_specificities() to get it
+ *without writing into the stylesheet.
+ *
+ *Returns CR_OK upon sucessfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_get_matched_rulesets (CRSelEng * a_this,
+                                 CRStyleSheet * a_sheet,
+                                 xmlNode * a_node,
+                                 CRStatement *** a_rulesets, gulong * a_len)
+{
+        gulong *specs_tab = NULL;
+        enum CRStatus status = CR_OK;
+        gulong i = 0;
+
+        g_return_val_if_fail (a_this
+                              && a_sheet
+                              && a_node
+                              && a_rulesets && *a_rulesets == NULL
+                              && a_len, CR_BAD_PARAM_ERROR);
+
+        status = cr_sel_eng_get_matched_rulesets_with_specificities
+                (a_this, a_sheet, a_node, a_rulesets, &specs_tab, a_len);
+        if (status != CR_OK)
+                return status;
+        for (i = 0; i < *a_len; i++) {
+                (*a_rulesets)[i]->specificity = specs_tab[i];
+        }
+        g_free (specs_tab);
+        return CR_OK;
+}
+
+/**
+ * cr_sel_eng_get_matched_rulesets_with_specificities:
+ *@a_this: the current instance of the selection engine.
+ *@a_sheet: the stylesheet that holds the selectors.
+ *@a_node: the xml node to consider during the walk thru
+ *the stylesheet.
+ *@a_rulesets: out parameter. A pointer to an array of
+ *rulesets statement pointers. *a_rulesets is allocated by
+ *this function and must be freed by the caller. However, the caller
+ *must not alter the rulesets statements pointer because they
+ *point to statements that are still in the css stylesheet.
+ *@a_specificities: out parameter. A pointer to an array
+ *of the same length as *a_rulesets. (*a_specificities)[i] is the
+ *specificity of the most specific selector of (*a_rulesets)[i]
+ *that matches the xml node. *a_specificities is allocated by
+ *this function and must be freed by the caller.
+ *@a_len: the length of *a_ruleset.
+ *
+ *Like cr_sel_eng_get_matched_rulesets(), but returns the
+ *specificity each ruleset has been matched with next to it,
+ *and leaves the stylesheet untouched.
+ *
+ *Returns CR_OK upon sucessfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_get_matched_rulesets_with_specificities (CRSelEng * a_this,
+                                                    CRStyleSheet * a_sheet,
+                                                    xmlNode * a_node,
+                                                    CRStatement *** a_rulesets,
+                                                    gulong ** a_specificities,
+                                                    gulong * a_len)
+{
+        CRStatement **stmts_tab = NULL;
+        gulong *specs_tab = NULL;
+        enum CRStatus status = CR_OK;
+        gulong tab_size = 0,
+                tab_len = 0,
+                index = 0;
+        gushort stmts_chunck_size = 8;
+        gint64 start = 0;
+
+        g_return_val_if_fail (a_this
+                              && a_sheet
+                              && a_node
+                              && a_rulesets && *a_rulesets == NULL
+                              && a_specificities && *a_specificities == NULL
+                              && a_len, CR_BAD_PARAM_ERROR);
+
+        start = stats_phase_begin (a_this);
+        status = grow_matched_tabs (&stmts_tab, &specs_tab, &tab_size,
+                                    stmts_chunck_size);
+        if (status != CR_OK)
+                goto error;
+        tab_len = tab_size;
+
+        while ((status = cr_sel_eng_get_matched_rulesets_real
+                (a_this, a_sheet, a_node, stmts_tab + index,
+                 specs_tab + index, &tab_len))
+               == CR_OUTPUT_TOO_SHORT_ERROR) {
+                status = grow_matched_tabs (&stmts_tab, &specs_tab,
+                                            &tab_size, stmts_chunck_size);
+                if (status != CR_OK)
+                        goto error;
+                index += tab_len;
+                tab_len = tab_size - index;
+        }
+        if (status != CR_OK)
+                goto error;
+
+        *a_rulesets = stmts_tab;
+        *a_specificities = specs_tab;
+        *a_len = index + tab_len;
+
+        stats_phase_end (a_this, start, &PRIVATE (a_this)->stats.match_time);
+        return CR_OK;
+
+      error:
+
+        if (stmts_tab) {
+                g_free (stmts_tab);
+                stmts_tab = NULL;
+        }
+        if (specs_tab) {
+                g_free (specs_tab);
+                specs_tab = NULL;
+        }
+
+        *a_len = 0;
+        stats_phase_end (a_this, start, &PRIVATE (a_this)->stats.match_time);
+        return status;
+}
+
+/**
+ * cr_sel_eng_get_matched_rulesets_from_cascade:
+ *@a_this: the current instance of the selection engine.
+ *@a_cascade: the cascade to take the rulesets from.
+ *@a_node: the xml node to consider.
+ *@a_rulesets: the array the matched rulesets are put in.
+ *
+ *Gets the rulesets of all the sheets of a_cascade that match
+ *a_node, in cascade order: the rulesets of the UA sheets first,
+ *then those of the user sheets, then those of the author sheets,
+ *the sheets of each origin in the order they have been added.
+ *a_rulesets is emptied first. It is meant to be given again from
+ *one call to the other, so that no memory has to be allocated
+ *once it has grown large enough. The statements it holds belong
+ *to the stylesheets.
+ *
+ *The rulesets of the cascade are indexed at each call, so the
+ *sheets may be changed freely between two calls. To match many
+ *elements against the same rulesets, prefer
+ *cr_sel_eng_style_document(), which indexes them once per walk.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_get_matched_rulesets_from_cascade (CRSelEng * a_this,
+                                              CRCascade * a_cascade,
+                                              xmlNode * a_node,
+                                              GPtrArray * a_rulesets)
+{
+        GArray *rules = NULL;
+        enum CRStatus status = CR_OK;
+        guint i = 0;
+        gint64 start = 0;
+
+        g_return_val_if_fail (a_this && a_cascade && a_node && a_rulesets,
+                              CR_BAD_PARAM_ERROR);
+
+        start = stats_phase_begin (a_this);
+        g_ptr_array_set_size (a_rulesets, 0);
+        rules = PRIVATE (a_this)->matched_rules;
+        status = get_matched_rules_from_index (a_this, a_cascade, a_node,
+                                               rules);
+        for (i = 0; status == CR_OK && i < rules->len; i++) {
+                g_ptr_array_add (a_rulesets,
+                                 g_array_index (rules, struct CRMatchedRule,
+                                                i).ruleset);
+        }
+        release_rule_index (a_this);
+        stats_phase_end (a_this, start, &PRIVATE (a_this)->stats.match_time);
+        return status;
+}
+
+enum CRStatus
+cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
+                                                CRCascade * a_cascade,
+                                                xmlNode * a_node,
+                                                CRPropList ** a_props)
+{
+        struct CRCascadeTable table;
+        CRPropList *cur = NULL,
+                *props = NULL;
+        CRDeclaration *decl = NULL;
+        struct CRCascadedDecl *slot = NULL;
+        enum CRStatus status = CR_OK;
+        gint64 start = 0;
+        CRAllocator const *prev_allocator = NULL;
+
+        g_return_val_if_fail (a_this
+                              && a_cascade
+                              && a_node && a_props, CR_BAD_PARAM_ERROR);
+
+        start = stats_phase_begin (a_this);
+        prev_allocator = sel_eng_push_allocator (a_this);
+        cascade_table_init (&table);
+
+        /*
+         *The properties already in *a_props take part in
+         *the cascade with the lowest precedence: a matched
+         *declaration of the same property overrides them.
+         */
+        for (cur = *a_props; cur; cur = cr_prop_list_get_next (cur)) {
+                decl = NULL;
+                cr_prop_list_get_decl (cur, &decl);
+                if (!decl || !decl->property
+                    || !decl->property->stryng
+                    || !decl->property->stryng->str)
+                        continue;
+                slot = cascade_table_get_slot (&table, decl);
+                if (!slot) {
+                        status = CR_OUT_OF_MEMORY_ERROR;
+                        goto cleanup;
+                }
+                if (slot->decl)
+                        continue;
+                cascade_table_elect (&table, slot, decl);
+        }
+
+        status = get_matched_cascade_table (a_this, a_cascade, a_node,
+                                            &table);
+        if (status != CR_OK)
+                goto cleanup;
+        status = cascade_table_to_prop_list (&table, &props);
+        if (status != CR_OK)
+                goto cleanup;
+        if (*a_props) {
+                cr_prop_list_destroy (*a_props);
+        }
+        *a_props = props;
+
+ cleanup:
+        cascade_table_clear (&table);
+        release_rule_index (a_this);
+        sel_eng_pop_allocator (a_this, prev_allocator);
+        stats_phase_end (a_this, start, &PRIVATE (a_this)->stats.match_time);
+        return status;
+}
+
+enum CRStatus
+cr_sel_eng_get_matched_style (CRSelEng * a_this,
+                              CRCascade * a_cascade,
+                              xmlNode * a_node,
+                              CRStyle * a_parent_style, 
+                              CRStyle ** a_style,
+                              gboolean a_set_props_to_initial_values)
+{
+        enum CRStatus status = CR_OK;
+        struct CRCascadeTable table;
+        gint64 start = 0;
+        CRAllocator const *prev_allocator = NULL;
+
+        g_return_val_if_fail (a_this && a_cascade
+                              && a_node && a_style, CR_BAD_PARAM_ERROR);
+
+        start = stats_phase_begin (a_this);
+        prev_allocator = sel_eng_push_allocator (a_this);
+        cascade_table_init (&table);
+        status = get_matched_cascade_table (a_this, a_cascade, a_node,
+                                            &table);
+        if (status != CR_OK)
+                goto cleanup;
+        if (table.next_rank) {
+                if (!*a_style) {
+                        *a_style = cr_style_new (a_set_props_to_initial_values) ;
+                        if (!*a_style) {
+                                cr_utils_trace_info ("Out of memory");
+                                status = CR_ERROR;
+                                goto cleanup;
+                        }
+                } else {
+                        if (a_set_props_to_initial_values == TRUE) {
+                                cr_style_set_props_to_initial_values (*a_style) ;
+                        } else {
+                                cr_style_set_props_to_default_values (*a_style);
+                        }
+                }
+                (*a_style)->parent_style = a_parent_style;
+
+                set_style_from_cascade_table (*a_style, &table);
+        }
+
+ cleanup:
+        cascade_table_clear (&table);
+        release_rule_index (a_this);
+        sel_eng_pop_allocator (a_this, prev_allocator);
+        stats_phase_end (a_this, start, &PRIVATE (a_this)->stats.style_time);
+        return status;
+}
+
+/**
+ * cr_sel_eng_set_lazy_style_resolution:
+ *@a_this: the current instance of the selection engine.
+ *@a_lazy: TRUE to resolve the inherited properties on demand.
+ *
+ *By default, cr_sel_eng_style_document() and
+ *cr_sel_eng_style_document_parallel() resolve all the inherited
+ *properties of the style of each element before passing it to the
+ *style handler. If a_lazy is TRUE, they are left unresolved and
+ *the cr_style_get_computed_* () functions resolve the ones they read,
+ *which saves the work spent on the properties nobody reads.
+ *The fields of the styles must then not be read directly, and the
+ *properties of a style must be read while the styles of its
+ *ancestors are alive, e.g. from the style handler.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_set_lazy_style_resolution (CRSelEng * a_this, gboolean a_lazy)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->lazy_resolution = a_lazy;
+        return CR_OK;
+}
+
+/**
+ * cr_sel_eng_set_allocator:
+ *@a_this: the current instance of the selection engine.
+ *@a_allocator: the allocator, or NULL to use the current
+ *allocator of the calling thread. It is not copied.
+ *
+ *Makes the engine allocate the styles and the property lists
+ *it builds with @a_allocator, in the calling thread as in the
+ *worker threads of cr_sel_eng_style_document_parallel().
+ *@a_allocator must stay valid until they are destroyed.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_set_allocator (CRSelEng * a_this, CRAllocator const * a_allocator)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->allocator = a_allocator;
+        return CR_OK;
+}
+
+/**
+ * cr_sel_eng_set_limits:
+ *@a_this: the current instance of the selection engine.
+ *@a_limits: the limits, or NULL to remove them. They are copied.
  *
- *Evaluates a chained list of simple selectors (known as a css2 selector).
- *Says wheter if this selector matches the xml node given in parameter or
- *not.
+ *Bounds the selectors the engine tests against the elements,
+ *and sets a deadline or a cancel flag it stops at. Only the
+ *max_match_attempts, deadline, cancel_flag and check_interval
+ *fields of @a_limits matter here.
+ *A call that stops returns CR_LIMIT_EXCEEDED_ERROR or
+ *CR_CANCELLED_ERROR. The match attempts are counted from the
+ *call to this function on, and so do the calls that follow a
+ *stop fail at once, until the limits are set again.
+ *In cr_sel_eng_style_document_parallel(), all the worker
+ *threads spend the same max_match_attempts, and stop as soon
+ *as one of them stops.
  *
- *Returns the CR_OK if the selection ran correctly, an error code otherwise.
+ *Returns CR_OK upon successful completion, an error code otherwise.
  */
 enum CRStatus
-cr_sel_eng_matches_node (CRSelEng * a_this, CRSimpleSel * a_sel,
-                         xmlNode * a_node, gboolean * a_result)
+cr_sel_eng_set_limits (CRSelEng * a_this, CRLimits const * a_limits)
 {
-        g_return_val_if_fail (a_this && PRIVATE (a_this)
-                              && a_this && a_node
-                              && a_result, CR_BAD_PARAM_ERROR);
+        CRLimitsState *limits = NULL;
 
-        if (a_node->type != XML_ELEMENT_NODE) {
-                *a_result = FALSE;
-                return CR_OK;
-        }
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
 
-        return sel_matches_node_real (a_this, a_sel, 
-                                      a_node, a_result, 
-                                      TRUE, TRUE);
+        if (a_limits) {
+                limits = cr_limits_state_new (a_limits);
+                if (!limits)
+                        return CR_OUT_OF_MEMORY_ERROR;
+        }
+        if (PRIVATE (a_this)->limits)
+                cr_limits_state_unref (PRIVATE (a_this)->limits);
+        PRIVATE (a_this)->limits = limits;
+        return CR_OK;
 }
 
 /**
- * cr_sel_eng_get_matched_rulesets:
+ * cr_sel_eng_set_stats_enabled:
  *@a_this: the current instance of the selection engine.
- *@a_sheet: the stylesheet that holds the selectors.
- *@a_node: the xml node to consider during the walk thru
- *the stylesheet.
- *@a_rulesets: out parameter. A pointer to an array of
- *rulesets statement pointers. *a_rulesets is allocated by
- *this function and must be freed by the caller. However, the caller
- *must not alter the rulesets statements pointer because they
- *point to statements that are still in the css stylesheet.
- *@a_len: the length of *a_ruleset.
+ *@a_enabled: whether to gather statistics.
  *
- *Returns an array of pointers to selectors that matches
- *the xml node given in parameter.
+ *Makes the engine count the simple selectors it tests and the
+ *ones that match, per combinator, the attribute lookups, the
+ *objects allocated and the time spent matching, building styles
+ *and walking documents. The statistics are not gathered by
+ *default; when they are not, they cost the engine nothing but a
+ *test per simple selector. The engines of the worker threads of
+ *cr_sel_eng_style_document_parallel() add their counts to the
+ *ones of a_this when the walk is over.
+ *See cr_sel_eng_get_stats().
  *
- *Returns CR_OK upon sucessfull completion, an error code otherwise.
+ *Returns CR_OK upon successful completion, an error code otherwise.
  */
 enum CRStatus
-cr_sel_eng_get_matched_rulesets (CRSelEng * a_this,
-                                 CRStyleSheet * a_sheet,
-                                 xmlNode * a_node,
-                                 CRStatement *** a_rulesets, gulong * a_len)
+cr_sel_eng_set_stats_enabled (CRSelEng * a_this, gboolean a_enabled)
 {
-        CRStatement **stmts_tab = NULL;
-        enum CRStatus status = CR_OK;
-        gulong tab_size = 0,
-                tab_len = 0,
-                index = 0;
-        gushort stmts_chunck_size = 8;
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
 
-        g_return_val_if_fail (a_this
-                              && a_sheet
-                              && a_node
-                              && a_rulesets && *a_rulesets == NULL
-                              && a_len, CR_BAD_PARAM_ERROR);
+        PRIVATE (a_this)->stats_enabled = a_enabled;
+        return CR_OK;
+}
 
-        stmts_tab = g_try_malloc (stmts_chunck_size * sizeof (CRStatement *));
+/**
+ * cr_sel_eng_get_stats:
+ *@a_this: the current instance of the selection engine.
+ *@a_stats: out parameter. The statistics gathered since the
+ *last call to cr_sel_eng_reset_stats().
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_get_stats (CRSelEng const * a_this, CRSelEngStats * a_stats)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_stats,
+                              CR_BAD_PARAM_ERROR);
 
-        if (!stmts_tab) {
-                cr_utils_trace_info ("Out of memory");
-                status = CR_ERROR;
-                goto error;
-        }
-        memset (stmts_tab, 0, stmts_chunck_size * sizeof (CRStatement *));
+        memcpy (a_stats, &PRIVATE (a_this)->stats, sizeof (CRSelEngStats));
+        return CR_OK;
+}
 
-        tab_size = stmts_chunck_size;
-        tab_len = tab_size;
+/**
+ * cr_sel_eng_reset_stats:
+ *@a_this: the current instance of the selection engine.
+ *
+ *Sets all the statistics of the engine to zero.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_reset_stats (CRSelEng * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
 
-        while ((status = cr_sel_eng_get_matched_rulesets_real
-                (a_this, a_sheet, a_node, stmts_tab + index, &tab_len))
-               == CR_OUTPUT_TOO_SHORT_ERROR) {
-                stmts_tab = g_try_realloc (stmts_tab,
-                                           (tab_size + stmts_chunck_size)
-                                           * sizeof (CRStatement *));
-                if (!stmts_tab) {
+        memset (&PRIVATE (a_this)->stats, 0, sizeof (CRSelEngStats));
+        return CR_OK;
+}
+
+/**
+ * cr_sel_eng_set_selector_profiling:
+ *@a_this: the current instance of the selection engine.
+ *@a_enabled: whether to profile the selectors.
+ *
+ *Makes the engine record, for each selector of the rulesets it
+ *matches against, the number of times the ancestor filter told it
+ *could not match, the number of times it has been matched and has
+ *matched, and the number of simple selectors tested to match it,
+ *that is, the steps taken up and across the document tree. The
+ *last one is where the expensive descendant selectors show up.
+ *Disabling the profiling keeps what has been recorded so far.
+ *See cr_sel_eng_dump_selector_profile().
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_set_selector_profiling (CRSelEng * a_this, gboolean a_enabled)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        if (a_enabled == TRUE && !PRIVATE (a_this)->sel_profiles) {
+                PRIVATE (a_this)->sel_profiles = g_hash_table_new_full
+                        (g_direct_hash, g_direct_equal, NULL,
+                         sel_profile_free);
+                if (!PRIVATE (a_this)->sel_profiles) {
                         cr_utils_trace_info ("Out of memory");
-                        status = CR_ERROR;
-                        goto error;
+                        return CR_OUT_OF_MEMORY_ERROR;
                 }
-                tab_size += stmts_chunck_size;
-                index += tab_len;
-                tab_len = tab_size - index;
         }
+        PRIVATE (a_this)->profile_selectors = a_enabled;
+        return CR_OK;
+}
 
-        tab_len = tab_size - stmts_chunck_size + tab_len;
-        *a_rulesets = stmts_tab;
-        *a_len = tab_len;
+/**
+ * cr_sel_eng_reset_selector_profile:
+ *@a_this: the current instance of the selection engine.
+ *
+ *Forgets what has been recorded about the selectors. The profile
+ *is keyed by the address of the selectors, so it must be reset
+ *before matching against stylesheets built after the ones it
+ *has been recorded against have been destroyed.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_reset_selector_profile (CRSelEng * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
 
+        if (PRIVATE (a_this)->sel_profiles)
+                g_hash_table_remove_all (PRIVATE (a_this)->sel_profiles);
         return CR_OK;
+}
 
-      error:
-
-        if (stmts_tab) {
-                g_free (stmts_tab);
-                stmts_tab = NULL;
+/**
+ * cr_sel_eng_dump_selector_profile:
+ *@a_this: the current instance of the selection engine.
+ *@a_max: the number of selectors to dump, 0 to dump them all.
+ *@a_fp: the file to dump to.
+ *
+ *Dumps the selectors recorded by the profiling, the most
+ *expensive first: by decreasing number of steps, then of
+ *attempts. Each line gives the steps, the attempts, the
+ *matches, the filter rejections, the location of the selector
+ *in its stylesheet and the selector itself.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_dump_selector_profile (CRSelEng const * a_this, guint a_max,
+                                  FILE * a_fp)
+{
+        GPtrArray *profiles = NULL;
+        GHashTableIter iter;
+        gpointer value = NULL;
+        struct CRSelProfile *profile = NULL;
+        guint i = 0;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_fp,
+                              CR_BAD_PARAM_ERROR);
+
+        fprintf (a_fp, "%10s %10s %10s %10s  %-20s %s\n",
+                 "steps", "attempts", "matches", "filtered",
+                 "location", "selector");
+        if (!PRIVATE (a_this)->sel_profiles)
+                return CR_OK;
 
+        profiles = g_ptr_array_sized_new
+                (g_hash_table_size (PRIVATE (a_this)->sel_profiles));
+        g_hash_table_iter_init (&iter, PRIVATE (a_this)->sel_profiles);
+        while (g_hash_table_iter_next (&iter, NULL, &value)) {
+                g_ptr_array_add (profiles, value);
         }
-
-        *a_len = 0;
-        return status;
+        g_ptr_array_sort (profiles, compare_sel_profiles);
+        for (i = 0; i < profiles->len && (!a_max || i < a_max); i++) {
+                profile = g_ptr_array_index (profiles, i);
+                fprintf (a_fp, "%10lu %10lu %10lu %10lu  %6u:%-13u %s\n",
+                         profile->nb_steps, profile->nb_attempts,
+                         profile->nb_matches, profile->nb_filtered,
+                         profile->location.line, profile->location.column,
+                         profile->text ? profile->text : "");
+        }
+        g_ptr_array_free (profiles, TRUE);
+        return CR_OK;
 }
 
+/**
+ *Estimates the memory used by the slots of a hash table,
+ *each slot holding a key, a value and a hash.
+ */
+static gulong
+hash_table_mem_usage (GHashTable * a_table)
+{
+        if (!a_table)
+                return 0;
+        return g_hash_table_size (a_table)
+                * (2 * sizeof (gpointer) + sizeof (guint));
+}
 
-enum CRStatus
-cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
-                                                CRCascade * a_cascade,
-                                                xmlNode * a_node,
-                                                CRPropList ** a_props)
+static void
+add_rule_index_mem_usage (CRMemUsage * a_usage,
+                          struct CRRuleIndex *a_index)
 {
-        CRStatement **stmts_tab = NULL;
-        enum CRStatus status = CR_OK;
-        gulong tab_size = 0,
-                tab_len = 0,
-                i = 0,
-                index = 0;
-        enum CRStyleOrigin origin = 0;
-        gushort stmts_chunck_size = 8;
-        CRStyleSheet *sheet = NULL;
+        GHashTableIter iter;
+        gpointer value = NULL;
+        GArray *bucket = NULL;
+
+        a_usage->bytes[CR_MEM_INDICES] += sizeof (struct CRRuleIndex)
+                + hash_table_mem_usage (a_index->buckets)
+                + sizeof (GArray)
+                + a_index->universal->len * sizeof (struct CRRuleIndexEntry);
+        g_hash_table_iter_init (&iter, a_index->buckets);
+        while (g_hash_table_iter_next (&iter, NULL, &value)) {
+                bucket = value;
+                a_usage->bytes[CR_MEM_INDICES] += sizeof (GArray)
+                        + bucket->len * sizeof (struct CRRuleIndexEntry);
+        }
+}
 
-        g_return_val_if_fail (a_this
-                              && a_cascade
-                              && a_node && a_props, CR_BAD_PARAM_ERROR);
+static void
+add_rule_tree_mem_usage (CRMemUsage * a_usage, struct CRRuleNode *a_node)
+{
+        struct CRRuleNode *cur = NULL;
 
-        for (origin = ORIGIN_UA; origin < NB_ORIGINS; origin++) {
-                sheet = cr_cascade_get_sheet (a_cascade, origin);
-                if (!sheet)
-                        continue;
-                if (tab_size - index < 1) {
-                        stmts_tab = g_try_realloc
-                                (stmts_tab, (tab_size + stmts_chunck_size)
-                                 * sizeof (CRStatement *));
-                        if (!stmts_tab) {
-                                cr_utils_trace_info ("Out of memory");
-                                status = CR_ERROR;
-                                goto cleanup;
-                        }
-                        tab_size += stmts_chunck_size;
-                        /*
-                         *compute the max size left for
-                         *cr_sel_eng_get_matched_rulesets_real()'s output tab 
-                         */
-                        tab_len = tab_size - index;
-                }
-                while ((status = cr_sel_eng_get_matched_rulesets_real
-                        (a_this, sheet, a_node, stmts_tab + index, &tab_len))
-                       == CR_OUTPUT_TOO_SHORT_ERROR) {
-                        stmts_tab = g_try_realloc
-                                (stmts_tab, (tab_size + stmts_chunck_size)
-                                 * sizeof (CRStatement *));
-                        if (!stmts_tab) {
-                                cr_utils_trace_info ("Out of memory");
-                                status = CR_ERROR;
-                                goto cleanup;
-                        }
-                        tab_size += stmts_chunck_size;
-                        index += tab_len;
-                        /*
-                         *compute the max size left for
-                         *cr_sel_eng_get_matched_rulesets_real()'s output tab 
-                         */
-                        tab_len = tab_size - index;
-                }
-                if (status != CR_OK) {
-                        cr_utils_trace_info ("Error while running "
-                                             "selector engine");
-                        goto cleanup;
-                }
-                index += tab_len;
-                tab_len = tab_size - index;
+        a_usage->bytes[CR_MEM_INDICES] += sizeof (struct CRRuleNode);
+        if (a_node->style)
+                cr_style_get_memory_usage (a_node->style, a_usage);
+        for (cur = a_node->children; cur; cur = cur->next) {
+                add_rule_tree_mem_usage (a_usage, cur);
         }
+}
 
-        /*
-         *TODO, walk down the stmts_tab and build the
-         *property_name/declaration hashtable.
-         *Make sure one can walk from the declaration to
-         *the stylesheet.
-         */
-        for (i = 0; i < index; i++) {
-                CRStatement *stmt = stmts_tab[i];
-
-                if (!stmt)
-                        continue;
-                switch (stmt->type) {
-                case RULESET_STMT:
-                        if (!stmt->parent_sheet)
-                                continue;
-                        status = put_css_properties_in_props_list
-                                (a_props, stmt);
-                        break;
-                default:
-                        break;
-                }
+/**
+ * cr_sel_eng_get_memory_usage:
+ *@a_this: the current instance of the selection engine.
+ *@a_usage: the memory usage the bytes used are added to, so
+ *that the usage of several objects can be summed. Clear it
+ *before the first call.
+ *
+ *Estimates the memory used by the engine, per category: mostly
+ *the rule index it keeps for the last cascade it matched
+ *against, and the selector profile. The caches of a document
+ *walk are counted while the walk is running only.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_get_memory_usage (CRSelEng const * a_this, CRMemUsage * a_usage)
+{
+        GList *cur = NULL;
+        GHashTableIter iter;
+        gpointer value = NULL;
+        struct CRSelProfile *profile = NULL;
+        struct CRPseudoClassSelHandlerEntry *entry = NULL;
 
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_usage,
+                              CR_BAD_PARAM_ERROR);
+
+        a_usage->bytes[CR_MEM_OTHER] += sizeof (CRSelEng)
+                + sizeof (CRSelEngPriv);
+        for (cur = PRIVATE (a_this)->pcs_handlers; cur; cur = cur->next) {
+                entry = cur->data;
+                a_usage->bytes[CR_MEM_OTHER] += sizeof (GList)
+                        + sizeof (struct CRPseudoClassSelHandlerEntry);
+                if (entry && entry->name)
+                        a_usage->bytes[CR_MEM_STRINGS] +=
+                                strlen ((const char *) entry->name) + 1;
         }
-        status = CR_OK ;
- cleanup:
-        if (stmts_tab) {
-                g_free (stmts_tab);
-                stmts_tab = NULL;
+        if (PRIVATE (a_this)->rule_index)
+                add_rule_index_mem_usage (a_usage,
+                                          PRIVATE (a_this)->rule_index);
+        if (PRIVATE (a_this)->rule_tree)
+                add_rule_tree_mem_usage (a_usage,
+                                         PRIVATE (a_this)->rule_tree);
+        if (PRIVATE (a_this)->ancestor_filter)
+                a_usage->bytes[CR_MEM_INDICES] += ANCESTOR_FILTER_SIZE;
+        if (PRIVATE (a_this)->sel_hashes)
+                a_usage->bytes[CR_MEM_INDICES] +=
+                        hash_table_mem_usage (PRIVATE (a_this)->sel_hashes)
+                        + g_hash_table_size (PRIVATE (a_this)->sel_hashes)
+                        * sizeof (struct CRSelAncestorHashes);
+        if (PRIVATE (a_this)->match_memo)
+                a_usage->bytes[CR_MEM_INDICES] +=
+                        hash_table_mem_usage (PRIVATE (a_this)->match_memo)
+                        + g_hash_table_size (PRIVATE (a_this)->match_memo)
+                        * sizeof (struct CRMatchMemoKey);
+        if (PRIVATE (a_this)->sel_profiles) {
+                a_usage->bytes[CR_MEM_OTHER] +=
+                        hash_table_mem_usage (PRIVATE (a_this)->sel_profiles);
+                g_hash_table_iter_init (&iter,
+                                        PRIVATE (a_this)->sel_profiles);
+                while (g_hash_table_iter_next (&iter, NULL, &value)) {
+                        profile = value;
+                        a_usage->bytes[CR_MEM_OTHER] +=
+                                sizeof (struct CRSelProfile);
+                        if (profile->text)
+                                a_usage->bytes[CR_MEM_STRINGS] +=
+                                        strlen (profile->text) + 1;
+                }
         }
-
-        return status;
+        return CR_OK;
 }
 
+/**
+ * cr_sel_eng_style_document:
+ *@a_this: the current instance of the selection engine.
+ *@a_cascade: the cascade to take the style rules from.
+ *@a_doc: the xml document to style.
+ *@a_handler: the function called with the style of each element.
+ *@a_user_data: the user data passed to a_handler.
+ *
+ *Computes the style of every element of a_doc in a single
+ *top-down walk of the tree.
+ *Unlike cr_sel_eng_get_matched_style(), the style of the parent
+ *of each element is known during the walk and is used to resolve
+ *the inherited properties. The names, ids and classes of the
+ *ancestors of the current element are kept in a filter that lets
+ *the engine skip most of the descendant and child selectors that
+ *cannot match, without climbing up to the root.
+ *
+ *Elements whose parents have the same style and that cannot be
+ *told apart by the selectors of the cascade (same name, id, class,
+ *attributes used by attribute selectors, and so on) are
+ *given the same style instance: the style of a recently styled
+ *sibling or cousin is reused instead of being computed again.
+ *
+ *a_handler is called once per element, in document order, after
+ *the style of the element is computed and before its children are
+ *styled. The style passed to a_handler belongs to the engine and
+ *is released when the subtree of the element has been styled; call
+ *cr_style_ref() on it to keep it around. As it may be shared
+ *with other elements, a_handler must not modify it. Note that the
+ *parent_style field of a style that outlives the walk must not be
+ *dereferenced unless the parent style has been kept as well.
+ *If a_handler returns something else than CR_OK, the walk stops
+ *and that status is returned.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
 enum CRStatus
-cr_sel_eng_get_matched_style (CRSelEng * a_this,
-                              CRCascade * a_cascade,
-                              xmlNode * a_node,
-                              CRStyle * a_parent_style, 
-                              CRStyle ** a_style,
-                              gboolean a_set_props_to_initial_values)
+cr_sel_eng_style_document (CRSelEng * a_this,
+                           CRCascade * a_cascade,
+                           xmlDoc * a_doc,
+                           CRSelEngStyleHandler a_handler,
+                           gpointer a_user_data)
 {
         enum CRStatus status = CR_OK;
+        xmlNode *root = NULL;
+        gint64 start = 0;
+        CRAllocator const *prev_allocator = NULL;
 
-        CRPropList *props = NULL;
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_cascade && a_doc && a_handler,
+                              CR_BAD_PARAM_ERROR);
+
+        root = xmlDocGetRootElement (a_doc);
+        if (!root)
+                return CR_NO_ROOT_NODE_ERROR;
+
+        start = stats_phase_begin (a_this);
+        prev_allocator = sel_eng_push_allocator (a_this);
+        status = style_document_walk_begin (a_this, a_cascade);
+        if (status == CR_OK)
+                status = style_document_element (a_this, a_cascade, root,
+                                                 NULL, a_handler,
+                                                 a_user_data);
+        style_document_walk_end (a_this);
+        sel_eng_pop_allocator (a_this, prev_allocator);
+        stats_phase_end (a_this, start, &PRIVATE (a_this)->stats.walk_time);
+        return status;
+}
 
-        g_return_val_if_fail (a_this && a_cascade
-                              && a_node && a_style, CR_BAD_PARAM_ERROR);
+/**
+ * cr_sel_eng_style_document_parallel:
+ *@a_this: the current instance of the selection engine.
+ *@a_cascade: the cascade to take the style rules from.
+ *@a_doc: the xml document to style.
+ *@a_nb_threads: the number of worker threads to use. If 0, use
+ *as many threads as there are processors.
+ *@a_handler: the function called with the style of each element.
+ *@a_user_data: the user data passed to a_handler.
+ *
+ *Computes the style of every element of a_doc like
+ *cr_sel_eng_style_document() does, but spreads the work over
+ *a_nb_threads threads.
+ *The top of the tree is styled by the calling thread until the
+ *document is split into enough independent subtrees; each subtree
+ *is then styled by a worker thread with its own copy of the
+ *selection engine and its own ancestor filter. The style of the
+ *parent of each subtree is handed down to the worker that styles
+ *it and is kept alive until all the workers are done.
+ *
+ *Neither a_cascade nor a_doc may be modified during the call.
+ *The pseudo class handlers registered in a_this must be
+ *safe to call from several threads at once.
+ *
+ *a_handler is called once per element, from the calling thread
+ *or from a worker thread, and may be called by several threads at
+ *once. The handler of an element is always called before the ones
+ *of its children, but the elements are not visited in document
+ *order. The ownership rules of the style passed to a_handler are
+ *the ones of cr_sel_eng_style_document(); a_handler must not call
+ *cr_style_ref() or cr_style_unref() on the parent style.
+ *If a_handler returns something else than CR_OK, no new subtree
+ *is started and the first such status is returned.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_style_document_parallel (CRSelEng * a_this,
+                                    CRCascade * a_cascade,
+                                    xmlDoc * a_doc,
+                                    guint a_nb_threads,
+                                    CRSelEngStyleHandler a_handler,
+                                    gpointer a_user_data)
+{
+        enum CRStatus status = CR_OK;
+        struct CRStyleTaskCtxt ctxt;
+        struct CRStyleTask *task = NULL,
+                *cur_task = NULL;
+        GPtrArray *tasks = NULL;
+        GList *kept_styles = NULL,
+                *cur = NULL;
+        GThreadPool *pool = NULL;
+        CRSelEng *engine = NULL;
+        CRStyle *style = NULL;
+        xmlNode *root = NULL,
+                *cur_node = NULL;
+        guint head = 0,
+                i = 0;
+        gint64 start = 0;
+        CRAllocator const *prev_allocator = NULL;
 
-        status = cr_sel_eng_get_matched_properties_from_cascade
-                (a_this, a_cascade, a_node, &props);
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_cascade && a_doc && a_handler,
+                              CR_BAD_PARAM_ERROR);
+
+        root = xmlDocGetRootElement (a_doc);
+        if (!root)
+                return CR_NO_ROOT_NODE_ERROR;
+
+        if (a_nb_threads == 0)
+                a_nb_threads = g_get_num_processors ();
+        if (a_nb_threads < 2)
+                return cr_sel_eng_style_document (a_this, a_cascade, a_doc,
+                                                  a_handler, a_user_data);
+
+        memset (&ctxt, 0, sizeof (ctxt));
+        ctxt.cascade = a_cascade;
+        ctxt.handler = a_handler;
+        ctxt.user_data = a_user_data;
+        ctxt.status = CR_OK;
+        g_mutex_init (&ctxt.lock);
+        ctxt.engines = g_async_queue_new ();
+        tasks = g_ptr_array_new ();
+
+        start = stats_phase_begin (a_this);
+        prev_allocator = sel_eng_push_allocator (a_this);
+        status = style_document_walk_begin (a_this, a_cascade);
+        if (status != CR_OK)
+                goto cleanup;
 
-        g_return_val_if_fail (status == CR_OK, status);
-        if (props) {
-                if (!*a_style) {
-                        *a_style = cr_style_new (a_set_props_to_initial_values) ;
-                        g_return_val_if_fail (*a_style, CR_ERROR);
-                } else {
-                        if (a_set_props_to_initial_values == TRUE) {
-                                cr_style_set_props_to_initial_values (*a_style) ;
-                        } else {
-                                cr_style_set_props_to_default_values (*a_style);
+        /*
+         *style the top of the tree, breadth first, until
+         *there are enough subtrees left to style.
+         */
+        task = style_task_new (root, NULL);
+        if (!task) {
+                status = CR_OUT_OF_MEMORY_ERROR;
+                goto cleanup;
+        }
+        g_ptr_array_add (tasks, task);
+        while (head < tasks->len
+               && tasks->len - head
+               < a_nb_threads * STYLE_TASKS_PER_THREAD) {
+                cur_task = g_ptr_array_index (tasks, head);
+                g_ptr_array_index (tasks, head) = NULL;
+                head++;
+
+                ancestor_filter_load (a_this, cur_task->node);
+                style = NULL;
+                status = style_document_node (a_this, a_cascade,
+                                              cur_task->node,
+                                              cur_task->parent_style,
+                                              &style);
+                if (status == CR_OK) {
+                        kept_styles = g_list_prepend (kept_styles, style);
+                        status = a_handler (a_this, cur_task->node, style,
+                                            a_user_data);
+                }
+                for (cur_node = cur_task->node->children;
+                     status == CR_OK && cur_node;
+                     cur_node = cur_node->next) {
+                        if (cur_node->type != XML_ELEMENT_NODE)
+                                continue;
+                        task = style_task_new (cur_node, style);
+                        if (!task) {
+                                status = CR_OUT_OF_MEMORY_ERROR;
+                                break;
                         }
+                        g_ptr_array_add (tasks, task);
                 }
-                (*a_style)->parent_style = a_parent_style;
+                g_free (cur_task);
+                cur_task = NULL;
+                if (status != CR_OK)
+                        goto cleanup;
+        }
+        if (head == tasks->len)
+                goto cleanup;
 
-                set_style_from_props (*a_style, props);
-                if (props) {
-                        cr_prop_list_destroy (props);
-                        props = NULL;
+        for (i = 0; i < a_nb_threads; i++) {
+                engine = clone_for_worker (a_this, a_cascade);
+                if (!engine) {
+                        status = CR_OUT_OF_MEMORY_ERROR;
+                        goto cleanup;
                 }
+                g_async_queue_push (ctxt.engines, engine);
         }
-        return CR_OK;
+        pool = g_thread_pool_new (style_task_run, &ctxt, a_nb_threads,
+                                  TRUE, NULL);
+        if (!pool) {
+                cr_utils_trace_info ("Could not create the worker threads");
+                status = CR_ERROR;
+                goto cleanup;
+        }
+        for (; head < tasks->len; head++) {
+                g_thread_pool_push (pool, g_ptr_array_index (tasks, head),
+                                    NULL);
+                g_ptr_array_index (tasks, head) = NULL;
+        }
+        /*wait for all the subtrees to be styled*/
+        g_thread_pool_free (pool, FALSE, TRUE);
+        pool = NULL;
+        status = ctxt.status;
+
+ cleanup:
+        for (; head < tasks->len; head++) {
+                if (g_ptr_array_index (tasks, head))
+                        g_free (g_ptr_array_index (tasks, head));
+        }
+        g_ptr_array_free (tasks, TRUE);
+        while ((engine = g_async_queue_try_pop (ctxt.engines))) {
+                if (PRIVATE (a_this)->stats_enabled == TRUE)
+                        stats_merge (a_this, engine);
+                if (PRIVATE (a_this)->profile_selectors == TRUE
+                    && PRIVATE (engine)->sel_profiles)
+                        sel_profile_merge (a_this, engine);
+                style_document_walk_end (engine);
+                cr_sel_eng_destroy (engine);
+        }
+        g_async_queue_unref (ctxt.engines);
+        for (cur = kept_styles; cur; cur = cur->next) {
+                cr_style_unref (cur->data);
+        }
+        g_list_free (kept_styles);
+        style_document_walk_end (a_this);
+        sel_eng_pop_allocator (a_this, prev_allocator);
+        stats_phase_end (a_this, start, &PRIVATE (a_this)->stats.walk_time);
+        g_mutex_clear (&ctxt.lock);
+        return status;
 }
 
 /**
@@ -1570,6 +4444,30 @@ cr_sel_eng_destroy (CRSelEng * a_this)
                         (a_this) ;
                 PRIVATE (a_this)->pcs_handlers = NULL ;
         }
+        if (PRIVATE (a_this)->rule_index) {
+                rule_index_unref (PRIVATE (a_this)->rule_index);
+                PRIVATE (a_this)->rule_index = NULL;
+        }
+        if (PRIVATE (a_this)->candidates) {
+                g_ptr_array_free (PRIVATE (a_this)->candidates, TRUE);
+                PRIVATE (a_this)->candidates = NULL;
+        }
+        if (PRIVATE (a_this)->matched_rules) {
+                g_array_free (PRIVATE (a_this)->matched_rules, TRUE);
+                PRIVATE (a_this)->matched_rules = NULL;
+        }
+        if (PRIVATE (a_this)->blocks) {
+                g_array_free (PRIVATE (a_this)->blocks, TRUE);
+                PRIVATE (a_this)->blocks = NULL;
+        }
+        if (PRIVATE (a_this)->sel_profiles) {
+                g_hash_table_destroy (PRIVATE (a_this)->sel_profiles);
+                PRIVATE (a_this)->sel_profiles = NULL;
+        }
+        if (PRIVATE (a_this)->limits) {
+                cr_limits_state_unref (PRIVATE (a_this)->limits);
+                PRIVATE (a_this)->limits = NULL;
+        }
         g_free (PRIVATE (a_this));
         PRIVATE (a_this) = NULL;
  end:
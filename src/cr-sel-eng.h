@@ -29,6 +29,9 @@
 #include "cr-cascade.h"
 #include "cr-style.h"
 #include "cr-prop-list.h"
+#include "cr-stats.h"
+#include "cr-allocator.h"
+#include "cr-limits.h"
 
 #include <libxml/tree.h>
 
@@ -60,6 +63,17 @@ struct _CRSelEng
 typedef gboolean (*CRPseudoClassSelectorHandler) (CRSelEng* a_this,
                                                   CRAdditionalSel *a_add_sel,
                                                   xmlNode *a_node) ;
+
+/**
+ *The function called by cr_sel_eng_style_document() and
+ *cr_sel_eng_style_document_parallel() with the computed style of each element of the document.
+ *Returning something else than CR_OK stops the walk.
+ */
+typedef enum CRStatus (*CRSelEngStyleHandler) (CRSelEng *a_this,
+                                               xmlNode *a_node,
+                                               CRStyle *a_style,
+                                               gpointer a_user_data) ;
+
 CRSelEng * cr_sel_eng_new (void) ;
 
 enum CRStatus cr_sel_eng_register_pseudo_class_sel_handler (CRSelEng *a_this,
@@ -89,6 +103,18 @@ enum CRStatus cr_sel_eng_get_matched_rulesets (CRSelEng *a_this,
                                                CRStatement ***a_rulesets,
                                                gulong *a_len) ;
 
+enum CRStatus cr_sel_eng_get_matched_rulesets_with_specificities (CRSelEng *a_this,
+                                                                  CRStyleSheet *a_sheet,
+                                                                  xmlNode *a_node,
+                                                                  CRStatement ***a_rulesets,
+                                                                  gulong **a_specificities,
+                                                                  gulong *a_len) ;
+
+enum CRStatus cr_sel_eng_get_matched_rulesets_from_cascade (CRSelEng *a_this,
+                                                            CRCascade *a_cascade,
+                                                            xmlNode *a_node,
+                                                            GPtrArray *a_rulesets) ;
+
 enum CRStatus
 cr_sel_eng_get_matched_properties_from_cascade  (CRSelEng *a_this,
                                                  CRCascade *a_cascade,
@@ -102,6 +128,48 @@ enum CRStatus cr_sel_eng_get_matched_style (CRSelEng *a_this,
                                             CRStyle **a_style,
                                             gboolean a_set_props_to_initial_values) ;
 
+enum CRStatus cr_sel_eng_set_lazy_style_resolution (CRSelEng *a_this,
+                                                   gboolean a_lazy) ;
+
+enum CRStatus cr_sel_eng_set_allocator (CRSelEng *a_this,
+                                        CRAllocator const *a_allocator) ;
+
+enum CRStatus cr_sel_eng_set_limits (CRSelEng *a_this,
+                                     CRLimits const *a_limits) ;
+
+enum CRStatus cr_sel_eng_set_stats_enabled (CRSelEng *a_this,
+                                            gboolean a_enabled) ;
+
+enum CRStatus cr_sel_eng_get_stats (CRSelEng const *a_this,
+                                    CRSelEngStats *a_stats) ;
+
+enum CRStatus cr_sel_eng_reset_stats (CRSelEng *a_this) ;
+
+enum CRStatus cr_sel_eng_set_selector_profiling (CRSelEng *a_this,
+                                                 gboolean a_enabled) ;
+
+enum CRStatus cr_sel_eng_reset_selector_profile (CRSelEng *a_this) ;
+
+enum CRStatus cr_sel_eng_dump_selector_profile (CRSelEng const *a_this,
+                                                guint a_max,
+                                                FILE *a_fp) ;
+
+enum CRStatus cr_sel_eng_get_memory_usage (CRSelEng const *a_this,
+                                           CRMemUsage *a_usage) ;
+
+enum CRStatus cr_sel_eng_style_document (CRSelEng *a_this,
+                                         CRCascade *a_cascade,
+                                         xmlDoc *a_doc,
+                                         CRSelEngStyleHandler a_handler,
+                                         gpointer a_user_data) ;
+
+enum CRStatus cr_sel_eng_style_document_parallel (CRSelEng *a_this,
+                                                  CRCascade *a_cascade,
+                                                  xmlDoc *a_doc,
+                                                  guint a_nb_threads,
+                                                  CRSelEngStyleHandler a_handler,
+                                                  gpointer a_user_data) ;
+
 void cr_sel_eng_destroy (CRSelEng *a_this) ;
 
 G_END_DECLS
@@ -23,6 +23,8 @@
 #include <string.h>
 #include "cr-selector.h"
 #include "cr-parser.h"
+#include "cr-stats-priv.h"
+#include "cr-allocator-priv.h"
 
 /**
  * cr_selector_new:
@@ -30,7 +32,8 @@
  *@a_simple_sel: the initial simple selector list
  *of the current instance of #CRSelector.
  *
- *Creates a new instance of #CRSelector.
+ *Creates a new instance of #CRSelector and computes
+ *the specificity of a_simple_sel.
  *
  *Returns the newly built instance of #CRSelector, or
  *NULL in case of failure.
@@ -40,13 +43,18 @@ cr_selector_new (CRSimpleSel * a_simple_sel)
 {
         CRSelector *result = NULL;
 
-        result = g_try_malloc (sizeof (CRSelector));
+        result = cr_allocator_alloc (sizeof (CRSelector));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
         memset (result, 0, sizeof (CRSelector));
+        cr_stats_count_alloc (CR_STATS_SELECTOR);
         result->simple_sel = a_simple_sel;
+        if (a_simple_sel) {
+                cr_simple_sel_compute_specificity (a_simple_sel);
+                result->specificity = a_simple_sel->specificity;
+        }
         return result;
 }
 
@@ -137,6 +145,62 @@ cr_selector_append_simple_sel (CRSelector * a_this,
         return cr_selector_append (a_this, selector);
 }
 
+/**
+ * cr_selector_compute_specificity:
+ *
+ *@a_this: the current instance of #CRSelector.
+ *
+ *Computes again the specificity of each selector of the
+ *list headed by a_this. The specificity is computed when a
+ *selector is built, so this is only needed after
+ *the simple selectors of a selector have been changed.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_selector_compute_specificity (CRSelector * a_this)
+{
+        CRSelector *cur = NULL;
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
+
+        for (cur = a_this; cur; cur = cur->next) {
+                if (!cur->simple_sel) {
+                        cur->specificity = 0;
+                        continue;
+                }
+                status = cr_simple_sel_compute_specificity
+                        (cur->simple_sel);
+                if (status != CR_OK)
+                        return status;
+                cur->specificity = cur->simple_sel->specificity;
+        }
+        return CR_OK;
+}
+
+/**
+ * cr_selector_get_specificity:
+ *
+ *@a_this: the current instance of #CRSelector.
+ *@a_specificity: out parameter. The specificity of
+ *the current selector (not of the whole list).
+ *
+ *Gets the specificity of the selector, as defined in chapter
+ *6.4.3 of the css2 spec.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_selector_get_specificity (CRSelector const * a_this,
+                             gulong * a_specificity)
+{
+        g_return_val_if_fail (a_this && a_specificity, CR_BAD_PARAM_ERROR);
+
+        *a_specificity = a_this->specificity;
+        return CR_OK;
+}
+
 guchar *
 cr_selector_to_string (CRSelector const * a_this)
 {
@@ -282,14 +346,14 @@ cr_selector_destroy (CRSelector * a_this)
 
         /*in case the list has only one element */
         if (cur && !cur->prev) {
-                g_free (cur);
+                cr_allocator_free (cur);
                 return;
         }
 
         /*walk backward the list and free each "next element" */
         for (cur = cur->prev; cur && cur->prev; cur = cur->prev) {
                 if (cur->next) {
-                        g_free (cur->next);
+                        cr_allocator_free (cur->next);
                         cur->next = NULL;
                 }
         }
@@ -298,9 +362,9 @@ cr_selector_destroy (CRSelector * a_this)
                 return;
 
         if (cur->next) {
-                g_free (cur->next);
+                cr_allocator_free (cur->next);
                 cur->next = NULL;
         }
 
-        g_free (cur);
+        cr_allocator_free (cur);
 }
@@ -66,6 +66,14 @@ struct _CRSelector
 	CRSelector *prev ;
 	CRParsingLocation location ;
 	glong ref_count ;
+
+	/**
+	 *The specificity of simple_sel, as defined in
+	 *chapter 6.4.3 of the css2 spec. It is computed once,
+	 *when the selector is built. Read it with
+	 *cr_selector_get_specificity().
+	 */
+	gulong specificity ;
 };
 
 CRSelector* cr_selector_new (CRSimpleSel *a_sel_expr) ;
@@ -80,6 +88,11 @@ CRSelector* cr_selector_append_simple_sel (CRSelector *a_this,
 
 CRSelector* cr_selector_prepend (CRSelector *a_this, CRSelector *a_new) ;
 
+enum CRStatus cr_selector_compute_specificity (CRSelector *a_this) ;
+
+enum CRStatus cr_selector_get_specificity (CRSelector const *a_this,
+					   gulong *a_specificity) ;
+
 guchar * cr_selector_to_string (CRSelector const *a_this) ;
 
 void cr_selector_dump (CRSelector const *a_this, FILE *a_fp) ;
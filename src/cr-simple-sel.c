@@ -24,6 +24,8 @@
 #include <string.h>
 #include <glib.h>
 #include "cr-simple-sel.h"
+#include "cr-stats-priv.h"
+#include "cr-allocator-priv.h"
 
 /**
  * cr_simple_sel_new:
@@ -37,12 +39,13 @@ cr_simple_sel_new (void)
 {
         CRSimpleSel *result = NULL;
 
-        result = g_try_malloc (sizeof (CRSimpleSel));
+        result = cr_allocator_alloc (sizeof (CRSimpleSel));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
         memset (result, 0, sizeof (CRSimpleSel));
+        cr_stats_count_alloc (CR_STATS_SIMPLE_SEL);
 
         return result;
 }
@@ -259,7 +262,8 @@ cr_simple_sel_compute_specificity (CRSimpleSel * a_this)
                 } else if (!cur_sel->name 
                            || !cur_sel->name->stryng
                            || !cur_sel->name->stryng->str) {
-                        if (cur_sel->add_sel->type ==
+                        if (cur_sel->add_sel
+                            && cur_sel->add_sel->type ==
                             PSEUDO_CLASS_ADD_SELECTOR) {
                                 /*
                                  *this is a pseudo element, and
@@ -320,6 +324,6 @@ cr_simple_sel_destroy (CRSimpleSel * a_this)
         }
 
         if (a_this) {
-                g_free (a_this);
+                cr_allocator_free (a_this);
         }
 }
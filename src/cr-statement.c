@@ -24,6 +24,8 @@
 #include <string.h>
 #include "cr-statement.h"
 #include "cr-parser.h"
+#include "cr-stats-priv.h"
+#include "cr-allocator-priv.h"
 
 /**
  *@file
@@ -478,7 +480,7 @@ cr_statement_clear (CRStatement * a_this)
                                 (a_this->kind.ruleset->decl_list);
                         a_this->kind.ruleset->decl_list = NULL;
                 }
-                g_free (a_this->kind.ruleset);
+                cr_allocator_free (a_this->kind.ruleset);
                 a_this->kind.ruleset = NULL;
                 break;
 
@@ -490,7 +492,20 @@ cr_statement_clear (CRStatement * a_this)
                                 (a_this->kind.import_rule->url) ;
                         a_this->kind.import_rule->url = NULL;
                 }
-                g_free (a_this->kind.import_rule);
+                if (a_this->kind.import_rule->media_list) {
+                        GList *cur = NULL;
+
+                        for (cur = a_this->kind.import_rule->media_list;
+                             cur; cur = cur->next) {
+                                if (cur->data) {
+                                        cr_string_destroy ((CRString *) cur->data);
+                                        cur->data = NULL;
+                                }
+                        }
+                        g_list_free (a_this->kind.import_rule->media_list);
+                        a_this->kind.import_rule->media_list = NULL;
+                }
+                cr_allocator_free (a_this->kind.import_rule);
                 a_this->kind.import_rule = NULL;
                 break;
 
@@ -516,7 +531,7 @@ cr_statement_clear (CRStatement * a_this)
                         g_list_free (a_this->kind.media_rule->media_list);
                         a_this->kind.media_rule->media_list = NULL;
                 }
-                g_free (a_this->kind.media_rule);
+                cr_allocator_free (a_this->kind.media_rule);
                 a_this->kind.media_rule = NULL;
                 break;
 
@@ -539,7 +554,7 @@ cr_statement_clear (CRStatement * a_this)
                                 (a_this->kind.page_rule->pseudo);
                         a_this->kind.page_rule->pseudo = NULL;
                 }
-                g_free (a_this->kind.page_rule);
+                cr_allocator_free (a_this->kind.page_rule);
                 a_this->kind.page_rule = NULL;
                 break;
 
@@ -552,7 +567,7 @@ cr_statement_clear (CRStatement * a_this)
                                 (a_this->kind.charset_rule->charset);
                         a_this->kind.charset_rule->charset = NULL;
                 }
-                g_free (a_this->kind.charset_rule);
+                cr_allocator_free (a_this->kind.charset_rule);
                 a_this->kind.charset_rule = NULL;
                 break;
 
@@ -565,7 +580,7 @@ cr_statement_clear (CRStatement * a_this)
                                 (a_this->kind.font_face_rule->decl_list);
                         a_this->kind.font_face_rule->decl_list = NULL;
                 }
-                g_free (a_this->kind.font_face_rule);
+                cr_allocator_free (a_this->kind.font_face_rule);
                 a_this->kind.font_face_rule = NULL;
                 break;
 
@@ -1133,7 +1148,7 @@ cr_statement_new_ruleset (CRStyleSheet * a_sheet,
                                       NULL);
         }
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_allocator_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -1141,13 +1156,14 @@ cr_statement_new_ruleset (CRStyleSheet * a_sheet,
         }
 
         memset (result, 0, sizeof (CRStatement));
+        cr_stats_count_alloc (CR_STATS_STATEMENT);
         result->type = RULESET_STMT;
-        result->kind.ruleset = g_try_malloc (sizeof (CRRuleSet));
+        result->kind.ruleset = cr_allocator_alloc (sizeof (CRRuleSet));
 
         if (!result->kind.ruleset) {
                 cr_utils_trace_info ("Out of memory");
                 if (result)
-                        g_free (result);
+                        cr_allocator_free (result);
                 return NULL;
         }
 
@@ -1268,7 +1284,7 @@ cr_statement_new_at_media_rule (CRStyleSheet * a_sheet,
         if (a_rulesets)
                 g_return_val_if_fail (a_rulesets->type == RULESET_STMT, NULL);
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_allocator_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -1276,12 +1292,13 @@ cr_statement_new_at_media_rule (CRStyleSheet * a_sheet,
         }
 
         memset (result, 0, sizeof (CRStatement));
+        cr_stats_count_alloc (CR_STATS_STATEMENT);
         result->type = AT_MEDIA_RULE_STMT;
 
-        result->kind.media_rule = g_try_malloc (sizeof (CRAtMediaRule));
+        result->kind.media_rule = cr_allocator_alloc (sizeof (CRAtMediaRule));
         if (!result->kind.media_rule) {
                 cr_utils_trace_info ("Out of memory");
-                g_free (result);
+                cr_allocator_free (result);
                 return NULL;
         }
         memset (result->kind.media_rule, 0, sizeof (CRAtMediaRule));
@@ -1327,7 +1344,7 @@ cr_statement_new_at_import_rule (CRStyleSheet * a_container_sheet,
 {
         CRStatement *result = NULL;
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_allocator_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -1335,13 +1352,15 @@ cr_statement_new_at_import_rule (CRStyleSheet * a_container_sheet,
         }
 
         memset (result, 0, sizeof (CRStatement));
+        cr_stats_count_alloc (CR_STATS_STATEMENT);
         result->type = AT_IMPORT_RULE_STMT;
 
-        result->kind.import_rule = g_try_malloc (sizeof (CRAtImportRule));
+        result->kind.import_rule =
+                cr_allocator_alloc (sizeof (CRAtImportRule));
 
         if (!result->kind.import_rule) {
                 cr_utils_trace_info ("Out of memory");
-                g_free (result);
+                cr_allocator_free (result);
                 return NULL;
         }
 
@@ -1450,7 +1469,7 @@ cr_statement_new_at_page_rule (CRStyleSheet * a_sheet,
 {
         CRStatement *result = NULL;
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_allocator_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -1458,13 +1477,14 @@ cr_statement_new_at_page_rule (CRStyleSheet * a_sheet,
         }
 
         memset (result, 0, sizeof (CRStatement));
+        cr_stats_count_alloc (CR_STATS_STATEMENT);
         result->type = AT_PAGE_RULE_STMT;
 
-        result->kind.page_rule = g_try_malloc (sizeof (CRAtPageRule));
+        result->kind.page_rule = cr_allocator_alloc (sizeof (CRAtPageRule));
 
         if (!result->kind.page_rule) {
                 cr_utils_trace_info ("Out of memory");
-                g_free (result);
+                cr_allocator_free (result);
                 return NULL;
         }
 
@@ -1575,7 +1595,7 @@ cr_statement_new_at_charset_rule (CRStyleSheet * a_sheet,
 
         g_return_val_if_fail (a_charset, NULL);
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_allocator_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -1583,13 +1603,15 @@ cr_statement_new_at_charset_rule (CRStyleSheet * a_sheet,
         }
 
         memset (result, 0, sizeof (CRStatement));
+        cr_stats_count_alloc (CR_STATS_STATEMENT);
         result->type = AT_CHARSET_RULE_STMT;
 
-        result->kind.charset_rule = g_try_malloc (sizeof (CRAtCharsetRule));
+        result->kind.charset_rule =
+                cr_allocator_alloc (sizeof (CRAtCharsetRule));
 
         if (!result->kind.charset_rule) {
                 cr_utils_trace_info ("Out of memory");
-                g_free (result);
+                cr_allocator_free (result);
                 return NULL;
         }
         memset (result->kind.charset_rule, 0, sizeof (CRAtCharsetRule));
@@ -1669,21 +1691,22 @@ cr_statement_new_at_font_face_rule (CRStyleSheet * a_sheet,
 {
         CRStatement *result = NULL;
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_allocator_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
         memset (result, 0, sizeof (CRStatement));
+        cr_stats_count_alloc (CR_STATS_STATEMENT);
         result->type = AT_FONT_FACE_RULE_STMT;
 
-        result->kind.font_face_rule = g_try_malloc
+        result->kind.font_face_rule = cr_allocator_alloc
                 (sizeof (CRAtFontFaceRule));
 
         if (!result->kind.font_face_rule) {
                 cr_utils_trace_info ("Out of memory");
-                g_free (result);
+                cr_allocator_free (result);
                 return NULL;
         }
         memset (result->kind.font_face_rule, 0, sizeof (CRAtFontFaceRule));
@@ -2768,14 +2791,14 @@ cr_statement_destroy (CRStatement * a_this)
                 cr_statement_clear (cur);
 
         if (cur->prev == NULL) {
-                g_free (a_this);
+                cr_allocator_free (a_this);
                 return;
         }
 
         /*walk backward and free next element */
         for (cur = cur->prev; cur && cur->prev; cur = cur->prev) {
                 if (cur->next) {
-                        g_free (cur->next);
+                        cr_allocator_free (cur->next);
                         cur->next = NULL;
                 }
         }
@@ -2785,10 +2808,10 @@ cr_statement_destroy (CRStatement * a_this)
 
         /*free the one remaining list */
         if (cur->next) {
-                g_free (cur->next);
+                cr_allocator_free (cur->next);
                 cur->next = NULL;
         }
 
-        g_free (cur);
+        cr_allocator_free (cur);
         cur = NULL;
 }
@@ -0,0 +1,59 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+/**
+ *@file
+ *The declaration of the functions the library gathers
+ *its statistics with. It is not installed.
+ */
+
+#ifndef __CR_STATS_PRIV_H__
+#define __CR_STATS_PRIV_H__
+
+#include "cr-stats.h"
+#include "cr-statement.h"
+#include "cr-fonts.h"
+#include "cr-tknzr.h"
+
+G_BEGIN_DECLS
+
+void cr_stats_add_statements_mem_usage (CRMemUsage *a_usage,
+                                        CRStatement const *a_stmts) ;
+
+void cr_stats_add_string_mem_usage (CRMemUsage *a_usage,
+                                    CRString const *a_string) ;
+
+void cr_stats_add_font_family_mem_usage (CRMemUsage *a_usage,
+                                         enum CRMemCategory a_category,
+                                         CRFontFamily const *a_family) ;
+
+gulong * cr_stats_push_alloc_counters (gulong *a_counters) ;
+
+void cr_stats_pop_alloc_counters (gulong *a_prev_counters) ;
+
+void cr_stats_count_alloc (enum CRStatsObjectType a_type) ;
+
+void cr_tknzr_set_stats (CRTknzr *a_this, CRParserStats *a_stats) ;
+
+G_END_DECLS
+
+#endif /*__CR_STATS_PRIV_H__*/
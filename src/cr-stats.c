@@ -0,0 +1,487 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <string.h>
+#include "cr-stats-priv.h"
+
+/**
+ *@CRStats:
+ *
+ *The counting of the allocations made while a parser or a
+ *selection engine which statistics are enabled is running.
+ *The constructors call cr_stats_count_alloc(), which adds one to
+ *the counters the running parser or engine pushed for the calling
+ *thread, if any.
+ *
+ *The estimation of the memory used by the objects of a
+ *stylesheet, which cr_stylesheet_get_memory_usage() and the
+ *like build upon.
+ */
+
+static const gchar *gv_object_type_names[CR_STATS_NB_OBJECT_TYPES] = {
+        "token",
+        "string",
+        "num",
+        "term",
+        "additional-sel",
+        "simple-sel",
+        "selector",
+        "declaration",
+        "statement",
+        "style",
+        "style-group",
+        "prop-list"
+};
+
+static const gchar *gv_mem_category_names[CR_MEM_NB_CATEGORIES] = {
+        "strings",
+        "selectors",
+        "declarations",
+        "terms",
+        "locations",
+        "indices",
+        "statements",
+        "styles",
+        "other"
+};
+
+/**
+ *The number of counters pushed, in all the threads.
+ *While it is zero, counting an allocation does
+ *not even look the counters of the thread up.
+ */
+static gint gv_nb_pushed_counters = 0;
+
+/**
+ *The counters of the calling thread.
+ */
+static GPrivate gv_alloc_counters = G_PRIVATE_INIT (NULL);
+
+/**
+ * cr_stats_object_type_to_string:
+ *@a_type: the type of object.
+ *
+ *Returns the name of a type of object which allocations
+ *are counted, or NULL if @a_type is not valid.
+ */
+const gchar *
+cr_stats_object_type_to_string (enum CRStatsObjectType a_type)
+{
+        g_return_val_if_fail (a_type < CR_STATS_NB_OBJECT_TYPES, NULL);
+
+        return gv_object_type_names[a_type];
+}
+
+/**
+ * cr_stats_push_alloc_counters:
+ *@a_counters: an array of #CR_STATS_NB_OBJECT_TYPES counters.
+ *
+ *Makes the allocations of the calling thread be counted
+ *in @a_counters, until cr_stats_pop_alloc_counters() is called.
+ *
+ *Returns the counters used so far, to be passed to
+ *cr_stats_pop_alloc_counters().
+ */
+gulong *
+cr_stats_push_alloc_counters (gulong * a_counters)
+{
+        gulong *result = NULL;
+
+        g_return_val_if_fail (a_counters, NULL);
+
+        result = g_private_get (&gv_alloc_counters);
+        g_private_set (&gv_alloc_counters, a_counters);
+        g_atomic_int_inc (&gv_nb_pushed_counters);
+        return result;
+}
+
+/**
+ * cr_stats_pop_alloc_counters:
+ *@a_prev_counters: what the matching call to
+ *cr_stats_push_alloc_counters() returned.
+ *
+ *Stops counting the allocations of the calling thread in
+ *the counters pushed last.
+ */
+void
+cr_stats_pop_alloc_counters (gulong * a_prev_counters)
+{
+        g_private_set (&gv_alloc_counters, a_prev_counters);
+        g_atomic_int_dec_and_test (&gv_nb_pushed_counters);
+}
+
+/**
+ * cr_stats_count_alloc:
+ *@a_type: the type of the object allocated.
+ *
+ *Counts the allocation of an object in the counters
+ *of the calling thread, if any.
+ */
+void
+cr_stats_count_alloc (enum CRStatsObjectType a_type)
+{
+        gulong *counters = NULL;
+
+        if (G_LIKELY (!g_atomic_int_get (&gv_nb_pushed_counters)))
+                return;
+        counters = g_private_get (&gv_alloc_counters);
+        if (counters && a_type < CR_STATS_NB_OBJECT_TYPES)
+                counters[a_type]++;
+}
+
+/**
+ * cr_mem_category_to_string:
+ *@a_category: the category.
+ *
+ *Returns the name of a category of memory usage, or NULL
+ *if @a_category is not valid.
+ */
+const gchar *
+cr_mem_category_to_string (enum CRMemCategory a_category)
+{
+        g_return_val_if_fail (a_category < CR_MEM_NB_CATEGORIES, NULL);
+
+        return gv_mem_category_names[a_category];
+}
+
+/**
+ * cr_mem_usage_get_total:
+ *@a_this: the memory usage.
+ *
+ *Returns the bytes used, all categories included.
+ */
+gulong
+cr_mem_usage_get_total (CRMemUsage const * a_this)
+{
+        gulong result = 0;
+        guint i = 0;
+
+        g_return_val_if_fail (a_this, 0);
+
+        for (i = 0; i < CR_MEM_NB_CATEGORIES; i++) {
+                result += a_this->bytes[i];
+        }
+        return result;
+}
+
+/**
+ *Adds the size of an object that carries a parsing
+ *location, the location being accounted apart.
+ */
+static void
+add_located_object (CRMemUsage * a_usage, enum CRMemCategory a_category,
+                    gsize a_size)
+{
+        a_usage->bytes[a_category] += a_size - sizeof (CRParsingLocation);
+        a_usage->bytes[CR_MEM_LOCATIONS] += sizeof (CRParsingLocation);
+}
+
+/**
+ * cr_stats_add_string_mem_usage:
+ *@a_usage: the memory usage to add to.
+ *@a_string: the string, or NULL.
+ *
+ *Adds the memory used by a string to @a_usage.
+ */
+void
+cr_stats_add_string_mem_usage (CRMemUsage * a_usage,
+                               CRString const * a_string)
+{
+        if (!a_string)
+                return;
+        add_located_object (a_usage, CR_MEM_STRINGS, sizeof (CRString));
+        if (a_string->stryng)
+                a_usage->bytes[CR_MEM_STRINGS] += sizeof (GString)
+                        + a_string->stryng->allocated_len;
+}
+
+/**
+ * cr_stats_add_font_family_mem_usage:
+ *@a_usage: the memory usage to add to.
+ *@a_category: the category of the object that holds the list.
+ *@a_family: the font family list, or NULL.
+ *
+ *Adds the memory used by a font family list to @a_usage.
+ */
+void
+cr_stats_add_font_family_mem_usage (CRMemUsage * a_usage,
+                                    enum CRMemCategory a_category,
+                                    CRFontFamily const * a_family)
+{
+        CRFontFamily const *cur = NULL;
+
+        for (cur = a_family; cur; cur = cur->next) {
+                a_usage->bytes[a_category] += sizeof (CRFontFamily);
+                if (cur->name)
+                        a_usage->bytes[CR_MEM_STRINGS] +=
+                                strlen ((const char *) cur->name) + 1;
+        }
+}
+
+static void
+add_terms_mem_usage (CRMemUsage * a_usage, CRTerm const * a_terms)
+{
+        CRTerm const *cur = NULL;
+
+        for (cur = a_terms; cur; cur = cur->next) {
+                add_located_object (a_usage, CR_MEM_TERMS, sizeof (CRTerm));
+                switch (cur->type) {
+                case TERM_NUMBER:
+                        if (cur->content.num)
+                                add_located_object (a_usage, CR_MEM_TERMS,
+                                                    sizeof (CRNum));
+                        break;
+                case TERM_FUNCTION:
+                        add_terms_mem_usage (a_usage,
+                                             cur->ext_content.func_param);
+                        /*fall through*/
+                case TERM_STRING:
+                case TERM_IDENT:
+                case TERM_URI:
+                case TERM_HASH:
+                        cr_stats_add_string_mem_usage (a_usage,
+                                                       cur->content.str);
+                        break;
+                case TERM_RGB:
+                        if (cur->content.rgb)
+                                add_located_object (a_usage, CR_MEM_TERMS,
+                                                    sizeof (CRRgb));
+                        break;
+                default:
+                        break;
+                }
+        }
+}
+
+/**
+ *Adds the font family list a decoded value owns, if any.
+ *The value may be being decoded by another thread,
+ *so its type is read first.
+ */
+static void
+add_decl_value_mem_usage (CRMemUsage * a_usage,
+                          CRDeclValue const * a_value)
+{
+        if (!a_value)
+                return;
+        a_usage->bytes[CR_MEM_DECLARATIONS] += sizeof (CRDeclValue);
+        if (a_value->type == DECL_VALUE_FONT_FAMILY)
+                cr_stats_add_font_family_mem_usage
+                        (a_usage, CR_MEM_DECLARATIONS,
+                         a_value->content.font_family);
+}
+
+static void
+add_declarations_mem_usage (CRMemUsage * a_usage,
+                            CRDeclaration const * a_decls)
+{
+        CRDeclaration const *cur = NULL;
+        CRLonghand const *longhand = NULL;
+
+        for (cur = a_decls; cur; cur = cur->next) {
+                add_located_object (a_usage, CR_MEM_DECLARATIONS,
+                                    sizeof (CRDeclaration));
+                cr_stats_add_string_mem_usage (a_usage, cur->property);
+                add_terms_mem_usage (a_usage, cur->value);
+                add_decl_value_mem_usage
+                        (a_usage, g_atomic_pointer_get (&cur->typed_value));
+                longhand = g_atomic_pointer_get (&cur->longhands);
+                if (!longhand)
+                        continue;
+                /*the values of the longhands are terms of cur->value*/
+                for (; longhand->value;
+                     longhand++) {
+                        a_usage->bytes[CR_MEM_DECLARATIONS] +=
+                                sizeof (CRLonghand);
+                        add_decl_value_mem_usage
+                                (a_usage, g_atomic_pointer_get
+                                 (&longhand->typed_value));
+                }
+                /*the terminator*/
+                a_usage->bytes[CR_MEM_DECLARATIONS] += sizeof (CRLonghand);
+        }
+}
+
+static void
+add_additional_sels_mem_usage (CRMemUsage * a_usage,
+                               CRAdditionalSel const * a_sels)
+{
+        CRAdditionalSel const *cur = NULL;
+        CRAttrSel const *attr = NULL;
+
+        for (cur = a_sels; cur; cur = cur->next) {
+                add_located_object (a_usage, CR_MEM_SELECTORS,
+                                    sizeof (CRAdditionalSel));
+                switch (cur->type) {
+                case CLASS_ADD_SELECTOR:
+                        cr_stats_add_string_mem_usage
+                                (a_usage, cur->content.class_name);
+                        break;
+                case ID_ADD_SELECTOR:
+                        cr_stats_add_string_mem_usage
+                                (a_usage, cur->content.id_name);
+                        break;
+                case PSEUDO_CLASS_ADD_SELECTOR:
+                        if (!cur->content.pseudo)
+                                break;
+                        add_located_object (a_usage, CR_MEM_SELECTORS,
+                                            sizeof (CRPseudo));
+                        cr_stats_add_string_mem_usage
+                                (a_usage, cur->content.pseudo->name);
+                        cr_stats_add_string_mem_usage
+                                (a_usage, cur->content.pseudo->extra);
+                        break;
+                case ATTRIBUTE_ADD_SELECTOR:
+                        for (attr = cur->content.attr_sel; attr;
+                             attr = attr->next) {
+                                add_located_object (a_usage,
+                                                    CR_MEM_SELECTORS,
+                                                    sizeof (CRAttrSel));
+                                cr_stats_add_string_mem_usage
+                                        (a_usage, attr->name);
+                                cr_stats_add_string_mem_usage
+                                        (a_usage, attr->value);
+                        }
+                        break;
+                default:
+                        break;
+                }
+        }
+}
+
+static void
+add_selectors_mem_usage (CRMemUsage * a_usage, CRSelector const * a_sels)
+{
+        CRSelector const *cur = NULL;
+        CRSimpleSel const *simple_sel = NULL;
+
+        for (cur = a_sels; cur; cur = cur->next) {
+                add_located_object (a_usage, CR_MEM_SELECTORS,
+                                    sizeof (CRSelector));
+                for (simple_sel = cur->simple_sel; simple_sel;
+                     simple_sel = simple_sel->next) {
+                        add_located_object (a_usage, CR_MEM_SELECTORS,
+                                            sizeof (CRSimpleSel));
+                        cr_stats_add_string_mem_usage (a_usage,
+                                                       simple_sel->name);
+                        add_additional_sels_mem_usage (a_usage,
+                                                       simple_sel->add_sel);
+                }
+        }
+}
+
+static void
+add_media_list_mem_usage (CRMemUsage * a_usage, GList const * a_media_list)
+{
+        GList const *cur = NULL;
+
+        for (cur = a_media_list; cur; cur = cur->next) {
+                a_usage->bytes[CR_MEM_STATEMENTS] += sizeof (GList);
+                cr_stats_add_string_mem_usage (a_usage, cur->data);
+        }
+}
+
+/**
+ * cr_stats_add_statements_mem_usage:
+ *@a_usage: the memory usage to add to.
+ *@a_stmts: the list of statements.
+ *
+ *Adds the memory used by a list of statements and by what
+ *they own to @a_usage. The stylesheets imported by the
+ *import rules are not theirs and are left out.
+ */
+void
+cr_stats_add_statements_mem_usage (CRMemUsage * a_usage,
+                                   CRStatement const * a_stmts)
+{
+        CRStatement const *cur = NULL;
+
+        g_return_if_fail (a_usage);
+
+        for (cur = a_stmts; cur; cur = cur->next) {
+                add_located_object (a_usage, CR_MEM_STATEMENTS,
+                                    sizeof (CRStatement));
+                switch (cur->type) {
+                case RULESET_STMT:
+                        if (!cur->kind.ruleset)
+                                break;
+                        a_usage->bytes[CR_MEM_STATEMENTS] +=
+                                sizeof (CRRuleSet);
+                        add_selectors_mem_usage
+                                (a_usage, cur->kind.ruleset->sel_list);
+                        add_declarations_mem_usage
+                                (a_usage, cur->kind.ruleset->decl_list);
+                        break;
+                case AT_IMPORT_RULE_STMT:
+                        if (!cur->kind.import_rule)
+                                break;
+                        a_usage->bytes[CR_MEM_STATEMENTS] +=
+                                sizeof (CRAtImportRule);
+                        cr_stats_add_string_mem_usage
+                                (a_usage, cur->kind.import_rule->url);
+                        add_media_list_mem_usage
+                                (a_usage, cur->kind.import_rule->media_list);
+                        break;
+                case AT_MEDIA_RULE_STMT:
+                        if (!cur->kind.media_rule)
+                                break;
+                        a_usage->bytes[CR_MEM_STATEMENTS] +=
+                                sizeof (CRAtMediaRule);
+                        add_media_list_mem_usage
+                                (a_usage, cur->kind.media_rule->media_list);
+                        cr_stats_add_statements_mem_usage
+                                (a_usage, cur->kind.media_rule->rulesets);
+                        break;
+                case AT_PAGE_RULE_STMT:
+                        if (!cur->kind.page_rule)
+                                break;
+                        a_usage->bytes[CR_MEM_STATEMENTS] +=
+                                sizeof (CRAtPageRule);
+                        add_declarations_mem_usage
+                                (a_usage, cur->kind.page_rule->decl_list);
+                        cr_stats_add_string_mem_usage
+                                (a_usage, cur->kind.page_rule->name);
+                        cr_stats_add_string_mem_usage
+                                (a_usage, cur->kind.page_rule->pseudo);
+                        break;
+                case AT_CHARSET_RULE_STMT:
+                        if (!cur->kind.charset_rule)
+                                break;
+                        a_usage->bytes[CR_MEM_STATEMENTS] +=
+                                sizeof (CRAtCharsetRule);
+                        cr_stats_add_string_mem_usage
+                                (a_usage, cur->kind.charset_rule->charset);
+                        break;
+                case AT_FONT_FACE_RULE_STMT:
+                        if (!cur->kind.font_face_rule)
+                                break;
+                        a_usage->bytes[CR_MEM_STATEMENTS] +=
+                                sizeof (CRAtFontFaceRule);
+                        add_declarations_mem_usage
+                                (a_usage,
+                                 cur->kind.font_face_rule->decl_list);
+                        break;
+                default:
+                        break;
+                }
+        }
+}
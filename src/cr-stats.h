@@ -0,0 +1,158 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+/**
+ *@file
+ *The declaration of the statistics the parser and the
+ *selection engine gather when asked to.
+ */
+
+#ifndef __CR_STATS_H__
+#define __CR_STATS_H__
+
+#include <glib.h>
+#include "cr-utils.h"
+#include "cr-simple-sel.h"
+
+G_BEGIN_DECLS
+
+/**
+ *The types of the objects which allocations are counted.
+ */
+enum CRStatsObjectType {
+        CR_STATS_TOKEN,
+        CR_STATS_STRING,
+        CR_STATS_NUM,
+        CR_STATS_TERM,
+        CR_STATS_ADDITIONAL_SEL,
+        CR_STATS_SIMPLE_SEL,
+        CR_STATS_SELECTOR,
+        CR_STATS_DECLARATION,
+        CR_STATS_STATEMENT,
+        CR_STATS_STYLE,
+        CR_STATS_STYLE_GROUP,
+        CR_STATS_PROP_LIST,
+        CR_STATS_NB_OBJECT_TYPES
+};
+
+/**
+ *The number of values of enum #Combinator.
+ */
+#define CR_STATS_NB_COMBINATORS (COMB_GT + 1)
+
+typedef struct _CRParserStats CRParserStats ;
+
+/**
+ *What a #CRParser counted, see cr_parser_set_stats_enabled().
+ */
+struct _CRParserStats
+{
+        /*the tokens returned by the tokenizer*/
+        gulong nb_tokens ;
+        /*the calls to cr_tknzr_unget_token()*/
+        gulong nb_unget_tokens ;
+        /*the times the parser moved the tokenizer back*/
+        gulong nb_backtracks ;
+        /*the calls to cr_tknzr_seek_index()*/
+        gulong nb_seeks ;
+        /*the objects allocated, per enum #CRStatsObjectType*/
+        gulong nb_allocs[CR_STATS_NB_OBJECT_TYPES] ;
+        /*the wall clock time spent in cr_parser_parse(), in seconds*/
+        gdouble parse_time ;
+} ;
+
+typedef struct _CRSelEngStats CRSelEngStats ;
+
+/**
+ *What a #CRSelEng counted, see cr_sel_eng_set_stats_enabled().
+ */
+struct _CRSelEngStats
+{
+        /*
+         *the simple selectors tested against an element, and the
+         *ones that matched, per combinator the element was reached
+         *by: NO_COMBINATOR for the element the selector is matched
+         *against, COMB_WS for its ancestors, and so on.
+         */
+        gulong nb_match_attempts[CR_STATS_NB_COMBINATORS] ;
+        gulong nb_match_hits[CR_STATS_NB_COMBINATORS] ;
+        /*the calls to xmlGetProp()*/
+        gulong nb_get_props ;
+        /*the objects allocated, per enum #CRStatsObjectType*/
+        gulong nb_allocs[CR_STATS_NB_OBJECT_TYPES] ;
+        /*
+         *the wall clock time, in seconds, spent in the functions
+         *that return matched rulesets or properties, in
+         *cr_sel_eng_get_matched_style() and in the document walks.
+         */
+        gdouble match_time ;
+        gdouble style_time ;
+        gdouble walk_time ;
+} ;
+
+/**
+ *The categories the memory used by stylesheets, cascades,
+ *styles and selection engines is reported in.
+ */
+enum CRMemCategory {
+        /*the strings and their #CRString holders*/
+        CR_MEM_STRINGS,
+        /*the selectors, simple, additional, attribute and pseudo*/
+        CR_MEM_SELECTORS,
+        /*the declarations and their decoded values and longhands*/
+        CR_MEM_DECLARATIONS,
+        /*the terms of the values, numbers and colors included*/
+        CR_MEM_TERMS,
+        /*the parsing locations all the above carry*/
+        CR_MEM_LOCATIONS,
+        /*the indices built to speed the lookups up*/
+        CR_MEM_INDICES,
+        /*the statements and the stylesheets*/
+        CR_MEM_STATEMENTS,
+        /*the styles and their property groups*/
+        CR_MEM_STYLES,
+        /*the rest: cascades, lists, engines*/
+        CR_MEM_OTHER,
+        CR_MEM_NB_CATEGORIES
+};
+
+typedef struct _CRMemUsage CRMemUsage ;
+
+/**
+ *The bytes used by a set of objects, per enum #CRMemCategory.
+ *It is an estimate: the allocator overhead is left out, and
+ *so is the spare room of the hash tables and arrays.
+ */
+struct _CRMemUsage
+{
+        gulong bytes[CR_MEM_NB_CATEGORIES] ;
+} ;
+
+const gchar * cr_stats_object_type_to_string (enum CRStatsObjectType a_type) ;
+
+const gchar * cr_mem_category_to_string (enum CRMemCategory a_category) ;
+
+gulong cr_mem_usage_get_total (CRMemUsage const *a_this) ;
+
+G_END_DECLS
+
+#endif /*__CR_STATS_H__*/
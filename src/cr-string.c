@@ -23,6 +23,8 @@
 
 #include <string.h>
 #include "cr-string.h"
+#include "cr-stats-priv.h"
+#include "cr-allocator-priv.h"
 
 /**
  *Instanciates a #CRString
@@ -34,12 +36,13 @@ cr_string_new (void)
 {
 	CRString *result = NULL ;
 
-	result = g_try_malloc (sizeof (CRString)) ;
+	result = cr_allocator_alloc (sizeof (CRString)) ;
 	if (!result) {
 		cr_utils_trace_info ("Out of memory") ;
 		return NULL ;
 	}
 	memset (result, 0, sizeof (CRString)) ;
+	cr_stats_count_alloc (CR_STATS_STRING) ;
         result->stryng = g_string_new (NULL) ;
 	return result ;
 }
@@ -164,5 +167,5 @@ cr_string_destroy (CRString *a_this)
 		g_string_free (a_this->stryng, TRUE) ;
 		a_this->stryng = NULL ;
 	}
-	g_free (a_this) ;
+	cr_allocator_free (a_this) ;
 }
@@ -23,145 +23,18 @@
  * see COPYRIGTHS file for copyright information
  */
 
+#include "config.h"
 #include <string.h>
 #include "cr-style.h"
+#include "cr-stats-priv.h"
+#include "cr-trace-priv.h"
+#include "cr-allocator-priv.h"
 
 /**
  *@file
  *The definition of the #CRStyle class.
  */
 
-/**
- *A property ID.
- *Each supported css property has an ID which is
- *an entry into a property "population" jump table.
- *each entry of the property population jump table
- *contains code to tranform the literal form of
- *a property value into a strongly typed value.
- */
-enum CRPropertyID {
-        PROP_ID_NOT_KNOWN = 0,
-        PROP_ID_PADDING_TOP,
-        PROP_ID_PADDING_RIGHT,
-        PROP_ID_PADDING_BOTTOM,
-        PROP_ID_PADDING_LEFT,
-        PROP_ID_PADDING,
-        PROP_ID_BORDER_TOP_WIDTH,
-        PROP_ID_BORDER_RIGHT_WIDTH,
-        PROP_ID_BORDER_BOTTOM_WIDTH,
-        PROP_ID_BORDER_LEFT_WIDTH,
-        PROP_ID_BORDER_WIDTH,
-        PROP_ID_BORDER_TOP_STYLE,
-        PROP_ID_BORDER_RIGHT_STYLE,
-        PROP_ID_BORDER_BOTTOM_STYLE,
-        PROP_ID_BORDER_LEFT_STYLE,
-        PROP_ID_BORDER_STYLE,
-        PROP_ID_BORDER_TOP_COLOR,
-        PROP_ID_BORDER_RIGHT_COLOR,
-        PROP_ID_BORDER_BOTTOM_COLOR,
-        PROP_ID_BORDER_LEFT_COLOR,
-        PROP_ID_BORDER_TOP,
-        PROP_ID_BORDER_RIGHT,
-        PROP_ID_BORDER_BOTTOM,
-        PROP_ID_BORDER_LEFT,
-        PROP_ID_BORDER,
-        PROP_ID_MARGIN_TOP,
-        PROP_ID_MARGIN_RIGHT,
-        PROP_ID_MARGIN_BOTTOM,
-        PROP_ID_MARGIN_LEFT,
-        PROP_ID_MARGIN,
-        PROP_ID_DISPLAY,
-        PROP_ID_POSITION,
-        PROP_ID_TOP,
-        PROP_ID_RIGHT,
-        PROP_ID_BOTTOM,
-        PROP_ID_LEFT,
-        PROP_ID_FLOAT,
-        PROP_ID_WIDTH,
-        PROP_ID_COLOR,
-        PROP_ID_BACKGROUND_COLOR,
-        PROP_ID_FONT_FAMILY,
-        PROP_ID_FONT_SIZE,
-        PROP_ID_FONT_STYLE,
-        PROP_ID_FONT_WEIGHT,
-	PROP_ID_WHITE_SPACE,
-        /*should be the last one. */
-        NB_PROP_IDS
-};
-
-typedef struct _CRPropertyDesc CRPropertyDesc;
-
-struct _CRPropertyDesc {
-        const gchar *name;
-        enum CRPropertyID prop_id;
-};
-
-static CRPropertyDesc gv_prop_table[] = {
-        {"padding-top", PROP_ID_PADDING_TOP},
-        {"padding-right", PROP_ID_PADDING_RIGHT},
-        {"padding-bottom", PROP_ID_PADDING_BOTTOM},
-        {"padding-left", PROP_ID_PADDING_LEFT},
-        {"padding", PROP_ID_PADDING},
-        {"border-top-width", PROP_ID_BORDER_TOP_WIDTH},
-        {"border-right-width", PROP_ID_BORDER_RIGHT_WIDTH},
-        {"border-bottom-width", PROP_ID_BORDER_BOTTOM_WIDTH},
-        {"border-left-width", PROP_ID_BORDER_LEFT_WIDTH},
-        {"border-width", PROP_ID_BORDER_WIDTH},
-        {"border-top-style", PROP_ID_BORDER_TOP_STYLE},
-        {"border-right-style", PROP_ID_BORDER_RIGHT_STYLE},
-        {"border-bottom-style", PROP_ID_BORDER_BOTTOM_STYLE},
-        {"border-left-style", PROP_ID_BORDER_LEFT_STYLE},
-        {"border-style", PROP_ID_BORDER_STYLE},
-        {"border-top", PROP_ID_BORDER_TOP},
-        {"border-right", PROP_ID_BORDER_RIGHT},
-        {"border-bottom", PROP_ID_BORDER_BOTTOM},
-        {"border-left", PROP_ID_BORDER_LEFT},
-        {"border", PROP_ID_BORDER},
-        {"margin-top", PROP_ID_MARGIN_TOP},
-        {"margin-right", PROP_ID_MARGIN_RIGHT},
-        {"margin-bottom", PROP_ID_MARGIN_BOTTOM},
-        {"margin-left", PROP_ID_MARGIN_LEFT},
-        {"margin", PROP_ID_MARGIN},
-        {"display", PROP_ID_DISPLAY},
-        {"position", PROP_ID_POSITION},
-        {"top", PROP_ID_TOP},
-        {"right", PROP_ID_RIGHT},
-        {"bottom", PROP_ID_BOTTOM},
-        {"left", PROP_ID_LEFT},
-        {"float", PROP_ID_FLOAT},
-        {"width", PROP_ID_WIDTH},
-        {"color", PROP_ID_COLOR},
-        {"border-top-color", PROP_ID_BORDER_TOP_COLOR},
-        {"border-right-color", PROP_ID_BORDER_RIGHT_COLOR},
-        {"border-bottom-color", PROP_ID_BORDER_BOTTOM_COLOR},
-        {"border-left-color", PROP_ID_BORDER_LEFT_COLOR},
-        {"background-color", PROP_ID_BACKGROUND_COLOR},
-        {"font-family", PROP_ID_FONT_FAMILY},
-        {"font-size", PROP_ID_FONT_SIZE},
-        {"font-style", PROP_ID_FONT_STYLE},
-        {"font-weight", PROP_ID_FONT_WEIGHT},
-	{"white-space", PROP_ID_WHITE_SPACE},
-        /*must be the last one */
-        {NULL, 0}
-};
-
-/**
- *A the key/value pair of this hash table
- *are:
- *key => name of the the css propertie found in gv_prop_table
- *value => matching property id found in gv_prop_table.
- *So this hash table is here just to retrieval of a property id
- *from a property name.
- */
-static GHashTable *gv_prop_hash = NULL;
-
-/**
- *incremented by each new instance of #CRStyle
- *and decremented at the it destroy time.
- *When this reaches zero, gv_prop_hash is destroyed.
- */
-static gulong gv_prop_hash_ref_count = 0;
-
 struct CRNumPropEnumDumpInfo {
         enum CRNumProp code;
         const gchar *str;
@@ -218,9 +91,6 @@ static struct CRBorderStylePropEnumDumpInfo gv_border_style_props_dump_infos[]
         {0, NULL}
 };
 
-static enum CRStatus
-  cr_style_init_properties (void);
-
 enum CRDirection {
         DIR_TOP = 0,
         DIR_RIGHT,
@@ -239,55 +109,17 @@ static const gchar *border_style_prop_code_to_string (enum CRBorderStyleProp
                                                       a_code);
 
 static enum CRStatus
-set_prop_padding_x_from_value (CRStyle * a_style,
-                                 CRTerm * a_value, enum CRDirection a_dir);
+set_prop_from_value (CRStyle * a_this, enum CRPropertyID a_prop_id,
+                     CRTerm * a_value);
 
 static enum CRStatus
-set_prop_border_x_width_from_value (CRStyle * a_style,
-                                    CRTerm * a_value,
-                                    enum CRDirection a_dir);
-static enum CRStatus
 set_prop_border_width_from_value (CRStyle *a_style,
                                   CRTerm *a_value) ;
 
 static enum CRStatus
-set_prop_border_x_style_from_value (CRStyle * a_style,
-                                    CRTerm * a_value,
-                                    enum CRDirection a_dir);
-static enum CRStatus
 set_prop_border_style_from_value (CRStyle *a_style,
                                   CRTerm *a_value) ;
 
-static enum CRStatus
-set_prop_margin_x_from_value (CRStyle * a_style, CRTerm * a_value,
-                                enum CRDirection a_dir);
-
-static enum CRStatus
-set_prop_display_from_value (CRStyle * a_style, CRTerm * a_value);
-
-static enum CRStatus
-set_prop_position_from_value (CRStyle * a_style, CRTerm * a_value);
-
-static enum CRStatus
-set_prop_x_from_value (CRStyle * a_style, CRTerm * a_value,
-                         enum CRDirection a_dir);
-
-static enum CRStatus
-set_prop_float (CRStyle * a_style, CRTerm * a_value);
-
-static enum CRStatus
-set_prop_width (CRStyle * a_style, CRTerm * a_value);
-
-static enum CRStatus
-set_prop_color (CRStyle * a_style, CRTerm * a_value);
-
-static enum CRStatus
-set_prop_background_color (CRStyle * a_style, CRTerm * a_value);
-
-static enum CRStatus
-set_prop_border_x_color_from_value (CRStyle * a_style, CRTerm * a_value,
-                                      enum CRDirection a_dir);
-
 static enum CRStatus
 set_prop_border_x_from_value (CRStyle * a_style, CRTerm * a_value,
                                 enum CRDirection a_dir);
@@ -301,20 +133,49 @@ set_prop_padding_from_value (CRStyle * a_style, CRTerm * a_value);
 static enum CRStatus
 set_prop_margin_from_value (CRStyle * a_style, CRTerm * a_value);
 
-static enum CRStatus
-set_prop_font_family_from_value (CRStyle * a_style, CRTerm * a_value);
+static const enum CRPropertyID gv_margin_ids[NB_DIRS] = {
+        PROP_ID_MARGIN_TOP, PROP_ID_MARGIN_RIGHT,
+        PROP_ID_MARGIN_BOTTOM, PROP_ID_MARGIN_LEFT
+};
 
-static enum CRStatus
-init_style_font_size_field (CRStyle * a_style);
+static const enum CRPropertyID gv_padding_ids[NB_DIRS] = {
+        PROP_ID_PADDING_TOP, PROP_ID_PADDING_RIGHT,
+        PROP_ID_PADDING_BOTTOM, PROP_ID_PADDING_LEFT
+};
 
-static enum CRStatus
-set_prop_font_size_from_value (CRStyle * a_style, CRTerm * a_value);
+static const enum CRPropertyID gv_border_width_ids[NB_DIRS] = {
+        PROP_ID_BORDER_TOP_WIDTH, PROP_ID_BORDER_RIGHT_WIDTH,
+        PROP_ID_BORDER_BOTTOM_WIDTH, PROP_ID_BORDER_LEFT_WIDTH
+};
 
-static enum CRStatus
-set_prop_font_style_from_value (CRStyle * a_style, CRTerm * a_value);
+static const enum CRPropertyID gv_border_style_ids[NB_DIRS] = {
+        PROP_ID_BORDER_TOP_STYLE, PROP_ID_BORDER_RIGHT_STYLE,
+        PROP_ID_BORDER_BOTTOM_STYLE, PROP_ID_BORDER_LEFT_STYLE
+};
 
-static enum CRStatus
-set_prop_font_weight_from_value (CRStyle * a_style, CRTerm * a_value);
+static const enum CRPropertyID gv_border_color_ids[NB_DIRS] = {
+        PROP_ID_BORDER_TOP_COLOR, PROP_ID_BORDER_RIGHT_COLOR,
+        PROP_ID_BORDER_BOTTOM_COLOR, PROP_ID_BORDER_LEFT_COLOR
+};
+
+static gboolean
+is_shorthand (enum CRPropertyID a_prop_id)
+{
+        switch (a_prop_id) {
+        case PROP_ID_MARGIN:
+        case PROP_ID_PADDING:
+        case PROP_ID_BORDER_WIDTH:
+        case PROP_ID_BORDER_STYLE:
+        case PROP_ID_BORDER_TOP:
+        case PROP_ID_BORDER_RIGHT:
+        case PROP_ID_BORDER_BOTTOM:
+        case PROP_ID_BORDER_LEFT:
+        case PROP_ID_BORDER:
+                return TRUE;
+        default:
+                return FALSE;
+        }
+}
 
 static const gchar *
 num_prop_code_to_string (enum CRNumProp a_code)
@@ -387,95 +248,99 @@ border_style_prop_code_to_string (enum CRBorderStyleProp a_code)
         return gv_border_style_props_dump_infos[a_code].str;
 }
 
-static enum CRStatus
-cr_style_init_properties (void)
+/**
+ *Returns the string of a_value if it is an identifier,
+ *NULL otherwise.
+ */
+static const gchar *
+get_term_ident (CRTerm * a_value)
 {
+        if (a_value->type == TERM_IDENT
+            && a_value->content.str
+            && a_value->content.str->stryng
+            && a_value->content.str->stryng->str)
+                return a_value->content.str->stryng->str;
+        return NULL;
+}
 
-        if (!gv_prop_hash) {
-                gulong i = 0;
-
-                gv_prop_hash = g_hash_table_new (g_str_hash, g_str_equal);
-                if (!gv_prop_hash) {
-                        cr_utils_trace_info ("Out of memory");
-                        return CR_ERROR;
-                }
+struct CRKeywordValPair {
+        const gchar *name;
+        gint value;
+};
 
-                /*load gv_prop_hash from gv_prop_table */
-                for (i = 0; gv_prop_table[i].name; i++) {
-                        g_hash_table_insert
-                                (gv_prop_hash,
-                                 (gpointer) gv_prop_table[i].name,
-                                 GINT_TO_POINTER (gv_prop_table[i].prop_id));
+/**
+ *Looks an identifier up in a keyword map.
+ *@param a_map the map, terminated by an entry which name is NULL.
+ *@param a_ident the identifier to look up.
+ *@param a_prefix if TRUE, an identifier matches a keyword
+ *it starts with.
+ *@param a_value out parameter. The value of the keyword found.
+ *@return TRUE if a keyword has been found, FALSE otherwise.
+ */
+static gboolean
+lookup_keyword (const struct CRKeywordValPair *a_map,
+                const gchar * a_ident, gboolean a_prefix,
+                gint * a_value)
+{
+        gulong i = 0;
+
+        if (!a_ident)
+                return FALSE;
+
+        for (i = 0; a_map[i].name; i++) {
+                if ((a_prefix
+                     && !strncmp (a_map[i].name, a_ident,
+                                  strlen (a_map[i].name)))
+                    || (!a_prefix && !strcmp (a_map[i].name, a_ident))) {
+                        *a_value = a_map[i].value;
+                        return TRUE;
                 }
         }
-
-        return CR_OK;
+        return FALSE;
 }
 
-static enum CRPropertyID
-cr_style_get_prop_id (const guchar * a_prop)
+static void
+set_num_value (CRDeclValue * a_result, gdouble a_val,
+               enum CRNumType a_type)
 {
-        gpointer *raw_id = NULL;
+        a_result->type = DECL_VALUE_NUM;
+        cr_num_set (&a_result->content.num, a_val, a_type);
+}
 
-        if (!gv_prop_hash) {
-                cr_style_init_properties ();
-        }
+static void
+copy_num_value (CRDeclValue * a_result, CRNum const * a_num)
+{
+        a_result->type = DECL_VALUE_NUM;
+        cr_num_copy (&a_result->content.num, a_num);
+}
 
-        raw_id = g_hash_table_lookup (gv_prop_hash, a_prop);
-        if (!raw_id) {
-                return PROP_ID_NOT_KNOWN;
-        }
-        return GPOINTER_TO_INT (raw_id);
+static void
+set_keyword_value (CRDeclValue * a_result, gint a_keyword)
+{
+        a_result->type = DECL_VALUE_KEYWORD;
+        a_result->content.keyword = a_keyword;
 }
 
 static enum CRStatus
-set_prop_padding_x_from_value (CRStyle * a_style,
-                               CRTerm * a_value, enum CRDirection a_dir)
+decode_padding (CRTerm * a_value, CRDeclValue * a_result)
 {
-        enum CRStatus status = CR_OK;
-        CRNum *num_val = NULL;
-
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+        const gchar *ident = NULL;
 
         if (a_value->type != TERM_NUMBER && a_value->type != TERM_IDENT)
                 return CR_BAD_PARAM_ERROR;
 
-        switch (a_dir) {
-        case DIR_TOP:
-                num_val = &a_style->num_props[NUM_PROP_PADDING_TOP].sv;
-                break;
-
-        case DIR_RIGHT:
-                num_val = &a_style->num_props[NUM_PROP_PADDING_RIGHT].sv;
-                break;
-
-        case DIR_BOTTOM:
-                num_val = &a_style->num_props[NUM_PROP_PADDING_BOTTOM].sv;
-                break;
-
-        case DIR_LEFT:
-                num_val = &a_style->num_props[NUM_PROP_PADDING_LEFT].sv;
-                break;
-
-        default:
-                return CR_BAD_PARAM_ERROR;
-        }
-
         if (a_value->type == TERM_IDENT) {
-                if (a_value->content.str
-                    && a_value->content.str->stryng
-		    && a_value->content.str->stryng->str
-                    && !strncmp ((const char *) "inherit",
-                                 a_value->content.str->stryng->str,
-                                 sizeof ("inherit")-1)) {
-			status = cr_num_set (num_val, 0.0, NUM_INHERIT);
+                ident = get_term_ident (a_value);
+                if (ident && !strncmp ("inherit", ident,
+                                       sizeof ("inherit") - 1)) {
+                        set_num_value (a_result, 0.0, NUM_INHERIT);
                         return CR_OK;
-                } else
-                        return CR_UNKNOWN_TYPE_ERROR;
+                }
+                return CR_UNKNOWN_TYPE_ERROR;
         }
 
-        g_return_val_if_fail (a_value->type == TERM_NUMBER
-                              && a_value->content.num, CR_UNKNOWN_TYPE_ERROR);
+        if (!a_value->content.num)
+                return CR_UNKNOWN_TYPE_ERROR;
 
         switch (a_value->content.num->type) {
         case NUM_LENGTH_EM:
@@ -487,1515 +352,2638 @@ set_prop_padding_x_from_value (CRStyle * a_style,
         case NUM_LENGTH_PT:
         case NUM_LENGTH_PC:
         case NUM_PERCENTAGE:
-                status = cr_num_copy (num_val, a_value->content.num);
-                break;
+                copy_num_value (a_result, a_value->content.num);
+                return CR_OK;
         default:
-                status = CR_UNKNOWN_TYPE_ERROR;
-                break;
+                return CR_UNKNOWN_TYPE_ERROR;
         }
-
-        return status;
 }
 
 static enum CRStatus
-set_prop_border_x_width_from_value (CRStyle * a_style,
-                                    CRTerm * a_value, 
-                                    enum CRDirection a_dir)
+decode_border_width (CRTerm * a_value, CRDeclValue * a_result)
 {
-        enum CRStatus status = CR_OK;
-        CRNum *num_val = NULL;
-
-        g_return_val_if_fail (a_value && a_style, CR_BAD_PARAM_ERROR);
-
-        switch (a_dir) {
-        case DIR_TOP:
-                num_val = &a_style->num_props[NUM_PROP_BORDER_TOP].sv;
-                break;
-
-        case DIR_RIGHT:
-                num_val = &a_style->num_props[NUM_PROP_BORDER_RIGHT].sv;
-                break;
-
-        case DIR_BOTTOM:
-                num_val = &a_style->num_props[NUM_PROP_BORDER_BOTTOM].sv;
-                break;
-
-        case DIR_LEFT:
-                num_val = &a_style->num_props[NUM_PROP_BORDER_LEFT].sv;
-                break;
-
-        default:
-                return CR_BAD_PARAM_ERROR;
-                break;
-        }
+        const gchar *ident = NULL;
 
         if (a_value->type == TERM_IDENT) {
-                if (a_value->content.str 
-                    && a_value->content.str->stryng
-                    && a_value->content.str->stryng->str) {
-                        if (!strncmp ("thin",
-                                      a_value->content.str->stryng->str,
-                                      sizeof ("thin")-1)) {
-                                cr_num_set (num_val, BORDER_THIN,
-                                            NUM_LENGTH_PX);
-                        } else if (!strncmp 
-                                   ("medium",
-                                    a_value->content.str->stryng->str,
-                                             sizeof ("medium")-1)) {
-                                cr_num_set (num_val, BORDER_MEDIUM,
-                                            NUM_LENGTH_PX);
-                        } else if (!strncmp ("thick",
-                                             a_value->content.str->stryng->str,
-                                             sizeof ("thick")-1)) {
-                                cr_num_set (num_val, BORDER_THICK,
-                                            NUM_LENGTH_PX);
-                        } else {
-                                return CR_UNKNOWN_TYPE_ERROR;
-                        }
+                ident = get_term_ident (a_value);
+                if (!ident)
+                        return CR_OK;
+                if (!strncmp ("thin", ident, sizeof ("thin") - 1)) {
+                        set_num_value (a_result, BORDER_THIN,
+                                       NUM_LENGTH_PX);
+                } else if (!strncmp ("medium", ident,
+                                     sizeof ("medium") - 1)) {
+                        set_num_value (a_result, BORDER_MEDIUM,
+                                       NUM_LENGTH_PX);
+                } else if (!strncmp ("thick", ident,
+                                     sizeof ("thick") - 1)) {
+                        set_num_value (a_result, BORDER_THICK,
+                                       NUM_LENGTH_PX);
+                } else {
+                        return CR_UNKNOWN_TYPE_ERROR;
                 }
         } else if (a_value->type == TERM_NUMBER) {
                 if (a_value->content.num) {
-                        cr_num_copy (num_val, a_value->content.num);
+                        copy_num_value (a_result, a_value->content.num);
                 }
-        } else if (a_value->type != TERM_NUMBER
-                   || a_value->content.num == NULL) {
+        } else {
                 return CR_UNKNOWN_TYPE_ERROR;
         }
+        return CR_OK;
+}
 
-        return status;
+static enum CRStatus
+decode_border_style (CRTerm * a_value, CRDeclValue * a_result)
+{
+        static const struct CRKeywordValPair border_style_vals_map[] = {
+                {"none", BORDER_STYLE_NONE},
+                {"hidden", BORDER_STYLE_HIDDEN},
+                {"dotted", BORDER_STYLE_DOTTED},
+                {"dashed", BORDER_STYLE_DASHED},
+                {"solid", BORDER_STYLE_SOLID},
+                {"double", BORDER_STYLE_DOUBLE},
+                {"groove", BORDER_STYLE_GROOVE},
+                {"ridge", BORDER_STYLE_RIDGE},
+                {"inset", BORDER_STYLE_INSET},
+                {"outset", BORDER_STYLE_OUTSET},
+                {"inherit", BORDER_STYLE_INHERIT},
+                {NULL, BORDER_STYLE_NONE}
+        };
+        gint keyword = 0;
+
+        if (!lookup_keyword (border_style_vals_map,
+                             get_term_ident (a_value), TRUE, &keyword))
+                return CR_UNKNOWN_TYPE_ERROR;
+        set_keyword_value (a_result, keyword);
+        return CR_OK;
 }
 
 static enum CRStatus
-set_prop_border_width_from_value (CRStyle *a_style,
-                                  CRTerm *a_value)
+decode_margin (CRTerm * a_value, CRDeclValue * a_result)
 {
-        CRTerm *cur_term = NULL ;
-        enum CRDirection direction = DIR_TOP ;
+        const gchar *ident = NULL;
 
-        g_return_val_if_fail (a_style && a_value,
-                              CR_BAD_PARAM_ERROR) ;
-        cur_term = a_value ;
+        switch (a_value->type) {
+        case TERM_IDENT:
+                ident = get_term_ident (a_value);
+                if (ident && !strcmp (ident, "inherit")) {
+                        set_num_value (a_result, 0.0, NUM_INHERIT);
+                } else if (ident && !strcmp (ident, "auto")) {
+                        set_num_value (a_result, 0.0, NUM_AUTO);
+                } else {
+                        return CR_UNKNOWN_TYPE_ERROR;
+                }
+                return CR_OK;
 
-        if (!cur_term)
-                return CR_ERROR ;
+        case TERM_NUMBER:
+                if (!a_value->content.num)
+                        return CR_BAD_PARAM_ERROR;
+                copy_num_value (a_result, a_value->content.num);
+                return CR_OK;
 
-        for (direction = DIR_TOP ; 
-             direction < NB_DIRS ; direction ++) {
-                set_prop_border_x_width_from_value (a_style, 
-                                                    cur_term,
-                                                    direction) ;
+        default:
+                return CR_UNKNOWN_TYPE_ERROR;
         }
+}
 
-        cur_term = cur_term->next ;
-        if (!cur_term)
-                return CR_OK ;
-        set_prop_border_x_width_from_value (a_style, cur_term,
-                                            DIR_RIGHT) ;
-        set_prop_border_x_width_from_value (a_style, cur_term,
-                                            DIR_LEFT) ;
+static enum CRStatus
+decode_display (CRTerm * a_value, CRDeclValue * a_result)
+{
+        static const struct CRKeywordValPair disp_vals_map[] = {
+                {"none", DISPLAY_NONE},
+                {"inline", DISPLAY_INLINE},
+                {"block", DISPLAY_BLOCK},
+                {"run-in", DISPLAY_RUN_IN},
+                {"compact", DISPLAY_COMPACT},
+                {"marker", DISPLAY_MARKER},
+                {"table", DISPLAY_TABLE},
+                {"inline-table", DISPLAY_INLINE_TABLE},
+                {"table-row-group", DISPLAY_TABLE_ROW_GROUP},
+                {"table-header-group", DISPLAY_TABLE_HEADER_GROUP},
+                {"table-footer-group", DISPLAY_TABLE_FOOTER_GROUP},
+                {"table-row", DISPLAY_TABLE_ROW},
+                {"table-column-group", DISPLAY_TABLE_COLUMN_GROUP},
+                {"table-column", DISPLAY_TABLE_COLUMN},
+                {"table-cell", DISPLAY_TABLE_CELL},
+                {"table-caption", DISPLAY_TABLE_CAPTION},
+                {"inherit", DISPLAY_INHERIT},
+                {NULL, DISPLAY_NONE}
+        };
+        gint keyword = 0;
 
-        cur_term = cur_term->next ;
-        if (!cur_term)
-                return CR_OK ;
-        set_prop_border_x_width_from_value (a_style, cur_term,
-                                            DIR_BOTTOM) ;
+        if (lookup_keyword (disp_vals_map, get_term_ident (a_value),
+                            TRUE, &keyword))
+                set_keyword_value (a_result, keyword);
+        return CR_OK;
+}
 
-        cur_term = cur_term->next ;
-        if (!cur_term)
-                return CR_OK ;
-        set_prop_border_x_width_from_value (a_style, cur_term,
-                                            DIR_LEFT) ;
+static enum CRStatus
+decode_position (CRTerm * a_value, CRDeclValue * a_result)
+{
+        static const struct CRKeywordValPair position_vals_map[] = {
+                {"static", POSITION_STATIC},
+                {"relative", POSITION_RELATIVE},
+                {"absolute", POSITION_ABSOLUTE},
+                {"fixed", POSITION_FIXED},
+                {"inherit", POSITION_INHERIT},
+                {NULL, POSITION_STATIC}
+                /*must alwas be the last one */
+        };
+        gint keyword = 0;
 
-        return CR_OK ;
+        if (!lookup_keyword (position_vals_map, get_term_ident (a_value),
+                             TRUE, &keyword))
+                return CR_UNKNOWN_PROP_VAL_ERROR;
+        set_keyword_value (a_result, keyword);
+        return CR_OK;
 }
 
+/**
+ *Decodes the value of the top, right, bottom or left properties.
+ */
 static enum CRStatus
-set_prop_border_x_style_from_value (CRStyle * a_style,
-                                    CRTerm * a_value, enum CRDirection a_dir)
+decode_box_offset (CRTerm * a_value, CRDeclValue * a_result)
 {
-        enum CRStatus status = CR_OK;
-        enum CRBorderStyle *border_style_ptr = NULL;
+        const gchar *ident = NULL;
 
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
-
-        switch (a_dir) {
-        case DIR_TOP:
-                border_style_ptr = &a_style->
-                        border_style_props[BORDER_STYLE_PROP_TOP];
-                break;
+        if (!(a_value->type == TERM_NUMBER)
+            && !(a_value->type == TERM_IDENT)) {
+                return CR_UNKNOWN_PROP_VAL_ERROR;
+        }
 
-        case DIR_RIGHT:
-                border_style_ptr =
-                        &a_style->border_style_props[BORDER_STYLE_PROP_RIGHT];
-                break;
+        /*
+         *an unknown value only turns the offset into auto,
+         *leaving its numerical value as it is.
+         */
+        a_result->type = DECL_VALUE_NUM_TYPE;
+        a_result->content.num.type = NUM_AUTO;
 
-        case DIR_BOTTOM:
-                border_style_ptr = &a_style->
-                        border_style_props[BORDER_STYLE_PROP_BOTTOM];
-                break;
+        ident = get_term_ident (a_value);
+        if (a_value->type == TERM_NUMBER && a_value->content.num) {
+                copy_num_value (a_result, a_value->content.num);
+        } else if (ident && !strncmp ("inherit", ident,
+                                      sizeof ("inherit") - 1)) {
+                set_num_value (a_result, 0.0, NUM_INHERIT);
+        }
+        return CR_OK;
+}
 
-        case DIR_LEFT:
-                border_style_ptr = &a_style->
-                        border_style_props[BORDER_STYLE_PROP_LEFT];
-                break;
+static enum CRStatus
+decode_float (CRTerm * a_value, CRDeclValue * a_result)
+{
+        static const struct CRKeywordValPair float_vals_map[] = {
+                {"none", FLOAT_NONE},
+                {"left", FLOAT_LEFT},
+                {"right", FLOAT_RIGHT},
+                {"inherit", FLOAT_INHERIT},
+                {NULL, FLOAT_NONE}
+        };
+        /*the default float type as specified by the css2 spec */
+        gint keyword = FLOAT_NONE;
 
-        default:
-                break;
-        }
+        lookup_keyword (float_vals_map, get_term_ident (a_value),
+                        TRUE, &keyword);
+        set_keyword_value (a_result, keyword);
+        return CR_OK;
+}
 
-        if (a_value->type != TERM_IDENT || !a_value->content.str) {
-                return CR_UNKNOWN_TYPE_ERROR;
-        }
+static enum CRStatus
+decode_width (CRTerm * a_value, CRDeclValue * a_result)
+{
+        const gchar *ident = get_term_ident (a_value);
 
-        if (!strncmp ("none", 
-                      a_value->content.str->stryng->str, 
-                      sizeof ("none")-1)) {
-                *border_style_ptr = BORDER_STYLE_NONE;
-        } else if (!strncmp ("hidden",
-                             a_value->content.str->stryng->str, 
-                             sizeof ("hidden")-1)) {
-                *border_style_ptr = BORDER_STYLE_HIDDEN;
-        } else if (!strncmp ("dotted",
-                             a_value->content.str->stryng->str, 
-                             sizeof ("dotted")-1)) {
-                *border_style_ptr = BORDER_STYLE_DOTTED;
-        } else if (!strncmp ("dashed",
-                             a_value->content.str->stryng->str, sizeof ("dashed")-1)) {
-                *border_style_ptr = BORDER_STYLE_DASHED;
-        } else if (!strncmp ("solid",
-                             a_value->content.str->stryng->str, sizeof ("solid")-1)) {
-                *border_style_ptr = BORDER_STYLE_SOLID;
-        } else if (!strncmp ("double",
-                             a_value->content.str->stryng->str, sizeof ("double")-1)) {
-                *border_style_ptr = BORDER_STYLE_DOUBLE;
-        } else if (!strncmp ("groove",
-                             a_value->content.str->stryng->str, sizeof ("groove")-1)) {
-                *border_style_ptr = BORDER_STYLE_GROOVE;
-        } else if (!strncmp ("ridge",
-                             a_value->content.str->stryng->str, 
-                             sizeof ("ridge")-1)) {
-                *border_style_ptr = BORDER_STYLE_RIDGE;
-        } else if (!strncmp ("inset",
-                             a_value->content.str->stryng->str, 
-                             sizeof ("inset")-1)) {
-                *border_style_ptr = BORDER_STYLE_INSET;
-        } else if (!strncmp ("outset",
-                             a_value->content.str->stryng->str, 
-                             sizeof ("outset")-1)) {
-                *border_style_ptr = BORDER_STYLE_OUTSET;
-        } else if (!strncmp ("inherit",
-                             a_value->content.str->stryng->str, 
-                             sizeof ("inherit")-1)) {
-		*border_style_ptr = BORDER_STYLE_INHERIT;
-        } else {
-                status = CR_UNKNOWN_TYPE_ERROR;
+        set_num_value (a_result, 0.0, NUM_AUTO);
+        if (ident && !strncmp ("inherit", ident, sizeof ("inherit") - 1)) {
+                set_num_value (a_result, 0.0, NUM_INHERIT);
+        } else if (a_value->type == TERM_NUMBER && a_value->content.num) {
+                copy_num_value (a_result, a_value->content.num);
         }
-
-        return status;
+        return CR_OK;
 }
 
+/**
+ *Decodes the value of the color and background-color properties.
+ */
 static enum CRStatus
-set_prop_border_style_from_value (CRStyle *a_style,
-                                  CRTerm *a_value)
+decode_color (CRTerm * a_value, CRDeclValue * a_result)
 {
-        CRTerm *cur_term = NULL ;
-        enum CRDirection direction = DIR_TOP ;
+        enum CRStatus status = CR_OK;
+        const gchar *ident = NULL;
 
-        g_return_val_if_fail (a_style && a_value, 
-                              CR_BAD_PARAM_ERROR) ;
-
-        cur_term = a_value ;
-        if (!cur_term || cur_term->type != TERM_IDENT) {
-                return CR_ERROR ;
-        }
-        
-        for (direction = DIR_TOP ; 
-             direction < NB_DIRS ;
-             direction ++) {
-                set_prop_border_x_style_from_value (a_style, 
-                                                    cur_term,
-                                                    direction) ;
-        }
-        
-        cur_term = cur_term->next ;
-        if (!cur_term || cur_term->type != TERM_IDENT) {
-                return CR_OK ;
-        }
-        
-        set_prop_border_x_style_from_value (a_style, cur_term, 
-                                            DIR_RIGHT) ;
-        set_prop_border_x_style_from_value (a_style, cur_term, 
-                                            DIR_LEFT) ;
-
-        cur_term = cur_term->next ;
-        if (!cur_term || cur_term->type != TERM_IDENT) {
-                return CR_OK ;
-        }        
-        set_prop_border_x_style_from_value (a_style, cur_term,
-                                           DIR_BOTTOM) ;
-        
-        cur_term = cur_term->next ;
-        if (!cur_term || cur_term->type != TERM_IDENT) {
-                return CR_OK ;
-        }
-        set_prop_border_x_style_from_value (a_style, cur_term,
-                                            DIR_LEFT) ;
-        return CR_OK ;
-}
-
-static enum CRStatus
-set_prop_margin_x_from_value (CRStyle * a_style, CRTerm * a_value,
-                              enum CRDirection a_dir)
-{
-        enum CRStatus status = CR_OK;
-        CRNum *num_val = NULL;
-
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
-
-        switch (a_dir) {
-        case DIR_TOP:
-                num_val = &a_style->num_props[NUM_PROP_MARGIN_TOP].sv;
-                break;
-
-        case DIR_RIGHT:
-                num_val = &a_style->num_props[NUM_PROP_MARGIN_RIGHT].sv;
-                break;
-
-        case DIR_BOTTOM:
-                num_val = &a_style->num_props[NUM_PROP_MARGIN_BOTTOM].sv;
-                break;
-
-        case DIR_LEFT:
-                num_val = &a_style->num_props[NUM_PROP_MARGIN_LEFT].sv;
+        switch (a_value->type) {
+        case TERM_RGB:
+                if (a_value->content.rgb) {
+                        a_result->type = DECL_VALUE_RGB;
+                        cr_rgb_copy (&a_result->content.rgb,
+                                     a_value->content.rgb);
+                }
                 break;
 
-        default:
+        case TERM_IDENT:
+                ident = get_term_ident (a_value);
+                if (!ident) {
+                        cr_utils_trace_info ("a_value has NULL string value");
+                } else if (!strncmp ("inherit", ident,
+                                     sizeof ("inherit") - 1)) {
+                        a_result->type = DECL_VALUE_RGB_INHERIT;
+                } else {
+                        status = cr_rgb_set_from_name
+                                (&a_result->content.rgb,
+                                 (const guchar *) ident);
+                        if (status == CR_OK)
+                                a_result->type = DECL_VALUE_RGB;
+                }
                 break;
-        }
 
-        switch (a_value->type) {
-        case TERM_IDENT:
+        case TERM_HASH:
                 if (a_value->content.str
                     && a_value->content.str->stryng
-                    && a_value->content.str->stryng->str
-                    && !strcmp (a_value->content.str->stryng->str,
-                                 "inherit")) {
-			status = cr_num_set (num_val, 0.0, NUM_INHERIT);
-                } else if (a_value->content.str
-                           && a_value->content.str->stryng
-                           && !strcmp (a_value->content.str->stryng->str,
-                                        "auto")) {
-                        status = cr_num_set (num_val, 0.0, NUM_AUTO);
+                    && a_value->content.str->stryng->str) {
+                        status = cr_rgb_set_from_hex_str
+                                (&a_result->content.rgb,
+                                 (const guchar *) a_value->content.str->stryng->str);
+                        if (status == CR_OK)
+                                a_result->type = DECL_VALUE_RGB;
                 } else {
-                        status = CR_UNKNOWN_TYPE_ERROR;
+                        cr_utils_trace_info ("a_value has NULL string value");
                 }
-                break ;
-
-        case TERM_NUMBER:
-                status = cr_num_copy (num_val, a_value->content.num);
                 break;
 
         default:
                 status = CR_UNKNOWN_TYPE_ERROR;
                 break;
         }
-
         return status;
 }
 
-struct CRPropDisplayValPair {
-        const gchar *prop_name;
-        enum CRDisplayType type;
-};
-
+/**
+ *Decodes the value of the border-top-color, border-right-color,
+ *border-bottom-color or border-left-color properties.
+ *The value is taken from a css2 term of type IDENT or RGB.
+ *An unknown color name decodes to black.
+ */
 static enum CRStatus
-set_prop_display_from_value (CRStyle * a_style, CRTerm * a_value)
+decode_border_color (CRTerm * a_value, CRDeclValue * a_result)
 {
-        static const struct CRPropDisplayValPair disp_vals_map[] = {
-                {"none", DISPLAY_NONE},
-                {"inline", DISPLAY_INLINE},
-                {"block", DISPLAY_BLOCK},
-                {"run-in", DISPLAY_RUN_IN},
-                {"compact", DISPLAY_COMPACT},
-                {"marker", DISPLAY_MARKER},
-                {"table", DISPLAY_TABLE},
-                {"inline-table", DISPLAY_INLINE_TABLE},
-                {"table-row-group", DISPLAY_TABLE_ROW_GROUP},
-                {"table-header-group", DISPLAY_TABLE_HEADER_GROUP},
-                {"table-footer-group", DISPLAY_TABLE_FOOTER_GROUP},
-                {"table-row", DISPLAY_TABLE_ROW},
-                {"table-column-group", DISPLAY_TABLE_COLUMN_GROUP},
-                {"table-column", DISPLAY_TABLE_COLUMN},
-                {"table-cell", DISPLAY_TABLE_CELL},
-                {"table-caption", DISPLAY_TABLE_CAPTION},
-                {"inherit", DISPLAY_INHERIT},
-                {NULL, DISPLAY_NONE}
-        };
-
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+        enum CRStatus status = CR_UNKNOWN_PROP_VAL_ERROR;
+        const gchar *ident = NULL;
 
-        switch (a_value->type) {
-        case TERM_IDENT:
-                {
-                        int i = 0;
-
-                        if (!a_value->content.str
-                            || !a_value->content.str->stryng
-                            || !a_value->content.str->stryng->str)
-                                break;
-
-                        for (i = 0; disp_vals_map[i].prop_name; i++) {
-                                if (!strncmp 
-                                    (disp_vals_map[i].prop_name,
-                                     a_value->content.str->stryng->str,
-                                     strlen (disp_vals_map[i].prop_name))) {
-                                        a_style->display =
-                                                disp_vals_map[i].type;
-                                        break;
-                                }
-                        }
+        if (a_value->type == TERM_IDENT) {
+                ident = get_term_ident (a_value);
+                if (ident) {
+                        status = cr_rgb_set_from_name
+                                (&a_result->content.rgb,
+                                 (const guchar *) ident);
+                }
+                if (status != CR_OK) {
+                        cr_rgb_set_from_name (&a_result->content.rgb,
+                                              (const guchar *) "black");
+                }
+                a_result->type = DECL_VALUE_RGB;
+        } else if (a_value->type == TERM_RGB) {
+                if (a_value->content.rgb) {
+                        status = cr_rgb_set_from_rgb
+                                (&a_result->content.rgb,
+                                 a_value->content.rgb);
+                        a_result->type = DECL_VALUE_RGB;
                 }
-                break;
-
-        default:
-                break;
         }
-
-        return CR_OK;
+        return status;
 }
 
-struct CRPropPositionValPair {
-        const gchar *name;
-        enum CRPositionType type;
-};
-
 static enum CRStatus
-set_prop_position_from_value (CRStyle * a_style, CRTerm * a_value)
+decode_font_family (CRTerm * a_value, CRDeclValue * a_result)
 {
-        enum CRStatus status = CR_UNKNOWN_PROP_VAL_ERROR;
-        static const struct CRPropPositionValPair position_vals_map[] = {
-                {"static", POSITION_STATIC},
-                {"relative", POSITION_RELATIVE},
-                {"absolute", POSITION_ABSOLUTE},
-                {"fixed", POSITION_FIXED},
-                {"inherit", POSITION_INHERIT},
-                {NULL, POSITION_STATIC}
-                /*must alwas be the last one */
+        static const struct CRKeywordValPair generic_vals_map[] = {
+                {"sans-serif", FONT_FAMILY_SANS_SERIF},
+                {"serif", FONT_FAMILY_SERIF},
+                {"cursive", FONT_FAMILY_CURSIVE},
+                {"fantasy", FONT_FAMILY_FANTASY},
+                {"monospace", FONT_FAMILY_MONOSPACE},
+                {NULL, FONT_FAMILY_SANS_SERIF}
         };
+        CRTerm *cur_term = NULL;
+        CRFontFamily *font_family = NULL,
+                *cur_ff = NULL;
+        const gchar *ident = NULL;
+        gint font_type = 0;
 
-        g_return_val_if_fail (a_value, CR_BAD_PARAM_ERROR);
+        ident = get_term_ident (a_value);
+        if (ident && !strcmp ("inherit", ident)) {
+                font_family = cr_font_family_new (FONT_FAMILY_INHERIT, NULL);
+                goto out;
+        }
 
-        switch (a_value->type) {
-        case TERM_IDENT:
-                {
-                        int i = 0;
-
-                        if (!a_value->content.str
-                            || !a_value->content.str->stryng
-                            || !a_value->content.str->stryng->str)
-                                break;
-
-                        for (i = 0; position_vals_map[i].name; i++) {
-                                if (!strncmp (position_vals_map[i].name,
-                                              a_value->content.str->stryng->str,
-                                              strlen (position_vals_map[i].
-                                                      name))) {
-                                        a_style->position =
-                                                position_vals_map[i].type;
-                                        status = CR_OK;
-                                        break;
-                                }
+        for (cur_term = a_value; cur_term; cur_term = cur_term->next) {
+                cur_ff = NULL;
+                switch (cur_term->type) {
+                case TERM_IDENT:
+                        /*unknown property values are ignored*/
+                        if (lookup_keyword (generic_vals_map,
+                                            get_term_ident (cur_term),
+                                            FALSE, &font_type)) {
+                                cur_ff = cr_font_family_new (font_type,
+                                                             NULL);
                         }
-                }
-                break;
+                        break;
 
-        default:
-                break;
+                case TERM_STRING:
+                        if (cur_term->content.str
+                            && cur_term->content.str->stryng
+                            && cur_term->content.str->stryng->str) {
+                                cur_ff = cr_font_family_new
+                                        (FONT_FAMILY_NON_GENERIC,
+                                         (guchar *) g_strdup
+                                         (cur_term->content.str->stryng->str));
+                        }
+                        break;
+
+                default:
+                        break;
+                }
+                if (cur_ff) {
+                        font_family = cr_font_family_append (font_family,
+                                                             cur_ff);
+                }
         }
 
-        return status;
+ out:
+        if (font_family) {
+                a_result->type = DECL_VALUE_FONT_FAMILY;
+                a_result->content.font_family = font_family;
+        }
+        return CR_OK;
 }
 
 static enum CRStatus
-set_prop_x_from_value (CRStyle * a_style, CRTerm * a_value,
-                       enum CRDirection a_dir)
+decode_font_size (CRTerm * a_value, CRDeclValue * a_result)
 {
-        CRNum *box_offset = NULL;
-
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
-
-        if (!(a_value->type == TERM_NUMBER)
-            && !(a_value->type == TERM_IDENT)) {
-                return CR_UNKNOWN_PROP_VAL_ERROR;
-        }
-
-        switch (a_dir) {
-        case DIR_TOP:
-                box_offset = &a_style->num_props[NUM_PROP_TOP].sv;
-                break;
+        static const struct CRKeywordValPair absolute_vals_map[] = {
+                {"xx-small", FONT_SIZE_XX_SMALL},
+                {"x-small", FONT_SIZE_X_SMALL},
+                {"small", FONT_SIZE_SMALL},
+                {"medium", FONT_SIZE_MEDIUM},
+                {"large", FONT_SIZE_LARGE},
+                {"x-large", FONT_SIZE_X_LARGE},
+                {"xx-large", FONT_SIZE_XX_LARGE},
+                {NULL, FONT_SIZE_MEDIUM}
+        };
+        static const struct CRKeywordValPair relative_vals_map[] = {
+                {"larger", FONT_SIZE_LARGER},
+                {"smaller", FONT_SIZE_SMALLER},
+                {NULL, FONT_SIZE_LARGER}
+        };
+        CRFontSize *font_size = &a_result->content.font_size;
+        const gchar *ident = NULL;
+        gint keyword = 0;
 
-        case DIR_RIGHT:
-                box_offset = &a_style->num_props[NUM_PROP_RIGHT].sv;
+        switch (a_value->type) {
+        case TERM_IDENT:
+                a_result->type = DECL_VALUE_FONT_SIZE;
+                ident = get_term_ident (a_value);
+                if (lookup_keyword (absolute_vals_map, ident, FALSE,
+                                    &keyword)) {
+                        font_size->type = PREDEFINED_ABSOLUTE_FONT_SIZE;
+                        font_size->value.predefined = keyword;
+                } else if (lookup_keyword (relative_vals_map, ident,
+                                           FALSE, &keyword)) {
+                        font_size->type = RELATIVE_FONT_SIZE;
+                        font_size->value.relative = keyword;
+                } else if (ident && !strcmp (ident, "inherit")) {
+                        font_size->type = INHERITED_FONT_SIZE;
+                } else {
+                        cr_utils_trace_info ("Unknown value of font-size") ;
+                        return CR_UNKNOWN_PROP_VAL_ERROR;
+                }
                 break;
 
-        case DIR_BOTTOM:
-                box_offset = &a_style->num_props[NUM_PROP_BOTTOM].sv;
-                break;
-        case DIR_LEFT:
-                box_offset = &a_style->num_props[NUM_PROP_LEFT].sv;
+        case TERM_NUMBER:
+                if (a_value->content.num) {
+                        a_result->type = DECL_VALUE_FONT_SIZE;
+                        font_size->type = ABSOLUTE_FONT_SIZE;
+                        cr_num_copy (&font_size->value.absolute,
+                                     a_value->content.num) ;
+                }
                 break;
 
         default:
-                break;
-        }
-
-        box_offset->type = NUM_AUTO;
-
-        if (a_value->type == TERM_NUMBER && a_value->content.num) {
-                cr_num_copy (box_offset, a_value->content.num);
-        } else if (a_value->type == TERM_IDENT
-                   && a_value->content.str
-                   && a_value->content.str->stryng
-                   && a_value->content.str->stryng->str) {
-                if (!strncmp ("inherit",
-                              a_value->content.str->stryng->str,
-                              sizeof ("inherit")-1)) {
-                        cr_num_set (box_offset, 0.0, NUM_INHERIT);
-                } else if (!strncmp ("auto",
-                                     a_value->content.str->stryng->str,
-                                     sizeof ("auto")-1)) {
-                        box_offset->type = NUM_AUTO;
-                }
+                a_result->type = DECL_VALUE_FONT_SIZE;
+                return CR_UNKNOWN_PROP_VAL_ERROR;
         }
-
         return CR_OK;
 }
 
 static enum CRStatus
-set_prop_float (CRStyle * a_style, CRTerm * a_value)
+decode_font_style (CRTerm * a_value, CRDeclValue * a_result)
 {
-        g_return_val_if_fail (a_style && a_value, 
-                              CR_BAD_PARAM_ERROR);
+        static const struct CRKeywordValPair font_style_vals_map[] = {
+                {"normal", FONT_STYLE_NORMAL},
+                {"italic", FONT_STYLE_ITALIC},
+                {"oblique", FONT_STYLE_OBLIQUE},
+                {"inherit", FONT_STYLE_INHERIT},
+                {NULL, FONT_STYLE_NORMAL}
+        };
+        const gchar *ident = NULL;
+        gint keyword = 0;
 
-        /*the default float type as specified by the css2 spec */
-        a_style->float_type = FLOAT_NONE;
+        if (a_value->type != TERM_IDENT)
+                return CR_UNKNOWN_PROP_VAL_ERROR;
 
-        if (a_value->type != TERM_IDENT 
-            || !a_value->content.str
-            || !a_value->content.str->stryng
-            || !a_value->content.str->stryng->str) { 
-                /*unknown type, the float type is set to it's default value */
+        ident = get_term_ident (a_value);
+        if (!ident)
                 return CR_OK;
-        }
-
-        if (!strncmp ("none", 
-                      a_value->content.str->stryng->str, 
-                      sizeof ("none")-1)) {
-                a_style->float_type = FLOAT_NONE;
-        } else if (!strncmp ("left",
-                             a_value->content.str->stryng->str, 
-                             sizeof ("left")-1)) {
-                a_style->float_type = FLOAT_LEFT;
-        } else if (!strncmp ("right",
-                             a_value->content.str->stryng->str, 
-                             sizeof ("right")-1)) {
-                a_style->float_type = FLOAT_RIGHT;
-        } else if (!strncmp ("inherit",
-                             a_value->content.str->stryng->str, 
-                             sizeof ("inherit")-1)) {
-		a_style->float_type = FLOAT_INHERIT;
-        }
+        if (!lookup_keyword (font_style_vals_map, ident, FALSE, &keyword))
+                return CR_UNKNOWN_PROP_VAL_ERROR;
+        set_keyword_value (a_result, keyword);
         return CR_OK;
 }
 
 static enum CRStatus
-set_prop_width (CRStyle * a_style, CRTerm * a_value)
+decode_font_weight (CRTerm * a_value, CRDeclValue * a_result)
 {
-	CRNum *width = NULL;
-        g_return_val_if_fail (a_style 
-                              && a_value, 
-                              CR_BAD_PARAM_ERROR);
+        static const struct CRKeywordValPair font_weight_vals_map[] = {
+                {"normal", FONT_WEIGHT_NORMAL},
+                {"bold", FONT_WEIGHT_BOLD},
+                {"bolder", FONT_WEIGHT_BOLDER},
+                {"lighter", FONT_WEIGHT_LIGHTER},
+                {"inherit", FONT_WEIGHT_INHERIT},
+                {NULL, FONT_WEIGHT_NORMAL}
+        };
+        const gchar *ident = NULL;
+        gint keyword = 0;
+        gdouble val = 0;
 
-	width = &a_style->num_props[NUM_PROP_WIDTH].sv;
-	cr_num_set (width, 0.0, NUM_AUTO);
+        switch (a_value->type) {
+        case TERM_IDENT:
+                ident = get_term_ident (a_value);
+                if (!ident)
+                        return CR_OK;
+                if (!lookup_keyword (font_weight_vals_map, ident, FALSE,
+                                     &keyword))
+                        return CR_UNKNOWN_PROP_VAL_ERROR;
+                set_keyword_value (a_result, keyword);
+                break;
 
-        if (a_value->type == TERM_IDENT) {
-                if (a_value->content.str 
-                    && a_value->content.str->stryng
-                    && a_value->content.str->stryng->str) {
-                        if (!strncmp ("auto",
-                                      a_value->content.str->stryng->str,
-                                      sizeof ("auto")-1)) {
-				cr_num_set (width, 0.0, NUM_AUTO);
-                        } else if (!strncmp ("inherit",
-                                             a_value->content.str->stryng->str,
-                                             sizeof ("inherit")-1)) {
-				cr_num_set (width, 0.0, NUM_INHERIT);
+        case TERM_NUMBER:
+                if (a_value->content.num
+                    && (a_value->content.num->type == NUM_GENERIC
+                        || a_value->content.num->type == NUM_AUTO)) {
+                        val = a_value->content.num->val;
+                        if (val <= 150) {
+                                keyword = FONT_WEIGHT_100;
+                        } else if (val <= 250) {
+                                keyword = FONT_WEIGHT_200;
+                        } else if (val <= 350) {
+                                keyword = FONT_WEIGHT_300;
+                        } else if (val <= 450) {
+                                keyword = FONT_WEIGHT_400;
+                        } else if (val <= 550) {
+                                keyword = FONT_WEIGHT_500;
+                        } else if (val <= 650) {
+                                keyword = FONT_WEIGHT_600;
+                        } else if (val <= 750) {
+                                keyword = FONT_WEIGHT_700;
+                        } else if (val <= 850) {
+                                keyword = FONT_WEIGHT_800;
+                        } else {
+                                keyword = FONT_WEIGHT_900;
                         }
+                        set_keyword_value (a_result, keyword);
                 }
-        } else if (a_value->type == TERM_NUMBER) {
-                if (a_value->content.num) {
-                        cr_num_copy (&a_style->num_props[NUM_PROP_WIDTH].sv,
-                                     a_value->content.num);
-                }
+                break;
+
+        default:
+                return CR_UNKNOWN_PROP_VAL_ERROR;
         }
         return CR_OK;
 }
 
-static enum CRStatus 
-set_prop_color (CRStyle * a_style, CRTerm * a_value)
-{
-	enum CRStatus status = CR_OK;
-	CRRgb *a_rgb = &a_style->rgb_props[RGB_PROP_COLOR].sv;
-
-	g_return_val_if_fail (a_style 
-                              && a_value, CR_BAD_PARAM_ERROR);
-
-	status = cr_rgb_set_from_term (a_rgb, a_value);
-
-	return status;
-}
-
 static enum CRStatus
-set_prop_background_color (CRStyle * a_style, CRTerm * a_value)
+decode_white_space (CRTerm * a_value, CRDeclValue * a_result)
 {
-	enum CRStatus status = CR_OK;
-	CRRgb *rgb = &a_style->rgb_props[RGB_PROP_BACKGROUND_COLOR].sv;
+        static const struct CRKeywordValPair white_space_vals_map[] = {
+                {"normal", WHITE_SPACE_NORMAL},
+                {"pre", WHITE_SPACE_PRE},
+                {"nowrap", WHITE_SPACE_NOWRAP},
+                {"inherit", WHITE_SPACE_INHERIT},
+                {NULL, WHITE_SPACE_NORMAL}
+        };
+        const gchar *ident = NULL;
+        gint keyword = 0;
 
-	g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+        if (a_value->type != TERM_IDENT)
+                return CR_UNKNOWN_PROP_VAL_ERROR;
 
-	status = cr_rgb_set_from_term (rgb, a_value);
-	return status;
+        ident = get_term_ident (a_value);
+        if (!ident)
+                return CR_OK;
+        if (!lookup_keyword (white_space_vals_map, ident, FALSE, &keyword))
+                return CR_UNKNOWN_PROP_VAL_ERROR;
+        set_keyword_value (a_result, keyword);
+        return CR_OK;
 }
 
 /**
- *Sets border-top-color, border-right-color,
- *border-bottom-color or border-left-color properties
- *in the style structure. The value is taken from a
- *css2 term of type IDENT or RGB.
- *@param a_style the style structure to set.
- *@param a_value the css2 term to take the color information from.
- *@param a_dir the direction (TOP, LEFT, RIGHT, or BOTTOM).
- *@return CR_OK upon successfull completion, an error code otherwise.
+ *Interprets the value of a longhand property once, so that
+ *it can then be stored in any number of #CRStyle instances
+ *by apply_decl_value().
+ *@param a_prop_id the id of the property.
+ *@param a_value the value of the property.
+ *@param a_result out parameter. The decoded value.
+ *If the value is invalid and setting it is a no-op, its type is
+ *DECL_VALUE_NONE. It must be released by clear_decl_value().
+ *@return CR_OK upon successful completion, an error code otherwise.
  */
 static enum CRStatus
-set_prop_border_x_color_from_value (CRStyle * a_style, CRTerm * a_value,
-                                    enum CRDirection a_dir)
+decode_value (enum CRPropertyID a_prop_id, CRTerm * a_value,
+              CRDeclValue * a_result)
 {
-        CRRgb *rgb_color = NULL;
-        enum CRStatus status = CR_OK;
+        memset (a_result, 0, sizeof (CRDeclValue));
+        a_result->type = DECL_VALUE_NONE;
 
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+        g_return_val_if_fail (a_value, CR_BAD_PARAM_ERROR);
 
-        switch (a_dir) {
-        case DIR_TOP:
-                rgb_color = &a_style->rgb_props[RGB_PROP_BORDER_TOP_COLOR].sv;
-                break;
+        switch (a_prop_id) {
+        case PROP_ID_PADDING_TOP:
+        case PROP_ID_PADDING_RIGHT:
+        case PROP_ID_PADDING_BOTTOM:
+        case PROP_ID_PADDING_LEFT:
+                return decode_padding (a_value, a_result);
 
-        case DIR_RIGHT:
-                rgb_color =
-                        &a_style->rgb_props[RGB_PROP_BORDER_RIGHT_COLOR].sv;
-                break;
+        case PROP_ID_BORDER_TOP_WIDTH:
+        case PROP_ID_BORDER_RIGHT_WIDTH:
+        case PROP_ID_BORDER_BOTTOM_WIDTH:
+        case PROP_ID_BORDER_LEFT_WIDTH:
+                return decode_border_width (a_value, a_result);
 
-        case DIR_BOTTOM:
-                rgb_color =
-                        &a_style->rgb_props[RGB_PROP_BORDER_BOTTOM_COLOR].sv;
-                break;
+        case PROP_ID_BORDER_TOP_STYLE:
+        case PROP_ID_BORDER_RIGHT_STYLE:
+        case PROP_ID_BORDER_BOTTOM_STYLE:
+        case PROP_ID_BORDER_LEFT_STYLE:
+                return decode_border_style (a_value, a_result);
 
-        case DIR_LEFT:
-                rgb_color =
-                        &a_style->rgb_props[RGB_PROP_BORDER_LEFT_COLOR].sv;
-                break;
+        case PROP_ID_BORDER_TOP_COLOR:
+        case PROP_ID_BORDER_RIGHT_COLOR:
+        case PROP_ID_BORDER_BOTTOM_COLOR:
+        case PROP_ID_BORDER_LEFT_COLOR:
+                return decode_border_color (a_value, a_result);
 
-        default:
-                cr_utils_trace_info ("unknown DIR type");
-                return CR_BAD_PARAM_ERROR;
-        }
+        case PROP_ID_MARGIN_TOP:
+        case PROP_ID_MARGIN_RIGHT:
+        case PROP_ID_MARGIN_BOTTOM:
+        case PROP_ID_MARGIN_LEFT:
+                return decode_margin (a_value, a_result);
 
-        status = CR_UNKNOWN_PROP_VAL_ERROR;
+        case PROP_ID_DISPLAY:
+                return decode_display (a_value, a_result);
 
-        if (a_value->type == TERM_IDENT) {
-                if (a_value->content.str 
-                    && a_value->content.str->stryng
-                    && a_value->content.str->stryng->str) {
-                        status = cr_rgb_set_from_name
-                                (rgb_color, 
-                                 (const guchar *) a_value->content.str->stryng->str);
+        case PROP_ID_POSITION:
+                return decode_position (a_value, a_result);
 
-                }
-                if (status != CR_OK) {
-                        cr_rgb_set_from_name (rgb_color, (const guchar *) "black");
-                }
-        } else if (a_value->type == TERM_RGB) {
-                if (a_value->content.rgb) {
-                        status = cr_rgb_set_from_rgb
-                                (rgb_color, a_value->content.rgb);
-                }
-        }
-        return status;
-}
+        case PROP_ID_TOP:
+        case PROP_ID_RIGHT:
+        case PROP_ID_BOTTOM:
+        case PROP_ID_LEFT:
+                return decode_box_offset (a_value, a_result);
 
-static enum CRStatus
-set_prop_border_x_from_value (CRStyle * a_style, CRTerm * a_value,
-                              enum CRDirection a_dir)
-{
-        CRTerm *cur_term = NULL;
+        case PROP_ID_FLOAT:
+                return decode_float (a_value, a_result);
 
-        enum CRStatus status = CR_OK;
+        case PROP_ID_WIDTH:
+                return decode_width (a_value, a_result);
 
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+        case PROP_ID_COLOR:
+        case PROP_ID_BACKGROUND_COLOR:
+                return decode_color (a_value, a_result);
 
-        for (cur_term = a_value; 
-             cur_term; 
-             cur_term = cur_term->next) {
-                status = set_prop_border_x_width_from_value (a_style,
-                                                             cur_term, a_dir);
+        case PROP_ID_FONT_FAMILY:
+                return decode_font_family (a_value, a_result);
 
-                if (status != CR_OK) {
-                        status = set_prop_border_x_style_from_value
-                                (a_style, cur_term, a_dir);
-                }
-                if (status != CR_OK) {
-                        status = set_prop_border_x_color_from_value
-                                (a_style, cur_term, a_dir);
-                }
-        }
-        return CR_OK;
-}
+        case PROP_ID_FONT_SIZE:
+                return decode_font_size (a_value, a_result);
 
-static enum CRStatus
-set_prop_border_from_value (CRStyle * a_style, CRTerm * a_value)
-{
-        enum CRDirection direction = 0;
+        case PROP_ID_FONT_STYLE:
+                return decode_font_style (a_value, a_result);
 
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+        case PROP_ID_FONT_WEIGHT:
+                return decode_font_weight (a_value, a_result);
 
-        for (direction = 0; direction < NB_DIRS; direction++) {
-                set_prop_border_x_from_value (a_style, 
-                                              a_value, 
-                                              direction);
-        }
+        case PROP_ID_WHITE_SPACE:
+                return decode_white_space (a_value, a_result);
 
-        return CR_OK;
+        default:
+                return CR_UNKNOWN_TYPE_ERROR;
+        }
 }
 
-static enum CRStatus
-set_prop_padding_from_value (CRStyle * a_style, CRTerm * a_value)
+static void
+clear_decl_value (CRDeclValue * a_value)
 {
-        CRTerm *cur_term = NULL;
-        enum CRDirection direction = 0;
-        enum CRStatus status = CR_OK;
-        
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
-
-        cur_term = a_value;
-
-        /*filter the eventual non NUMBER terms some user can have written here*/
-        while (cur_term && cur_term->type != TERM_NUMBER) {
-                cur_term = cur_term->next;
-        }
-        if (!cur_term)
-                return CR_ERROR ;
-
-        for (direction = 0; direction < NB_DIRS; direction++) {
-                set_prop_padding_x_from_value (a_style, cur_term, direction);
+        if (a_value->type == DECL_VALUE_FONT_FAMILY
+            && a_value->content.font_family) {
+                cr_font_family_destroy (a_value->content.font_family);
+                a_value->content.font_family = NULL;
         }
-        cur_term = cur_term->next;
+        a_value->type = DECL_VALUE_NONE;
+}
 
-        /*filter non NUMBER terms that some users can have written here...*/
-        while (cur_term && cur_term->type != TERM_NUMBER) {
-                cur_term = cur_term->next;
+/**
+ *Returns a copy of a font family list, which names
+ *are duplicated.
+ */
+static CRFontFamily *
+font_family_dup (CRFontFamily const * a_font_family)
+{
+        CRFontFamily const *cur_ff = NULL;
+        CRFontFamily *result = NULL,
+                *new_ff = NULL;
+
+        for (cur_ff = a_font_family; cur_ff; cur_ff = cur_ff->next) {
+                new_ff = cr_font_family_new
+                        (cur_ff->type,
+                         cur_ff->name ?
+                         (guchar *) g_strdup ((const gchar *) cur_ff->name)
+                         : NULL);
+                if (!new_ff) {
+                        cr_utils_trace_info ("Out of memory");
+                        break;
+                }
+                result = cr_font_family_append (result, new_ff);
         }
-        /*the user can have just written padding: 1px*/
-        if (!cur_term)
-                return CR_OK;
+        return result;
+}
 
-        set_prop_padding_x_from_value (a_style, cur_term, DIR_RIGHT);
-        set_prop_padding_x_from_value (a_style, cur_term, DIR_LEFT);
+/*
+ *The groups the styles built by cr_style_new () start from.
+ *They are built once by init_base_groups () and are never
+ *modified afterwards, so every style can share them.
+ */
+static CRStyleGroup *gv_default_groups[NB_STYLE_GROUPS];
+static CRStyleGroup *gv_initial_groups[NB_STYLE_GROUPS];
+
+static const gsize gv_group_sizes[NB_STYLE_GROUPS] = {
+        sizeof (CRStyleBox),
+        sizeof (CRStyleBorder),
+        sizeof (CRStyleColor),
+        sizeof (CRStyleFont),
+        sizeof (CRStyleText)
+};
 
-        while (cur_term && cur_term->type != TERM_NUMBER) {
-                cur_term = cur_term->next;
-        }
-        if (!cur_term)
-                return CR_OK;
+static void group_unref (enum CRStyleGroupKind a_kind,
+                         CRStyleGroup * a_this);
 
-        set_prop_padding_x_from_value (a_style, cur_term, DIR_BOTTOM);
+static CRStyleGroup *
+group_new (enum CRStyleGroupKind a_kind)
+{
+        CRStyleGroup *result = NULL;
 
-        while (cur_term && cur_term->type != TERM_NUMBER) {
-                cur_term = cur_term->next;
+        result = cr_allocator_alloc (gv_group_sizes[a_kind]);
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
         }
-        if (!cur_term)
-                return CR_OK;
-        status = set_prop_padding_x_from_value (a_style, cur_term, DIR_LEFT);
-        return status;
+        memset (result, 0, gv_group_sizes[a_kind]);
+        result->ref_count = 1;
+        cr_stats_count_alloc (CR_STATS_STYLE_GROUP);
+        return result;
 }
 
-static enum CRStatus
-set_prop_margin_from_value (CRStyle * a_style, CRTerm * a_value)
+static void
+group_ref (CRStyleGroup * a_this)
 {
-        CRTerm *cur_term = NULL;
-        enum CRDirection direction = 0;
-        enum CRStatus status = CR_OK;
-
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
-
-        cur_term = a_value;
-
-        while (cur_term && cur_term->type != TERM_NUMBER) {
-                cur_term = cur_term->next;
-        }
+        g_atomic_int_inc (&a_this->ref_count);
+}
 
-        if (!cur_term)
-                return CR_OK;
+struct _CRStyleFontFamily
+{
+        gint ref_count;
+        CRFontFamily *font_family;
+};
 
-        for (direction = 0; direction < NB_DIRS; direction++) {
-                set_prop_margin_x_from_value (a_style, cur_term, direction);
-        }
-        cur_term = cur_term->next;
+/**
+ *Makes a font group hold a font family list of its own.
+ *@param a_font the font group.
+ *@param a_font_family the font family list. It is
+ *destroyed with the last group that holds it.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+hold_font_family (CRStyleFont * a_font, CRFontFamily * a_font_family)
+{
+        CRStyleFontFamily *holder = NULL;
 
-        while (cur_term && cur_term->type != TERM_NUMBER) {
-                cur_term = cur_term->next;
+        holder = cr_allocator_alloc (sizeof (CRStyleFontFamily));
+        if (!holder) {
+                cr_utils_trace_info ("Out of memory");
+                cr_font_family_destroy (a_font_family);
+                return CR_OUT_OF_MEMORY_ERROR;
         }
-        if (!cur_term)
-                return CR_OK;
-
-        set_prop_margin_x_from_value (a_style, cur_term, DIR_RIGHT);
-        set_prop_margin_x_from_value (a_style, cur_term, DIR_LEFT);
+        holder->ref_count = 1;
+        holder->font_family = a_font_family;
+        a_font->font_family_holder = holder;
+        a_font->font_family = a_font_family;
+        return CR_OK;
+}
 
-        while (cur_term && cur_term->type != TERM_NUMBER) {
-                cur_term = cur_term->next;
-        }
-        if (!cur_term)
-                return CR_OK;
+/**
+ *Makes a font group use the font family of another one.
+ */
+static void
+share_font_family (CRStyleFont * a_font, CRStyleFont const * a_src)
+{
+        a_font->font_family = a_src->font_family;
+        a_font->font_family_holder = a_src->font_family_holder;
+        if (a_font->font_family_holder)
+                g_atomic_int_inc (&a_font->font_family_holder->ref_count);
+}
 
-        set_prop_margin_x_from_value (a_style, cur_term, DIR_BOTTOM);
+static void
+release_font_family (CRStyleFont * a_font)
+{
+        CRStyleFontFamily *holder = a_font->font_family_holder;
 
-        while (cur_term && cur_term->type != TERM_NUMBER) {
-                cur_term = cur_term->next;
+        if (holder && g_atomic_int_dec_and_test (&holder->ref_count)) {
+                cr_font_family_destroy (holder->font_family);
+                cr_allocator_free (holder);
         }
-        if (!cur_term)
-                return CR_OK;
-
-        status = set_prop_margin_x_from_value (a_style, cur_term, DIR_LEFT);        
-
-        return status;
+        a_font->font_family = NULL;
+        a_font->font_family_holder = NULL;
 }
 
-static enum CRStatus
-set_prop_font_family_from_value (CRStyle * a_style, CRTerm * a_value)
+static void
+drop_default_child (enum CRStyleGroupKind a_kind, CRStyleGroup * a_this)
 {
-        CRTerm *cur_term = NULL;
-        CRFontFamily *font_family = NULL,
-                *cur_ff = NULL,
-                *cur_ff2 = NULL;
-
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
-
-	if (a_value->type == TERM_IDENT &&
-	    a_value->content.str &&
-	    a_value->content.str->stryng &&
-	    a_value->content.str->stryng->str &&
-	    !strcmp ("inherit", a_value->content.str->stryng->str))
-	{
-		font_family = cr_font_family_new (FONT_FAMILY_INHERIT, NULL);
-		goto out;
-	}
+        CRStyleGroup *default_child = a_this->default_child;
 
-        for (cur_term = a_value; cur_term; cur_term = cur_term->next) {
-                switch (cur_term->type) {
-                case TERM_IDENT:
-                        {
-                                enum CRFontFamilyType font_type;
-
-                                if (cur_term->content.str
-                                    && cur_term->content.str->stryng
-                                    && cur_term->content.str->stryng->str
-                                    && !strcmp 
-                                    (cur_term->content.str->stryng->str,
-                                     "sans-serif")) {
-                                        font_type = FONT_FAMILY_SANS_SERIF;
-                                } else if (cur_term->content.str
-                                           && cur_term->content.str->stryng
-                                           && cur_term->content.str->stryng->str
-                                           && !strcmp 
-                                           (cur_term->content.str->stryng->str, 
-                                            "serif")) {
-                                        font_type = FONT_FAMILY_SERIF;
-                                } else if (cur_term->content.str
-                                           && cur_term->content.str->stryng
-                                           && cur_term->content.str->stryng->str
-                                           && !strcmp (cur_term->content.str->stryng->str, 
-                                                       "cursive")) {
-                                        font_type = FONT_FAMILY_CURSIVE;
-                                } else if (cur_term->content.str
-                                           && cur_term->content.str->stryng
-                                           && cur_term->content.str->stryng->str
-                                           && !strcmp (cur_term->content.str->stryng->str,
-                                                       "fantasy")) {
-                                        font_type = FONT_FAMILY_FANTASY;
-                                } else if (cur_term->content.str
-                                           && cur_term->content.str->stryng
-                                           && cur_term->content.str->stryng->str
-                                           && !strcmp (cur_term->content.str->stryng->str, 
-                                                       "monospace")) {
-                                        font_type = FONT_FAMILY_MONOSPACE;
-                                } else {
-                                        /*
-                                         *unknown property value.
-                                         *ignore it.
-                                         */
-                                        continue;
-                                }
-
-                                cur_ff = cr_font_family_new (font_type, NULL);
-                        }
-                        break;
+        a_this->default_child = NULL;
+        /*a group can be its own default child, without a reference*/
+        if (default_child && default_child != a_this)
+                group_unref (a_kind, default_child);
+}
 
-                case TERM_STRING:
-                        {
-                                if (cur_term->content.str
-                                    && cur_term->content.str->stryng
-                                    && cur_term->content.str->stryng->str) {
-                                        cur_ff = cr_font_family_new
-                                                (FONT_FAMILY_NON_GENERIC,
-                                                 (guchar *) cur_term->content.str->stryng->str);
-                                }
-                        }
-                        break;
+static void
+group_unref (enum CRStyleGroupKind a_kind, CRStyleGroup * a_this)
+{
+        if (!g_atomic_int_dec_and_test (&a_this->ref_count))
+                return;
+        drop_default_child (a_kind, a_this);
+        if (a_kind == STYLE_GROUP_FONT)
+                release_font_family ((CRStyleFont *) a_this);
+        cr_allocator_free (a_this);
+}
 
-                default:
-                        break;
-                }
+/**
+ *Duplicates a property group.
+ *The font family list of a font group is shared, not copied.
+ *@param a_kind the kind of the group.
+ *@param a_this the group to duplicate.
+ *@return the new group, with a reference count of 1.
+ */
+static CRStyleGroup *
+group_dup (enum CRStyleGroupKind a_kind, CRStyleGroup * a_this)
+{
+        CRStyleGroup *result = NULL;
 
-                cur_ff2 = cr_font_family_append (font_family, cur_ff);
-                if (cur_ff2) {
-                        font_family = cur_ff2;
-                }
+        result = cr_allocator_alloc (gv_group_sizes[a_kind]);
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
         }
-
- out:
-        if (font_family) {
-                if (a_style->font_family) {
-                        cr_font_family_destroy (a_style->font_family);
-                        a_style->font_family = NULL ;
-                }
-                a_style->font_family = font_family;
-                font_family = NULL ;
+        memcpy (result, a_this, gv_group_sizes[a_kind]);
+        result->ref_count = 1;
+        cr_stats_count_alloc (CR_STATS_STYLE_GROUP);
+        result->default_child = NULL;
+        if (a_kind == STYLE_GROUP_FONT) {
+                share_font_family ((CRStyleFont *) result,
+                                   (CRStyleFont *) a_this);
         }
-
-        return CR_OK;
+        return result;
 }
 
-static enum CRStatus
-init_style_font_size_field (CRStyle * a_style)
+/**
+ *Tells whether two groups of the same kind hold the same values.
+ */
+static gboolean
+group_equal (enum CRStyleGroupKind a_kind,
+             CRStyleGroup const * a_this, CRStyleGroup const * a_other)
 {
-        g_return_val_if_fail (a_style, CR_BAD_PARAM_ERROR);
+        if (a_this == a_other)
+                return TRUE;
+        return memcmp ((guchar const *) a_this + sizeof (CRStyleGroup),
+                       (guchar const *) a_other + sizeof (CRStyleGroup),
+                       gv_group_sizes[a_kind] - sizeof (CRStyleGroup))
+                == 0;
+}
 
-        memset (&a_style->font_size, 0, 
-               sizeof (CRFontSizeVal)) ;
-        /*
-        if (!a_style->font_size) {
-                a_style->font_size = cr_font_size_new ();
-                if (!a_style->font_size) {
-                        return CR_INSTANCIATION_FAILED_ERROR;
-                }
-        } else {
-                cr_font_size_clear (a_style->font_size);
+static CRStyleGroup *
+get_group (CRStyle const * a_style, enum CRStyleGroupKind a_kind)
+{
+        switch (a_kind) {
+        case STYLE_GROUP_BOX:
+                return (CRStyleGroup *) a_style->box;
+        case STYLE_GROUP_BORDER:
+                return (CRStyleGroup *) a_style->border;
+        case STYLE_GROUP_COLOR:
+                return (CRStyleGroup *) a_style->color;
+        case STYLE_GROUP_FONT:
+                return (CRStyleGroup *) a_style->font;
+        case STYLE_GROUP_TEXT:
+                return (CRStyleGroup *) a_style->text;
+        default:
+                return NULL;
         }
-        */
-        return CR_OK;
 }
 
-static enum CRStatus
-set_prop_font_size_from_value (CRStyle * a_style, CRTerm * a_value)
+static void
+set_group (CRStyle * a_style, enum CRStyleGroupKind a_kind,
+           CRStyleGroup * a_group)
 {
-        enum CRStatus status = CR_OK;
-
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
-
-        switch (a_value->type) {
-        case TERM_IDENT:
-                if (a_value->content.str
-                    && a_value->content.str->stryng
-                    && a_value->content.str->stryng->str
-                    && !strcmp (a_value->content.str->stryng->str,
-                                "xx-small")) {
-                        status = init_style_font_size_field (a_style);
-                        g_return_val_if_fail (status == CR_OK, status);
-
-                        a_style->font_size.sv.type =
-                                PREDEFINED_ABSOLUTE_FONT_SIZE;
-                        a_style->font_size.sv.value.predefined =
-                                FONT_SIZE_XX_SMALL;
-
-                } else if (a_value->content.str
-                           && a_value->content.str->stryng
-                           && a_value->content.str->stryng->str
-                           && !strcmp (a_value->content.str->stryng->str, 
-                                       "x-small")) {
-                        status = init_style_font_size_field (a_style);
-                        g_return_val_if_fail (status == CR_OK, status);
-
-                        a_style->font_size.sv.type =
-                                PREDEFINED_ABSOLUTE_FONT_SIZE;
-                        a_style->font_size.sv.value.predefined =
-                                FONT_SIZE_X_SMALL;
-                } else if (a_value->content.str
-                           && a_value->content.str->stryng
-                           && a_value->content.str->stryng->str
-                           && !strcmp (a_value->content.str->stryng->str, 
-                                       "small")) {
-                        status = init_style_font_size_field (a_style);
-                        g_return_val_if_fail (status == CR_OK, status);
-
-                        a_style->font_size.sv.type =
-                                PREDEFINED_ABSOLUTE_FONT_SIZE;
-                        a_style->font_size.sv.value.predefined =
-                                FONT_SIZE_SMALL;
-                } else if (a_value->content.str
-                           && a_value->content.str->stryng
-                           && a_value->content.str->stryng->str
-                           && !strcmp (a_value->content.str->stryng->str, "medium")) {
-                        status = init_style_font_size_field (a_style);
-                        g_return_val_if_fail (status == CR_OK, status);
-
-                        a_style->font_size.sv.type =
-                                PREDEFINED_ABSOLUTE_FONT_SIZE;
-                        a_style->font_size.sv.value.predefined =
-                                FONT_SIZE_MEDIUM;
-                } else if (a_value->content.str
-                           && a_value->content.str->stryng
-                           && a_value->content.str->stryng->str
-                           && !strcmp (a_value->content.str->stryng->str, 
-                                       "large")) {
-                        status = init_style_font_size_field (a_style);
-                        g_return_val_if_fail (status == CR_OK, status);
-
-                        a_style->font_size.sv.type =
-                                PREDEFINED_ABSOLUTE_FONT_SIZE;
-                        a_style->font_size.sv.value.predefined =
-                                FONT_SIZE_LARGE;
-                } else if (a_value->content.str
-                           && a_value->content.str->stryng
-                           && a_value->content.str->stryng->str
-                           && !strcmp (a_value->content.str->stryng->str, 
-                                       "x-large")) {
-                        status = init_style_font_size_field (a_style);
-                        g_return_val_if_fail (status == CR_OK, status);
-
-                        a_style->font_size.sv.type =
-                                PREDEFINED_ABSOLUTE_FONT_SIZE;
-                        a_style->font_size.sv.value.predefined =
-                                FONT_SIZE_X_LARGE;
-                } else if (a_value->content.str
-                           && a_value->content.str->stryng
-                           && a_value->content.str->stryng->str
-                           && !strcmp (a_value->content.str->stryng->str, 
-                                       "xx-large")) {
-                        status = init_style_font_size_field (a_style);
-                        g_return_val_if_fail (status == CR_OK, status);
-
-                        a_style->font_size.sv.type =
-                                PREDEFINED_ABSOLUTE_FONT_SIZE;
-                        a_style->font_size.sv.value.predefined =
-                                FONT_SIZE_XX_LARGE;
-                } else if (a_value->content.str
-                           && a_value->content.str->stryng
-                           && a_value->content.str->stryng->str
-                           && !strcmp (a_value->content.str->stryng->str, 
-                                       "larger")) {
-                        status = init_style_font_size_field (a_style);
-                        g_return_val_if_fail (status == CR_OK, status);
-
-                        a_style->font_size.sv.type = RELATIVE_FONT_SIZE;
-                        a_style->font_size.sv.value.relative = FONT_SIZE_LARGER;
-                } else if (a_value->content.str
-                           && a_value->content.str->stryng
-                           && a_value->content.str->stryng->str
-                           && !strcmp (a_value->content.str->stryng->str, 
-                                       "smaller")) {
-                        status = init_style_font_size_field (a_style);
-                        g_return_val_if_fail (status == CR_OK, status);
-
-                        a_style->font_size.sv.type = RELATIVE_FONT_SIZE;
-                        a_style->font_size.sv.value.relative =
-                                FONT_SIZE_SMALLER;
-                } else if (a_value->content.str
-                           && a_value->content.str->stryng
-                           && a_value->content.str->stryng->str
-                           && !strcmp (a_value->content.str->stryng->str, "inherit")) {
-                        status = init_style_font_size_field (a_style);
-                        g_return_val_if_fail (status == CR_OK, status);
-			a_style->font_size.sv.type = INHERITED_FONT_SIZE;
-
-                } else {
-                        cr_utils_trace_info ("Unknown value of font-size") ;
-                        status = init_style_font_size_field (a_style);
-                        return CR_UNKNOWN_PROP_VAL_ERROR;
-                }
+        switch (a_kind) {
+        case STYLE_GROUP_BOX:
+                a_style->box = (CRStyleBox *) a_group;
                 break;
-
-        case TERM_NUMBER:
-                if (a_value->content.num) {
-                        status = init_style_font_size_field (a_style);
-                        g_return_val_if_fail (status == CR_OK, status);
-
-                        a_style->font_size.sv.type = ABSOLUTE_FONT_SIZE;
-                        cr_num_copy (&a_style->font_size.sv.value.absolute,
-                                     a_value->content.num) ;
-                }
+        case STYLE_GROUP_BORDER:
+                a_style->border = (CRStyleBorder *) a_group;
+                break;
+        case STYLE_GROUP_COLOR:
+                a_style->color = (CRStyleColor *) a_group;
+                break;
+        case STYLE_GROUP_FONT:
+                a_style->font = (CRStyleFont *) a_group;
+                break;
+        case STYLE_GROUP_TEXT:
+                a_style->text = (CRStyleText *) a_group;
                 break;
-
         default:
-                status = init_style_font_size_field (a_style);
-                return CR_UNKNOWN_PROP_VAL_ERROR;
+                break;
         }
-        return CR_OK;
 }
 
-static enum CRStatus
-set_prop_font_style_from_value (CRStyle * a_style, CRTerm * a_value)
+/**
+ *Makes a style refer to a group, dropping the
+ *reference it held on its previous group of that kind.
+ *@param a_style the style.
+ *@param a_kind the kind of the group.
+ *@param a_group the group. The caller's reference is
+ *handed over to a_style.
+ */
+static void
+replace_group (CRStyle * a_style, enum CRStyleGroupKind a_kind,
+               CRStyleGroup * a_group)
 {
-        enum CRStatus status = CR_OK;
+        CRStyleGroup *old_group = get_group (a_style, a_kind);
 
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+        set_group (a_style, a_kind, a_group);
+        if (old_group)
+                group_unref (a_kind, old_group);
+}
 
-        switch (a_value->type) {
-        case TERM_IDENT:
-                if (a_value->content.str 
-                    && a_value->content.str->stryng
-                    && a_value->content.str->stryng->str) {
-                        if (!strcmp (a_value->content.str->stryng->str, "normal")) {
-                                a_style->font_style = FONT_STYLE_NORMAL;
-                        } else if (!strcmp
-                                   (a_value->content.str->stryng->str,
-				    "italic")) {
-                                a_style->font_style = FONT_STYLE_ITALIC;
-                        } else if (!strcmp
-                                   (a_value->content.str->stryng->str,
-				    "oblique")) {
-                                a_style->font_style = FONT_STYLE_OBLIQUE;
-                        } else if (!strcmp
-                                   (a_value->content.str->stryng->str,
-				    "inherit")) {
-				a_style->font_style = FONT_STYLE_INHERIT;
-                        } else {
-                                status = CR_UNKNOWN_PROP_VAL_ERROR;
-                        }
-                }
-                break;
+/**
+ *Returns a group of a style that the style is the only
+ *one to use, copying the group first if it is shared.
+ *@param a_style the style.
+ *@param a_kind the kind of group.
+ *@return the group, or NULL if the copy failed.
+ */
+static CRStyleGroup *
+get_group_for_writing (CRStyle * a_style, enum CRStyleGroupKind a_kind)
+{
+        CRStyleGroup *group = get_group (a_style, a_kind),
+                *result = NULL;
 
-        default:
-                status = CR_UNKNOWN_PROP_VAL_ERROR;
-                break;
-        }
+        g_return_val_if_fail (group, NULL);
 
-        return status;
+        if (g_atomic_int_get (&group->ref_count) == 1) {
+                /*what the children resolved to is about to change*/
+                drop_default_child (a_kind, group);
+                return group;
+        }
+        result = group_dup (a_kind, group);
+        if (!result)
+                return NULL;
+        replace_group (a_style, a_kind, result);
+        return result;
 }
 
-static enum CRStatus
-set_prop_font_weight_from_value (CRStyle * a_style, CRTerm * a_value)
+static CRNum *
+get_num_prop_sv (CRStyleBox * a_box, enum CRPropertyID a_prop_id)
 {
-        enum CRStatus status = CR_OK;
-
-        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+        switch (a_prop_id) {
+        case PROP_ID_PADDING_TOP:
+                return &a_box->num_props[NUM_PROP_PADDING_TOP].sv;
+        case PROP_ID_PADDING_RIGHT:
+                return &a_box->num_props[NUM_PROP_PADDING_RIGHT].sv;
+        case PROP_ID_PADDING_BOTTOM:
+                return &a_box->num_props[NUM_PROP_PADDING_BOTTOM].sv;
+        case PROP_ID_PADDING_LEFT:
+                return &a_box->num_props[NUM_PROP_PADDING_LEFT].sv;
+        case PROP_ID_BORDER_TOP_WIDTH:
+                return &a_box->num_props[NUM_PROP_BORDER_TOP].sv;
+        case PROP_ID_BORDER_RIGHT_WIDTH:
+                return &a_box->num_props[NUM_PROP_BORDER_RIGHT].sv;
+        case PROP_ID_BORDER_BOTTOM_WIDTH:
+                return &a_box->num_props[NUM_PROP_BORDER_BOTTOM].sv;
+        case PROP_ID_BORDER_LEFT_WIDTH:
+                return &a_box->num_props[NUM_PROP_BORDER_LEFT].sv;
+        case PROP_ID_MARGIN_TOP:
+                return &a_box->num_props[NUM_PROP_MARGIN_TOP].sv;
+        case PROP_ID_MARGIN_RIGHT:
+                return &a_box->num_props[NUM_PROP_MARGIN_RIGHT].sv;
+        case PROP_ID_MARGIN_BOTTOM:
+                return &a_box->num_props[NUM_PROP_MARGIN_BOTTOM].sv;
+        case PROP_ID_MARGIN_LEFT:
+                return &a_box->num_props[NUM_PROP_MARGIN_LEFT].sv;
+        case PROP_ID_TOP:
+                return &a_box->num_props[NUM_PROP_TOP].sv;
+        case PROP_ID_RIGHT:
+                return &a_box->num_props[NUM_PROP_RIGHT].sv;
+        case PROP_ID_BOTTOM:
+                return &a_box->num_props[NUM_PROP_BOTTOM].sv;
+        case PROP_ID_LEFT:
+                return &a_box->num_props[NUM_PROP_LEFT].sv;
+        case PROP_ID_WIDTH:
+                return &a_box->num_props[NUM_PROP_WIDTH].sv;
+        default:
+                return NULL;
+        }
+}
 
-        switch (a_value->type) {
-        case TERM_IDENT:
-                if (a_value->content.str 
-                    && a_value->content.str->stryng
-                    && a_value->content.str->stryng->str) {
-                        if (!strcmp (a_value->content.str->stryng->str, 
-                                     "normal")) {
-                                a_style->font_weight = FONT_WEIGHT_NORMAL;
-                        } else if (!strcmp (a_value->content.str->stryng->str,
-                                            "bold")) {
-                                a_style->font_weight = FONT_WEIGHT_BOLD;
-                        } else if (!strcmp (a_value->content.str->stryng->str,
-                                            "bolder")) {
-                                a_style->font_weight = FONT_WEIGHT_BOLDER;
-                        } else if (!strcmp (a_value->content.str->stryng->str,
-                                            "lighter")) {
-                                a_style->font_weight = FONT_WEIGHT_LIGHTER;
-			} else if (!strcmp (a_value->content.str->stryng->str,
-                                            "inherit")) {
-                                a_style->font_weight = FONT_WEIGHT_INHERIT;
+static CRRgb *
+get_rgb_prop_sv (CRStyleColor * a_color, enum CRPropertyID a_prop_id)
+{
+        switch (a_prop_id) {
+        case PROP_ID_BORDER_TOP_COLOR:
+                return &a_color->rgb_props[RGB_PROP_BORDER_TOP_COLOR].sv;
+        case PROP_ID_BORDER_RIGHT_COLOR:
+                return &a_color->rgb_props[RGB_PROP_BORDER_RIGHT_COLOR].sv;
+        case PROP_ID_BORDER_BOTTOM_COLOR:
+                return &a_color->rgb_props[RGB_PROP_BORDER_BOTTOM_COLOR].sv;
+        case PROP_ID_BORDER_LEFT_COLOR:
+                return &a_color->rgb_props[RGB_PROP_BORDER_LEFT_COLOR].sv;
+        case PROP_ID_COLOR:
+                return &a_color->rgb_props[RGB_PROP_COLOR].sv;
+        case PROP_ID_BACKGROUND_COLOR:
+                return &a_color->rgb_props[RGB_PROP_BACKGROUND_COLOR].sv;
+        default:
+                return NULL;
+        }
+}
 
-                        } else {
-                                status = CR_UNKNOWN_PROP_VAL_ERROR;
-                        }
+static void
+apply_keyword (CRStyle * a_style, enum CRPropertyID a_prop_id,
+               gint a_keyword)
+{
+        CRStyleBox *box = NULL;
+        CRStyleBorder *border = NULL;
+        CRStyleFont *font = NULL;
+        CRStyleText *text = NULL;
+        enum CRBorderStyleProp border_style_prop = BORDER_STYLE_PROP_TOP;
 
-                }
+        switch (a_prop_id) {
+        case PROP_ID_BORDER_TOP_STYLE:
+        case PROP_ID_BORDER_RIGHT_STYLE:
+        case PROP_ID_BORDER_BOTTOM_STYLE:
+        case PROP_ID_BORDER_LEFT_STYLE:
+                if (a_prop_id == PROP_ID_BORDER_RIGHT_STYLE)
+                        border_style_prop = BORDER_STYLE_PROP_RIGHT;
+                else if (a_prop_id == PROP_ID_BORDER_BOTTOM_STYLE)
+                        border_style_prop = BORDER_STYLE_PROP_BOTTOM;
+                else if (a_prop_id == PROP_ID_BORDER_LEFT_STYLE)
+                        border_style_prop = BORDER_STYLE_PROP_LEFT;
+                border = cr_style_get_border_for_writing (a_style);
+                if (border)
+                        border->border_style_props[border_style_prop] =
+                                a_keyword;
+                break;
+        case PROP_ID_DISPLAY:
+        case PROP_ID_POSITION:
+        case PROP_ID_FLOAT:
+                box = cr_style_get_box_for_writing (a_style);
+                if (!box)
+                        break;
+                if (a_prop_id == PROP_ID_DISPLAY)
+                        box->display = a_keyword;
+                else if (a_prop_id == PROP_ID_POSITION)
+                        box->position = a_keyword;
+                else
+                        box->float_type = a_keyword;
+                break;
+        case PROP_ID_FONT_STYLE:
+        case PROP_ID_FONT_WEIGHT:
+                font = cr_style_get_font_for_writing (a_style);
+                if (!font)
+                        break;
+                if (a_prop_id == PROP_ID_FONT_STYLE)
+                        font->font_style = a_keyword;
+                else
+                        font->font_weight = a_keyword;
+                break;
+        case PROP_ID_WHITE_SPACE:
+                text = cr_style_get_text_for_writing (a_style);
+                if (text)
+                        text->white_space = a_keyword;
+                break;
+        default:
                 break;
+        }
+}
 
-        case TERM_NUMBER:
-                if (a_value->content.num
-                    && (a_value->content.num->type == NUM_GENERIC
-                        || a_value->content.num->type == NUM_AUTO)) {
-                        if (a_value->content.num->val <= 150) {
-                                a_style->font_weight = FONT_WEIGHT_100;
-                        } else if (a_value->content.num->val <= 250) {
-                                a_style->font_weight = FONT_WEIGHT_200;
-                        } else if (a_value->content.num->val <= 350) {
-                                a_style->font_weight = FONT_WEIGHT_300;
-                        } else if (a_value->content.num->val <= 450) {
-                                a_style->font_weight = FONT_WEIGHT_400;
-                        } else if (a_value->content.num->val <= 550) {
-                                a_style->font_weight = FONT_WEIGHT_500;
-                        } else if (a_value->content.num->val <= 650) {
-                                a_style->font_weight = FONT_WEIGHT_600;
-                        } else if (a_value->content.num->val <= 750) {
-                                a_style->font_weight = FONT_WEIGHT_700;
-                        } else if (a_value->content.num->val <= 850) {
-                                a_style->font_weight = FONT_WEIGHT_800;
-                        } else {
-                                a_style->font_weight = FONT_WEIGHT_900;
-                        }
+/**
+ *Stores a value decoded by decode_value() into the
+ *field of a #CRStyle that corresponds to a property.
+ *The group that holds the field is unshared first.
+ *@param a_style the style to set.
+ *@param a_prop_id the id of the property.
+ *@param a_value the decoded value of the property.
+ */
+static void
+apply_decl_value (CRStyle * a_style, enum CRPropertyID a_prop_id,
+                  CRDeclValue const * a_value)
+{
+        CRStyleBox *box = NULL;
+        CRStyleColor *color = NULL;
+        CRStyleFont *font = NULL;
+        CRFontFamily *font_family = NULL;
+        CRNum *num = NULL;
+        CRRgb *rgb = NULL;
+
+        switch (a_value->type) {
+        case DECL_VALUE_NUM:
+        case DECL_VALUE_NUM_TYPE:
+                box = cr_style_get_box_for_writing (a_style);
+                if (box)
+                        num = get_num_prop_sv (box, a_prop_id);
+                if (!num)
+                        break;
+                if (a_value->type == DECL_VALUE_NUM)
+                        cr_num_copy (num, &a_value->content.num);
+                else
+                        num->type = a_value->content.num.type;
+                break;
+
+        case DECL_VALUE_RGB:
+        case DECL_VALUE_RGB_INHERIT:
+                color = cr_style_get_color_for_writing (a_style);
+                if (color)
+                        rgb = get_rgb_prop_sv (color, a_prop_id);
+                if (!rgb)
+                        break;
+                if (a_value->type == DECL_VALUE_RGB) {
+                        cr_rgb_copy (rgb, &a_value->content.rgb);
+                } else {
+                        rgb->inherit = TRUE;
+                        rgb->is_transparent = FALSE;
                 }
                 break;
 
-        default:
-                status = CR_UNKNOWN_PROP_VAL_ERROR;
-                break;
-        }
+        case DECL_VALUE_KEYWORD:
+                apply_keyword (a_style, a_prop_id, a_value->content.keyword);
+                break;
+
+        case DECL_VALUE_FONT_SIZE:
+                font = cr_style_get_font_for_writing (a_style);
+                if (!font)
+                        break;
+                memset (&font->font_size, 0, sizeof (CRFontSizeVal));
+                memcpy (&font->font_size.sv, &a_value->content.font_size,
+                        sizeof (CRFontSize));
+                break;
+
+        case DECL_VALUE_FONT_FAMILY:
+                font = cr_style_get_font_for_writing (a_style);
+                if (!font)
+                        break;
+                release_font_family (font);
+                font_family = font_family_dup (a_value->content.font_family);
+                if (font_family)
+                        hold_font_family (font, font_family);
+                break;
+
+        default:
+                break;
+        }
+}
+
+/**
+ *Returns the decoded form of a property value, decoding
+ *it into *a_cache the first time it is asked for.
+ *Several threads can style documents against the same
+ *declarations: the value published first into *a_cache is
+ *kept, the ones decoded meanwhile by other threads are dropped.
+ *If the system is out of memory, the value is decoded into
+ *a_scratch, which must then be released by clear_decl_value().
+ *The cached value lives as long as the declaration, whatever the
+ *allocator of the caller, so it is built with the glib allocator.
+ *@param a_prop_id the id of the property.
+ *@param a_value the value of the property.
+ *@param a_cache the cache of the decoded value.
+ *@param a_scratch the decoded value to use if *a_cache can't
+ *be allocated.
+ */
+static CRDeclValue const *
+get_decl_value (enum CRPropertyID a_prop_id, CRTerm * a_value,
+                CRDeclValue ** a_cache, CRDeclValue * a_scratch)
+{
+        CRAllocator const *prev_allocator = NULL;
+        CRDeclValue *decoded = NULL;
+
+        decoded = g_atomic_pointer_get (a_cache);
+        if (decoded)
+                return decoded;
+
+        decoded = g_try_malloc (sizeof (CRDeclValue));
+        if (!decoded) {
+                cr_utils_trace_info ("Out of memory");
+                decode_value (a_prop_id, a_value, a_scratch);
+                return a_scratch;
+        }
+        prev_allocator = cr_allocator_push (&gv_cr_glib_allocator);
+        decode_value (a_prop_id, a_value, decoded);
+        if (!g_atomic_pointer_compare_and_exchange (a_cache, NULL,
+                                                    decoded)) {
+                clear_decl_value (decoded);
+                g_free (decoded);
+                decoded = g_atomic_pointer_get (a_cache);
+        }
+        cr_allocator_pop (prev_allocator);
+        return decoded;
+}
+
+static enum CRStatus
+set_prop_border_width_from_value (CRStyle *a_style,
+                                  CRTerm *a_value)
+{
+        CRTerm *cur_term = NULL ;
+        enum CRDirection direction = DIR_TOP ;
+
+        g_return_val_if_fail (a_style && a_value,
+                              CR_BAD_PARAM_ERROR) ;
+        cur_term = a_value ;
+
+        if (!cur_term)
+                return CR_ERROR ;
+
+        for (direction = DIR_TOP ; 
+             direction < NB_DIRS ; direction ++) {
+                set_prop_from_value (a_style, gv_border_width_ids[direction],
+                                     cur_term) ;
+        }
+
+        cur_term = cur_term->next ;
+        if (!cur_term)
+                return CR_OK ;
+        set_prop_from_value (a_style, gv_border_width_ids[DIR_RIGHT],
+                             cur_term) ;
+        set_prop_from_value (a_style, gv_border_width_ids[DIR_LEFT],
+                             cur_term) ;
+
+        cur_term = cur_term->next ;
+        if (!cur_term)
+                return CR_OK ;
+        set_prop_from_value (a_style, gv_border_width_ids[DIR_BOTTOM],
+                             cur_term) ;
+
+        cur_term = cur_term->next ;
+        if (!cur_term)
+                return CR_OK ;
+        set_prop_from_value (a_style, gv_border_width_ids[DIR_LEFT],
+                             cur_term) ;
+
+        return CR_OK ;
+}
+
+static enum CRStatus
+set_prop_border_style_from_value (CRStyle *a_style,
+                                  CRTerm *a_value)
+{
+        CRTerm *cur_term = NULL ;
+        enum CRDirection direction = DIR_TOP ;
+
+        g_return_val_if_fail (a_style && a_value, 
+                              CR_BAD_PARAM_ERROR) ;
+
+        cur_term = a_value ;
+        if (!cur_term || cur_term->type != TERM_IDENT) {
+                return CR_ERROR ;
+        }
+        
+        for (direction = DIR_TOP ; 
+             direction < NB_DIRS ;
+             direction ++) {
+                set_prop_from_value (a_style, gv_border_style_ids[direction],
+                                     cur_term) ;
+        }
+        
+        cur_term = cur_term->next ;
+        if (!cur_term || cur_term->type != TERM_IDENT) {
+                return CR_OK ;
+        }
+        
+        set_prop_from_value (a_style, gv_border_style_ids[DIR_RIGHT],
+                             cur_term) ;
+        set_prop_from_value (a_style, gv_border_style_ids[DIR_LEFT],
+                             cur_term) ;
+
+        cur_term = cur_term->next ;
+        if (!cur_term || cur_term->type != TERM_IDENT) {
+                return CR_OK ;
+        }        
+        set_prop_from_value (a_style, gv_border_style_ids[DIR_BOTTOM],
+                             cur_term) ;
+        
+        cur_term = cur_term->next ;
+        if (!cur_term || cur_term->type != TERM_IDENT) {
+                return CR_OK ;
+        }
+        set_prop_from_value (a_style, gv_border_style_ids[DIR_LEFT],
+                             cur_term) ;
+        return CR_OK ;
+}
+
+static enum CRStatus
+set_prop_border_x_from_value (CRStyle * a_style, CRTerm * a_value,
+                              enum CRDirection a_dir)
+{
+        CRTerm *cur_term = NULL;
+
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+
+        for (cur_term = a_value; 
+             cur_term; 
+             cur_term = cur_term->next) {
+                status = set_prop_from_value
+                        (a_style, gv_border_width_ids[a_dir], cur_term);
+
+                if (status != CR_OK) {
+                        status = set_prop_from_value
+                                (a_style, gv_border_style_ids[a_dir],
+                                 cur_term);
+                }
+                if (status != CR_OK) {
+                        status = set_prop_from_value
+                                (a_style, gv_border_color_ids[a_dir],
+                                 cur_term);
+                }
+        }
+        return CR_OK;
+}
+
+static enum CRStatus
+set_prop_border_from_value (CRStyle * a_style, CRTerm * a_value)
+{
+        enum CRDirection direction = 0;
+
+        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+
+        for (direction = 0; direction < NB_DIRS; direction++) {
+                set_prop_border_x_from_value (a_style, 
+                                              a_value, 
+                                              direction);
+        }
+
+        return CR_OK;
+}
+
+static enum CRStatus
+set_prop_padding_from_value (CRStyle * a_style, CRTerm * a_value)
+{
+        CRTerm *cur_term = NULL;
+        enum CRDirection direction = 0;
+        enum CRStatus status = CR_OK;
+        
+        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+
+        cur_term = a_value;
+
+        /*filter the eventual non NUMBER terms some user can have written here*/
+        while (cur_term && cur_term->type != TERM_NUMBER) {
+                cur_term = cur_term->next;
+        }
+        if (!cur_term)
+                return CR_ERROR ;
+
+        for (direction = 0; direction < NB_DIRS; direction++) {
+                set_prop_from_value (a_style, gv_padding_ids[direction],
+                                     cur_term);
+        }
+        cur_term = cur_term->next;
+
+        /*filter non NUMBER terms that some users can have written here...*/
+        while (cur_term && cur_term->type != TERM_NUMBER) {
+                cur_term = cur_term->next;
+        }
+        /*the user can have just written padding: 1px*/
+        if (!cur_term)
+                return CR_OK;
+
+        set_prop_from_value (a_style, gv_padding_ids[DIR_RIGHT], cur_term);
+        set_prop_from_value (a_style, gv_padding_ids[DIR_LEFT], cur_term);
+
+        while (cur_term && cur_term->type != TERM_NUMBER) {
+                cur_term = cur_term->next;
+        }
+        if (!cur_term)
+                return CR_OK;
+
+        set_prop_from_value (a_style, gv_padding_ids[DIR_BOTTOM], cur_term);
+
+        while (cur_term && cur_term->type != TERM_NUMBER) {
+                cur_term = cur_term->next;
+        }
+        if (!cur_term)
+                return CR_OK;
+        status = set_prop_from_value (a_style, gv_padding_ids[DIR_LEFT],
+                                      cur_term);
+        return status;
+}
+
+static enum CRStatus
+set_prop_margin_from_value (CRStyle * a_style, CRTerm * a_value)
+{
+        CRTerm *cur_term = NULL;
+        enum CRDirection direction = 0;
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
+
+        cur_term = a_value;
+
+        while (cur_term && cur_term->type != TERM_NUMBER) {
+                cur_term = cur_term->next;
+        }
+
+        if (!cur_term)
+                return CR_OK;
+
+        for (direction = 0; direction < NB_DIRS; direction++) {
+                set_prop_from_value (a_style, gv_margin_ids[direction],
+                                     cur_term);
+        }
+        cur_term = cur_term->next;
+
+        while (cur_term && cur_term->type != TERM_NUMBER) {
+                cur_term = cur_term->next;
+        }
+        if (!cur_term)
+                return CR_OK;
+
+        set_prop_from_value (a_style, gv_margin_ids[DIR_RIGHT], cur_term);
+        set_prop_from_value (a_style, gv_margin_ids[DIR_LEFT], cur_term);
+
+        while (cur_term && cur_term->type != TERM_NUMBER) {
+                cur_term = cur_term->next;
+        }
+        if (!cur_term)
+                return CR_OK;
+
+        set_prop_from_value (a_style, gv_margin_ids[DIR_BOTTOM], cur_term);
+
+        while (cur_term && cur_term->type != TERM_NUMBER) {
+                cur_term = cur_term->next;
+        }
+        if (!cur_term)
+                return CR_OK;
+
+        status = set_prop_from_value (a_style, gv_margin_ids[DIR_LEFT],
+                                      cur_term);
+
+        return status;
+}
+
+/**
+ *Sets the properties held by the (writable) groups of a style to
+ *their default values according to the css2 spec
+ *i.e inherit if the property is inherited, its initial value otherwise.
+ *@param a_style the style which groups to fill.
+ */
+static void
+fill_default_values (CRStyle * a_style)
+{
+	glong i = 0;
+        CRStyleBox *box = a_style->box;
+        CRStyleColor *color = a_style->color;
+        CRStyleFont *font = a_style->font;
+
+	for (i = 0; i < NB_NUM_PROPS; i++)
+	{
+		switch (i)
+		{
+		case NUM_PROP_WIDTH:
+		case NUM_PROP_TOP:
+		case NUM_PROP_RIGHT:
+		case NUM_PROP_BOTTOM:
+		case NUM_PROP_LEFT:
+			cr_num_set (&box->num_props[i].sv, 0, NUM_AUTO);
+			break;
+
+		case NUM_PROP_PADDING_TOP:
+		case NUM_PROP_PADDING_RIGHT:
+		case NUM_PROP_PADDING_BOTTOM:
+		case NUM_PROP_PADDING_LEFT:
+		case NUM_PROP_BORDER_TOP:
+		case NUM_PROP_BORDER_RIGHT:
+		case NUM_PROP_BORDER_BOTTOM:
+		case NUM_PROP_BORDER_LEFT:
+		case NUM_PROP_MARGIN_TOP:
+		case NUM_PROP_MARGIN_RIGHT:
+		case NUM_PROP_MARGIN_BOTTOM:
+		case NUM_PROP_MARGIN_LEFT:
+			cr_num_set (&box->num_props[i].sv,
+				    0, NUM_LENGTH_PX);
+			break;
+
+		default:
+			cr_utils_trace_info ("Unknown property");
+			break;
+		}
+	}
+
+	for (i = 0; i < NB_RGB_PROPS; i++) {
+                
+		switch (i) {
+			/*default foreground color is black */
+		case RGB_PROP_COLOR:
+			/*
+                         *REVIEW: color is inherited and the default value is
+			 *ua dependant.
+                         */
+			cr_rgb_set_to_inherit (&color->rgb_props[i].sv,
+                                               TRUE) ;
+			break;
+
+			/*default background color is white */
+		case RGB_PROP_BACKGROUND_COLOR:
+			/* TODO: the default value should be transparent */
+			cr_rgb_set (&color->rgb_props[i].sv,
+				    255, 255, 255, FALSE);
+                        cr_rgb_set_to_transparent (&color->rgb_props[i].sv,
+                                                   TRUE) ;
+			break;
+
+		default:
+			/* 
+                         *TODO: for BORDER_COLOR the initial value should
+			 * be the same as COLOR 
+                         */
+			cr_rgb_set (&color->rgb_props[i].sv, 0, 0, 0,
+				    FALSE);
+			break;
+		}
+	}
+
+	for (i = 0; i < NB_BORDER_STYLE_PROPS; i++) {
+		a_style->border->border_style_props[i] = BORDER_STYLE_NONE;
+	}
+
+	box->display = DISPLAY_INLINE;
+	box->position = POSITION_STATIC;
+	box->float_type = FLOAT_NONE;
+	font->font_style = FONT_STYLE_INHERIT;
+	font->font_variant = FONT_VARIANT_INHERIT;
+	font->font_weight = FONT_WEIGHT_INHERIT;
+	font->font_family = NULL;
+        
+        cr_font_size_set_to_inherit (&font->font_size.sv) ;
+        cr_font_size_clear (&font->font_size.cv) ;
+        cr_font_size_clear (&font->font_size.av) ;
+}
+
+/**
+ *Sets the properties held by the (writable) groups of a style
+ *to their initial value according to the css2 spec.
+ *@param a_style the style which groups to fill.
+ */
+static void
+fill_initial_values (CRStyle * a_style)
+{
+        glong i = 0;
+        CRStyleBox *box = a_style->box;
+        CRStyleColor *color = a_style->color;
+        CRStyleFont *font = a_style->font;
+
+        for (i = 0; i < NB_NUM_PROPS; i++) {
+                switch (i) {
+                case NUM_PROP_WIDTH:
+                        cr_num_set (&box->num_props[i].sv, 800,
+                                    NUM_LENGTH_PX) ;
+                        break ;
+                case NUM_PROP_TOP:
+                case NUM_PROP_RIGHT:
+                case NUM_PROP_BOTTOM:
+                case NUM_PROP_LEFT:
+                        cr_num_set (&box->num_props[i].sv, 0, NUM_AUTO);
+                        break;
+
+                case NUM_PROP_PADDING_TOP:
+                case NUM_PROP_PADDING_RIGHT:
+                case NUM_PROP_PADDING_BOTTOM:
+                case NUM_PROP_PADDING_LEFT:
+                case NUM_PROP_BORDER_TOP:
+                case NUM_PROP_BORDER_RIGHT:
+                case NUM_PROP_BORDER_BOTTOM:
+                case NUM_PROP_BORDER_LEFT:
+                case NUM_PROP_MARGIN_TOP:
+                case NUM_PROP_MARGIN_RIGHT:
+                case NUM_PROP_MARGIN_BOTTOM:
+                case NUM_PROP_MARGIN_LEFT:
+                        cr_num_set (&box->num_props[i].sv,
+                                    0, NUM_LENGTH_PX);
+                        break;
+
+                default:
+                        cr_utils_trace_info ("Unknown property");
+                        break;
+                }
+        }
+
+        for (i = 0; i < NB_RGB_PROPS; i++) {
+
+                switch (i) {
+                        /*default foreground color is black */
+                case RGB_PROP_COLOR:
+                        cr_rgb_set (&color->rgb_props[i].sv, 0, 0, 0, FALSE);
+                        break;
+
+                        /*default background color is white */
+                case RGB_PROP_BACKGROUND_COLOR:
+                        cr_rgb_set (&color->rgb_props[i].sv,
+                                    255, 255, 255, FALSE);
+                        cr_rgb_set_to_transparent (&color->rgb_props[i].sv,
+                                                   TRUE) ;                        
+                        break;
+                default:
+                        cr_rgb_set (&color->rgb_props[i].sv, 0, 0, 0, FALSE);
+                        break;
+                }
+        }
+
+        for (i = 0; i < NB_BORDER_STYLE_PROPS; i++) {
+                a_style->border->border_style_props[i] = BORDER_STYLE_NONE;
+        }
+
+        box->display = DISPLAY_BLOCK;
+        box->position = POSITION_STATIC;
+        box->float_type = FLOAT_NONE;
+        font->font_style = FONT_STYLE_NORMAL;
+        font->font_variant = FONT_VARIANT_NORMAL;
+        font->font_weight = FONT_WEIGHT_NORMAL;
+        font->font_stretch = FONT_STRETCH_NORMAL;
+	a_style->text->white_space = WHITE_SPACE_NORMAL;
+        cr_font_size_set_predefined_absolute_font_size
+                (&font->font_size.sv, FONT_SIZE_MEDIUM) ;
+}
+
+/**
+ *Builds a set of base groups.
+ *@param a_groups out parameter. The groups built.
+ *@param a_fill the function that sets the values of the groups.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+new_base_groups (CRStyleGroup ** a_groups, void (*a_fill) (CRStyle *))
+{
+        CRStyle style;
+        glong i = 0;
+
+        memset (&style, 0, sizeof (CRStyle));
+        for (i = 0; i < NB_STYLE_GROUPS; i++) {
+                a_groups[i] = group_new (i);
+                if (!a_groups[i]) {
+                        while (i--) {
+                                group_unref (i, a_groups[i]);
+                                a_groups[i] = NULL;
+                        }
+                        return CR_OUT_OF_MEMORY_ERROR;
+                }
+                set_group (&style, i, a_groups[i]);
+        }
+        a_fill (&style);
+        return CR_OK;
+}
+
+/**
+ *Builds the default and the initial groups
+ *the first time it is called.
+ *They are built by cr_style_new (), before
+ *any style can be shared between threads.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+init_base_groups (void)
+{
+        CRAllocator const *prev_allocator = NULL;
+        enum CRStatus status = CR_OK;
+
+        if (gv_default_groups[0] && gv_initial_groups[0])
+                return CR_OK;
+
+        /*they are never freed, so they must not come from an arena*/
+        prev_allocator = cr_allocator_push (&gv_cr_glib_allocator);
+        if (!gv_default_groups[0]) {
+                status = new_base_groups (gv_default_groups,
+                                          fill_default_values);
+        }
+        if (status == CR_OK && !gv_initial_groups[0]) {
+                status = new_base_groups (gv_initial_groups,
+                                          fill_initial_values);
+        }
+        cr_allocator_pop (prev_allocator);
+        return status;
+}
+
+/**
+ *Makes a style use a set of base groups.
+ *@param a_style the style.
+ *@param a_groups the base groups.
+ */
+static void
+set_base_groups (CRStyle * a_style, CRStyleGroup ** a_groups)
+{
+        glong i = 0;
+
+        for (i = 0; i < NB_STYLE_GROUPS; i++) {
+                group_ref (a_groups[i]);
+                replace_group (a_style, i, a_groups[i]);
+        }
+}
+
+/*
+ *The computed value of a property of a group which inherited
+ *properties are resolved: its specified value, or the value it
+ *inherited when it is specified as 'inherit'.
+ */
+static CRNum const *
+computed_num (CRStyleBox const * a_box, enum CRNumProp a_code)
+{
+        if (a_box->num_props[a_code].sv.type == NUM_INHERIT)
+                return &a_box->num_props[a_code].cv;
+        return &a_box->num_props[a_code].sv;
+}
+
+static CRRgb const *
+computed_rgb (CRStyleColor const * a_color, enum CRRgbProp a_code)
+{
+        if (cr_rgb_is_set_to_inherit (&a_color->rgb_props[a_code].sv)
+            == TRUE)
+                return &a_color->rgb_props[a_code].cv;
+        return &a_color->rgb_props[a_code].sv;
+}
+
+static CRFontSize const *
+computed_font_size (CRStyleFont const * a_font)
+{
+        if (a_font->font_size.sv.type == INHERITED_FONT_SIZE)
+                return &a_font->font_size.cv;
+        return &a_font->font_size.sv;
+}
+
+static gboolean
+box_needs_resolution (CRStyleBox const * a_box, CRStyleBox const * a_parent)
+{
+        glong i = 0;
+
+        for (i = 0; i < NB_NUM_PROPS; i++) {
+                if (a_box->num_props[i].sv.type == NUM_INHERIT
+                    && memcmp (&a_box->num_props[i].cv,
+                               computed_num (a_parent, i),
+                               sizeof (CRNum)))
+                        return TRUE;
+        }
+        return a_box->display == DISPLAY_INHERIT
+                || a_box->position == POSITION_INHERIT
+                || a_box->float_type == FLOAT_INHERIT;
+}
+
+static enum CRStatus
+resolve_box (CRStyle * a_this)
+{
+        CRStyleBox const *parent = a_this->parent_style->box;
+        CRStyleBox *box = NULL;
+        glong i = 0;
+
+        if (!box_needs_resolution (a_this->box, parent))
+                return CR_OK;
+        box = cr_style_get_box_for_writing (a_this);
+        if (!box)
+                return CR_OUT_OF_MEMORY_ERROR;
+
+        for (i=0 ; i < NB_NUM_PROPS ;i++) {
+                if (box->num_props[i].sv.type == NUM_INHERIT) {
+                        cr_num_copy (&box->num_props[i].cv,
+                                     computed_num (parent, i));
+                }
+        }
+	if (box->display == DISPLAY_INHERIT) {
+		box->display = parent->display;
+	}
+	if (box->position == POSITION_INHERIT) {
+		box->position = parent->position;
+	}
+	if (box->float_type == FLOAT_INHERIT) {
+		box->float_type = parent->float_type;
+	}
+        return CR_OK;
+}
+
+static enum CRStatus
+resolve_border (CRStyle * a_this)
+{
+        CRStyleBorder const *parent = a_this->parent_style->border;
+        CRStyleBorder *border = NULL;
+        glong i = 0;
+
+	for (i = 0; i < NB_BORDER_STYLE_PROPS; i++) {
+		if (a_this->border->border_style_props[i]
+                    != BORDER_STYLE_INHERIT)
+                        continue;
+                if (!border) {
+                        border = cr_style_get_border_for_writing (a_this);
+                        if (!border)
+                                return CR_OUT_OF_MEMORY_ERROR;
+                }
+                border->border_style_props[i] =
+                        parent->border_style_props[i];
+	}
+        return CR_OK;
+}
+
+static enum CRStatus
+resolve_color (CRStyle * a_this)
+{
+        CRStyleColor const *parent = a_this->parent_style->color;
+        CRStyleColor *color = NULL;
+        glong i = 0;
+
+	for (i=0; i < NB_RGB_PROPS; i++) {
+		if (cr_rgb_is_set_to_inherit (&a_this->color->rgb_props[i].sv)
+                    != TRUE
+                    || !memcmp (&a_this->color->rgb_props[i].cv,
+                                computed_rgb (parent, i), sizeof (CRRgb)))
+                        continue;
+                if (!color) {
+                        color = cr_style_get_color_for_writing (a_this);
+                        if (!color)
+                                return CR_OUT_OF_MEMORY_ERROR;
+                }
+                cr_rgb_copy (&color->rgb_props[i].cv,
+                             computed_rgb (parent, i));
+	}
+        return CR_OK;
+}
+
+static gboolean
+font_needs_resolution (CRStyleFont const * a_font,
+                       CRStyleFont const * a_parent)
+{
+        if (a_font->font_style == FONT_STYLE_INHERIT
+            || a_font->font_variant == FONT_VARIANT_INHERIT
+            || a_font->font_weight == FONT_WEIGHT_INHERIT
+            || a_font->font_stretch == FONT_STRETCH_INHERIT)
+                return TRUE;
+        if (a_font->font_family == NULL && a_parent->font_family)
+                return TRUE;
+        return a_font->font_size.sv.type == INHERITED_FONT_SIZE
+                && memcmp (&a_font->font_size.cv,
+                           computed_font_size (a_parent),
+                           sizeof (CRFontSize));
+}
+
+static enum CRStatus
+resolve_font (CRStyle * a_this)
+{
+        CRStyleFont const *parent = a_this->parent_style->font;
+        CRStyleFont *font = NULL;
+
+        if (!font_needs_resolution (a_this->font, parent))
+                return CR_OK;
+        font = cr_style_get_font_for_writing (a_this);
+        if (!font)
+                return CR_OUT_OF_MEMORY_ERROR;
+
+	if (font->font_style == FONT_STYLE_INHERIT) {
+		font->font_style = parent->font_style;
+	}
+	if (font->font_variant == FONT_VARIANT_INHERIT) {
+		font->font_variant = parent->font_variant;
+	}
+	if (font->font_weight == FONT_WEIGHT_INHERIT) {
+		font->font_weight = parent->font_weight;
+	}
+	if (font->font_stretch == FONT_STRETCH_INHERIT) {
+		font->font_stretch = parent->font_stretch;
+	}
+	/*NULL is inherit marker for font_famiy*/
+	if (font->font_family == NULL)  {
+		share_font_family (font, parent);
+	}
+        if (font->font_size.sv.type == INHERITED_FONT_SIZE) {
+                cr_font_size_copy (&font->font_size.cv,
+                                   computed_font_size (parent)) ;
+        }
+        return CR_OK;
+}
+
+/*
+ *The functions that resolve the inherited properties
+ *of each kind of group. The text group has none.
+ */
+static enum CRStatus (*const gv_group_resolvers[NB_STYLE_GROUPS])
+        (CRStyle *) = {
+        resolve_box,
+        resolve_border,
+        resolve_color,
+        resolve_font,
+        NULL
+};
+
+/**
+ *Resolves the inherited properties of a group of a style.
+ *The children whose group is a default one all resolve it
+ *to the same values, so the group they get is remembered on
+ *the group of their parent, and is the group of the
+ *parent itself when it holds the same values.
+ *@param a_this the style.
+ *@param a_kind the kind of the group to resolve.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+resolve_group (CRStyle * a_this, enum CRStyleGroupKind a_kind)
+{
+        CRStyleGroup *group = get_group (a_this, a_kind),
+                *parent_group = get_group (a_this->parent_style, a_kind),
+                *default_child = NULL;
+        enum CRStatus status = CR_OK;
+
+        if (!gv_group_resolvers[a_kind])
+                return CR_OK;
+
+        if (group != gv_default_groups[a_kind])
+                return gv_group_resolvers[a_kind] (a_this);
+
+        default_child = g_atomic_pointer_get (&parent_group->default_child);
+        if (default_child) {
+                group_ref (default_child);
+                replace_group (a_this, a_kind, default_child);
+                return CR_OK;
+        }
+        status = gv_group_resolvers[a_kind] (a_this);
+        if (status != CR_OK || get_group (a_this, a_kind) == group)
+                return status;
+
+        /*
+         *a base group outlives the styles, so it only remembers
+         *a default child when they are allocated by glib.
+         */
+        if (cr_allocator_get_current ()
+            && (parent_group == gv_default_groups[a_kind]
+                || parent_group == gv_initial_groups[a_kind]))
+                return CR_OK;
+
+        default_child = get_group (a_this, a_kind);
+        if (group_equal (a_kind, default_child, parent_group)) {
+                group_ref (parent_group);
+                replace_group (a_this, a_kind, parent_group);
+                default_child = parent_group;
+        } else {
+                group_ref (default_child);
+        }
+        if (!g_atomic_pointer_compare_and_exchange
+            (&parent_group->default_child, NULL, default_child)
+            && default_child != parent_group) {
+                group_unref (a_kind, default_child);
+        }
+        return CR_OK;
+}
+
+/*
+ *Serialize the resolutions made on demand, as the styles
+ *being read can be shared by several threads. A style always
+ *takes the same lock, picked by its address, so that threads
+ *resolving different styles rarely wait for each other.
+ *A style only writes its own groups when it is resolved,
+ *and its ancestors are resolved before its lock is taken,
+ *so no thread ever holds two of these locks.
+ */
+#define NB_LAZY_RESOLUTION_LOCKS 64
+
+static GMutex gv_lazy_resolution_locks[NB_LAZY_RESOLUTION_LOCKS];
+
+static GMutex *
+get_lazy_resolution_lock (CRStyle * a_this)
+{
+        return &gv_lazy_resolution_locks
+                [((gsize) a_this / sizeof (CRStyle))
+                 % NB_LAZY_RESOLUTION_LOCKS];
+}
+
+/**
+ *Resolves the inherited properties of a group of a style, and
+ *of the same group of its ancestors, unless it is already done.
+ *@param a_this the style.
+ *@param a_kind the kind of the group to resolve.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+ensure_group_resolved (CRStyle * a_this, enum CRStyleGroupKind a_kind)
+{
+        enum CRStatus status = CR_OK;
+        guint bit = 1 << a_kind;
+        GMutex *lock = NULL;
+
+        if (!a_this->parent_style
+            || (g_atomic_int_get ((gint *) &a_this->resolved_groups) & bit))
+                return CR_OK;
+
+        status = ensure_group_resolved (a_this->parent_style, a_kind);
+        if (status != CR_OK)
+                return status;
+
+        lock = get_lazy_resolution_lock (a_this);
+        g_mutex_lock (lock);
+        if (!(a_this->resolved_groups & bit)) {
+                status = resolve_group (a_this, a_kind);
+                if (status == CR_OK)
+                        g_atomic_int_or (&a_this->resolved_groups, bit);
+        }
+        g_mutex_unlock (lock);
+        return status;
+}
+
+/******************
+ *Public methods
+ ******************/
+
+/**
+ *Default constructor of #CRStyle.
+ *@param a_set_props_to_initial_values if TRUE, the style properties
+ *will be set to the default values. Only the style properties of the
+ *root box should be set to their initial values.
+ *Otherwise, the style values are set to their default value.
+ *Read the CSS2 spec, chapters 6.1.1 to 6.2.
+ */
+CRStyle *
+cr_style_new (gboolean a_set_props_to_initial_values)
+{
+        CRStyle *result = NULL;
+        enum CRStatus status = CR_OK;
+
+        result = cr_allocator_alloc (sizeof (CRStyle));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (CRStyle));
+        cr_stats_count_alloc (CR_STATS_STYLE);
+        if (a_set_props_to_initial_values == TRUE) {
+                status = cr_style_set_props_to_initial_values (result);
+        } else {
+                status = cr_style_set_props_to_default_values (result);
+        }
+        if (status != CR_OK) {
+                cr_style_destroy (result);
+                return NULL;
+        }
+
+        return result;
+}
+
+/**
+ *Sets the style properties to their default values according to the css2 spec
+ * i.e inherit if the property is inherited, its initial value otherwise.
+ *@param a_this the current instance of #CRStyle.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
+enum CRStatus 
+cr_style_set_props_to_default_values (CRStyle * a_this)
+{
+	g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
+
+        if (init_base_groups () != CR_OK)
+                return CR_OUT_OF_MEMORY_ERROR;
+        set_base_groups (a_this, gv_default_groups);
+	a_this->parent_style = NULL;
+        a_this->resolved_groups = 0;
+
+        /* To make the inheritance resolution possible and efficient */
+        a_this->inherited_props_resolved = FALSE ;
+	return CR_OK;
+}
+
+/**
+ *Sets the style properties to their initial value according to the css2 spec.
+ *This function should be used to initialize the style of the root element
+ *of an xml tree.
+ *Some properties are user agent dependant like font-family, and
+ *are not initialized, read the spec to make you renderer compliant.
+ *@param a_this the current instance of #CRStyle.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
+enum CRStatus 
+cr_style_set_props_to_initial_values (CRStyle *a_this)
+{
+        g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
+
+        if (init_base_groups () != CR_OK)
+                return CR_OUT_OF_MEMORY_ERROR;
+        set_base_groups (a_this, gv_initial_groups);
+        a_this->inherited_props_resolved = FALSE ;
+        a_this->resolved_groups = 0;
+
+        return CR_OK;
+}
+
+/**
+ *Resolves the inherited properties.
+ *The function sets the "inherited" properties to either the value of
+ *their parent properties.
+ *This function is *NOT* recursive. So the inherited properties of
+ *the parent style must have been resolved prior to calling this function.
+ *@param a_this the instance where 
+ *@return CR_OK if a root node is found and the propagation is successful,
+ *an error code otherwise
+ */
+enum CRStatus 
+cr_style_resolve_inherited_properties (CRStyle *a_this)
+{
+	enum CRStatus ret = CR_OK;
+	glong i = 0;
+
+	g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
+	g_return_val_if_fail (a_this->parent_style, CR_BAD_PARAM_ERROR) ;
+
+        if (a_this->inherited_props_resolved == TRUE)
+                return CR_OK ;
+
+        for (i = 0; ret == CR_OK && i < NB_STYLE_GROUPS; i++) {
+                if (a_this->resolved_groups & (1 << i))
+                        continue;
+                ret = ensure_group_resolved (a_this->parent_style, i);
+                if (ret == CR_OK)
+                        ret = resolve_group (a_this, i);
+                if (ret == CR_OK)
+                        a_this->resolved_groups |= 1 << i;
+        }
+        if (ret == CR_OK)
+                a_this->inherited_props_resolved = TRUE ;
+	return ret;
+}
+
+/**
+ * cr_style_get_computed_num:
+ *@a_this: the current instance of #CRStyle.
+ *@a_code: the numerical property to get.
+ *@a_result: out parameter. The computed value of the property.
+ *
+ *Gets the computed value of a numerical property.
+ *Unless cr_style_resolve_inherited_properties () was called on
+ *a_this, the inherited properties of the group that holds the
+ *property are resolved now, and are remembered for the next reads.
+ *The ancestors of a_this must still be alive.
+ *Several threads can read the properties of the same
+ *styles at once, but must not modify them meanwhile.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_style_get_computed_num (CRStyle * a_this, enum CRNumProp a_code,
+                           CRNum * a_result)
+{
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_this && a_result && a_code < NB_NUM_PROPS,
+                              CR_BAD_PARAM_ERROR);
+
+        status = ensure_group_resolved (a_this, STYLE_GROUP_BOX);
+        if (status != CR_OK)
+                return status;
+        return cr_num_copy (a_result, computed_num (a_this->box, a_code));
+}
+
+/**
+ * cr_style_get_actual_num:
+ *@a_this: the current instance of #CRStyle.
+ *@a_code: the numerical property to get.
+ *@a_result: out parameter. The actual value of the property.
+ *
+ *Gets the actual value of a numerical property.
+ *As libcroco does no layout, the actual value of a property
+ *is its computed value, see cr_style_get_computed_num ().
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_style_get_actual_num (CRStyle * a_this, enum CRNumProp a_code,
+                         CRNum * a_result)
+{
+        return cr_style_get_computed_num (a_this, a_code, a_result);
+}
+
+/**
+ * cr_style_get_computed_rgb:
+ *@a_this: the current instance of #CRStyle.
+ *@a_code: the color property to get.
+ *@a_result: out parameter. The computed value of the property.
+ *
+ *Gets the computed value of a color property.
+ *See cr_style_get_computed_num ().
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_style_get_computed_rgb (CRStyle * a_this, enum CRRgbProp a_code,
+                           CRRgb * a_result)
+{
+        enum CRStatus status = CR_OK;
 
-        return status;
+        g_return_val_if_fail (a_this && a_result && a_code < NB_RGB_PROPS,
+                              CR_BAD_PARAM_ERROR);
+
+        status = ensure_group_resolved (a_this, STYLE_GROUP_COLOR);
+        if (status != CR_OK)
+                return status;
+        return cr_rgb_copy (a_result, computed_rgb (a_this->color, a_code));
 }
 
-static enum CRStatus
-set_prop_white_space_from_value (CRStyle * a_style, CRTerm * a_value)
-{
-	enum CRStatus status = CR_OK;
-
-	g_return_val_if_fail (a_style && a_value, CR_BAD_PARAM_ERROR);
-
-	switch (a_value->type) {
-	case TERM_IDENT:
-		if (a_value->content.str && a_value->content.str->stryng) {
-			if (!strcmp (a_value->content.str->stryng->str, "normal")) {
-				a_style->white_space = WHITE_SPACE_NORMAL;
-			} else if (!strcmp (a_value->content.str->stryng->str, 
-                                            "pre")) {
-				a_style->white_space = WHITE_SPACE_PRE;
-			} else if (!strcmp (a_value->content.str->stryng->str,
-                                            "nowrap")) {
-				a_style->white_space = WHITE_SPACE_NOWRAP;
-			} else if (!strcmp (a_value->content.str->stryng->str,
-                                            "inherit")) {
-				a_style->white_space = WHITE_SPACE_INHERIT;
-			} else {
-				status = CR_UNKNOWN_PROP_VAL_ERROR;
-			}
-		}
-		break;
-	default:
-		status = CR_UNKNOWN_PROP_VAL_ERROR;
-		break;
-	}
+/**
+ * cr_style_get_computed_font_size:
+ *@a_this: the current instance of #CRStyle.
+ *@a_result: out parameter. The computed value of the font size.
+ *
+ *Gets the computed value of the 'font-size' property.
+ *See cr_style_get_computed_num ().
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_style_get_computed_font_size (CRStyle * a_this, CRFontSize * a_result)
+{
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_this && a_result, CR_BAD_PARAM_ERROR);
 
-	return status;
+        status = ensure_group_resolved (a_this, STYLE_GROUP_FONT);
+        if (status != CR_OK)
+                return status;
+        return cr_font_size_copy (a_result,
+                                  computed_font_size (a_this->font));
 }
 
-/******************
- *Public methods
- ******************/
+/*
+ *The scaling factors between the predefined absolute font
+ *sizes and 'medium', as suggested by the css2 spec, 15.2.4.
+ */
+static const gdouble gv_font_size_scales[NB_PREDEFINED_ABSOLUTE_FONT_SIZES] = {
+        3.0 / 5.0,              /*xx-small */
+        3.0 / 4.0,              /*x-small */
+        8.0 / 9.0,              /*small */
+        1.0,                    /*medium */
+        6.0 / 5.0,              /*large */
+        3.0 / 2.0,              /*x-large */
+        2.0,                    /*xx-large */
+        1.0                     /*inherit: scales the parent size */
+};
+
+/*
+ *The ratio between two consecutive predefined
+ *absolute font sizes, used for 'larger' and 'smaller'.
+ */
+#define RELATIVE_FONT_SIZE_SCALE 1.2
 
 /**
- *Default constructor of #CRStyle.
- *@param a_set_props_to_initial_values if TRUE, the style properties
- *will be set to the default values. Only the style properties of the
- *root box should be set to their initial values.
- *Otherwise, the style values are set to their default value.
- *Read the CSS2 spec, chapters 6.1.1 to 6.2.
+ *Fills a table that maps each type of number to the factor
+ *that turns it into pixels. The types that are not
+ *lengths or percentages are mapped to 0.
+ *@param a_context the unit resolution context.
+ *@param a_em the size of 'em', in pixels.
+ *@param a_percent_base what 100% is, in pixels.
+ *@param a_factors out parameter. The table to fill.
  */
-CRStyle *
-cr_style_new (gboolean a_set_props_to_initial_values)
+static void
+set_length_factors (CRUnitContext const * a_context, gdouble a_em,
+                    gdouble a_percent_base, gdouble * a_factors)
 {
-        CRStyle *result = NULL;
-
-        result = g_try_malloc (sizeof (CRStyle));
-        if (!result) {
-                cr_utils_trace_info ("Out of memory");
-                return NULL;
-        }
-        memset (result, 0, sizeof (CRStyle));
-        gv_prop_hash_ref_count++;
+        memset (a_factors, 0, NB_NUM_TYPE * sizeof (gdouble));
+        a_factors[NUM_LENGTH_PX] = 1.0;
+        a_factors[NUM_LENGTH_IN] = a_context->dpi;
+        a_factors[NUM_LENGTH_CM] = a_context->dpi / 2.54;
+        a_factors[NUM_LENGTH_MM] = a_context->dpi / 25.4;
+        a_factors[NUM_LENGTH_PT] = a_context->dpi / 72.0;
+        a_factors[NUM_LENGTH_PC] = a_context->dpi / 6.0;
+        a_factors[NUM_LENGTH_EM] = a_em;
+        a_factors[NUM_LENGTH_EX] = a_em / 2.0;
+        a_factors[NUM_PERCENTAGE] = a_percent_base / 100.0;
+}
 
-        if (a_set_props_to_initial_values == TRUE) {
-                cr_style_set_props_to_initial_values (result);
-        } else {
-                cr_style_set_props_to_default_values (result);
+/**
+ *Returns the size of a font in pixels.
+ *@param a_size the computed font size.
+ *@param a_parent_px the font size of the parent, in pixels.
+ *@param a_context the unit resolution context.
+ */
+static gdouble
+font_size_to_px (CRFontSize const * a_size, gdouble a_parent_px,
+                 CRUnitContext const * a_context)
+{
+        gdouble factors[NB_NUM_TYPE];
+
+        switch (a_size->type) {
+        case PREDEFINED_ABSOLUTE_FONT_SIZE:
+                if (a_size->value.predefined == FONT_SIZE_INHERIT)
+                        return a_parent_px;
+                if (a_size->value.predefined
+                    >= NB_PREDEFINED_ABSOLUTE_FONT_SIZES)
+                        return a_context->medium_font_size;
+                return a_context->medium_font_size
+                        * gv_font_size_scales[a_size->value.predefined];
+        case RELATIVE_FONT_SIZE:
+                if (a_size->value.relative == FONT_SIZE_LARGER)
+                        return a_parent_px * RELATIVE_FONT_SIZE_SCALE;
+                return a_parent_px / RELATIVE_FONT_SIZE_SCALE;
+        case ABSOLUTE_FONT_SIZE:
+                if (a_size->value.absolute.type >= NB_NUM_TYPE)
+                        return a_parent_px;
+                set_length_factors (a_context, a_parent_px, a_parent_px,
+                                    factors);
+                if (factors[a_size->value.absolute.type] == 0.0)
+                        return a_parent_px;
+                return a_size->value.absolute.val
+                        * factors[a_size->value.absolute.type];
+        default:
+                return a_parent_px;
         }
-
-        return result;
 }
 
-/**
- *Sets the style properties to their default values according to the css2 spec
- * i.e inherit if the property is inherited, its initial value otherwise.
- *@param a_this the current instance of #CRStyle.
- *@return CR_OK upon successfull completion, an error code otherwise.
+/*
+ *What a group was resolved into during a call to
+ *cr_style_resolve_units (), and against what. Groups resolved
+ *against the same values resolve to the same group.
  */
-enum CRStatus 
-cr_style_set_props_to_default_values (CRStyle * a_this)
+struct CRResolvedGroup {
+        enum CRStyleGroupKind kind;
+        /*the group before its resolution*/
+        CRStyleGroup *source;
+        gdouble em;
+        gdouble percent_base;
+        /*the group of the parent, if inherited values were copied from it*/
+        CRStyleGroup *parent;
+        CRStyleGroup *result;
+};
+
+static guint
+resolved_group_hash (gconstpointer a_key)
 {
-	glong i = 0;
+        struct CRResolvedGroup const *key = a_key;
 
-	g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
-	
-	for (i = 0; i < NB_NUM_PROPS; i++)
-	{
-		switch (i)
-		{
-		case NUM_PROP_WIDTH:
-		case NUM_PROP_TOP:
-		case NUM_PROP_RIGHT:
-		case NUM_PROP_BOTTOM:
-		case NUM_PROP_LEFT:
-			cr_num_set (&a_this->num_props[i].sv, 0, NUM_AUTO);
-			break;
+        return g_direct_hash (key->source) ^ g_direct_hash (key->parent)
+                ^ g_double_hash (&key->em)
+                ^ g_double_hash (&key->percent_base);
+}
 
-		case NUM_PROP_PADDING_TOP:
-		case NUM_PROP_PADDING_RIGHT:
-		case NUM_PROP_PADDING_BOTTOM:
-		case NUM_PROP_PADDING_LEFT:
-		case NUM_PROP_BORDER_TOP:
-		case NUM_PROP_BORDER_RIGHT:
-		case NUM_PROP_BORDER_BOTTOM:
-		case NUM_PROP_BORDER_LEFT:
-		case NUM_PROP_MARGIN_TOP:
-		case NUM_PROP_MARGIN_RIGHT:
-		case NUM_PROP_MARGIN_BOTTOM:
-		case NUM_PROP_MARGIN_LEFT:
-			cr_num_set (&a_this->num_props[i].sv,
-				    0, NUM_LENGTH_PX);
-			break;
+static gboolean
+resolved_group_equal (gconstpointer a_key, gconstpointer a_other)
+{
+        struct CRResolvedGroup const *key = a_key,
+                *other = a_other;
 
-		default:
-			cr_utils_trace_info ("Unknown property");
-			break;
-		}
-	}
+        return key->source == other->source
+                && key->parent == other->parent
+                && key->em == other->em
+                && key->percent_base == other->percent_base;
+}
 
-	for (i = 0; i < NB_RGB_PROPS; i++) {
-                
-		switch (i) {
-			/*default foreground color is black */
-		case RGB_PROP_COLOR:
-			/*
-                         *REVIEW: color is inherited and the default value is
-			 *ua dependant.
-                         */
-			cr_rgb_set_to_inherit (&a_this->rgb_props[i].sv,
-                                               TRUE) ;
-			break;
+static void
+resolved_group_destroy (gpointer a_data)
+{
+        struct CRResolvedGroup *entry = a_data;
 
-			/*default background color is white */
-		case RGB_PROP_BACKGROUND_COLOR:
-			/* TODO: the default value should be transparent */
-			cr_rgb_set (&a_this->rgb_props[i].sv,
-				    255, 255, 255, FALSE);
-                        cr_rgb_set_to_transparent (&a_this->rgb_props[i].sv,
-                                                   TRUE) ;
-			break;
+        group_unref (entry->kind, entry->source);
+        if (entry->parent)
+                group_unref (entry->kind, entry->parent);
+        group_unref (entry->kind, entry->result);
+        g_free (entry);
+}
 
-		default:
-			/* 
-                         *TODO: for BORDER_COLOR the initial value should
-			 * be the same as COLOR 
-                         */
-			cr_rgb_set (&a_this->rgb_props[i].sv, 0, 0, 0,
-				    FALSE);
-			break;
-		}
-	}
+/**
+ *Makes a style use the group its group was resolved to
+ *by another style, if it was resolved against the same values.
+ *@param a_style the style.
+ *@param a_resolved the table of the resolved groups.
+ *@param a_key the group of a_style and what it is resolved against.
+ *@return TRUE if a_style now uses the resolved group.
+ */
+static gboolean
+reuse_resolved_group (CRStyle * a_style, GHashTable * a_resolved,
+                      struct CRResolvedGroup const *a_key)
+{
+        struct CRResolvedGroup *entry = NULL;
+
+        entry = g_hash_table_lookup (a_resolved, a_key);
+        if (!entry)
+                return FALSE;
+        group_ref (entry->result);
+        replace_group (a_style, a_key->kind, entry->result);
+        return TRUE;
+}
 
-	for (i = 0; i < NB_BORDER_STYLE_PROPS; i++) {
-		a_this->border_style_props[i] = BORDER_STYLE_NONE;
-	}
+/**
+ *Remembers what a group was resolved into.
+ *@param a_resolved the table of the resolved groups.
+ *@param a_key the group and what it was resolved against.
+ *@param a_result the resolved group.
+ */
+static void
+remember_resolved_group (GHashTable * a_resolved,
+                         struct CRResolvedGroup const *a_key,
+                         CRStyleGroup * a_result)
+{
+        struct CRResolvedGroup *entry = NULL;
 
-	a_this->display = DISPLAY_INLINE;
-	a_this->position = POSITION_STATIC;
-	a_this->float_type = FLOAT_NONE;
-	a_this->parent_style = NULL;
-	a_this->font_style = FONT_STYLE_INHERIT;
-	a_this->font_variant = FONT_VARIANT_INHERIT;
-	a_this->font_weight = FONT_WEIGHT_INHERIT;
-	a_this->font_family = NULL;
-        
-        cr_font_size_set_to_inherit (&a_this->font_size.sv) ;
-        cr_font_size_clear (&a_this->font_size.cv) ;
-        cr_font_size_clear (&a_this->font_size.av) ;
+        entry = g_try_malloc (sizeof (struct CRResolvedGroup));
+        if (!entry)
+                return;
+        /*
+         *hold the source and parent groups too, so that their
+         *addresses cannot be reused by other groups during the batch.
+         */
+        memcpy (entry, a_key, sizeof (struct CRResolvedGroup));
+        group_ref (entry->source);
+        if (entry->parent)
+                group_ref (entry->parent);
+        entry->result = a_result;
+        group_ref (a_result);
+        g_hash_table_replace (a_resolved, entry, entry);
+}
 
-        /* To make the inheritance resolution possible and efficient */
-        a_this->inherited_props_resolved = FALSE ;
-	return CR_OK;
+/**
+ *Sets the actual font size of a style, in pixels.
+ *@return the font size, in pixels.
+ */
+static gdouble
+resolve_font_size_units (CRStyle * a_this, CRUnitContext const * a_context,
+                         GHashTable * a_resolved)
+{
+        CRStyleFont const *parent = NULL;
+        CRStyleFont *font = NULL;
+        struct CRResolvedGroup key;
+        CRFontSize av;
+        gdouble parent_px = a_context->medium_font_size,
+                px = 0;
+
+        if (a_this->parent_style) {
+                parent = a_this->parent_style->font;
+                if (parent->font_size.av.type == ABSOLUTE_FONT_SIZE
+                    && parent->font_size.av.value.absolute.type
+                    == NUM_LENGTH_PX)
+                        parent_px = parent->font_size.av.value.absolute.val;
+        }
+        if (a_this->font->font_size.sv.type == INHERITED_FONT_SIZE) {
+                px = parent_px;
+        } else {
+                px = font_size_to_px (computed_font_size (a_this->font),
+                                      parent_px, a_context);
+        }
+
+        memset (&av, 0, sizeof (CRFontSize));
+        cr_font_size_set_absolute_font_size (&av, NUM_LENGTH_PX, px);
+        memset (&key, 0, sizeof (key));
+        key.kind = STYLE_GROUP_FONT;
+        key.source = get_group (a_this, STYLE_GROUP_FONT);
+        key.em = parent_px;
+        if (!memcmp (&a_this->font->font_size.av, &av, sizeof (CRFontSize))
+            || reuse_resolved_group (a_this, a_resolved, &key))
+                return px;
+        group_ref (key.source);
+        font = cr_style_get_font_for_writing (a_this);
+        if (font) {
+                memcpy (&font->font_size.av, &av, sizeof (CRFontSize));
+                remember_resolved_group (a_resolved, &key, &font->group);
+        }
+        group_unref (STYLE_GROUP_FONT, key.source);
+        return px;
 }
 
 /**
- *Sets the style properties to their initial value according to the css2 spec.
- *This function should be used to initialize the style of the root element
- *of an xml tree.
- *Some properties are user agent dependant like font-family, and
- *are not initialized, read the spec to make you renderer compliant.
- *@param a_this the current instance of #CRStyle.
- *@return CR_OK upon successfull completion, an error code otherwise.
+ *Sets the actual values of the numerical properties of a style,
+ *in pixels.
  */
-enum CRStatus 
-cr_style_set_props_to_initial_values (CRStyle *a_this)
+static void
+resolve_box_units (CRStyle * a_this, gdouble a_em,
+                   CRUnitContext const * a_context, GHashTable * a_resolved)
 {
+        CRStyleBox const *parent = NULL;
+        CRStyleBox *box = NULL;
+        struct CRResolvedGroup key;
+        CRNum const *cv = NULL;
+        CRNum avs[NB_NUM_PROPS];
+        gdouble widths[NB_NUM_TYPE],
+                heights[NB_NUM_TYPE],
+                *factors = NULL;
+        gdouble width = a_context->viewport_width;
+        gboolean inherits = FALSE;
         glong i = 0;
 
-        g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
-
+        if (a_this->parent_style) {
+                parent = a_this->parent_style->box;
+                if (parent->num_props[NUM_PROP_WIDTH].av.type
+                    == NUM_LENGTH_PX)
+                        width = parent->num_props[NUM_PROP_WIDTH].av.val;
+        }
+        /*
+         *percentages refer to the width of the containing block, but
+         *for 'top' and 'bottom'. As libcroco does no layout, the height
+         *of the containing block is taken to be the one of the viewport.
+         */
+        set_length_factors (a_context, a_em, width, widths);
+        set_length_factors (a_context, a_em, a_context->viewport_height,
+                            heights);
+
+        memset (avs, 0, sizeof (avs));
         for (i = 0; i < NB_NUM_PROPS; i++) {
-                switch (i) {
-                case NUM_PROP_WIDTH:
-                        cr_num_set (&a_this->num_props[i].sv, 800,
-                                    NUM_LENGTH_PX) ;
-                        break ;
-                case NUM_PROP_TOP:
-                case NUM_PROP_RIGHT:
-                case NUM_PROP_BOTTOM:
-                case NUM_PROP_LEFT:
-                        cr_num_set (&a_this->num_props[i].sv, 0, NUM_AUTO);
-                        break;
-
-                case NUM_PROP_PADDING_TOP:
-                case NUM_PROP_PADDING_RIGHT:
-                case NUM_PROP_PADDING_BOTTOM:
-                case NUM_PROP_PADDING_LEFT:
-                case NUM_PROP_BORDER_TOP:
-                case NUM_PROP_BORDER_RIGHT:
-                case NUM_PROP_BORDER_BOTTOM:
-                case NUM_PROP_BORDER_LEFT:
-                case NUM_PROP_MARGIN_TOP:
-                case NUM_PROP_MARGIN_RIGHT:
-                case NUM_PROP_MARGIN_BOTTOM:
-                case NUM_PROP_MARGIN_LEFT:
-                        cr_num_set (&a_this->num_props[i].sv,
-                                    0, NUM_LENGTH_PX);
-                        break;
-
-                default:
-                        cr_utils_trace_info ("Unknown property");
-                        break;
+                if (a_this->box->num_props[i].sv.type == NUM_INHERIT
+                    && parent) {
+                        inherits = TRUE;
+                        avs[i] = parent->num_props[i].av;
+                        continue;
+                }
+                cv = computed_num (a_this->box, i);
+                factors = (i == NUM_PROP_TOP || i == NUM_PROP_BOTTOM) ?
+                        heights : widths;
+                if (cv->type < NB_NUM_TYPE && factors[cv->type] != 0.0) {
+                        avs[i].type = NUM_LENGTH_PX;
+                        avs[i].val = cv->val * factors[cv->type];
+                } else {
+                        avs[i].type = cv->type;
+                        avs[i].val = cv->val;
                 }
         }
 
-        for (i = 0; i < NB_RGB_PROPS; i++) {
-
-                switch (i) {
-                        /*default foreground color is black */
-                case RGB_PROP_COLOR:
-                        cr_rgb_set (&a_this->rgb_props[i].sv, 0, 0, 0, FALSE);
-                        break;
-
-                        /*default background color is white */
-                case RGB_PROP_BACKGROUND_COLOR:
-                        cr_rgb_set (&a_this->rgb_props[i].sv,
-                                    255, 255, 255, FALSE);
-                        cr_rgb_set_to_transparent (&a_this->rgb_props[i].sv,
-                                                   TRUE) ;                        
-                        break;
-                default:
-                        cr_rgb_set (&a_this->rgb_props[i].sv, 0, 0, 0, FALSE);
+        for (i = 0; i < NB_NUM_PROPS; i++) {
+                if (memcmp (&a_this->box->num_props[i].av, &avs[i],
+                            sizeof (CRNum)))
                         break;
-                }
         }
-
-        for (i = 0; i < NB_BORDER_STYLE_PROPS; i++) {
-                a_this->border_style_props[i] = BORDER_STYLE_NONE;
+        if (i == NB_NUM_PROPS)
+                return;
+        /*
+         *the values inherited from the parent are part of what
+         *the group resolves to, so the parent group is too.
+         */
+        memset (&key, 0, sizeof (key));
+        key.kind = STYLE_GROUP_BOX;
+        key.source = get_group (a_this, STYLE_GROUP_BOX);
+        key.em = a_em;
+        key.percent_base = width;
+        if (inherits)
+                key.parent = (CRStyleGroup *) &parent->group;
+        if (reuse_resolved_group (a_this, a_resolved, &key))
+                return;
+        group_ref (key.source);
+        box = cr_style_get_box_for_writing (a_this);
+        if (box) {
+                for (i = 0; i < NB_NUM_PROPS; i++) {
+                        box->num_props[i].av = avs[i];
+                }
+                remember_resolved_group (a_resolved, &key, &box->group);
         }
+        group_unref (STYLE_GROUP_BOX, key.source);
+}
 
-        a_this->display = DISPLAY_BLOCK;
-        a_this->position = POSITION_STATIC;
-        a_this->float_type = FLOAT_NONE;
-        a_this->font_style = FONT_STYLE_NORMAL;
-        a_this->font_variant = FONT_VARIANT_NORMAL;
-        a_this->font_weight = FONT_WEIGHT_NORMAL;
-        a_this->font_stretch = FONT_STRETCH_NORMAL;
-	a_this->white_space = WHITE_SPACE_NORMAL;
-        cr_font_size_set_predefined_absolute_font_size
-                (&a_this->font_size.sv, FONT_SIZE_MEDIUM) ;
-        a_this->inherited_props_resolved = FALSE ;
+/**
+ * cr_unit_context_set_defaults:
+ *@a_this: the unit resolution context to set.
+ *
+ *Sets a unit resolution context to the values css assumes
+ *in the absence of a rendering device: a 96dpi screen,
+ *a 800x600 pixels viewport and a 16 pixels 'medium' font size.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_unit_context_set_defaults (CRUnitContext * a_this)
+{
+        g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
 
+        a_this->dpi = 96.0;
+        a_this->viewport_width = 800.0;
+        a_this->viewport_height = 600.0;
+        a_this->medium_font_size = 16.0;
         return CR_OK;
 }
 
 /**
- *Resolves the inherited properties.
- *The function sets the "inherited" properties to either the value of
- *their parent properties.
- *This function is *NOT* recursive. So the inherited properties of
- *the parent style must have been resolved prior to calling this function.
- *@param a_this the instance where 
- *@return CR_OK if a root node is found and the propagation is successful,
- *an error code otherwise
+ * cr_style_resolve_units:
+ *@a_styles: the styles to resolve.
+ *@a_nb_styles: the number of styles in @a_styles.
+ *@a_context: the device the lengths are resolved for.
+ *
+ *Computes the actual values, in pixels, of the font size and of
+ *the numerical properties of a batch of styles, typically the
+ *styles of all the nodes of a document.
+ *The parent of a style must come before it in @a_styles, or have
+ *been resolved by a previous call. The styles that end up with the
+ *same values share their storage, so that resolving the styles
+ *of a large document allocates only a few groups of properties.
+ *Percentages resolve against the width of the parent, or against
+ *the height of the viewport for 'top' and 'bottom'.
+ *The actual values are then found in the
+ *'av' fields of the properties of the style.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
  */
-enum CRStatus 
-cr_style_resolve_inherited_properties (CRStyle *a_this)
+enum CRStatus
+cr_style_resolve_units (CRStyle ** a_styles, gulong a_nb_styles,
+                        CRUnitContext const * a_context)
+{
+        enum CRStatus status = CR_OK;
+        GHashTable *resolved = NULL;
+        gdouble em = 0;
+        gulong i = 0;
+
+        g_return_val_if_fail ((a_styles || !a_nb_styles) && a_context,
+                              CR_BAD_PARAM_ERROR);
+
+        resolved = g_hash_table_new_full (resolved_group_hash,
+                                          resolved_group_equal,
+                                          resolved_group_destroy, NULL);
+        if (!resolved) {
+                cr_utils_trace_info ("Out of memory");
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+        for (i = 0; i < a_nb_styles; i++) {
+                if (!a_styles[i])
+                        continue;
+                status = ensure_group_resolved (a_styles[i],
+                                                STYLE_GROUP_FONT);
+                if (status == CR_OK)
+                        status = ensure_group_resolved (a_styles[i],
+                                                        STYLE_GROUP_BOX);
+                if (status != CR_OK)
+                        break;
+                em = resolve_font_size_units (a_styles[i], a_context,
+                                              resolved);
+                resolve_box_units (a_styles[i], em, a_context, resolved);
+        }
+        g_hash_table_destroy (resolved);
+        return status;
+}
+
+/**
+ *Sets the field(s) of a #CRStyle that correspond to
+ *a property, from the value of that property.
+ *@param a_this the instance of #CRStyle to set.
+ *@param a_prop_id the id of the property.
+ *@param a_value the value of the property.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
+static enum CRStatus
+set_prop_from_value (CRStyle * a_this, enum CRPropertyID a_prop_id,
+                     CRTerm * a_value)
 {
-	enum CRStatus ret = CR_OK;
-	glong i = 0;
+        CRDeclValue decoded;
+        enum CRStatus status = CR_OK;
 
-	g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
-	g_return_val_if_fail (a_this->parent_style, CR_BAD_PARAM_ERROR) ;
+        switch (a_prop_id) {
+        case PROP_ID_PADDING:
+                return set_prop_padding_from_value (a_this, a_value);
 
-        if (a_this->inherited_props_resolved == TRUE)
-                return CR_OK ;
+        case PROP_ID_BORDER_WIDTH:
+                return set_prop_border_width_from_value (a_this, a_value);
 
-        for (i=0 ; i < NB_NUM_PROPS ;i++) {
-                if (a_this->num_props[i].sv.type == NUM_INHERIT) {
-                        cr_num_copy (&a_this->num_props[i].cv,
-                                     &a_this->parent_style->num_props[i].cv);
-                }
-        }
-	for (i=0; i < NB_RGB_PROPS; i++) {
-		if (cr_rgb_is_set_to_inherit (&a_this->rgb_props[i].sv) == TRUE) {
-			cr_rgb_copy (
-				&a_this->rgb_props[i].cv,
-				&a_this->parent_style->rgb_props[i].cv);
-		}
-	}
-	for (i = 0; i < NB_BORDER_STYLE_PROPS; i++) {
-		if (a_this->border_style_props[i] == BORDER_STYLE_INHERIT) {
-			a_this->border_style_props[i] =
-			  a_this->parent_style->border_style_props[i];
-		}
-	}
+        case PROP_ID_BORDER_STYLE:
+                return set_prop_border_style_from_value (a_this, a_value);
 
-	if (a_this->display == DISPLAY_INHERIT) {
-		a_this->display = a_this->parent_style->display;
-	}
-	if (a_this->position == POSITION_INHERIT) {
-		a_this->position = a_this->parent_style->position;
-	}
-	if (a_this->float_type == FLOAT_INHERIT) {
-		a_this->float_type = a_this->parent_style->float_type;
-	}
-	if (a_this->font_style == FONT_STYLE_INHERIT) {
-		a_this->font_style = a_this->parent_style->font_style;
-	}
-	if (a_this->font_variant == FONT_VARIANT_INHERIT) {
-		a_this->font_variant = a_this->parent_style->font_variant;
-	}
-	if (a_this->font_weight == FONT_WEIGHT_INHERIT) {
-		a_this->font_weight = a_this->parent_style->font_weight;
-	}
-	if (a_this->font_stretch == FONT_STRETCH_INHERIT) {
-		a_this->font_stretch = a_this->parent_style->font_stretch;
-	}
-	/*NULL is inherit marker for font_famiy*/
-	if (a_this->font_family == NULL)  {
-		a_this->font_family = a_this->parent_style->font_family;
-	}
-        if (a_this->font_size.sv.type == INHERITED_FONT_SIZE) {
-                cr_font_size_copy (&a_this->font_size.cv,
-                                   &a_this->parent_style->font_size.cv) ;
+        case PROP_ID_BORDER_TOP:
+                return set_prop_border_x_from_value (a_this, a_value,
+                                                     DIR_TOP);
+
+        case PROP_ID_BORDER_RIGHT:
+                return set_prop_border_x_from_value (a_this, a_value,
+                                                     DIR_RIGHT);
+
+        case PROP_ID_BORDER_BOTTOM:
+                return set_prop_border_x_from_value (a_this, a_value,
+                                                     DIR_BOTTOM);
+
+        case PROP_ID_BORDER_LEFT:
+                return set_prop_border_x_from_value (a_this, a_value,
+                                                     DIR_LEFT);
+
+        case PROP_ID_BORDER:
+                return set_prop_border_from_value (a_this, a_value);
+
+        case PROP_ID_MARGIN:
+                return set_prop_margin_from_value (a_this, a_value);
+
+        default:
+                break;
         }
-        a_this->inherited_props_resolved = TRUE ;
-	return ret;
+
+        status = decode_value (a_prop_id, a_value, &decoded);
+        apply_decl_value (a_this, a_prop_id, &decoded);
+        clear_decl_value (&decoded);
+        return status;
 }
 
 /**
@@ -2003,7 +2991,13 @@ cr_style_resolve_inherited_properties (CRStyle *a_this)
  *according field(s) in the #CRStyle structure.
  *If the properties or their value(s) are/is not known, 
  *sets the corresponding field(s) of #CRStyle to its/their default 
- *value(s)
+ *value(s).
+ *If the declaration is a shorthand, it is expanded by
+ *cr_style_expand_shorthand() the first time it is applied,
+ *and its longhands are applied instead.
+ *The value of each property is decoded the first time it is
+ *applied and the decoded form is kept in the declaration,
+ *so that applying it again is a mere store into a_this.
  *@param a_this the instance of #CRStyle to set.
  *@param a_decl the declaration from which the #CRStyle fields are set.
  *@return CR_OK upon successfull completion, an error code otherwise.
@@ -2011,11 +3005,12 @@ cr_style_resolve_inherited_properties (CRStyle *a_this)
 enum CRStatus
 cr_style_set_style_from_decl (CRStyle * a_this, CRDeclaration * a_decl)
 {
-        CRTerm *value = NULL;
+        CRLonghand *longhands = NULL,
+                *cur = NULL;
+        CRDeclValue const *value = NULL;
+        CRDeclValue scratch;
         enum CRStatus status = CR_OK;
 
-        enum CRPropertyID prop_id = PROP_ID_NOT_KNOWN;
-
         g_return_val_if_fail (a_this && a_decl
                               && a_decl
                               && a_decl->property
@@ -2023,216 +3018,217 @@ cr_style_set_style_from_decl (CRStyle * a_this, CRDeclaration * a_decl)
                               && a_decl->property->stryng->str,
                               CR_BAD_PARAM_ERROR);
 
-        prop_id = cr_style_get_prop_id
-                ((const guchar *) a_decl->property->stryng->str);
+        CR_TRACE (decl__begin, CR_TRACE_DECL_BEGIN,
+                  a_decl->prop_id, a_decl->location.byte_offset);
 
-        value = a_decl->value;
-        switch (prop_id) {
-        case PROP_ID_PADDING_TOP:
-                status = set_prop_padding_x_from_value
-                        (a_this, value, DIR_TOP);
-                break;
+        if (is_shorthand (a_decl->prop_id) && a_decl->value) {
+                longhands = g_atomic_pointer_get (&a_decl->longhands);
+                if (!longhands) {
+                        cr_style_expand_shorthand (a_decl);
+                        longhands = g_atomic_pointer_get
+                                (&a_decl->longhands);
+                }
+        }
+        if (longhands) {
+                for (cur = longhands; cur->value; cur++) {
+                        value = get_decl_value (cur->prop_id, cur->value,
+                                                &cur->typed_value,
+                                                &scratch);
+                        apply_decl_value (a_this, cur->prop_id, value);
+                        if (value == &scratch)
+                                clear_decl_value (&scratch);
+                }
+        } else if (!a_decl->value || is_shorthand (a_decl->prop_id)) {
+                status = set_prop_from_value (a_this, a_decl->prop_id,
+                                              a_decl->value);
+        } else {
+                value = get_decl_value (a_decl->prop_id, a_decl->value,
+                                        &a_decl->typed_value, &scratch);
+                apply_decl_value (a_this, a_decl->prop_id, value);
+                if (value == &scratch)
+                        clear_decl_value (&scratch);
+        }
 
-        case PROP_ID_PADDING_RIGHT:
-                status = set_prop_padding_x_from_value
-                        (a_this, value, DIR_RIGHT);
-                break;
-        case PROP_ID_PADDING_BOTTOM:
-                status = set_prop_padding_x_from_value
-                        (a_this, value, DIR_BOTTOM);
-                break;
+        CR_TRACE (decl__end, CR_TRACE_DECL_END, a_decl->prop_id, status);
+        return status;
+}
 
-        case PROP_ID_PADDING_LEFT:
-                status = set_prop_padding_x_from_value
-                        (a_this, value, DIR_LEFT);
-                break;
+static void
+append_longhand (GArray * a_longhands, enum CRPropertyID a_prop_id,
+                 CRTerm * a_value)
+{
+        CRLonghand longhand;
 
-        case PROP_ID_PADDING:
-                status = set_prop_padding_from_value (a_this, value) ;
-                break;
+        memset (&longhand, 0, sizeof (CRLonghand));
+        longhand.prop_id = a_prop_id;
+        longhand.value = a_value;
+        g_array_append_val (a_longhands, longhand);
+}
 
-        case PROP_ID_BORDER_TOP_WIDTH:
-                status = set_prop_border_x_width_from_value (a_this, value,
-                                                             DIR_TOP);
-                break;
+/**
+ *Expands the value of a margin, padding, border-width or
+ *border-style shorthand into the four longhands it sets,
+ *following the usual top, right, bottom, left mapping
+ *of 1 to 4 values.
+ *@param a_longhands the array to append the longhands to.
+ *@param a_value the value of the shorthand.
+ *@param a_ids the ids of the top, right, bottom and left longhands.
+ *@param a_type if not TERM_NO_TYPE, the type of the terms to consider.
+ *@param a_skip if TRUE, terms which type is not a_type are skipped,
+ *otherwise the first of them ends the value.
+ */
+static void
+expand_box_shorthand (GArray * a_longhands, CRTerm * a_value,
+                      const enum CRPropertyID *a_ids,
+                      enum CRTermType a_type, gboolean a_skip)
+{
+        CRTerm *terms[NB_DIRS] = {NULL};
+        CRTerm *cur = NULL;
+        guint nb_terms = 0;
+
+        for (cur = a_value; cur && nb_terms < NB_DIRS; cur = cur->next) {
+                if (a_type != TERM_NO_TYPE && cur->type != a_type) {
+                        if (a_skip)
+                                continue;
+                        break;
+                }
+                terms[nb_terms++] = cur;
+        }
+        if (!nb_terms)
+                return;
+
+        append_longhand (a_longhands, a_ids[DIR_TOP], terms[0]);
+        append_longhand (a_longhands, a_ids[DIR_RIGHT],
+                         nb_terms > 1 ? terms[1] : terms[0]);
+        append_longhand (a_longhands, a_ids[DIR_BOTTOM],
+                         nb_terms > 2 ? terms[2] : terms[0]);
+        append_longhand (a_longhands, a_ids[DIR_LEFT],
+                         nb_terms > 3 ? terms[3]
+                         : nb_terms > 1 ? terms[1] : terms[0]);
+}
 
-        case PROP_ID_BORDER_RIGHT_WIDTH:
-                status = set_prop_border_x_width_from_value (a_this, value,
-                                                             DIR_RIGHT);
-                break;
+/**
+ *Expands the value of a border-top, border-right, border-bottom
+ *or border-left shorthand into the width, style and color
+ *longhands of its direction.
+ *Each term is classified the way set_prop_border_x_from_value()
+ *does it: a width if it is one, otherwise a style if it is one,
+ *otherwise a color.
+ *@param a_longhands the array to append the longhands to.
+ *@param a_value the value of the shorthand.
+ *@param a_dir the direction of the border.
+ */
+static void
+expand_border_x_shorthand (GArray * a_longhands, CRTerm * a_value,
+                           enum CRDirection a_dir)
+{
+        CRDeclValue decoded;
+        CRTerm *cur = NULL;
+
+        for (cur = a_value; cur; cur = cur->next) {
+                if (decode_border_width (cur, &decoded) == CR_OK) {
+                        append_longhand (a_longhands,
+                                         gv_border_width_ids[a_dir], cur);
+                } else if (decode_border_style (cur, &decoded) == CR_OK) {
+                        append_longhand (a_longhands,
+                                         gv_border_style_ids[a_dir], cur);
+                } else {
+                        append_longhand (a_longhands,
+                                         gv_border_color_ids[a_dir], cur);
+                }
+        }
+}
 
-        case PROP_ID_BORDER_BOTTOM_WIDTH:
-                status = set_prop_border_x_width_from_value (a_this, value,
-                                                             DIR_BOTTOM);
-                break;
+/**
+ * cr_style_expand_shorthand:
+ *@a_decl: the declaration to expand.
+ *
+ *If a_decl is a margin, padding or border shorthand, interprets
+ *its value once and stores the longhands it expands to
+ *in a_decl->longhands, so that cr_style_set_style_from_decl()
+ *doesn't have to decode the value again for each styled node.
+ *Does nothing for the other declarations, or if a_decl is
+ *already expanded.
+ *cr_style_set_style_from_decl() calls it the first time it
+ *applies a_decl. Threads styling documents at once may race
+ *to expand the same declaration: the longhands of the first of
+ *them are kept, those of the others are dropped.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_style_expand_shorthand (CRDeclaration * a_decl)
+{
+        GArray *longhands = NULL;
+        CRLonghand *result = NULL;
+        CRLonghand terminator;
+        enum CRDirection dir = DIR_TOP;
 
-        case PROP_ID_BORDER_LEFT_WIDTH:
-                status = set_prop_border_x_width_from_value (a_this, value,
-                                                             DIR_LEFT);
-                break;
+        g_return_val_if_fail (a_decl, CR_BAD_PARAM_ERROR);
 
-        case PROP_ID_BORDER_WIDTH:
-                status = set_prop_border_width_from_value (a_this, value) ;
-                break ;
+        if (!is_shorthand (a_decl->prop_id) || !a_decl->value
+            || g_atomic_pointer_get (&a_decl->longhands))
+                return CR_OK;
 
-        case PROP_ID_BORDER_TOP_STYLE:
-                status = set_prop_border_x_style_from_value (a_this, value,
-                                                             DIR_TOP);
-                break;
+        longhands = g_array_new (FALSE, FALSE, sizeof (CRLonghand));
+        if (!longhands) {
+                cr_utils_trace_info ("Out of memory");
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
 
-        case PROP_ID_BORDER_RIGHT_STYLE:
-                status = set_prop_border_x_style_from_value (a_this, value,
-                                                             DIR_RIGHT);
+        switch (a_decl->prop_id) {
+        case PROP_ID_MARGIN:
+                expand_box_shorthand (longhands, a_decl->value,
+                                      gv_margin_ids, TERM_NUMBER, TRUE);
                 break;
-
-        case PROP_ID_BORDER_BOTTOM_STYLE:
-                status = set_prop_border_x_style_from_value (a_this, value,
-                                                             DIR_BOTTOM);
+        case PROP_ID_PADDING:
+                expand_box_shorthand (longhands, a_decl->value,
+                                      gv_padding_ids, TERM_NUMBER, TRUE);
                 break;
-
-        case PROP_ID_BORDER_LEFT_STYLE:
-                status = set_prop_border_x_style_from_value (a_this, value,
-                                                             DIR_LEFT);
+        case PROP_ID_BORDER_WIDTH:
+                expand_box_shorthand (longhands, a_decl->value,
+                                      gv_border_width_ids,
+                                      TERM_NO_TYPE, FALSE);
                 break;
-
         case PROP_ID_BORDER_STYLE:
-                status = set_prop_border_style_from_value (a_this, value) ;
-                break ;
-
-        case PROP_ID_BORDER_TOP_COLOR:
-                status = set_prop_border_x_color_from_value (a_this, value,
-                                                             DIR_TOP);
-                break;
-
-        case PROP_ID_BORDER_RIGHT_COLOR:
-                status = set_prop_border_x_color_from_value (a_this, value,
-                                                             DIR_RIGHT);
+                expand_box_shorthand (longhands, a_decl->value,
+                                      gv_border_style_ids,
+                                      TERM_IDENT, FALSE);
                 break;
-
-        case PROP_ID_BORDER_BOTTOM_COLOR:
-                status = set_prop_border_x_color_from_value (a_this, value,
-                                                             DIR_BOTTOM);
-                break;
-
-        case PROP_ID_BORDER_LEFT_COLOR:
-                status = set_prop_border_x_color_from_value (a_this, value,
-                                                             DIR_BOTTOM);
-                break;
-
         case PROP_ID_BORDER_TOP:
-                status = set_prop_border_x_from_value (a_this, value,
-                                                       DIR_TOP);
+                expand_border_x_shorthand (longhands, a_decl->value,
+                                           DIR_TOP);
                 break;
-
         case PROP_ID_BORDER_RIGHT:
-                status = set_prop_border_x_from_value (a_this, value,
-                                                       DIR_RIGHT);
+                expand_border_x_shorthand (longhands, a_decl->value,
+                                           DIR_RIGHT);
                 break;
-
         case PROP_ID_BORDER_BOTTOM:
-                status = set_prop_border_x_from_value (a_this, value,
-                                                       DIR_BOTTOM);
+                expand_border_x_shorthand (longhands, a_decl->value,
+                                           DIR_BOTTOM);
                 break;
-
         case PROP_ID_BORDER_LEFT:
-                status = set_prop_border_x_from_value (a_this, value,
-                                                       DIR_LEFT);
-                break;
-
-        case PROP_ID_MARGIN_TOP:
-                status = set_prop_margin_x_from_value (a_this, value,
-                                                       DIR_TOP);
+                expand_border_x_shorthand (longhands, a_decl->value,
+                                           DIR_LEFT);
                 break;
-
         case PROP_ID_BORDER:
-                status = set_prop_border_from_value (a_this, value);
-                break;
-
-        case PROP_ID_MARGIN_RIGHT:
-                status = set_prop_margin_x_from_value (a_this, value,
-                                                       DIR_RIGHT);
-                break;
-
-        case PROP_ID_MARGIN_BOTTOM:
-                status = set_prop_margin_x_from_value (a_this, value,
-                                                       DIR_BOTTOM);
-                break;
-
-        case PROP_ID_MARGIN_LEFT:
-                status = set_prop_margin_x_from_value (a_this, value,
-                                                       DIR_LEFT);
-                break;
-
-        case PROP_ID_MARGIN:
-                status = set_prop_margin_from_value (a_this, value);
-                break;
-
-        case PROP_ID_DISPLAY:
-                status = set_prop_display_from_value (a_this, value);
-                break;
-
-        case PROP_ID_POSITION:
-                status = set_prop_position_from_value (a_this, value);
-                break;
-
-        case PROP_ID_TOP:
-                status = set_prop_x_from_value (a_this, value, DIR_TOP);
-                break;
-
-        case PROP_ID_RIGHT:
-                status = set_prop_x_from_value (a_this, value, DIR_RIGHT);
-                break;
-
-        case PROP_ID_BOTTOM:
-                status = set_prop_x_from_value (a_this, value, DIR_BOTTOM);
-                break;
-
-        case PROP_ID_LEFT:
-                status = set_prop_x_from_value (a_this, value, DIR_LEFT);
-                break;
-
-        case PROP_ID_FLOAT:
-                status = set_prop_float (a_this, value);
-                break;
-
-        case PROP_ID_WIDTH:
-                status = set_prop_width (a_this, value);
-                break;
-
-        case PROP_ID_COLOR:
-                status = set_prop_color (a_this, value);
-                break;
-
-        case PROP_ID_BACKGROUND_COLOR:
-                status = set_prop_background_color (a_this, value);
-                break;
-
-        case PROP_ID_FONT_FAMILY:
-                status = set_prop_font_family_from_value (a_this, value);
-                break;
-
-        case PROP_ID_FONT_SIZE:
-                status = set_prop_font_size_from_value (a_this, value);
-                break;
-
-        case PROP_ID_FONT_STYLE:
-                status = set_prop_font_style_from_value (a_this, value);
-                break;
-
-        case PROP_ID_FONT_WEIGHT:
-                status = set_prop_font_weight_from_value (a_this, value);
+                for (dir = DIR_TOP; dir < NB_DIRS; dir++) {
+                        expand_border_x_shorthand (longhands,
+                                                   a_decl->value, dir);
+                }
                 break;
-
-	case PROP_ID_WHITE_SPACE:
-		status = set_prop_white_space_from_value(a_this, value);
-		break;
-
         default:
-                return CR_UNKNOWN_TYPE_ERROR;
-
+                break;
         }
 
-        return status;
+        terminator.prop_id = PROP_ID_NOT_KNOWN;
+        terminator.value = NULL;
+        g_array_append_val (longhands, terminator);
+        result = (CRLonghand *) g_array_free (longhands, FALSE);
+        if (!g_atomic_pointer_compare_and_exchange (&a_decl->longhands,
+                                                    NULL, result))
+                g_free (result);
+        return CR_OK;
 }
 
 /**
@@ -2247,7 +3243,7 @@ cr_style_ref (CRStyle * a_this)
 {
         g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
 
-        a_this->ref_count++;
+        g_atomic_int_inc (&a_this->ref_count);
         return CR_OK;
 }
 
@@ -2265,15 +3261,84 @@ cr_style_unref (CRStyle * a_this)
 {
         g_return_val_if_fail (a_this, FALSE);
 
-        if (a_this->ref_count)
-                a_this->ref_count--;
+        /*
+         *styles are shared between the worker threads of
+         *cr_sel_eng_style_document_parallel (), hence the atomics.
+         */
+        if (g_atomic_int_get (&a_this->ref_count) > 0
+            && !g_atomic_int_dec_and_test (&a_this->ref_count))
+                return FALSE;
+
+        cr_style_destroy (a_this);
+        return TRUE;
+}
 
-        if (!a_this->ref_count) {
-                cr_style_destroy (a_this);
-                return TRUE;
+/**
+ *Adds the memory a property group owns, the group included,
+ *to a_usage.
+ */
+static void
+add_group_mem_usage (CRMemUsage * a_usage, enum CRStyleGroupKind a_kind,
+                     CRStyleGroup const * a_group)
+{
+        CRStyleFontFamily const *holder = NULL;
+        CRMemUsage family;
+        gint nb_refs = 0;
+        guint i = 0;
+
+        a_usage->bytes[CR_MEM_STYLES] += gv_group_sizes[a_kind];
+        if (a_kind != STYLE_GROUP_FONT)
+                return;
+        holder = ((CRStyleFont const *) a_group)->font_family_holder;
+        if (!holder)
+                return;
+        memset (&family, 0, sizeof (CRMemUsage));
+        family.bytes[CR_MEM_STYLES] += sizeof (CRStyleFontFamily);
+        cr_stats_add_font_family_mem_usage (&family, CR_MEM_STYLES,
+                                            holder->font_family);
+        nb_refs = MAX (g_atomic_int_get (&holder->ref_count), 1);
+        for (i = 0; i < CR_MEM_NB_CATEGORIES; i++) {
+                a_usage->bytes[i] += family.bytes[i] / nb_refs;
         }
+}
 
-        return FALSE;
+/**
+ *Estimates the memory used by a style, per category.
+ *A property group shared by n styles counts for the nth of
+ *its size, so that the usage of the styles of a document
+ *adds up to what they use together. The groups all the styles
+ *start from are left out, and so is the parent style.
+ *@param a_this the current instance of #CRStyle.
+ *@param a_usage the memory usage the bytes used are added to,
+ *so that the usage of several objects can be summed. Clear it
+ *before the first call.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_style_get_memory_usage (CRStyle const * a_this, CRMemUsage * a_usage)
+{
+        CRStyleGroup const *group = NULL;
+        CRMemUsage group_usage;
+        gint nb_refs = 0;
+        guint i = 0,
+                j = 0;
+
+        g_return_val_if_fail (a_this && a_usage, CR_BAD_PARAM_ERROR);
+
+        a_usage->bytes[CR_MEM_STYLES] += sizeof (CRStyle);
+        for (i = 0; i < NB_STYLE_GROUPS; i++) {
+                group = get_group (a_this, i);
+                if (!group || group == gv_default_groups[i]
+                    || group == gv_initial_groups[i])
+                        continue;
+                memset (&group_usage, 0, sizeof (CRMemUsage));
+                add_group_mem_usage (&group_usage, i, group);
+                nb_refs = MAX (g_atomic_int_get (&group->ref_count), 1);
+                for (j = 0; j < CR_MEM_NB_CATEGORIES; j++) {
+                        a_usage->bytes[j] += group_usage.bytes[j] / nb_refs;
+                }
+        }
+        return CR_OK;
 }
 
 /**
@@ -2301,9 +3366,8 @@ cr_style_dup (CRStyle * a_this)
 
 /**
  *Copies a style data structure into another.
- *TODO: this is actually broken because it's based
- *on memcpy although some data stuctures of CRStyle should
- *be properly duplicated.
+ *The property groups are not copied: a_dest shares
+ *them with a_src until one of the two modifies them.
  *@param a_dest the destination style datastructure
  *@param a_src the source style datastructure.
  *@return CR_OK upon succesfull completion, an error code otherwise
@@ -2311,12 +3375,118 @@ cr_style_dup (CRStyle * a_this)
 enum CRStatus
 cr_style_copy (CRStyle * a_dest, CRStyle * a_src)
 {
+        CRStyleGroup *group = NULL;
+        glong i = 0;
+
         g_return_val_if_fail (a_dest && a_src, CR_BAD_PARAM_ERROR);
 
-        memcpy (a_dest, a_src, sizeof (CRStyle));
+        for (i = 0; i < NB_STYLE_GROUPS; i++) {
+                group = get_group (a_src, i);
+                if (group)
+                        group_ref (group);
+                replace_group (a_dest, i, group);
+        }
+        a_dest->inherited_props_resolved = a_src->inherited_props_resolved;
+        a_dest->resolved_groups = a_src->resolved_groups;
+        a_dest->parent_style = a_src->parent_style;
+        g_atomic_int_set (&a_dest->ref_count,
+                          g_atomic_int_get (&a_src->ref_count));
         return CR_OK;
 }
 
+/**
+ * cr_style_get_box_for_writing:
+ *@a_this: the current instance of #CRStyle.
+ *
+ *Returns the box group of a_this, after having copied it
+ *if it was shared with other styles, so that it can be modified.
+ *The cr_style_get_*_for_writing () functions must be used
+ *before any property of a #CRStyle is modified.
+ *
+ *Returns the group, or NULL if a system error occured.
+ */
+CRStyleBox *
+cr_style_get_box_for_writing (CRStyle * a_this)
+{
+        g_return_val_if_fail (a_this, NULL);
+
+        return (CRStyleBox *) get_group_for_writing (a_this, STYLE_GROUP_BOX);
+}
+
+/**
+ * cr_style_get_border_for_writing:
+ *@a_this: the current instance of #CRStyle.
+ *
+ *Returns the border group of a_this, unshared.
+ *See cr_style_get_box_for_writing ().
+ *
+ *Returns the group, or NULL if a system error occured.
+ */
+CRStyleBorder *
+cr_style_get_border_for_writing (CRStyle * a_this)
+{
+        g_return_val_if_fail (a_this, NULL);
+
+        return (CRStyleBorder *) get_group_for_writing
+                (a_this, STYLE_GROUP_BORDER);
+}
+
+/**
+ * cr_style_get_color_for_writing:
+ *@a_this: the current instance of #CRStyle.
+ *
+ *Returns the color group of a_this, unshared.
+ *See cr_style_get_box_for_writing ().
+ *
+ *Returns the group, or NULL if a system error occured.
+ */
+CRStyleColor *
+cr_style_get_color_for_writing (CRStyle * a_this)
+{
+        g_return_val_if_fail (a_this, NULL);
+
+        return (CRStyleColor *) get_group_for_writing
+                (a_this, STYLE_GROUP_COLOR);
+}
+
+/**
+ * cr_style_get_font_for_writing:
+ *@a_this: the current instance of #CRStyle.
+ *
+ *Returns the font group of a_this, unshared.
+ *See cr_style_get_box_for_writing ().
+ *The font family list of the group can still be shared:
+ *replace it rather than modifying it.
+ *
+ *Returns the group, or NULL if a system error occured.
+ */
+CRStyleFont *
+cr_style_get_font_for_writing (CRStyle * a_this)
+{
+        g_return_val_if_fail (a_this, NULL);
+
+        return (CRStyleFont *) get_group_for_writing
+                (a_this, STYLE_GROUP_FONT);
+}
+
+/**
+ * cr_style_get_text_for_writing:
+ *@a_this: the current instance of #CRStyle.
+ *
+ *Returns the text group of a_this, unshared.
+ *See cr_style_get_box_for_writing ().
+ *
+ *Returns the group, or NULL if a system error occured.
+ */
+CRStyleText *
+cr_style_get_text_for_writing (CRStyle * a_this)
+{
+        g_return_val_if_fail (a_this, NULL);
+
+        return (CRStyleText *) get_group_for_writing
+                (a_this, STYLE_GROUP_TEXT);
+}
+
 /**
  *dump a CRNumpPropVal in a string.
  *@param a_prop_val the numerical property value to dump
@@ -2689,7 +3859,8 @@ cr_style_to_string (CRStyle * a_this, GString ** a_str, guint a_nb_indent)
                         g_string_append (str, "NULL");
                 }
                 tmp_str = NULL;
-                cr_style_num_prop_val_to_string (&a_this->num_props[i], str,
+                cr_style_num_prop_val_to_string (&a_this->box->num_props[i],
+                                                 str,
                                                  a_nb_indent +
                                                  INTERNAL_INDENT);
                 g_string_append (str, "\n");
@@ -2704,7 +3875,8 @@ cr_style_to_string (CRStyle * a_this, GString ** a_str, guint a_nb_indent)
                         g_string_append (str, "NULL: ");
                 }
                 tmp_str = NULL;
-                cr_style_rgb_prop_val_to_string (&a_this->rgb_props[i], str,
+                cr_style_rgb_prop_val_to_string (&a_this->color->rgb_props[i],
+                                                 str,
                                                  a_nb_indent +
                                                  INTERNAL_INDENT);
                 g_string_append (str, "\n");
@@ -2719,34 +3891,36 @@ cr_style_to_string (CRStyle * a_this, GString ** a_str, guint a_nb_indent)
                         g_string_append (str, "NULL: ");
                 }
                 tmp_str = NULL;
-                cr_style_border_style_to_string (a_this->
+                cr_style_border_style_to_string (a_this->border->
                                                  border_style_props[i], str,
                                                  0);
                 g_string_append (str, "\n");
         }
         cr_utils_dump_n_chars2 (' ', str, indent);
         g_string_append (str, "display: ");
-        cr_style_display_type_to_string (a_this->display, str, 0);
+        cr_style_display_type_to_string (a_this->box->display, str, 0);
         g_string_append (str, "\n");
 
         cr_utils_dump_n_chars2 (' ', str, indent);
         g_string_append (str, "position: ");
-        cr_style_position_type_to_string (a_this->position, str, 0);
+        cr_style_position_type_to_string (a_this->box->position, str, 0);
         g_string_append (str, "\n");
 
         cr_utils_dump_n_chars2 (' ', str, indent);
         g_string_append (str, "float-type: ");
-        cr_style_float_type_to_string (a_this->float_type, str, 0);
+        cr_style_float_type_to_string (a_this->box->float_type, str, 0);
         g_string_append (str, "\n");
 
 	cr_utils_dump_n_chars2 (' ', str, indent);
 	g_string_append (str, "white-space: ");
-	cr_style_white_space_type_to_string (a_this->white_space, str, 0);
+	cr_style_white_space_type_to_string (a_this->text->white_space,
+                                             str, 0);
 	g_string_append (str, "\n");
 
         cr_utils_dump_n_chars2 (' ', str, indent);
         g_string_append (str, "font-family: ");
-        tmp_str = (gchar *) cr_font_family_to_string (a_this->font_family, TRUE);
+        tmp_str = (gchar *) cr_font_family_to_string
+                (a_this->font->font_family, TRUE);
         if (tmp_str) {
                 g_string_append (str, tmp_str);
                 g_free (tmp_str);
@@ -2757,20 +3931,20 @@ cr_style_to_string (CRStyle * a_this, GString ** a_str, guint a_nb_indent)
         g_string_append (str, "\n");
 
         cr_utils_dump_n_chars2 (' ', str, indent);
-        tmp_str = cr_font_size_to_string (&a_this->font_size.sv);
+        tmp_str = cr_font_size_to_string (&a_this->font->font_size.sv);
         if (tmp_str) {
                 g_string_append_printf (str, "font-size {sv:%s, ",
                                         tmp_str) ;
         } else {
                 g_string_append (str, "font-size {sv:NULL, ");
         }
-        tmp_str = cr_font_size_to_string (&a_this->font_size.cv);
+        tmp_str = cr_font_size_to_string (&a_this->font->font_size.cv);
         if (tmp_str) {
                 g_string_append_printf (str, "cv:%s, ", tmp_str);
         } else {
                 g_string_append (str, "cv:NULL, ");
         }
-        tmp_str = cr_font_size_to_string (&a_this->font_size.av);
+        tmp_str = cr_font_size_to_string (&a_this->font->font_size.av);
         if (tmp_str) {
                 g_string_append_printf (str, "av:%s}", tmp_str);
         } else {
@@ -2781,7 +3955,8 @@ cr_style_to_string (CRStyle * a_this, GString ** a_str, guint a_nb_indent)
         g_string_append (str, "\n");
 
         cr_utils_dump_n_chars2 (' ', str, indent);
-        tmp_str = cr_font_size_adjust_to_string (a_this->font_size_adjust);
+        tmp_str = cr_font_size_adjust_to_string
+                (a_this->font->font_size_adjust);
         if (tmp_str) {
                 g_string_append_printf (str, "font-size-adjust: %s", tmp_str);
         } else {
@@ -2791,7 +3966,7 @@ cr_style_to_string (CRStyle * a_this, GString ** a_str, guint a_nb_indent)
         g_string_append (str, "\n");
 
         cr_utils_dump_n_chars2 (' ', str, indent);
-        tmp_str = (gchar *) cr_font_style_to_string (a_this->font_style);
+        tmp_str = (gchar *) cr_font_style_to_string (a_this->font->font_style);
         if (tmp_str) {
                 g_string_append_printf (str, "font-style: %s", tmp_str);
         } else {
@@ -2801,7 +3976,8 @@ cr_style_to_string (CRStyle * a_this, GString ** a_str, guint a_nb_indent)
         g_string_append (str, "\n");
 
         cr_utils_dump_n_chars2 (' ', str, indent);
-        tmp_str = (gchar *) cr_font_variant_to_string (a_this->font_variant);
+        tmp_str = (gchar *) cr_font_variant_to_string
+                (a_this->font->font_variant);
         if (tmp_str) {
                 g_string_append_printf (str, "font-variant: %s", tmp_str);
         } else {
@@ -2811,7 +3987,8 @@ cr_style_to_string (CRStyle * a_this, GString ** a_str, guint a_nb_indent)
         g_string_append (str, "\n");
 
         cr_utils_dump_n_chars2 (' ', str, indent);
-        tmp_str = (gchar *) cr_font_weight_to_string (a_this->font_weight);
+        tmp_str = (gchar *) cr_font_weight_to_string
+                (a_this->font->font_weight);
         if (tmp_str) {
                 g_string_append_printf (str, "font-weight: %s", tmp_str);
         } else {
@@ -2821,7 +3998,8 @@ cr_style_to_string (CRStyle * a_this, GString ** a_str, guint a_nb_indent)
         g_string_append (str, "\n");
 
         cr_utils_dump_n_chars2 (' ', str, indent);
-        tmp_str = (gchar *) cr_font_stretch_to_string (a_this->font_stretch);
+        tmp_str = (gchar *) cr_font_stretch_to_string
+                (a_this->font->font_stretch);
         if (tmp_str) {
                 g_string_append_printf (str, "font-stretch: %s", tmp_str);
         } else {
@@ -2844,8 +4022,16 @@ cr_style_to_string (CRStyle * a_this, GString ** a_str, guint a_nb_indent)
 void
 cr_style_destroy (CRStyle * a_this)
 {
+        CRStyleGroup *group = NULL;
+        glong i = 0;
+
         g_return_if_fail (a_this);
 
-        g_free (a_this);
+        for (i = 0; i < NB_STYLE_GROUPS; i++) {
+                group = get_group (a_this, i);
+                if (group)
+                        group_unref (i, group);
+        }
+        cr_allocator_free (a_this);
 }
 
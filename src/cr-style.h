@@ -28,6 +28,7 @@
 #include "cr-utils.h"
 #include "cr-statement.h"
 #include "cr-fonts.h"
+#include "cr-stats.h"
 
 /**
  *@file
@@ -221,32 +222,48 @@ struct _CRFontSizeVal {
 } ;
 
 /**
- *The css2 style class.
- *Contains computed and actual values
- *inferred from the declarations found
- *in the stylesheets.
- *See css2 spec chapter 6.
+ *The kinds of property groups a #CRStyle is made of.
  */
-struct _CRStyle
+enum CRStyleGroupKind
 {
-        /**
-         *numerical properties.
-         *the properties are indexed by
-         *enum #CRNumProp. 
-         */
-        CRNumPropVal num_props[NB_NUM_PROPS] ;
+        STYLE_GROUP_BOX = 0,
+        STYLE_GROUP_BORDER,
+        STYLE_GROUP_COLOR,
+        STYLE_GROUP_FONT,
+        STYLE_GROUP_TEXT,
 
-        /**
-         *color properties.
-         *They are indexed by enum #CRRgbProp .
-         */
-        CRRgbPropVal rgb_props[NB_RGB_PROPS] ;
+        /*must be last*/
+        NB_STYLE_GROUPS
+} ;
+
+/**
+ *The header shared by all the property groups.
+ *A group is reference counted and can be shared by
+ *any number of styles. It is copied the first time
+ *one of the styles that share it needs to modify it.
+ */
+typedef struct _CRStyleGroup CRStyleGroup ;
+struct _CRStyleGroup
+{
+        gint ref_count ;
 
         /**
-         *border style properties.
-         *They are indexed by enum #CRBorderStyleProp .
+         *the group a child resolves its default group
+         *into, when this group is the one of its parent.
          */
-        enum CRBorderStyle border_style_props[NB_BORDER_STYLE_PROPS] ;
+        CRStyleGroup *default_child ;
+} ;
+
+/**
+ *The box properties: offsets, padding, border widths,
+ *margins, width and the box layout properties.
+ *They are indexed by enum #CRNumProp.
+ */
+typedef struct _CRStyleBox CRStyleBox ;
+struct _CRStyleBox
+{
+        CRStyleGroup group ;
+        CRNumPropVal num_props[NB_NUM_PROPS] ;
 
         /**box display type*/
         enum CRDisplayType display ;
@@ -256,12 +273,48 @@ struct _CRStyle
 
         /**the float property*/
         enum CRFloatType float_type ;
+} ;
+
+/**
+ *The border style properties.
+ *They are indexed by enum #CRBorderStyleProp .
+ */
+typedef struct _CRStyleBorder CRStyleBorder ;
+struct _CRStyleBorder
+{
+        CRStyleGroup group ;
+        enum CRBorderStyle border_style_props[NB_BORDER_STYLE_PROPS] ;
+} ;
+
+/**
+ *The color properties, border colors included.
+ *They are indexed by enum #CRRgbProp .
+ */
+typedef struct _CRStyleColor CRStyleColor ;
+struct _CRStyleColor
+{
+        CRStyleGroup group ;
+        CRRgbPropVal rgb_props[NB_RGB_PROPS] ;
+} ;
+
+typedef struct _CRStyleFontFamily CRStyleFontFamily ;
+
+typedef struct _CRStyleFont CRStyleFont ;
+struct _CRStyleFont
+{
+        CRStyleGroup group ;
 
         /*
          *the 'font-family' property.
          */
         CRFontFamily *font_family ;
 
+        /*
+         *the reference counted holder of font_family,
+         *shared by the groups that use the same list.
+         */
+        CRStyleFontFamily *font_family_holder ;
+
         /**
          *the 'font-size' property.
          */
@@ -271,15 +324,68 @@ struct _CRStyle
         enum CRFontVariant font_variant ;
         enum CRFontWeight font_weight ;
         enum CRFontStretch font_stretch ;
+} ;
+
+typedef struct _CRStyleText CRStyleText ;
+struct _CRStyleText
+{
+        CRStyleGroup group ;
 
 	/**
 	 * the 'tex' properties
 	 */
 	enum CRWhiteSpaceType white_space;
+} ;
+
+/**
+ *The css2 style class.
+ *Contains computed and actual values
+ *inferred from the declarations found
+ *in the stylesheets.
+ *See css2 spec chapter 6.
+ *The properties are held by property groups
+ *that are shared between styles as long as
+ *they are not modified. Use the cr_style_get_*_for_writing ()
+ *functions before modifying a group.
+ */
+struct _CRStyle
+{
+        CRStyleBox *box ;
+        CRStyleBorder *border ;
+        CRStyleColor *color ;
+        CRStyleFont *font ;
+        CRStyleText *text ;
 
         gboolean inherited_props_resolved ;
+
+        /*
+         *the groups which inherited properties are resolved,
+         *one bit per enum #CRStyleGroupKind. Groups are resolved
+         *all at once by cr_style_resolve_inherited_properties (),
+         *or one at a time by the cr_style_get_computed_* () functions.
+         */
+        guint resolved_groups ;
         CRStyle *parent_style ;
-        gulong ref_count ;
+        /*changed with the g_atomic_int_* () functions*/
+        gint ref_count ;
+} ;
+
+typedef struct _CRUnitContext CRUnitContext ;
+
+/**
+ *What the lengths of a style are resolved against
+ *when they are converted to pixels.
+ *See cr_style_resolve_units ().
+ */
+struct _CRUnitContext
+{
+        /*the resolution of the device, in dots per inch*/
+        gdouble dpi ;
+        /*the size of the viewport, in pixels*/
+        gdouble viewport_width ;
+        gdouble viewport_height ;
+        /*the size of the 'medium' font, in pixels*/
+        gdouble medium_font_size ;
 } ;
 
 enum CRStatus cr_style_white_space_type_to_string (enum CRWhiteSpaceType a_code,
@@ -311,9 +417,33 @@ enum CRStatus cr_style_float_type_to_string (enum CRFloatType a_code,
 
 CRStyle * cr_style_new (gboolean a_set_props_to_initial_values) ;
 
+enum CRStatus cr_style_expand_shorthand (CRDeclaration *a_decl) ;
+
 enum CRStatus cr_style_set_props_to_default_values (CRStyle *a_this) ;
 enum CRStatus cr_style_set_props_to_initial_values (CRStyle *a_this) ;
 enum CRStatus cr_style_resolve_inherited_properties (CRStyle *a_this) ;
+
+enum CRStatus cr_style_get_computed_num (CRStyle *a_this,
+                                         enum CRNumProp a_code,
+                                         CRNum *a_result) ;
+
+enum CRStatus cr_style_get_actual_num (CRStyle *a_this,
+                                       enum CRNumProp a_code,
+                                       CRNum *a_result) ;
+
+enum CRStatus cr_style_get_computed_rgb (CRStyle *a_this,
+                                         enum CRRgbProp a_code,
+                                         CRRgb *a_result) ;
+
+enum CRStatus cr_style_get_computed_font_size (CRStyle *a_this,
+                                               CRFontSize *a_result) ;
+
+enum CRStatus cr_unit_context_set_defaults (CRUnitContext *a_this) ;
+
+enum CRStatus cr_style_resolve_units (CRStyle **a_styles,
+                                      gulong a_nb_styles,
+                                      CRUnitContext const *a_context) ;
+
 enum CRStatus cr_style_propagate_from_parent (CRStyle *a_this);
 
 enum CRStatus cr_style_set_style_from_decl (CRStyle *a_this, 
@@ -322,6 +452,16 @@ enum CRStatus cr_style_set_style_from_decl (CRStyle *a_this,
 
 enum CRStatus cr_style_copy (CRStyle *a_dest, CRStyle *a_src) ;
 
+CRStyleBox * cr_style_get_box_for_writing (CRStyle *a_this) ;
+
+CRStyleBorder * cr_style_get_border_for_writing (CRStyle *a_this) ;
+
+CRStyleColor * cr_style_get_color_for_writing (CRStyle *a_this) ;
+
+CRStyleFont * cr_style_get_font_for_writing (CRStyle *a_this) ;
+
+CRStyleText * cr_style_get_text_for_writing (CRStyle *a_this) ;
+
 enum CRStatus cr_style_ref (CRStyle *a_this) ;
 
 gboolean cr_style_unref (CRStyle *a_this) ;
@@ -330,6 +470,9 @@ void cr_style_destroy (CRStyle *a_this) ;
 
 CRStyle * cr_style_dup (CRStyle *a_this) ;
 
+enum CRStatus cr_style_get_memory_usage (CRStyle const *a_this,
+                                         CRMemUsage *a_usage) ;
+
 enum CRStatus cr_style_to_string (CRStyle *a_this, 
                                   GString **a_str, 
                                   guint a_nb_indent) ;
@@ -22,6 +22,8 @@
 
 #include "string.h"
 #include "cr-stylesheet.h"
+#include "cr-stats-priv.h"
+#include "cr-allocator-priv.h"
 
 /**
  *@file
@@ -38,7 +40,7 @@ cr_stylesheet_new (CRStatement * a_stmts)
 {
         CRStyleSheet *result;
 
-        result = g_try_malloc (sizeof (CRStyleSheet));
+        result = cr_allocator_alloc (sizeof (CRStyleSheet));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
@@ -122,6 +124,26 @@ cr_stylesheet_nr_rules (CRStyleSheet const * a_this)
         return cr_statement_nr_rules (a_this->statements);
 }
 
+/**
+ *Estimates the memory used by a stylesheet and by what it
+ *owns, per category. The stylesheets it imports are left out.
+ *@param a_this the current instance of #CRStyleSheet.
+ *@param a_usage the memory usage the bytes used are added to,
+ *so that the usage of several objects can be summed. Clear it
+ *before the first call.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_stylesheet_get_memory_usage (CRStyleSheet const * a_this,
+                                CRMemUsage * a_usage)
+{
+        g_return_val_if_fail (a_this && a_usage, CR_BAD_PARAM_ERROR);
+
+        a_usage->bytes[CR_MEM_STATEMENTS] += sizeof (CRStyleSheet);
+        cr_stats_add_statements_mem_usage (a_usage, a_this->statements);
+        return CR_OK;
+}
+
 /**
  *Use an index to get a CRStatement from the rules in a given stylesheet.
  *@param a_this the current instance of #CRStatement.
@@ -174,5 +196,5 @@ cr_stylesheet_destroy (CRStyleSheet * a_this)
                 cr_statement_destroy (a_this->statements);
                 a_this->statements = NULL;
         }
-        g_free (a_this);
+        cr_allocator_free (a_this);
 }
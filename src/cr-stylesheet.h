@@ -26,6 +26,7 @@
 
 #include "cr-utils.h"
 #include "cr-statement.h"
+#include "cr-stats.h"
 
 G_BEGIN_DECLS
 
@@ -89,6 +90,9 @@ void cr_stylesheet_dump (CRStyleSheet const *a_this, FILE *a_fp) ;
 
 gint cr_stylesheet_nr_rules (CRStyleSheet const *a_this) ;
 
+enum CRStatus cr_stylesheet_get_memory_usage (CRStyleSheet const *a_this,
+                                              CRMemUsage *a_usage) ;
+
 CRStatement * cr_stylesheet_statement_get_from_list (CRStyleSheet *a_this, int itemnr) ;
 
 void cr_stylesheet_ref (CRStyleSheet *a_this) ;
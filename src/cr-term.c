@@ -26,6 +26,8 @@
 #include "cr-term.h"
 #include "cr-num.h"
 #include "cr-parser.h"
+#include "cr-stats-priv.h"
+#include "cr-allocator-priv.h"
 
 /**
  *@file
@@ -86,12 +88,13 @@ cr_term_new (void)
 {
         CRTerm *result = NULL;
 
-        result = g_try_malloc (sizeof (CRTerm));
+        result = cr_allocator_alloc (sizeof (CRTerm));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
         memset (result, 0, sizeof (CRTerm));
+        cr_stats_count_alloc (CR_STATS_TERM);
         return result;
 }
 
@@ -784,7 +787,7 @@ cr_term_destroy (CRTerm * a_this)
         }
 
         if (a_this) {
-                g_free (a_this);
+                cr_allocator_free (a_this);
         }
 
 }
@@ -30,6 +30,8 @@
 #include "string.h"
 #include "cr-tknzr.h"
 #include "cr-doc-handler.h"
+#include "cr-stats-priv.h"
+#include "cr-limits-priv.h"
 
 struct _CRTknzrPriv {
         /**The parser input stream of bytes*/
@@ -58,6 +60,18 @@ struct _CRTknzrPriv {
          *and cr_tknzr_unref().
          */
         glong ref_count;
+
+        /**
+         *The statistics of the parser using the tokenizer,
+         *or NULL if the parser does not gather any.
+         */
+        CRParserStats *stats;
+
+        /**
+         *The limits of the parser using the tokenizer,
+         *or NULL if it has none.
+         */
+        CRLimitsState *limits;
 };
 
 #define PRIVATE(obj) ((obj)->priv)
@@ -1903,6 +1917,8 @@ cr_tknzr_seek_index (CRTknzr * a_this, enum CRSeekPos a_origin, gint a_pos)
                 cr_token_destroy (PRIVATE (a_this)->token_cache);
                 PRIVATE (a_this)->token_cache = NULL;
         }
+        if (PRIVATE (a_this)->stats)
+                PRIVATE (a_this)->stats->nb_seeks++;
 
         return cr_input_seek_index (PRIVATE (a_this)->input, a_origin, a_pos);
 }
@@ -1938,6 +1954,8 @@ cr_tknzr_set_cur_pos (CRTknzr * a_this, CRInputPos * a_pos)
                 cr_token_destroy (PRIVATE (a_this)->token_cache);
                 PRIVATE (a_this)->token_cache = NULL;
         }
+        if (PRIVATE (a_this)->stats)
+                PRIVATE (a_this)->stats->nb_backtracks++;
 
         return cr_input_set_cur_pos (PRIVATE (a_this)->input, a_pos);
 }
@@ -1950,10 +1968,36 @@ cr_tknzr_unget_token (CRTknzr * a_this, CRToken * a_token)
                               CR_BAD_PARAM_ERROR);
 
         PRIVATE (a_this)->token_cache = a_token;
+        if (PRIVATE (a_this)->stats)
+                PRIVATE (a_this)->stats->nb_unget_tokens++;
 
         return CR_OK;
 }
 
+/**
+ *Counts the token about to be read against the limits
+ *of the parser, and checks the bytes read so far.
+ *@param a_this the current tokenizer. Its limits are set.
+ *@return CR_OK if the token may be read, an error code otherwise.
+ */
+static enum CRStatus
+cr_tknzr_check_limits (CRTknzr * a_this)
+{
+        CRLimitsState *limits = PRIVATE (a_this)->limits;
+        glong index = 0;
+        enum CRStatus status = CR_OK;
+
+        status = cr_limits_state_step (limits, &limits->nb_tokens,
+                                       limits->limits.max_tokens);
+        if (status != CR_OK || !limits->limits.max_bytes)
+                return status;
+        cr_input_get_cur_index (PRIVATE (a_this)->input, &index);
+        if ((gulong) index > limits->limits.max_bytes)
+                return cr_limits_state_stop (limits,
+                                             CR_LIMIT_EXCEEDED_ERROR);
+        return CR_OK;
+}
+
 /**
  *Returns the next token of the input stream.
  *This method is really central. Each parsing
@@ -1990,6 +2034,14 @@ cr_tknzr_get_next_token (CRTknzr * a_this, CRToken ** a_tk)
                 return CR_OK;
         }
 
+        /*
+         *once a limit is reached, the input looks
+         *exhausted to the parser, which then unwinds.
+         */
+        if (PRIVATE (a_this)->limits
+            && cr_tknzr_check_limits (a_this) != CR_OK)
+                return CR_END_OF_INPUT_ERROR;
+
         RECORD_INITIAL_POS (a_this, &init_pos);
 
         status = cr_input_get_end_of_file
@@ -2607,6 +2659,8 @@ cr_tknzr_get_next_token (CRTknzr * a_this, CRToken ** a_tk)
                  */
                 memmove (&PRIVATE (a_this)->prev_pos,
                          &init_pos, sizeof (CRInputPos));
+                if (PRIVATE (a_this)->stats)
+                        PRIVATE (a_this)->stats->nb_tokens++;
                 return CR_OK;
         }
 
@@ -2736,6 +2790,37 @@ cr_tknzr_parse_token (CRTknzr * a_this, enum CRTokenType a_type,
         return status;
 }
 
+/**
+ *Sets where the tokenizer counts the tokens it reads, the
+ *tokens put back and the moves of its input stream. Used
+ *by the parser which statistics are enabled.
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_stats the statistics of the parser, or NULL to
+ *stop counting. The tokenizer does not own them.
+ */
+void
+cr_tknzr_set_stats (CRTknzr * a_this, CRParserStats * a_stats)
+{
+        g_return_if_fail (a_this && PRIVATE (a_this));
+
+        PRIVATE (a_this)->stats = a_stats;
+}
+
+/**
+ *Sets the limits the tokenizer checks before reading
+ *each token. Used by the parser which limits are set.
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_limits the limits of the parser, or NULL to
+ *stop checking. The tokenizer does not own them.
+ */
+void
+cr_tknzr_set_limits (CRTknzr * a_this, CRLimitsState * a_limits)
+{
+        g_return_if_fail (a_this && PRIVATE (a_this));
+
+        PRIVATE (a_this)->limits = a_limits;
+}
+
 void
 cr_tknzr_destroy (CRTknzr * a_this)
 {
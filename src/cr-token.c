@@ -28,6 +28,8 @@
  */
 #include <string.h>
 #include "cr-token.h"
+#include "cr-stats-priv.h"
+#include "cr-allocator-priv.h"
 
 /*
  *TODO: write a CRToken::to_string() method.
@@ -135,7 +137,7 @@ cr_token_new (void)
 {
         CRToken *result = NULL;
 
-        result = g_try_malloc (sizeof (CRToken));
+        result = cr_allocator_alloc (sizeof (CRToken));
 
         if (result == NULL) {
                 cr_utils_trace_info ("Out of memory");
@@ -143,6 +145,7 @@ cr_token_new (void)
         }
 
         memset (result, 0, sizeof (CRToken));
+        cr_stats_count_alloc (CR_STATS_TOKEN);
 
         return result;
 }
@@ -632,5 +635,5 @@ cr_token_destroy (CRToken * a_this)
 
         cr_token_clear (a_this);
 
-        g_free (a_this);
+        cr_allocator_free (a_this);
 }
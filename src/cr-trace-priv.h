@@ -0,0 +1,72 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+/**
+ *@file
+ *The macros the library fires its tracepoints with.
+ *It is not installed. The library sources include config.h
+ *before this file, which defines ENABLE_SDT and
+ *CROCO_DISABLE_TRACEPOINTS as configured.
+ */
+
+#ifndef __CR_TRACE_PRIV_H__
+#define __CR_TRACE_PRIV_H__
+
+#include "cr-trace.h"
+
+G_BEGIN_DECLS
+
+extern CRTraceHandler gv_cr_trace_handler ;
+extern gpointer gv_cr_trace_user_data ;
+
+#if defined (ENABLE_SDT) && !defined (CROCO_DISABLE_TRACEPOINTS)
+#include <sys/sdt.h>
+#define CR_TRACE_PROBE(a_probe, a_arg0, a_arg1) \
+        DTRACE_PROBE2 (libcroco, a_probe, a_arg0, a_arg1)
+#else
+#define CR_TRACE_PROBE(a_probe, a_arg0, a_arg1)
+#endif
+
+/**
+ *Fires a tracepoint: the USDT probe, which is a nop unless a
+ *tracer is attached, and the handler, if one is set. Without
+ *USDT probes, the arguments are only evaluated for the handler.
+ */
+#ifndef CROCO_DISABLE_TRACEPOINTS
+#define CR_TRACE(a_probe, a_point, a_arg0, a_arg1) \
+        do { \
+                CR_TRACE_PROBE (a_probe, (guint64) (a_arg0), \
+                                (guint64) (a_arg1)) ; \
+                if (G_UNLIKELY (gv_cr_trace_handler != NULL)) \
+                        gv_cr_trace_handler (a_point, \
+                                             (guint64) (a_arg0), \
+                                             (guint64) (a_arg1), \
+                                             gv_cr_trace_user_data) ; \
+        } while (0)
+#else
+#define CR_TRACE(a_probe, a_point, a_arg0, a_arg1) \
+        do { } while (0)
+#endif
+
+G_END_DECLS
+
+#endif /*__CR_TRACE_PRIV_H__*/
@@ -0,0 +1,89 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include "config.h"
+#include "cr-trace-priv.h"
+
+/**
+ *@CRTrace:
+ *
+ *The tracepoints of the library. With --enable-sdt, each one is a
+ *USDT probe that perf, bpftrace or systemtap can attach to without
+ *any change to the process. Without it, or to collect them from
+ *within the process, a handler can be set with cr_trace_set_handler().
+ */
+
+CRTraceHandler gv_cr_trace_handler = NULL;
+gpointer gv_cr_trace_user_data = NULL;
+
+static const gchar *gv_trace_point_names[CR_TRACE_NB_POINTS] = {
+        "parse-begin",
+        "parse-end",
+        "statement-begin",
+        "statement-end",
+        "match-begin",
+        "match-end",
+        "cascade-begin",
+        "cascade-end",
+        "decl-begin",
+        "decl-end"
+};
+
+/**
+ * cr_trace_set_handler:
+ *@a_handler: the function to call at each tracepoint, or NULL
+ *to stop calling it.
+ *@a_user_data: the user data to pass to @a_handler.
+ *
+ *Sets the function called at each tracepoint, from the thread
+ *that reaches it. It must be set or unset while the library is
+ *not in use by any thread. Until a handler is set, a tracepoint
+ *costs a test, plus a nop for its USDT probe.
+ *
+ *Returns CR_OK upon successful completion, CR_ERROR if the
+ *library has been built with --disable-tracepoints.
+ */
+enum CRStatus
+cr_trace_set_handler (CRTraceHandler a_handler, gpointer a_user_data)
+{
+#ifdef CROCO_DISABLE_TRACEPOINTS
+        return CR_ERROR;
+#else
+        gv_cr_trace_handler = a_handler;
+        gv_cr_trace_user_data = a_user_data;
+        return CR_OK;
+#endif
+}
+
+/**
+ * cr_trace_point_to_string:
+ *@a_point: the tracepoint.
+ *
+ *Returns the name of @a_point, or NULL if it is not valid.
+ */
+const gchar *
+cr_trace_point_to_string (enum CRTracePoint a_point)
+{
+        g_return_val_if_fail (a_point < CR_TRACE_NB_POINTS, NULL);
+
+        return gv_trace_point_names[a_point];
+}
@@ -0,0 +1,108 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+/**
+ *@file
+ *The declaration of the tracepoints that mark the
+ *phases of the parsing and of the styling.
+ */
+
+#ifndef __CR_TRACE_H__
+#define __CR_TRACE_H__
+
+#include <glib.h>
+#include "cr-utils.h"
+
+G_BEGIN_DECLS
+
+/**
+ *The tracepoints. Each one is also a USDT probe of the
+ *"libcroco" provider when the library is built with
+ *--enable-sdt, named as given below.
+ */
+enum CRTracePoint {
+        /*
+         *parse__begin, parse__end: cr_parser_parse().
+         *begin: the byte offset the parsing starts at, 0.
+         *end: the byte offset it ends at, the status.
+         */
+        CR_TRACE_PARSE_BEGIN,
+        CR_TRACE_PARSE_END,
+        /*
+         *statement__begin, statement__end: the parsing of a
+         *ruleset or an at-rule. The rulesets of an @media rule
+         *are nested in it.
+         *begin: the byte offset of the statement, its
+         *enum CRStatementType.
+         *end: the byte offset it ends at, the status.
+         */
+        CR_TRACE_STATEMENT_BEGIN,
+        CR_TRACE_STATEMENT_END,
+        /*
+         *match__begin, match__end: the lookup of the rulesets
+         *an element matches.
+         *begin: the line of the element, 0.
+         *end: the line of the element, the number of
+         *rulesets matched.
+         */
+        CR_TRACE_MATCH_BEGIN,
+        CR_TRACE_MATCH_END,
+        /*
+         *cascade__begin, cascade__end: the building of a style
+         *or of a property list from the declarations elected by
+         *the cascade.
+         *begin: the number of declarations, 0.
+         *end: the number of declarations handled, the status.
+         */
+        CR_TRACE_CASCADE_BEGIN,
+        CR_TRACE_CASCADE_END,
+        /*
+         *decl__begin, decl__end: cr_style_set_style_from_decl().
+         *begin: the enum CRPropertyID of the declaration, the
+         *byte offset of the declaration in its stylesheet.
+         *end: the enum CRPropertyID, the status.
+         */
+        CR_TRACE_DECL_BEGIN,
+        CR_TRACE_DECL_END,
+        CR_TRACE_NB_POINTS
+};
+
+/**
+ *The function called at each tracepoint,
+ *see cr_trace_set_handler().
+ *@param a_point the tracepoint.
+ *@param a_arg0 the first argument of the tracepoint.
+ *@param a_arg1 the second argument of the tracepoint.
+ *@param a_user_data the user data given to cr_trace_set_handler().
+ */
+typedef void (*CRTraceHandler) (enum CRTracePoint a_point,
+                                guint64 a_arg0, guint64 a_arg1,
+                                gpointer a_user_data) ;
+
+enum CRStatus cr_trace_set_handler (CRTraceHandler a_handler,
+                                    gpointer a_user_data) ;
+
+const gchar * cr_trace_point_to_string (enum CRTracePoint a_point) ;
+
+G_END_DECLS
+
+#endif /*__CR_TRACE_H__*/
@@ -21,6 +21,7 @@
  * See COPYRIGHTS file for copyright information.
  */
 
+#include <string.h>
 #include "cr-utils.h"
 #include "cr-string.h"
 
@@ -862,10 +863,92 @@ cr_utils_ucs4_str_to_utf8 (const guint32 * a_in,
         return status;
 }
 
+/*
+ *The transcoders below copy the runs of ascii characters a
+ *machine word at a time: a word of input which bytes, masked with
+ *the pattern of the encoding, are all zero only holds ascii
+ *characters. The patterns are byte arrays loaded the same way as the
+ *input, so that they do not depend on the byte order of the host.
+ */
+#define CR_WORD_SIZE sizeof (guint64)
+
+static const guchar gv_ucs1_ascii_mask[CR_WORD_SIZE] = {
+        0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+};
+
+static const guchar gv_utf16le_ascii_mask[CR_WORD_SIZE] = {
+        0x80, 0xFF, 0x80, 0xFF, 0x80, 0xFF, 0x80, 0xFF
+};
+
+static const guchar gv_utf16be_ascii_mask[CR_WORD_SIZE] = {
+        0xFF, 0x80, 0xFF, 0x80, 0xFF, 0x80, 0xFF, 0x80
+};
+
+static const guchar gv_ucs4le_ascii_mask[CR_WORD_SIZE] = {
+        0x80, 0xFF, 0xFF, 0xFF, 0x80, 0xFF, 0xFF, 0xFF
+};
+
+static const guchar gv_ucs4be_ascii_mask[CR_WORD_SIZE] = {
+        0xFF, 0xFF, 0xFF, 0x80, 0xFF, 0xFF, 0xFF, 0x80
+};
+
+/**
+ *@return TRUE if the CR_WORD_SIZE bytes at a_in
+ *only hold ascii characters, given the mask of their encoding.
+ */
+static gboolean
+word_is_ascii (const guchar * a_in, const guchar * a_mask)
+{
+        guint64 word = 0,
+                mask = 0;
+
+        memcpy (&word, a_in, CR_WORD_SIZE);
+        memcpy (&mask, a_mask, CR_WORD_SIZE);
+        return (word & mask) == 0;
+}
+
+/**
+ *Writes the utf8 encoding of a character, if it fits.
+ *@param a_char the character. Must be a valid unicode scalar value.
+ *@param a_out where to write the encoding.
+ *@param a_out_len the number of bytes available at a_out.
+ *@return the number of bytes written, or 0 if there was
+ *not enough room.
+ */
+static gulong
+put_utf8_char (guint32 a_char, guchar * a_out, gulong a_out_len)
+{
+        if (a_char <= 0x7F) {
+                if (a_out_len < 1)
+                        return 0;
+                a_out[0] = a_char;
+                return 1;
+        } else if (a_char <= 0x7FF) {
+                if (a_out_len < 2)
+                        return 0;
+                a_out[0] = 0xC0 | (a_char >> 6);
+                a_out[1] = 0x80 | (a_char & 0x3F);
+                return 2;
+        } else if (a_char <= 0xFFFF) {
+                if (a_out_len < 3)
+                        return 0;
+                a_out[0] = 0xE0 | (a_char >> 12);
+                a_out[1] = 0x80 | ((a_char >> 6) & 0x3F);
+                a_out[2] = 0x80 | (a_char & 0x3F);
+                return 3;
+        }
+        if (a_out_len < 4)
+                return 0;
+        a_out[0] = 0xF0 | (a_char >> 18);
+        a_out[1] = 0x80 | ((a_char >> 12) & 0x3F);
+        a_out[2] = 0x80 | ((a_char >> 6) & 0x3F);
+        a_out[3] = 0x80 | (a_char & 0x3F);
+        return 4;
+}
+
 /**
  *Converts an ucs1 buffer into an utf8 buffer.
- *The caller must know the size of the resulting buffer and
- *allocate it prior to calling this function.
+ *The ascii parts of the input are copied a word at a time.
  *
  *@param a_in the input ucs1 buffer.
  *
@@ -905,22 +988,30 @@ cr_utils_ucs1_to_utf8 (const guchar * a_in,
         in_len = *a_in_len;
         out_len = *a_out_len;
 
-        for (in_index = 0, out_index = 0;
-             (in_index < in_len) && (out_index < out_len); in_index++) {
-                /*
-                 *FIXME: return whenever we encounter forbidden char values.
-                 */
-
+        while (in_index < in_len && out_index < out_len) {
+                if (in_len - in_index >= CR_WORD_SIZE
+                    && out_len - out_index >= CR_WORD_SIZE
+                    && word_is_ascii (&a_in[in_index],
+                                      gv_ucs1_ascii_mask)) {
+                        memcpy (&a_out[out_index], &a_in[in_index],
+                                CR_WORD_SIZE);
+                        in_index += CR_WORD_SIZE;
+                        out_index += CR_WORD_SIZE;
+                        continue;
+                }
                 if (a_in[in_index] <= 0x7F) {
                         a_out[out_index] = a_in[in_index];
                         out_index++;
                 } else {
+                        if (out_len - out_index < 2)
+                                break;
                         a_out[out_index] = (0xC0 | (a_in[in_index] >> 6));
                         a_out[out_index + 1] =
                                 (0x80 | (a_in[in_index] & 0x3F));
                         out_index += 2;
                 }
-        }                       /*end for */
+                in_index++;
+        }
 
         *a_in_len = in_index;
         *a_out_len = out_index;
@@ -928,6 +1019,217 @@ cr_utils_ucs1_to_utf8 (const guchar * a_in,
         return status;
 }
 
+/**
+ *Converts an utf16 buffer into an utf8 buffer.
+ *@param a_big_endian TRUE if the input is utf16be, FALSE
+ *if it is utf16le.
+ *See cr_utils_utf16le_to_utf8 () for the other parameters.
+ */
+static enum CRStatus
+utf16_to_utf8 (const guchar * a_in, gulong * a_in_len,
+               guchar * a_out, gulong * a_out_len,
+               gboolean a_big_endian)
+{
+        const guchar *mask = a_big_endian ?
+                gv_utf16be_ascii_mask : gv_utf16le_ascii_mask;
+        gulong in_index = 0,
+                in_len = 0,
+                out_index = 0,
+                out_len = 0,
+                written = 0,
+                i = 0;
+        guint hi = a_big_endian ? 0 : 1,
+                lo = a_big_endian ? 1 : 0;
+        guint32 c = 0,
+                c2 = 0;
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_in && a_in_len && a_out && a_out_len,
+                              CR_BAD_PARAM_ERROR);
+
+        in_len = *a_in_len;
+        out_len = *a_out_len;
+
+        while (in_len - in_index >= 2) {
+                if (in_len - in_index >= CR_WORD_SIZE
+                    && out_len - out_index >= CR_WORD_SIZE / 2
+                    && word_is_ascii (&a_in[in_index], mask)) {
+                        for (i = 0; i < CR_WORD_SIZE / 2; i++) {
+                                a_out[out_index + i] =
+                                        a_in[in_index + 2 * i + lo];
+                        }
+                        in_index += CR_WORD_SIZE;
+                        out_index += CR_WORD_SIZE / 2;
+                        continue;
+                }
+                c = (a_in[in_index + hi] << 8) | a_in[in_index + lo];
+                if (c >= 0xDC00 && c <= 0xDFFF) {
+                        /*a low surrogate that follows no high surrogate */
+                        status = CR_ENCODING_ERROR;
+                        break;
+                }
+                if (c >= 0xD800 && c <= 0xDBFF) {
+                        /*wait for the low surrogate of the pair */
+                        if (in_len - in_index < 4)
+                                break;
+                        c2 = (a_in[in_index + 2 + hi] << 8)
+                                | a_in[in_index + 2 + lo];
+                        if (c2 < 0xDC00 || c2 > 0xDFFF) {
+                                status = CR_ENCODING_ERROR;
+                                break;
+                        }
+                        c = 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+                }
+                written = put_utf8_char (c, &a_out[out_index],
+                                         out_len - out_index);
+                if (!written)
+                        break;
+                out_index += written;
+                in_index += c > 0xFFFF ? 4 : 2;
+        }
+
+        *a_in_len = in_index;
+        *a_out_len = out_index;
+        return status;
+}
+
+/**
+ *Converts an utf16le buffer into an utf8 buffer.
+ *The ascii parts of the input are converted a word at a time.
+ *
+ *@param a_in the input utf16le buffer.
+ *@param a_in_len in/out parameter. The length of the input buffer,
+ *in bytes. After return, points to the number of bytes actually
+ *consumed. A trailing incomplete character is not consumed.
+ *@param a_out out parameter. The output utf8 converted buffer.
+ *@param a_out_len in/out parameter. The size of the output buffer.
+ *If it is shorter than the actual needed size, this function just
+ *converts what it can. After return, points to the number of
+ *bytes written.
+ *@return CR_OK upon successfull completion, CR_ENCODING_ERROR if the
+ *input holds an unpaired surrogate, an error code otherwise.
+ */
+enum CRStatus
+cr_utils_utf16le_to_utf8 (const guchar * a_in, gulong * a_in_len,
+                          guchar * a_out, gulong * a_out_len)
+{
+        return utf16_to_utf8 (a_in, a_in_len, a_out, a_out_len, FALSE);
+}
+
+/**
+ *Converts an utf16be buffer into an utf8 buffer.
+ *See cr_utils_utf16le_to_utf8 ().
+ */
+enum CRStatus
+cr_utils_utf16be_to_utf8 (const guchar * a_in, gulong * a_in_len,
+                          guchar * a_out, gulong * a_out_len)
+{
+        return utf16_to_utf8 (a_in, a_in_len, a_out, a_out_len, TRUE);
+}
+
+/**
+ *Converts an ucs4 byte buffer into an utf8 buffer.
+ *@param a_big_endian TRUE if the input is big endian.
+ *See cr_utils_ucs4le_to_utf8 () for the other parameters.
+ */
+static enum CRStatus
+ucs4_bytes_to_utf8 (const guchar * a_in, gulong * a_in_len,
+                    guchar * a_out, gulong * a_out_len,
+                    gboolean a_big_endian)
+{
+        const guchar *mask = a_big_endian ?
+                gv_ucs4be_ascii_mask : gv_ucs4le_ascii_mask;
+        gulong in_index = 0,
+                in_len = 0,
+                out_index = 0,
+                out_len = 0,
+                written = 0;
+        guint32 c = 0;
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_in && a_in_len && a_out && a_out_len,
+                              CR_BAD_PARAM_ERROR);
+
+        in_len = *a_in_len;
+        out_len = *a_out_len;
+
+        while (in_len - in_index >= 4) {
+                if (in_len - in_index >= CR_WORD_SIZE
+                    && out_len - out_index >= 2
+                    && word_is_ascii (&a_in[in_index], mask)) {
+                        a_out[out_index] =
+                                a_in[in_index + (a_big_endian ? 3 : 0)];
+                        a_out[out_index + 1] =
+                                a_in[in_index + (a_big_endian ? 7 : 4)];
+                        in_index += CR_WORD_SIZE;
+                        out_index += 2;
+                        continue;
+                }
+                if (a_big_endian) {
+                        c = (a_in[in_index] << 24)
+                                | (a_in[in_index + 1] << 16)
+                                | (a_in[in_index + 2] << 8)
+                                | a_in[in_index + 3];
+                } else {
+                        c = (a_in[in_index + 3] << 24)
+                                | (a_in[in_index + 2] << 16)
+                                | (a_in[in_index + 1] << 8)
+                                | a_in[in_index];
+                }
+                if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+                        status = CR_ENCODING_ERROR;
+                        break;
+                }
+                written = put_utf8_char (c, &a_out[out_index],
+                                         out_len - out_index);
+                if (!written)
+                        break;
+                out_index += written;
+                in_index += 4;
+        }
+
+        *a_in_len = in_index;
+        *a_out_len = out_index;
+        return status;
+}
+
+/**
+ *Converts an ucs4le byte buffer into an utf8 buffer.
+ *The ascii parts of the input are converted a word at a time.
+ *
+ *@param a_in the input ucs4le buffer.
+ *@param a_in_len in/out parameter. The length of the input buffer,
+ *in bytes. After return, points to the number of bytes actually
+ *consumed. A trailing incomplete character is not consumed.
+ *@param a_out out parameter. The output utf8 converted buffer.
+ *@param a_out_len in/out parameter. The size of the output buffer.
+ *If it is shorter than the actual needed size, this function just
+ *converts what it can. After return, points to the number of
+ *bytes written.
+ *@return CR_OK upon successfull completion, CR_ENCODING_ERROR if the
+ *input holds something else than unicode scalar values, an error
+ *code otherwise.
+ */
+enum CRStatus
+cr_utils_ucs4le_to_utf8 (const guchar * a_in, gulong * a_in_len,
+                         guchar * a_out, gulong * a_out_len)
+{
+        return ucs4_bytes_to_utf8 (a_in, a_in_len, a_out, a_out_len,
+                                   FALSE);
+}
+
+/**
+ *Converts an ucs4be byte buffer into an utf8 buffer.
+ *See cr_utils_ucs4le_to_utf8 ().
+ */
+enum CRStatus
+cr_utils_ucs4be_to_utf8 (const guchar * a_in, gulong * a_in_len,
+                         guchar * a_out, gulong * a_out_len)
+{
+        return ucs4_bytes_to_utf8 (a_in, a_in_len, a_out, a_out_len,
+                                   TRUE);
+}
+
 /**
  *Converts an ucs1 string into an utf8 string.
  *@param a_in_start the beginning of the input string to convert.
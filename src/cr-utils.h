@@ -65,7 +65,9 @@ enum CRStatus {
         CR_BAD_PSEUDO_CLASS_SEL_HANDLER_ERROR,
         CR_ERROR,
         CR_FILE_NOT_FOUND_ERROR,
-        CR_VALUE_NOT_FOUND_ERROR
+        CR_VALUE_NOT_FOUND_ERROR,
+        CR_LIMIT_EXCEEDED_ERROR,
+        CR_CANCELLED_ERROR
 } ;
 
 /**
@@ -151,6 +153,22 @@ enum CRStatus
 cr_utils_ucs1_to_utf8 (const guchar *a_in, gulong *a_in_len,
                        guchar *a_out, gulong *a_out_len) ;
 
+enum CRStatus
+cr_utils_utf16le_to_utf8 (const guchar *a_in, gulong *a_in_len,
+                          guchar *a_out, gulong *a_out_len) ;
+
+enum CRStatus
+cr_utils_utf16be_to_utf8 (const guchar *a_in, gulong *a_in_len,
+                          guchar *a_out, gulong *a_out_len) ;
+
+enum CRStatus
+cr_utils_ucs4le_to_utf8 (const guchar *a_in, gulong *a_in_len,
+                         guchar *a_out, gulong *a_out_len) ;
+
+enum CRStatus
+cr_utils_ucs4be_to_utf8 (const guchar *a_in, gulong *a_in_len,
+                         guchar *a_out, gulong *a_out_len) ;
+
 enum CRStatus
 cr_utils_utf8_to_ucs1 (const guchar * a_in, gulong * a_in_len,
                        guchar *a_out, gulong *a_out_len) ;
@@ -40,5 +40,9 @@
 #include "cr-sel-eng.h"
 #include "cr-style.h"
 #include "cr-string.h"
+#include "cr-stats.h"
+#include "cr-trace.h"
+#include "cr-allocator.h"
+#include "cr-limits.h"
 
 #endif /*__LIBCROCO_H__*/
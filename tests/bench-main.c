@@ -0,0 +1,594 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libcroco.h"
+#include "cr-bench-gen.h"
+
+/**
+ *@file
+ *The benchmarks of libcroco. Each stage of the library, from
+ *the decoding of the input to the styling of a document, is run
+ *on a small generated corpus (the micro benchmarks) and on a large
+ *one (the macro benchmarks). The timings are written in json.
+ */
+
+/**
+ *The options of the benchmark program.
+ */
+struct BenchOptions {
+        gboolean display_help;
+        struct CRBenchGenParams params;
+        gdouble min_time;
+        guint min_samples;
+        const gchar *filter;
+        const gchar *output_path;
+};
+
+/**
+ *A generated corpus, and what the benchmarks
+ *build from it before being timed.
+ */
+struct BenchCorpus {
+        const gchar *name;
+        struct CRBenchGenParams params;
+        GString *sheet_text;
+        GString *doc_text;
+        /*the sheet, encoded in utf16 with a byte order mark*/
+        guchar *sheet_utf16;
+        gulong sheet_utf16_len;
+        CRStyleSheet *sheet;
+        CRCascade *cascade;
+        CRSelEng *sel_eng;
+        xmlDoc *doc;
+        GPtrArray *elements;
+};
+
+/**
+ *A benchmark runs one stage over a corpus once,
+ *and returns the number of items it processed.
+ */
+typedef gulong (*BenchFunc) (struct BenchCorpus *a_corpus);
+
+struct Bench {
+        const gchar *name;
+        /*the kind of items the function returns the number of*/
+        const gchar *unit;
+        BenchFunc func;
+};
+
+static gulong bench_input_decode (struct BenchCorpus *a_corpus);
+
+static gulong bench_input_decode_streaming (struct BenchCorpus *a_corpus);
+
+static gulong bench_tknzr_next_token (struct BenchCorpus *a_corpus);
+
+static gulong bench_parser_parse_buf (struct BenchCorpus *a_corpus);
+
+static gulong bench_om_parser_parse_buf (struct BenchCorpus *a_corpus);
+
+static gulong bench_sel_eng_matched_rulesets (struct BenchCorpus *a_corpus);
+
+static gulong bench_sel_eng_matched_style (struct BenchCorpus *a_corpus);
+
+static gulong bench_statement_to_string (struct BenchCorpus *a_corpus);
+
+static const struct Bench gv_benches[] = {
+        {"input.decode_utf16", "chars", bench_input_decode},
+        {"input.decode_utf16_streaming", "chars",
+         bench_input_decode_streaming},
+        {"tknzr.get_next_token", "tokens", bench_tknzr_next_token},
+        {"parser.parse_buf", "bytes", bench_parser_parse_buf},
+        {"om_parser.parse_buf", "bytes", bench_om_parser_parse_buf},
+        {"sel_eng.get_matched_rulesets", "elements",
+         bench_sel_eng_matched_rulesets},
+        {"sel_eng.get_matched_style", "elements",
+         bench_sel_eng_matched_style},
+        {"statement.to_string", "statements", bench_statement_to_string}
+};
+
+static void
+display_help (char *prg_name)
+{
+        g_print ("\n\n");
+        g_print ("usage: %s [options]\n", prg_name);
+        g_print ("\t--rulesets <n>: the number of rulesets of the large sheet\n");
+        g_print ("\t--decls <n>: the number of declarations per ruleset\n");
+        g_print ("\t--elements <n>: the number of elements of the large document\n");
+        g_print ("\t--depth <n>: the depth of the large document\n");
+        g_print ("\t--sel-mix <type>,<class>,<id>,<attr>,<pseudo>: the weights\n"
+                 "\t\tof the kinds of simple selectors\n");
+        g_print ("\t--combinators <percent>: how often selectors are combined\n");
+        g_print ("\t--seed <n>: the seed of the corpus generators\n");
+        g_print ("\t--min-time <seconds>: the minimum time spent per benchmark\n");
+        g_print ("\t--min-samples <n>: the minimum number of samples per benchmark\n");
+        g_print ("\t--filter <string>: only run the benchmarks which name contains it\n");
+        g_print ("\t--output <file>: where to write the json results (stdout by default)\n");
+        g_print ("\n\n");
+}
+
+/**
+ *Parses the command line.
+ *@return FALSE if the command line is not valid.
+ */
+static gboolean
+parse_command_line (int a_argc, char **a_argv, struct BenchOptions *a_options)
+{
+        int i = 0;
+        gchar **mix = NULL;
+        guint j = 0;
+
+        memset (a_options, 0, sizeof (struct BenchOptions));
+        cr_bench_gen_params_set_defaults (&a_options->params);
+        a_options->min_time = 0.5;
+        a_options->min_samples = 3;
+
+        for (i = 1; i < a_argc; i++) {
+                if (!strcmp (a_argv[i], "-h")
+                    || !strcmp (a_argv[i], "--help")) {
+                        a_options->display_help = TRUE;
+                        continue;
+                }
+                if (i + 1 >= a_argc)
+                        return FALSE;
+                if (!strcmp (a_argv[i], "--rulesets")) {
+                        a_options->params.nb_rulesets = atoi (a_argv[++i]);
+                } else if (!strcmp (a_argv[i], "--decls")) {
+                        a_options->params.nb_decls = atoi (a_argv[++i]);
+                } else if (!strcmp (a_argv[i], "--elements")) {
+                        a_options->params.nb_elements = atoi (a_argv[++i]);
+                } else if (!strcmp (a_argv[i], "--depth")) {
+                        a_options->params.max_depth = atoi (a_argv[++i]);
+                } else if (!strcmp (a_argv[i], "--sel-mix")) {
+                        mix = g_strsplit (a_argv[++i], ",", 0);
+                        for (j = 0; mix[j] && j < NB_BENCH_SEL_KINDS; j++) {
+                                a_options->params.sel_mix[j] = atoi (mix[j]);
+                        }
+                        g_strfreev (mix);
+                        if (j != NB_BENCH_SEL_KINDS)
+                                return FALSE;
+                } else if (!strcmp (a_argv[i], "--combinators")) {
+                        a_options->params.combinator_pct = atoi (a_argv[++i]);
+                } else if (!strcmp (a_argv[i], "--seed")) {
+                        a_options->params.seed = strtoul (a_argv[++i],
+                                                          NULL, 10);
+                } else if (!strcmp (a_argv[i], "--min-time")) {
+                        a_options->min_time = g_ascii_strtod (a_argv[++i],
+                                                              NULL);
+                } else if (!strcmp (a_argv[i], "--min-samples")) {
+                        a_options->min_samples = atoi (a_argv[++i]);
+                } else if (!strcmp (a_argv[i], "--filter")) {
+                        a_options->filter = a_argv[++i];
+                } else if (!strcmp (a_argv[i], "--output")) {
+                        a_options->output_path = a_argv[++i];
+                } else {
+                        return FALSE;
+                }
+        }
+        if (!a_options->min_samples)
+                a_options->min_samples = 1;
+        return TRUE;
+}
+
+static gulong
+read_all_chars (CRInput * a_input)
+{
+        guint32 c = 0;
+        gulong result = 0;
+
+        while (cr_input_read_char (a_input, &c) == CR_OK) {
+                result++;
+        }
+        cr_input_destroy (a_input);
+        return result;
+}
+
+static gulong
+bench_input_decode (struct BenchCorpus *a_corpus)
+{
+        return read_all_chars (cr_input_new_from_buf
+                               (a_corpus->sheet_utf16,
+                                a_corpus->sheet_utf16_len,
+                                CR_AUTO, FALSE));
+}
+
+static gulong
+bench_input_decode_streaming (struct BenchCorpus *a_corpus)
+{
+        return read_all_chars (cr_input_new_from_buf_streaming
+                               (a_corpus->sheet_utf16,
+                                a_corpus->sheet_utf16_len,
+                                CR_AUTO, FALSE));
+}
+
+static gulong
+bench_tknzr_next_token (struct BenchCorpus *a_corpus)
+{
+        CRTknzr *tknzr = NULL;
+        CRToken *token = NULL;
+        gulong result = 0;
+
+        tknzr = cr_tknzr_new_from_buf ((guchar *) a_corpus->sheet_text->str,
+                                       a_corpus->sheet_text->len,
+                                       CR_UTF_8, FALSE);
+        while (cr_tknzr_get_next_token (tknzr, &token) == CR_OK && token) {
+                cr_token_destroy (token);
+                token = NULL;
+                result++;
+        }
+        cr_tknzr_destroy (tknzr);
+        return result;
+}
+
+static gulong
+bench_parser_parse_buf (struct BenchCorpus *a_corpus)
+{
+        CRParser *parser = NULL;
+
+        /*no sac handler: only the grammar is checked*/
+        parser = cr_parser_new (NULL);
+        cr_parser_parse_buf (parser, (const guchar *) a_corpus->sheet_text->str,
+                             a_corpus->sheet_text->len, CR_UTF_8);
+        cr_parser_destroy (parser);
+        return a_corpus->sheet_text->len;
+}
+
+static gulong
+bench_om_parser_parse_buf (struct BenchCorpus *a_corpus)
+{
+        CROMParser *parser = NULL;
+        CRStyleSheet *sheet = NULL;
+
+        parser = cr_om_parser_new (NULL);
+        cr_om_parser_parse_buf (parser,
+                                (const guchar *) a_corpus->sheet_text->str,
+                                a_corpus->sheet_text->len, CR_UTF_8, &sheet);
+        if (sheet)
+                cr_stylesheet_destroy (sheet);
+        cr_om_parser_destroy (parser);
+        return a_corpus->sheet_text->len;
+}
+
+static gulong
+bench_sel_eng_matched_rulesets (struct BenchCorpus *a_corpus)
+{
+        CRStatement **rulesets = NULL;
+        gulong len = 0;
+        guint i = 0;
+
+        for (i = 0; i < a_corpus->elements->len; i++) {
+                rulesets = NULL;
+                cr_sel_eng_get_matched_rulesets
+                        (a_corpus->sel_eng, a_corpus->sheet,
+                         g_ptr_array_index (a_corpus->elements, i),
+                         &rulesets, &len);
+                g_free (rulesets);
+        }
+        return a_corpus->elements->len;
+}
+
+/**
+ *Computes the style of an element and of its descendants.
+ *@return the number of elements styled.
+ */
+static gulong
+style_subtree (struct BenchCorpus *a_corpus, xmlNode * a_node,
+               CRStyle * a_parent_style)
+{
+        CRStyle *style = NULL;
+        xmlNode *cur = NULL;
+        gulong result = 1;
+
+        cr_sel_eng_get_matched_style (a_corpus->sel_eng, a_corpus->cascade,
+                                      a_node, a_parent_style, &style,
+                                      FALSE);
+        for (cur = a_node->children; cur; cur = cur->next) {
+                if (cur->type == XML_ELEMENT_NODE) {
+                        result += style_subtree (a_corpus, cur,
+                                                 style ? style :
+                                                 a_parent_style);
+                }
+        }
+        if (style)
+                cr_style_destroy (style);
+        return result;
+}
+
+static gulong
+bench_sel_eng_matched_style (struct BenchCorpus *a_corpus)
+{
+        return style_subtree (a_corpus, xmlDocGetRootElement (a_corpus->doc),
+                              NULL);
+}
+
+static gulong
+bench_statement_to_string (struct BenchCorpus *a_corpus)
+{
+        CRStatement *cur = NULL;
+        gchar *str = NULL;
+        gulong result = 0;
+
+        for (cur = a_corpus->sheet->statements; cur; cur = cur->next) {
+                str = cr_statement_to_string (cur, 0);
+                g_free (str);
+                result++;
+        }
+        return result;
+}
+
+static void
+collect_elements (xmlNode * a_node, GPtrArray * a_elements)
+{
+        xmlNode *cur = NULL;
+
+        for (cur = a_node; cur; cur = cur->next) {
+                if (cur->type == XML_ELEMENT_NODE) {
+                        g_ptr_array_add (a_elements, cur);
+                        collect_elements (cur->children, a_elements);
+                }
+        }
+}
+
+/**
+ *Generates a corpus and builds what the benchmarks need from it.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+corpus_init (struct BenchCorpus *a_corpus, const gchar * a_name,
+             struct CRBenchGenParams const *a_params)
+{
+        enum CRStatus status = CR_OK;
+        gulong i = 0;
+        guint16 unit = 0;
+
+        memset (a_corpus, 0, sizeof (struct BenchCorpus));
+        a_corpus->name = a_name;
+        a_corpus->params = *a_params;
+        a_corpus->sheet_text = cr_bench_gen_sheet (a_params);
+        a_corpus->doc_text = cr_bench_gen_document (a_params);
+
+        /*the sheet is ascii, which makes its utf16 encoding easy*/
+        a_corpus->sheet_utf16_len = 2 * (a_corpus->sheet_text->len + 1);
+        a_corpus->sheet_utf16 = g_malloc (a_corpus->sheet_utf16_len);
+        a_corpus->sheet_utf16[0] = 0xFF;
+        a_corpus->sheet_utf16[1] = 0xFE;
+        for (i = 0; i < a_corpus->sheet_text->len; i++) {
+                unit = (guchar) a_corpus->sheet_text->str[i];
+                a_corpus->sheet_utf16[2 * i + 2] = unit & 0xFF;
+                a_corpus->sheet_utf16[2 * i + 3] = unit >> 8;
+        }
+
+        status = cr_om_parser_simply_parse_buf
+                ((const guchar *) a_corpus->sheet_text->str,
+                 a_corpus->sheet_text->len, CR_UTF_8, &a_corpus->sheet);
+        if (status != CR_OK || !a_corpus->sheet)
+                return CR_ERROR;
+        a_corpus->cascade = cr_cascade_new (a_corpus->sheet, NULL, NULL);
+        a_corpus->sel_eng = cr_sel_eng_new ();
+
+        a_corpus->doc = xmlParseMemory (a_corpus->doc_text->str,
+                                        a_corpus->doc_text->len);
+        if (!a_corpus->cascade || !a_corpus->sel_eng || !a_corpus->doc)
+                return CR_ERROR;
+        a_corpus->elements = g_ptr_array_new ();
+        collect_elements (xmlDocGetRootElement (a_corpus->doc),
+                          a_corpus->elements);
+        return CR_OK;
+}
+
+static void
+corpus_clear (struct BenchCorpus *a_corpus)
+{
+        if (a_corpus->elements)
+                g_ptr_array_free (a_corpus->elements, TRUE);
+        if (a_corpus->doc)
+                xmlFreeDoc (a_corpus->doc);
+        if (a_corpus->sel_eng)
+                cr_sel_eng_destroy (a_corpus->sel_eng);
+        if (a_corpus->cascade)
+                cr_cascade_destroy (a_corpus->cascade);
+        else if (a_corpus->sheet)
+                cr_stylesheet_destroy (a_corpus->sheet);
+        g_free (a_corpus->sheet_utf16);
+        if (a_corpus->doc_text)
+                g_string_free (a_corpus->doc_text, TRUE);
+        if (a_corpus->sheet_text)
+                g_string_free (a_corpus->sheet_text, TRUE);
+        memset (a_corpus, 0, sizeof (struct BenchCorpus));
+}
+
+static void
+write_corpus_json (FILE * a_out, struct BenchCorpus *a_corpus)
+{
+        fprintf (a_out,
+                 "    \"%s\": {\"rulesets\": %u, \"decls\": %u, "
+                 "\"elements\": %u, \"depth\": %u, "
+                 "\"sel_mix\": [%u, %u, %u, %u, %u], "
+                 "\"combinators\": %u, \"sheet_bytes\": %lu, "
+                 "\"statements\": %lu, \"doc_elements\": %u}",
+                 a_corpus->name, a_corpus->params.nb_rulesets,
+                 a_corpus->params.nb_decls, a_corpus->params.nb_elements,
+                 a_corpus->params.max_depth,
+                 a_corpus->params.sel_mix[BENCH_SEL_TYPE],
+                 a_corpus->params.sel_mix[BENCH_SEL_CLASS],
+                 a_corpus->params.sel_mix[BENCH_SEL_ID],
+                 a_corpus->params.sel_mix[BENCH_SEL_ATTR],
+                 a_corpus->params.sel_mix[BENCH_SEL_PSEUDO],
+                 a_corpus->params.combinator_pct,
+                 (gulong) a_corpus->sheet_text->len,
+                 (gulong) cr_stylesheet_nr_rules (a_corpus->sheet),
+                 a_corpus->elements->len);
+}
+
+static int
+compare_doubles (gconstpointer a_a, gconstpointer a_b)
+{
+        gdouble a = *(const gdouble *) a_a,
+                b = *(const gdouble *) a_b;
+
+        return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+/**
+ *The minimum duration of a sample, in microseconds. Quicker
+ *benchmarks are run several times per sample, so that the
+ *resolution of the clock does not matter.
+ */
+#define BENCH_MIN_SAMPLE_TIME 2000
+
+/**
+ *Runs a benchmark until it ran for a_options->min_time seconds and
+ *at least a_options->min_samples times, and writes its results.
+ */
+static void
+run_bench (FILE * a_out, struct Bench const *a_bench,
+           struct BenchCorpus *a_corpus, struct BenchOptions *a_options,
+           gboolean a_first)
+{
+        GArray *samples = NULL;
+        gdouble total = 0.0,
+                elapsed = 0.0,
+                median = 0.0;
+        gint64 start = 0;
+        gulong items = 0;
+        guint batch = 1,
+                i = 0;
+
+        samples = g_array_new (FALSE, FALSE, sizeof (gdouble));
+        /*
+         *the first runs, not timed, warm the caches up and
+         *find out how many runs a sample needs.
+         */
+        for (;;) {
+                start = g_get_monotonic_time ();
+                for (i = 0; i < batch; i++) {
+                        a_bench->func (a_corpus);
+                }
+                if (g_get_monotonic_time () - start >= BENCH_MIN_SAMPLE_TIME
+                    || batch >= 1 << 20)
+                        break;
+                batch *= 2;
+        }
+        while (samples->len < a_options->min_samples
+               || total < a_options->min_time) {
+                start = g_get_monotonic_time ();
+                for (i = 0; i < batch; i++) {
+                        items = a_bench->func (a_corpus);
+                }
+                elapsed = (g_get_monotonic_time () - start) / 1e6 / batch;
+                g_array_append_val (samples, elapsed);
+                total += elapsed * batch;
+        }
+        g_array_sort (samples, compare_doubles);
+        median = g_array_index (samples, gdouble, samples->len / 2);
+        if (!(samples->len % 2)) {
+                median = (median + g_array_index (samples, gdouble,
+                                                  samples->len / 2 - 1)) / 2;
+        }
+
+        fprintf (a_out,
+                 "%s    {\"name\": \"%s\", \"corpus\": \"%s\", "
+                 "\"samples\": %u, \"runs_per_sample\": %u, "
+                 "\"items\": %lu, \"unit\": \"%s\", "
+                 "\"min_s\": %.9f, \"median_s\": %.9f, \"mean_s\": %.9f, "
+                 "\"items_per_s\": %.1f}",
+                 a_first ? "" : ",\n", a_bench->name, a_corpus->name,
+                 samples->len, batch, items, a_bench->unit,
+                 g_array_index (samples, gdouble, 0), median,
+                 total / (samples->len * batch),
+                 median > 0.0 ? items / median : 0.0);
+        fflush (a_out);
+        g_array_free (samples, TRUE);
+}
+
+int
+main (int argc, char **argv)
+{
+        struct BenchOptions options;
+        struct CRBenchGenParams micro_params;
+        struct BenchCorpus corpora[2];
+        FILE *out = stdout;
+        guint i = 0,
+                j = 0;
+        gboolean first = TRUE;
+        int result = 0;
+
+        if (parse_command_line (argc, argv, &options) == FALSE) {
+                display_help (argv[0]);
+                return 1;
+        }
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        micro_params = options.params;
+        micro_params.nb_rulesets = 20;
+        micro_params.nb_elements = 50;
+        micro_params.max_depth = 6;
+        memset (corpora, 0, sizeof (corpora));
+        if (corpus_init (&corpora[0], "micro", &micro_params) != CR_OK
+            || corpus_init (&corpora[1], "macro", &options.params) != CR_OK) {
+                g_printerr ("could not build the benchmark corpus\n");
+                result = 1;
+                goto cleanup;
+        }
+
+        if (options.output_path) {
+                out = fopen (options.output_path, "w");
+                if (!out) {
+                        g_printerr ("could not open %s\n",
+                                    options.output_path);
+                        result = 1;
+                        goto cleanup;
+                }
+        }
+
+        fprintf (out, "{\n  \"libcroco_version\": \"%s\",\n"
+                 "  \"seed\": %u,\n  \"corpora\": {\n",
+                 LIBCROCO_VERSION, options.params.seed);
+        write_corpus_json (out, &corpora[0]);
+        fprintf (out, ",\n");
+        write_corpus_json (out, &corpora[1]);
+        fprintf (out, "\n  },\n  \"benchmarks\": [\n");
+        for (i = 0; i < G_N_ELEMENTS (corpora); i++) {
+                for (j = 0; j < G_N_ELEMENTS (gv_benches); j++) {
+                        if (options.filter
+                            && !strstr (gv_benches[j].name, options.filter))
+                                continue;
+                        run_bench (out, &gv_benches[j], &corpora[i],
+                                   &options, first);
+                        first = FALSE;
+                }
+        }
+        fprintf (out, "\n  ]\n}\n");
+        if (out != stdout)
+                fclose (out);
+
+ cleanup:
+        corpus_clear (&corpora[0]);
+        corpus_clear (&corpora[1]);
+        return result;
+}
@@ -0,0 +1,414 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information
+ */
+
+#include <string.h>
+#include "cr-bench-gen.h"
+
+/**
+ *@file
+ *The generators of the benchmark corpus. They do not use the
+ *glib random functions, which sequences may change between glib
+ *versions, so that a corpus stays the same from one release to
+ *the other.
+ */
+
+/**
+ *The element names of the documents, and of the type selectors.
+ */
+static const gchar *gv_element_names[] = {
+        "div", "p", "span", "a", "ul", "li", "em", "strong",
+        "h1", "h2", "table", "tr", "td", "img", "section", "pre"
+};
+
+static const gchar *gv_langs[] = {"en", "fr", "de", "en-US"};
+
+/**
+ *The shapes of the values of the declarations.
+ */
+enum BenchDeclShape {
+        /*value is the whole value*/
+        DECL_KEYWORDS,
+        /*a pseudo random number followed by the unit in value*/
+        DECL_NUMBER,
+        /*a pseudo random number, written as a #rrggbb color*/
+        DECL_NUMBER_COLOR,
+        /*a pseudo random width in the unit in value, and a color*/
+        DECL_BORDER
+};
+
+/**
+ *The declarations the rulesets are made of.
+ */
+static const struct BenchDecl {
+        const gchar *property;
+        enum BenchDeclShape shape;
+        const gchar *value;
+} gv_decls[] = {
+        {"color", DECL_NUMBER_COLOR, NULL},
+        {"background-color", DECL_NUMBER_COLOR, NULL},
+        {"margin-left", DECL_NUMBER, "px"},
+        {"margin-top", DECL_NUMBER, "em"},
+        {"padding-top", DECL_NUMBER, "pt"},
+        {"padding-right", DECL_NUMBER, "%"},
+        {"width", DECL_NUMBER, "%"},
+        {"height", DECL_NUMBER, "px"},
+        {"font-size", DECL_NUMBER, "px"},
+        {"font-family", DECL_KEYWORDS, "Verdana, Arial, sans-serif"},
+        {"font-weight", DECL_KEYWORDS, "bold"},
+        {"display", DECL_KEYWORDS, "block"},
+        {"float", DECL_KEYWORDS, "left"},
+        {"position", DECL_KEYWORDS, "relative"},
+        {"top", DECL_NUMBER, "px"},
+        {"border", DECL_BORDER, "px"},
+        {"border-top-width", DECL_NUMBER, "px"},
+        {"white-space", DECL_KEYWORDS, "nowrap"},
+        {"text-decoration", DECL_KEYWORDS, "underline"},
+        {"line-height", DECL_NUMBER, "%"}
+};
+
+/**
+ *Returns the next number of a xorshift pseudo random sequence.
+ *@param a_state the state of the sequence.
+ */
+static guint32
+next_rand (guint32 * a_state)
+{
+        guint32 x = *a_state;
+
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        *a_state = x;
+        return x;
+}
+
+/**
+ *Returns a pseudo random number lower than a_max.
+ */
+static guint
+rand_below (guint32 * a_state, guint a_max)
+{
+        if (!a_max)
+                return 0;
+        return next_rand (a_state) % a_max;
+}
+
+/**
+ *Initializes a pseudo random sequence. The sheet
+ *and the document use different sequences.
+ */
+static void
+init_rand (guint32 * a_state, guint32 a_seed, guint32 a_stream)
+{
+        guint i = 0;
+
+        *a_state = (a_seed ^ (a_stream * 0x9E3779B9u)) | 1;
+        for (i = 0; i < 8; i++) {
+                next_rand (a_state);
+        }
+}
+
+/**
+ *Appends a simple selector of a kind picked according to
+ *the selector mix of the parameters.
+ */
+static void
+append_simple_sel (GString * a_str, struct CRBenchGenParams const *a_params,
+                   guint32 * a_rand)
+{
+        guint i = 0,
+                total = 0,
+                pick = 0;
+        const gchar *name =
+                gv_element_names[rand_below
+                                 (a_rand,
+                                  G_N_ELEMENTS (gv_element_names))];
+
+        for (i = 0; i < NB_BENCH_SEL_KINDS; i++) {
+                total += a_params->sel_mix[i];
+        }
+        pick = rand_below (a_rand, total);
+        for (i = 0; i + 1 < NB_BENCH_SEL_KINDS; i++) {
+                if (pick < a_params->sel_mix[i])
+                        break;
+                pick -= a_params->sel_mix[i];
+        }
+
+        switch (i) {
+        case BENCH_SEL_TYPE:
+                g_string_append (a_str, name);
+                break;
+        case BENCH_SEL_CLASS:
+                if (rand_below (a_rand, 2))
+                        g_string_append (a_str, name);
+                g_string_append_printf (a_str, ".c%u",
+                                        rand_below (a_rand,
+                                                    a_params->nb_classes));
+                break;
+        case BENCH_SEL_ID:
+                g_string_append_printf (a_str, "#i%u",
+                                        rand_below (a_rand,
+                                                    a_params->nb_ids));
+                break;
+        case BENCH_SEL_ATTR:
+                if (rand_below (a_rand, 2)) {
+                        g_string_append (a_str, "a[href]");
+                } else {
+                        g_string_append_printf
+                                (a_str, "%s[lang=\"%s\"]", name,
+                                 gv_langs[rand_below
+                                          (a_rand,
+                                           G_N_ELEMENTS (gv_langs))]);
+                }
+                break;
+        default:
+                g_string_append_printf (a_str, "%s:first-child", name);
+                break;
+        }
+}
+
+/**
+ *Appends a selector made of one to three simple selectors.
+ */
+static void
+append_selector (GString * a_str, struct CRBenchGenParams const *a_params,
+                 guint32 * a_rand)
+{
+        guint i = 0;
+
+        append_simple_sel (a_str, a_params, a_rand);
+        for (i = 1; i < 3; i++) {
+                if (rand_below (a_rand, 100) >= a_params->combinator_pct)
+                        break;
+                g_string_append (a_str,
+                                 rand_below (a_rand, 3) ? " " : " > ");
+                append_simple_sel (a_str, a_params, a_rand);
+        }
+}
+
+/**
+ * cr_bench_gen_params_set_defaults:
+ *@a_params: the parameters to set.
+ *
+ *Sets the parameters of a medium sized corpus.
+ */
+void
+cr_bench_gen_params_set_defaults (struct CRBenchGenParams *a_params)
+{
+        g_return_if_fail (a_params);
+
+        memset (a_params, 0, sizeof (struct CRBenchGenParams));
+        a_params->seed = 1;
+        a_params->nb_rulesets = 1000;
+        a_params->nb_decls = 4;
+        a_params->nb_elements = 2000;
+        a_params->max_depth = 12;
+        a_params->nb_classes = 50;
+        a_params->nb_ids = 100;
+        a_params->sel_mix[BENCH_SEL_TYPE] = 30;
+        a_params->sel_mix[BENCH_SEL_CLASS] = 40;
+        a_params->sel_mix[BENCH_SEL_ID] = 10;
+        a_params->sel_mix[BENCH_SEL_ATTR] = 10;
+        a_params->sel_mix[BENCH_SEL_PSEUDO] = 10;
+        a_params->combinator_pct = 40;
+}
+
+/**
+ *Appends a declaration to the sheet being generated.
+ *@param a_str the sheet.
+ *@param a_decl the declaration.
+ *@param a_number the pseudo random number of the value.
+ *@param a_color the pseudo random color of a border.
+ */
+static void
+append_decl (GString * a_str, struct BenchDecl const *a_decl,
+             guint a_number, guint32 a_color)
+{
+        switch (a_decl->shape) {
+        case DECL_KEYWORDS:
+                g_string_append_printf (a_str, "  %s: %s;\n",
+                                        a_decl->property, a_decl->value);
+                break;
+        case DECL_NUMBER:
+                g_string_append_printf (a_str, "  %s: %u%s;\n",
+                                        a_decl->property, a_number,
+                                        a_decl->value);
+                break;
+        case DECL_NUMBER_COLOR:
+                g_string_append_printf (a_str, "  %s: #%06x;\n",
+                                        a_decl->property, a_number);
+                break;
+        case DECL_BORDER:
+                g_string_append_printf (a_str, "  %s: %u%s solid #%06x;\n",
+                                        a_decl->property, a_number,
+                                        a_decl->value, a_color);
+                break;
+        }
+}
+
+/**
+ * cr_bench_gen_sheet:
+ *@a_params: the parameters of the generation.
+ *
+ *Generates a style sheet of a_params->nb_rulesets rulesets.
+ *One ruleset in twenty is in a @media rule.
+ *
+ *Returns the text of the sheet, to be freed by the caller.
+ */
+GString *
+cr_bench_gen_sheet (struct CRBenchGenParams const *a_params)
+{
+        GString *result = NULL;
+        guint32 rand_state = 0,
+                color = 0;
+        guint i = 0,
+                j = 0,
+                decl = 0,
+                number = 0;
+        gboolean in_media = FALSE;
+
+        g_return_val_if_fail (a_params, NULL);
+
+        init_rand (&rand_state, a_params->seed, 1);
+        result = g_string_new ("@charset \"UTF-8\";\n");
+        for (i = 0; i < a_params->nb_rulesets; i++) {
+                if (!in_media && i % 20 == 19) {
+                        g_string_append (result, "@media screen, print {\n");
+                        in_media = TRUE;
+                }
+                append_selector (result, a_params, &rand_state);
+                if (!rand_below (&rand_state, 4)) {
+                        g_string_append (result, ", ");
+                        append_selector (result, a_params, &rand_state);
+                }
+                g_string_append (result, " {\n");
+                for (j = 0; j < a_params->nb_decls; j++) {
+                        decl = rand_below (&rand_state,
+                                           G_N_ELEMENTS (gv_decls));
+                        /*both drawn whatever the shape, in this order*/
+                        color = next_rand (&rand_state) & 0xFFFFFF;
+                        number = rand_below (&rand_state, 100);
+                        append_decl (result, &gv_decls[decl], number,
+                                     color);
+                }
+                g_string_append (result, "}\n");
+                if (in_media) {
+                        g_string_append (result, "}\n");
+                        in_media = FALSE;
+                }
+        }
+        return result;
+}
+
+/**
+ *Appends an element and its descendants to the document
+ *being generated.
+ *@param a_str the document.
+ *@param a_params the parameters of the generation.
+ *@param a_rand the pseudo random sequence.
+ *@param a_depth the depth of the element.
+ *@param a_nb_elements in/out parameter. The number of elements
+ *generated so far.
+ */
+static void
+append_element (GString * a_str, struct CRBenchGenParams const *a_params,
+                guint32 * a_rand, guint a_depth, guint * a_nb_elements)
+{
+        const gchar *name =
+                gv_element_names[rand_below
+                                 (a_rand,
+                                  G_N_ELEMENTS (gv_element_names))];
+        guint nb_children = 0,
+                i = 0;
+
+        (*a_nb_elements)++;
+        g_string_append_printf (a_str, "%*s<%s", a_depth, "", name);
+        if (rand_below (a_rand, 100) < 40) {
+                g_string_append_printf (a_str, " class=\"c%u",
+                                        rand_below (a_rand,
+                                                    a_params->nb_classes));
+                if (!rand_below (a_rand, 4)) {
+                        g_string_append_printf
+                                (a_str, " c%u",
+                                 rand_below (a_rand, a_params->nb_classes));
+                }
+                g_string_append (a_str, "\"");
+        }
+        if (rand_below (a_rand, 100) < 5) {
+                g_string_append_printf (a_str, " id=\"i%u\"",
+                                        rand_below (a_rand,
+                                                    a_params->nb_ids));
+        }
+        if (!strcmp (name, "a") && rand_below (a_rand, 2)) {
+                g_string_append (a_str, " href=\"#\"");
+        }
+        if (rand_below (a_rand, 100) < 10) {
+                g_string_append_printf
+                        (a_str, " lang=\"%s\"",
+                         gv_langs[rand_below (a_rand,
+                                              G_N_ELEMENTS (gv_langs))]);
+        }
+
+        if (a_depth < a_params->max_depth) {
+                nb_children = rand_below (a_rand, 5);
+        }
+        if (!nb_children) {
+                g_string_append (a_str, "/>\n");
+                return;
+        }
+        g_string_append (a_str, ">\n");
+        for (i = 0; i < nb_children
+             && *a_nb_elements < a_params->nb_elements; i++) {
+                append_element (a_str, a_params, a_rand, a_depth + 1,
+                                a_nb_elements);
+        }
+        g_string_append_printf (a_str, "%*s</%s>\n", a_depth, "", name);
+}
+
+/**
+ * cr_bench_gen_document:
+ *@a_params: the parameters of the generation.
+ *
+ *Generates an xml document of a_params->nb_elements elements,
+ *which class names and ids are the ones used by the sheet
+ *generated by cr_bench_gen_sheet() with the same parameters.
+ *
+ *Returns the text of the document, to be freed by the caller.
+ */
+GString *
+cr_bench_gen_document (struct CRBenchGenParams const *a_params)
+{
+        GString *result = NULL;
+        guint32 rand_state = 0;
+        guint nb_elements = 2;
+
+        g_return_val_if_fail (a_params, NULL);
+
+        init_rand (&rand_state, a_params->seed, 2);
+        result = g_string_new ("<?xml version=\"1.0\"?>\n<html>\n<body>\n");
+        while (nb_elements < a_params->nb_elements) {
+                append_element (result, a_params, &rand_state, 2,
+                                &nb_elements);
+        }
+        g_string_append (result, "</body>\n</html>\n");
+        return result;
+}
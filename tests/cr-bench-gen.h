@@ -0,0 +1,83 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information
+ */
+
+#ifndef __CR_BENCH_GEN_H__
+#define __CR_BENCH_GEN_H__
+
+#include <glib.h>
+
+/**
+ *@file
+ *The generators of the style sheets and of the xml documents
+ *the benchmarks run on.
+ */
+
+/**
+ *The kinds of simple selectors the sheet generator picks from.
+ */
+enum CRBenchSelKind {
+        BENCH_SEL_TYPE,
+        BENCH_SEL_CLASS,
+        BENCH_SEL_ID,
+        BENCH_SEL_ATTR,
+        BENCH_SEL_PSEUDO,
+        NB_BENCH_SEL_KINDS
+};
+
+/**
+ *The parameters of the generators. A given set of parameters
+ *always generates the same sheet and the same document.
+ */
+struct CRBenchGenParams {
+        /*the seed of the pseudo random generator*/
+        guint32 seed;
+        /*the number of rulesets of the sheet*/
+        guint nb_rulesets;
+        /*the number of declarations of each ruleset*/
+        guint nb_decls;
+        /*the number of elements of the document*/
+        guint nb_elements;
+        /*the depth of the deepest element of the document*/
+        guint max_depth;
+        /*the number of class names and of ids used*/
+        guint nb_classes;
+        guint nb_ids;
+        /*
+         *the weight of each kind of simple selector in the
+         *selectors of the sheet.
+         */
+        guint sel_mix[NB_BENCH_SEL_KINDS];
+        /*
+         *the percentage of simple selectors that are combined
+         *with the previous one, by a descendant or a child
+         *combinator.
+         */
+        guint combinator_pct;
+};
+
+void cr_bench_gen_params_set_defaults (struct CRBenchGenParams *a_params) ;
+
+GString * cr_bench_gen_sheet (struct CRBenchGenParams const *a_params) ;
+
+GString * cr_bench_gen_document (struct CRBenchGenParams const *a_params) ;
+
+#endif /*__CR_BENCH_GEN_H__*/
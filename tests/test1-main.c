@@ -53,6 +53,12 @@ static void
 static enum CRStatus
   test_cr_input_read_char (guchar * a_file_uri);
 
+static enum CRStatus
+  test_cr_input_transcoding (guchar * a_file_uri);
+
+static enum CRStatus
+  test_cr_input_streaming (guchar * a_file_uri);
+
 /**
  *Displays the usage of the test
  *facility.
@@ -166,6 +172,318 @@ test_cr_input_read_char (guchar * a_file_uri)
         return status;
 }
 
+/**
+ *The encodings test_cr_input_transcoding() encodes
+ *the characters of the test file in.
+ */
+enum TestEncoding {
+        TEST_UTF16LE_BOM,
+        TEST_UTF16BE_BOM,
+        TEST_UTF16LE,
+        TEST_UCS4LE_BOM,
+        TEST_UCS4BE,
+        TEST_LATIN1,
+        NB_TEST_ENCODINGS
+};
+
+static const gchar *gv_test_encoding_names[NB_TEST_ENCODINGS] = {
+        "utf16le with bom",
+        "utf16be with bom",
+        "utf16le",
+        "ucs4le with bom",
+        "ucs4be",
+        "latin1 with a @charset rule"
+};
+
+/**
+ *Appends the encoding of a character to a buffer.
+ */
+static void
+append_char (GByteArray * a_buf, guint32 a_char, enum TestEncoding a_enc)
+{
+        guchar bytes[4];
+        guint32 hi = 0,
+                lo = 0;
+
+        switch (a_enc) {
+        case TEST_UTF16LE_BOM:
+        case TEST_UTF16LE:
+        case TEST_UTF16BE_BOM:
+                if (a_char > 0xFFFF) {
+                        hi = 0xD800 + ((a_char - 0x10000) >> 10);
+                        lo = 0xDC00 + ((a_char - 0x10000) & 0x3FF);
+                        append_char (a_buf, hi, a_enc);
+                        append_char (a_buf, lo, a_enc);
+                        return;
+                }
+                if (a_enc == TEST_UTF16BE_BOM) {
+                        bytes[0] = a_char >> 8;
+                        bytes[1] = a_char & 0xFF;
+                } else {
+                        bytes[0] = a_char & 0xFF;
+                        bytes[1] = a_char >> 8;
+                }
+                g_byte_array_append (a_buf, bytes, 2);
+                break;
+        case TEST_UCS4LE_BOM:
+                bytes[0] = a_char & 0xFF;
+                bytes[1] = (a_char >> 8) & 0xFF;
+                bytes[2] = (a_char >> 16) & 0xFF;
+                bytes[3] = a_char >> 24;
+                g_byte_array_append (a_buf, bytes, 4);
+                break;
+        case TEST_UCS4BE:
+                bytes[0] = a_char >> 24;
+                bytes[1] = (a_char >> 16) & 0xFF;
+                bytes[2] = (a_char >> 8) & 0xFF;
+                bytes[3] = a_char & 0xFF;
+                g_byte_array_append (a_buf, bytes, 4);
+                break;
+        default:
+                bytes[0] = a_char;
+                g_byte_array_append (a_buf, bytes, 1);
+                break;
+        }
+}
+
+/**
+ *Reads the characters of a_file_uri and appends a few non ascii
+ *characters to them.
+ *@param a_file_uri the file to read.
+ *@return the characters, NULL if the file could not be read.
+ */
+static GArray *
+load_chars (guchar * a_file_uri)
+{
+        static const guint32 extra_chars[] = {0xE9, 0xFF, 0x20AC, 0x1F600};
+        CRInput *input = NULL;
+        GArray *chars = NULL;
+        guint32 c = 0;
+        guint i = 0;
+
+        input = cr_input_new_from_uri ((const gchar *) a_file_uri, CR_UTF_8);
+        if (!input)
+                return NULL;
+        chars = g_array_new (FALSE, FALSE, sizeof (guint32));
+        while (cr_input_read_char (input, &c) == CR_OK) {
+                g_array_append_val (chars, c);
+        }
+        cr_input_destroy (input);
+        for (i = 0; i < G_N_ELEMENTS (extra_chars); i++) {
+                g_array_append_val (chars, extra_chars[i]);
+        }
+        return chars;
+}
+
+/**
+ *Encodes characters in a given test encoding.
+ *@param a_chars the characters to encode.
+ *@param a_enc the encoding.
+ *@param a_nb_chars out parameter. The number of characters
+ *encoded: the last ones are not in latin1.
+ *@return the encoded buffer.
+ */
+static GByteArray *
+encode_chars (GArray * a_chars, enum TestEncoding a_enc, guint * a_nb_chars)
+{
+        GByteArray *buf = NULL;
+        guint i = 0;
+
+        buf = g_byte_array_new ();
+        *a_nb_chars = 0;
+        switch (a_enc) {
+        case TEST_UTF16LE_BOM:
+        case TEST_UTF16BE_BOM:
+        case TEST_UCS4LE_BOM:
+                append_char (buf, 0xFEFF, a_enc);
+                break;
+        case TEST_LATIN1:
+                g_byte_array_append
+                        (buf, (const guint8 *)
+                         "@charset \"ISO-8859-1\";", 22);
+                break;
+        default:
+                break;
+        }
+        for (i = 0; i < a_chars->len; i++) {
+                if (a_enc == TEST_LATIN1
+                    && g_array_index (a_chars, guint32, i) > 0xFF)
+                        continue;
+                append_char (buf, g_array_index (a_chars, guint32, i),
+                             a_enc);
+                (*a_nb_chars)++;
+        }
+        return buf;
+}
+
+/**
+ *Reads the characters of an input and compares them to
+ *the encoded ones, latin1 encoded characters being those of
+ *a_chars which are below 0x100.
+ *@param a_input the input to read.
+ *@param a_chars the characters that got encoded.
+ *@param a_enc the encoding they got encoded in.
+ *@param a_from the index of the first character to read.
+ *@param a_to the index of the character next to the last one
+ *to read. If it is past the last character, the input must
+ *end there.
+ *@param a_identical out parameter. Set to FALSE if the
+ *characters differ.
+ *@return the number of characters read.
+ */
+static guint
+read_chars (CRInput * a_input, GArray * a_chars, enum TestEncoding a_enc,
+            guint a_from, guint a_to, gboolean * a_identical)
+{
+        guint32 c = 0;
+        guint i = 0,
+                nb_read = 0;
+
+        *a_identical = TRUE;
+        for (i = 0; i < a_chars->len; i++) {
+                if (a_enc == TEST_LATIN1
+                    && g_array_index (a_chars, guint32, i) > 0xFF)
+                        continue;
+                if (nb_read >= a_to)
+                        return nb_read - a_from;
+                if (nb_read++ < a_from)
+                        continue;
+                if (cr_input_read_char (a_input, &c) != CR_OK) {
+                        *a_identical = FALSE;
+                        return nb_read - 1 - a_from;
+                }
+                if (c != g_array_index (a_chars, guint32, i))
+                        *a_identical = FALSE;
+        }
+        if (cr_input_read_char (a_input, &c) == CR_OK)
+                *a_identical = FALSE;
+        return nb_read - a_from;
+}
+
+/**
+ *Reads the characters of a_file_uri, appends a few non ascii
+ *characters to them and encodes them in utf16, ucs4 and latin1.
+ *Then checks that reading each encoded buffer through a #CRInput
+ *which encoding is #CR_AUTO gives the same characters back.
+ *@param a_file_uri the file to read.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_cr_input_transcoding (guchar * a_file_uri)
+{
+        enum CRStatus status = CR_OK;
+        CRInput *input = NULL;
+        GArray *chars = NULL;
+        GByteArray *buf = NULL;
+        guint i = 0,
+                nb_chars = 0,
+                nb_read = 0;
+        gboolean identical = TRUE;
+
+        chars = load_chars (a_file_uri);
+        if (!chars)
+                return CR_ERROR;
+
+        printf ("\n");
+        for (i = 0; i < NB_TEST_ENCODINGS; i++) {
+                buf = encode_chars (chars, i, &nb_chars);
+                input = cr_input_new_from_buf (buf->data, buf->len,
+                                               CR_AUTO, FALSE);
+                if (!input) {
+                        status = CR_ERROR;
+                        g_byte_array_free (buf, TRUE);
+                        break;
+                }
+                if (i == TEST_LATIN1)
+                        cr_input_seek_index (input, CR_SEEK_CUR, 22);
+                nb_read = read_chars (input, chars, i, 0, G_MAXUINT,
+                                     &identical);
+                if (nb_read != nb_chars)
+                        identical = FALSE;
+                printf ("%s: %u characters, %s\n",
+                        gv_test_encoding_names[i], nb_read,
+                        identical == TRUE ? "identical" : "differ");
+                cr_input_destroy (input);
+                input = NULL;
+                g_byte_array_free (buf, TRUE);
+        }
+        g_array_free (chars, TRUE);
+        return status;
+}
+
+/**
+ *Same as test_cr_input_transcoding() but the input, made of
+ *several copies of the characters so that it does not fit in the
+ *decoding window, is read through an input created with
+ *cr_input_new_from_buf_streaming(). The second half of the input
+ *is then read again after seeking back to it.
+ *@param a_file_uri the file to read.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_cr_input_streaming (guchar * a_file_uri)
+{
+        enum CRStatus status = CR_OK;
+        CRInput *input = NULL;
+        CRInputPos pos;
+        GArray *chars = NULL,
+                *copies = NULL;
+        GByteArray *buf = NULL;
+        guint i = 0,
+                nb_chars = 0,
+                nb_read = 0;
+        gboolean identical = TRUE,
+                identical_again = TRUE;
+
+        chars = load_chars (a_file_uri);
+        if (!chars)
+                return CR_ERROR;
+        copies = g_array_new (FALSE, FALSE, sizeof (guint32));
+        for (i = 0; i < 8; i++) {
+                g_array_append_vals (copies, chars->data, chars->len);
+        }
+
+        printf ("\n");
+        for (i = 0; i < NB_TEST_ENCODINGS; i++) {
+                buf = encode_chars (copies, i, &nb_chars);
+                input = cr_input_new_from_buf_streaming (buf->data, buf->len,
+                                                         CR_AUTO, FALSE);
+                if (!input) {
+                        status = CR_ERROR;
+                        g_byte_array_free (buf, TRUE);
+                        break;
+                }
+                if (i == TEST_LATIN1)
+                        cr_input_seek_index (input, CR_SEEK_CUR, 22);
+
+                /*read the first half, remember where the second starts*/
+                nb_read = read_chars (input, copies, i, 0, nb_chars / 2,
+                                      &identical);
+                cr_input_get_cur_pos (input, &pos);
+                nb_read += read_chars (input, copies, i, nb_chars / 2,
+                                       G_MAXUINT, &identical_again);
+                if (nb_read != nb_chars || identical_again == FALSE)
+                        identical = FALSE;
+                printf ("%s: %u characters streamed, %s",
+                        gv_test_encoding_names[i], nb_read,
+                        identical == TRUE ? "identical" : "differ");
+
+                cr_input_set_cur_pos (input, &pos);
+                nb_read = read_chars (input, copies, i, nb_chars / 2,
+                                      G_MAXUINT, &identical_again);
+                printf (", %u characters read again, %s\n", nb_read,
+                        identical_again == TRUE ? "identical" : "differ");
+                cr_input_destroy (input);
+                input = NULL;
+                g_byte_array_free (buf, TRUE);
+        }
+        g_array_free (copies, TRUE);
+        g_array_free (chars, TRUE);
+        return status;
+}
+
 /**
  *The entry point of the testing routine.
  */
@@ -192,6 +510,8 @@ main (int argc, char **argv)
         }
 
         test_cr_input_read_char ((guchar *) options.files_list[0]);
+        test_cr_input_transcoding ((guchar *) options.files_list[0]);
+        test_cr_input_streaming ((guchar *) options.files_list[0]);
 
         return 0;
 }
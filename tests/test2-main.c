@@ -490,6 +490,32 @@ init_test_sac_handler (CRDocHandler * a_handler)
  *handlers.
  ***************************/
 
+/**
+ *Dumps the counters of the statistics of a parser;
+ *the parsing time is left out as it changes from
+ *one run to the other.
+ */
+static void
+dump_parser_stats (CRParserStats * a_stats)
+{
+        guint i = 0;
+
+        g_print ("\n***************\n");
+        g_print ("parser stats\n");
+        g_print ("***************\n");
+        g_print ("tokens: %lu\n", a_stats->nb_tokens);
+        g_print ("unget tokens: %lu\n", a_stats->nb_unget_tokens);
+        g_print ("backtracks: %lu\n", a_stats->nb_backtracks);
+        g_print ("seeks: %lu\n", a_stats->nb_seeks);
+        for (i = 0; i < CR_STATS_NB_OBJECT_TYPES; i++) {
+                if (!a_stats->nb_allocs[i])
+                        continue;
+                g_print ("%s allocations: %lu\n",
+                         cr_stats_object_type_to_string (i),
+                         a_stats->nb_allocs[i]);
+        }
+}
+
 /**
  *The test of the cr_input_read_byte() method.
  *Reads the each byte of a_file_uri using the
@@ -504,6 +530,7 @@ test_cr_parser_parse (guchar * a_file_uri)
 {
         enum CRStatus status = CR_OK;
         CRParser *parser = NULL;
+        CRParserStats stats;
 
         g_return_val_if_fail (a_file_uri, CR_BAD_PARAM_ERROR);
 
@@ -519,7 +546,10 @@ test_cr_parser_parse (guchar * a_file_uri)
                 g_return_val_if_fail (status == CR_OK, CR_ERROR);
         }
 
+        cr_parser_set_stats_enabled (parser, TRUE);
         status = cr_parser_parse_file (parser, a_file_uri, CR_ASCII);
+        if (cr_parser_get_stats (parser, &stats) == CR_OK)
+                dump_parser_stats (&stats);
 
         cr_parser_destroy (parser);
 
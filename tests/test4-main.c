@@ -22,6 +22,7 @@
  */
 
 
+#include <string.h>
 #include "cr-test-utils.h"
 #include "libcroco.h"
 
@@ -97,6 +98,157 @@ display_about (char *prg_name)
         g_print ("\n\n");
 }
 
+/**
+ *Displays the categories the memory used by a_sheet falls in.
+ *The byte counts are left out as they depend on the platform.
+ *Also checks that a cascade made of the sheet set twice counts
+ *it once.
+ */
+static void
+dump_mem_usage (CRStyleSheet * a_sheet)
+{
+        CRMemUsage sheet_usage,
+                cascade_usage;
+        CRCascade *cascade = NULL;
+        guint i = 0;
+
+        memset (&sheet_usage, 0, sizeof (CRMemUsage));
+        memset (&cascade_usage, 0, sizeof (CRMemUsage));
+        if (cr_stylesheet_get_memory_usage (a_sheet, &sheet_usage) != CR_OK)
+                return;
+        g_print ("\nmemory usage:");
+        for (i = 0; i < CR_MEM_NB_CATEGORIES; i++) {
+                if (sheet_usage.bytes[i])
+                        g_print (" %s", cr_mem_category_to_string (i));
+        }
+        g_print ("\n");
+
+        /*keeps the cascade from destroying the sheet*/
+        cr_stylesheet_ref (a_sheet);
+        cascade = cr_cascade_new (a_sheet, a_sheet, NULL);
+        if (!cascade)
+                return;
+        cr_cascade_get_memory_usage (cascade, &cascade_usage);
+        g_print ("cascade memory usage: %s\n",
+                 cr_mem_usage_get_total (&cascade_usage)
+                 - cascade_usage.bytes[CR_MEM_OTHER]
+                 == cr_mem_usage_get_total (&sheet_usage) ?
+                 "sheet counted once" : "wrong");
+        cr_cascade_destroy (cascade);
+}
+
+static gulong gv_nb_allocs = 0;
+static gulong gv_nb_frees = 0;
+
+static gpointer
+counting_alloc (gsize a_size, gpointer a_user_data)
+{
+        gv_nb_allocs++;
+        return g_try_malloc (a_size);
+}
+
+static void
+counting_free (gpointer a_mem, gpointer a_user_data)
+{
+        gv_nb_frees++;
+        g_free (a_mem);
+}
+
+/**
+ *Parses a_file_uri again with an allocator that counts the
+ *allocations and checks that destroying the stylesheet it
+ *builds, with no allocator pushed, frees all of them.
+ */
+static void
+check_allocator (guchar * a_file_uri)
+{
+        CRAllocator allocator = { counting_alloc, counting_free, NULL };
+        CROMParser *parser = NULL;
+        CRStyleSheet *stylesheet = NULL;
+
+        parser = cr_om_parser_new (NULL);
+        if (!parser)
+                return;
+        cr_om_parser_set_allocator (parser, &allocator);
+        cr_om_parser_parse_file (parser, a_file_uri, CR_ASCII, &stylesheet);
+        cr_om_parser_destroy (parser);
+        if (!stylesheet)
+                return;
+        cr_stylesheet_destroy (stylesheet);
+        g_print ("allocator: %s\n",
+                 gv_nb_allocs && gv_nb_allocs == gv_nb_frees ?
+                 "all the objects freed" : "wrong");
+}
+
+/**
+ *Parses a_buf, or a_file_uri if a_buf is NULL, within a_limits.
+ *@return the status of the parsing.
+ */
+static enum CRStatus
+parse_with_limits (CRLimits * a_limits, guchar * a_file_uri,
+                   const gchar * a_buf)
+{
+        CROMParser *parser = NULL;
+        CRStyleSheet *stylesheet = NULL;
+        enum CRStatus status = CR_OK;
+
+        parser = cr_om_parser_new (NULL);
+        if (!parser)
+                return CR_OUT_OF_MEMORY_ERROR;
+        cr_om_parser_set_limits (parser, a_limits);
+        if (a_buf)
+                status = cr_om_parser_parse_buf (parser, (const guchar *) a_buf,
+                                                 strlen (a_buf), CR_ASCII,
+                                                 &stylesheet);
+        else
+                status = cr_om_parser_parse_file (parser, a_file_uri,
+                                                  CR_ASCII, &stylesheet);
+        if (stylesheet)
+                cr_stylesheet_destroy (stylesheet);
+        cr_om_parser_destroy (parser);
+        return status;
+}
+
+/**
+ *Parses a_file_uri, and small buffers, again with limits they
+ *go past, and checks that each limit stops the parsing with
+ *the status it gives.
+ */
+static void
+check_limits (guchar * a_file_uri)
+{
+        CRLimits limits;
+        gint cancelled = 1;
+
+        memset (&limits, 0, sizeof (CRLimits));
+        limits.max_tokens = 8;
+        g_print ("limits: max_tokens %s\n",
+                 parse_with_limits (&limits, a_file_uri, NULL)
+                 == CR_LIMIT_EXCEEDED_ERROR ? "stops the parsing" : "wrong");
+
+        memset (&limits, 0, sizeof (CRLimits));
+        limits.cancel_flag = &cancelled;
+        g_print ("limits: cancel_flag %s\n",
+                 parse_with_limits (&limits, a_file_uri, NULL)
+                 == CR_CANCELLED_ERROR ? "stops the parsing" : "wrong");
+
+        memset (&limits, 0, sizeof (CRLimits));
+        limits.max_depth = 2;
+        g_print ("limits: max_depth %s\n",
+                 parse_with_limits (&limits, NULL, "a {b: f(1) g(h(2))}")
+                 == CR_OK
+                 && parse_with_limits (&limits, NULL,
+                                       "a {b: f(g(h(1)))}")
+                 == CR_LIMIT_EXCEEDED_ERROR ? "stops the parsing" : "wrong");
+
+        memset (&limits, 0, sizeof (CRLimits));
+        limits.max_selector_length = 2;
+        g_print ("limits: max_selector_length %s\n",
+                 parse_with_limits (&limits, NULL, "a > b {c: d}") == CR_OK
+                 && parse_with_limits (&limits, NULL, "a b c {d: e}")
+                 == CR_LIMIT_EXCEEDED_ERROR ? "stops the parsing" : "wrong");
+}
+
 /**
  *The test of the cr_input_read_byte() method.
  *Reads the each byte of a_file_uri using the
@@ -120,7 +272,10 @@ test_cr_parser_parse (guchar * a_file_uri)
                                           &stylesheet);
         if (status == CR_OK && stylesheet) {
                 cr_stylesheet_dump (stylesheet, stdout);
+                dump_mem_usage (stylesheet);
                 cr_stylesheet_destroy (stylesheet);
+                check_allocator (a_file_uri);
+                check_limits (a_file_uri);
         }
         cr_om_parser_destroy (parser);
 
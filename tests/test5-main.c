@@ -131,6 +131,137 @@ walk_xml_tree_and_lookup_rules (CRSelEng * a_sel_eng,
         }
 }
 
+/**
+ *Looks up the rulesets each element from a_node on matches,
+ *until a lookup fails.
+ *@return the status of the lookup that failed, or CR_OK.
+ */
+static enum CRStatus
+match_elements (CRSelEng * a_sel_eng, CRStyleSheet * a_sheet,
+                xmlNode * a_node)
+{
+        CRStatement **stmts_tab = NULL;
+        gulong tab_len = 0;
+        enum CRStatus status = CR_OK;
+        xmlNode *cur_node = NULL;
+
+        for (cur_node = a_node; cur_node; cur_node = cur_node->next) {
+                if (cur_node->type != XML_ELEMENT_NODE)
+                        continue;
+                status = cr_sel_eng_get_matched_rulesets
+                        (a_sel_eng, a_sheet, cur_node, &stmts_tab, &tab_len);
+                if (stmts_tab) {
+                        g_free (stmts_tab);
+                        stmts_tab = NULL;
+                }
+                if (status == CR_OK)
+                        status = match_elements (a_sel_eng, a_sheet,
+                                                 cur_node->children);
+                if (status != CR_OK)
+                        return status;
+        }
+        return CR_OK;
+}
+
+/**
+ *Matches the document again with limits the matching goes
+ *past, and checks that each limit stops it with the status
+ *it gives, and that the lookups that follow fail at once.
+ */
+static void
+check_limits (CRStyleSheet * a_sheet, xmlNode * a_node)
+{
+        CRLimits limits;
+        CRSelEng *sel_eng = NULL;
+        gint cancelled = 1;
+
+        sel_eng = cr_sel_eng_new ();
+        if (!sel_eng)
+                return;
+        memset (&limits, 0, sizeof (CRLimits));
+        limits.max_match_attempts = 2;
+        cr_sel_eng_set_limits (sel_eng, &limits);
+        g_print ("limits: max_match_attempts %s\n",
+                 match_elements (sel_eng, a_sheet, a_node)
+                 == CR_LIMIT_EXCEEDED_ERROR
+                 && match_elements (sel_eng, a_sheet, a_node)
+                 == CR_LIMIT_EXCEEDED_ERROR ?
+                 "stops the matching" : "wrong");
+
+        memset (&limits, 0, sizeof (CRLimits));
+        limits.cancel_flag = &cancelled;
+        limits.check_interval = 1;
+        cr_sel_eng_set_limits (sel_eng, &limits);
+        g_print ("limits: cancel_flag %s\n",
+                 match_elements (sel_eng, a_sheet, a_node)
+                 == CR_CANCELLED_ERROR ? "stops the matching" : "wrong");
+
+        cr_sel_eng_set_limits (sel_eng, NULL);
+        g_print ("limits: none %s\n",
+                 match_elements (sel_eng, a_sheet, a_node) == CR_OK ?
+                 "stops nothing" : "wrong");
+        cr_sel_eng_destroy (sel_eng);
+}
+
+/**
+ *Dumps the counters of the statistics of the selection
+ *engine; the times are left out as they change from
+ *one run to the other.
+ */
+static void
+dump_sel_eng_stats (CRSelEng * a_sel_eng)
+{
+        static const gchar *combinators[CR_STATS_NB_COMBINATORS] = {
+                "none", "descendant", "sibling", "child"
+        };
+        CRSelEngStats stats;
+        guint i = 0;
+
+        if (cr_sel_eng_get_stats (a_sel_eng, &stats) != CR_OK)
+                return;
+        g_print ("'''''''''''''''''''''''''\n");
+        g_print ("selection engine stats\n");
+        for (i = 0; i < CR_STATS_NB_COMBINATORS; i++) {
+                g_print ("%s: %lu simple selectors tried, %lu matched\n",
+                         combinators[i], stats.nb_match_attempts[i],
+                         stats.nb_match_hits[i]);
+        }
+        g_print ("attribute lookups: %lu\n", stats.nb_get_props);
+        for (i = 0; i < CR_STATS_NB_OBJECT_TYPES; i++) {
+                if (!stats.nb_allocs[i])
+                        continue;
+                g_print ("%s allocations: %lu\n",
+                         cr_stats_object_type_to_string (i),
+                         stats.nb_allocs[i]);
+        }
+        g_print ("'''''''''''''''''''''''''\n");
+}
+
+/**
+ *Counts the times each tracepoint is reached.
+ */
+static void
+count_tracepoint (enum CRTracePoint a_point,
+                  guint64 a_arg0, guint64 a_arg1, gpointer a_user_data)
+{
+        gulong *counts = a_user_data;
+
+        counts[a_point]++;
+}
+
+static void
+dump_tracepoint_counts (gulong * a_counts)
+{
+        guint i = 0;
+
+        g_print ("tracepoints\n");
+        for (i = 0; i < CR_TRACE_NB_POINTS; i++) {
+                g_print ("%s: %lu\n", cr_trace_point_to_string (i),
+                         a_counts[i]);
+        }
+        g_print ("'\n");
+}
+
 /**
  *The test of the cr_input_read_byte() method.
  *Reads the each byte of a_file_uri using the
@@ -149,9 +280,11 @@ test_sel_eng (guchar * a_file_uri)
         xmlDoc *xml_doc = NULL;
         xmlNode *cur_node = NULL;
         CRSelEng *selection_engine = NULL;
+        gulong trace_counts[CR_TRACE_NB_POINTS] = { 0 };
 
         g_return_val_if_fail (a_file_uri, CR_BAD_PARAM_ERROR);
 
+        cr_trace_set_handler (count_tracepoint, trace_counts);
         parser = cr_om_parser_new (NULL);
         status = cr_om_parser_parse_file (parser, a_file_uri, CR_ASCII,
                                           &stylesheet);
@@ -168,11 +301,20 @@ test_sel_eng (guchar * a_file_uri)
         }
 
         selection_engine = cr_sel_eng_new ();
+        cr_sel_eng_set_stats_enabled (selection_engine, TRUE);
+        cr_sel_eng_set_selector_profiling (selection_engine, TRUE);
 
         cur_node = xml_doc->children;
 
         walk_xml_tree_and_lookup_rules (selection_engine,
                                         stylesheet, cur_node);
+        dump_sel_eng_stats (selection_engine);
+        g_print ("selector profile\n");
+        cr_sel_eng_dump_selector_profile (selection_engine, 0, stdout);
+        g_print ("'''''''''''''''''''''''''\n");
+        cr_trace_set_handler (NULL, NULL);
+        dump_tracepoint_counts (trace_counts);
+        check_limits (stylesheet, xml_doc->children);
 
         if (parser) {
                 cr_om_parser_destroy (parser);
@@ -197,6 +339,7 @@ test_sel_eng (guchar * a_file_uri)
 
       error:
 
+        cr_trace_set_handler (NULL, NULL);
         if (parser) {
                 cr_om_parser_destroy (parser);
                 parser = NULL;
@@ -0,0 +1,830 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Some test facilities for the document styling
+ *walk of the #CRSelEng class.
+ */
+
+const guchar *xml_content =
+        (const guchar *) "<document>"
+        "<E0 class=\"c0\">text0</E0>"
+        "<E1 id=\"id1\">"
+        "<E1-1 class=\"c1 c2\"><E1-1-1>text1</E1-1-1></E1-1>"
+        "<E1-2>text1-2</E1-2>"
+        "</E1>"
+        "<E2 class=\"c1\"><E2-1 class=\"c2\">text2</E2-1></E2>"
+        "</document>";
+
+/**
+ *The number of copies of the hardwired document
+ *body styled by the parallel walk.
+ */
+#define NB_BODY_COPIES 32
+
+/**
+ *The styles computed during a walk.
+ *key => xmlNode*, value => the style, serialized.
+ */
+struct StyleRecord {
+        GHashTable *styles;
+        GMutex lock;
+        /*if not NULL, the styles are kept here*/
+        GPtrArray *kept_styles;
+};
+
+static void display_help (char *prg_name);
+
+static void display_about (char *prg_name);
+
+static enum CRStatus test_style_document (guchar * a_file_uri);
+
+static enum CRStatus test_style_document_parallel (CRCascade * a_cascade,
+                                                   xmlDoc * a_doc);
+
+static enum CRStatus test_style_document_limits (CRCascade * a_cascade,
+                                                 xmlDoc * a_doc);
+
+static enum CRStatus test_style_document_split (CRCascade * a_cascade,
+                                                xmlDoc * a_doc);
+
+static enum CRStatus test_style_document_units (CRCascade * a_cascade,
+                                                xmlDoc * a_doc);
+
+static enum CRStatus test_style_document_lazy (CRCascade * a_cascade,
+                                               xmlDoc * a_doc);
+
+/**
+ *Displays the usage of the test
+ *facility.
+ *@param a_argc the argc variable passed to the main function.
+ *@param a_argv the argv variable passed to the main function.
+ */
+static void
+display_help (char *prg_name)
+{
+        g_print ("\n\n");
+        g_print ("usage: %s <file-to-parse>\n", prg_name);
+        g_print ("\t <file-to-parse>: the file to parse\n");
+        g_print ("\n\n");
+        g_print ("Test the document styling walk of the selection engine");
+        g_print ("Returns OK if the status is CR_OK, KO otherwise\n");
+        g_print ("\n\n");
+}
+
+/**
+ *Displays the about text.
+ *@param a_argc the argc variable passed to the main function.
+ *@param a_argv the argv variable passed to the main function.
+ */
+static void
+display_about (char *prg_name)
+{
+        g_print ("\n\n");
+        g_print ("%s is a libcroco CRSelEng class test program.\n",
+                 prg_name);
+        g_print ("%s Parses a file and styles an xml document with it",
+                 prg_name);
+        g_print ("It should run on GNU compliants systems.\n");
+        g_print ("\n\n");
+}
+
+static enum CRStatus
+dump_node_style (CRSelEng * a_sel_eng, xmlNode * a_node,
+                 CRStyle * a_style, gpointer a_user_data)
+{
+        GString *str = NULL;
+
+        g_print ("'\n");
+        g_print ("xml element: %s\n", a_node->name);
+        str = g_string_new (NULL);
+        cr_style_to_string (a_style, &str, 0);
+        if (str) {
+                g_print ("%s\n", str->str);
+                g_string_free (str, TRUE);
+                str = NULL;
+        }
+        return CR_OK;
+}
+
+static enum CRStatus
+record_node_style (CRSelEng * a_sel_eng, xmlNode * a_node,
+                   CRStyle * a_style, gpointer a_user_data)
+{
+        struct StyleRecord *record = a_user_data;
+        GString *str = NULL;
+
+        str = g_string_new (NULL);
+        cr_style_to_string (a_style, &str, 0);
+        g_mutex_lock (&record->lock);
+        g_hash_table_insert (record->styles, a_node,
+                             g_string_free (str, FALSE));
+        if (record->kept_styles) {
+                cr_style_ref (a_style);
+                g_ptr_array_add (record->kept_styles, a_style);
+        }
+        g_mutex_unlock (&record->lock);
+        return CR_OK;
+}
+
+/**
+ *Records the computed values of the numerical and color
+ *properties and of the font size of a node, read through the
+ *cr_style_get_computed_* () functions.
+ */
+static enum CRStatus
+record_computed_values (CRSelEng * a_sel_eng, xmlNode * a_node,
+                        CRStyle * a_style, gpointer a_user_data)
+{
+        struct StyleRecord *record = a_user_data;
+        GString *str = NULL;
+        gchar *tmp_str = NULL;
+        CRNum num;
+        CRRgb rgb;
+        CRFontSize font_size;
+        int i = 0;
+
+        str = g_string_new (NULL);
+        for (i = 0; i < NB_NUM_PROPS; i++) {
+                if (cr_style_get_computed_num (a_style, i, &num) != CR_OK)
+                        return CR_ERROR;
+                tmp_str = (gchar *) cr_num_to_string (&num);
+                g_string_append_printf (str, "%s ", tmp_str);
+                g_free (tmp_str);
+        }
+        for (i = 0; i < NB_RGB_PROPS; i++) {
+                if (cr_style_get_computed_rgb (a_style, i, &rgb) != CR_OK)
+                        return CR_ERROR;
+                tmp_str = (gchar *) cr_rgb_to_string (&rgb);
+                g_string_append_printf (str, "%s ", tmp_str);
+                g_free (tmp_str);
+        }
+        if (cr_style_get_computed_font_size (a_style, &font_size) != CR_OK)
+                return CR_ERROR;
+        tmp_str = cr_font_size_to_string (&font_size);
+        g_string_append (str, tmp_str);
+        g_free (tmp_str);
+
+        g_mutex_lock (&record->lock);
+        g_hash_table_insert (record->styles, a_node,
+                             g_string_free (str, FALSE));
+        g_mutex_unlock (&record->lock);
+        return CR_OK;
+}
+
+static gboolean
+records_are_equal (struct StyleRecord *a_this, struct StyleRecord *a_other)
+{
+        GHashTableIter iter;
+        gpointer node = NULL,
+                style = NULL;
+
+        if (g_hash_table_size (a_this->styles)
+            != g_hash_table_size (a_other->styles))
+                return FALSE;
+        g_hash_table_iter_init (&iter, a_this->styles);
+        while (g_hash_table_iter_next (&iter, &node, &style)) {
+                gchar *other_style = g_hash_table_lookup
+                        (a_other->styles, node);
+
+                if (!other_style || strcmp (style, other_style))
+                        return FALSE;
+        }
+        return TRUE;
+}
+
+/**
+ *Releases the styles kept by a walk.
+ *@return the number of distinct style instances kept.
+ */
+static guint
+release_kept_styles (struct StyleRecord *a_this)
+{
+        GHashTable *distinct = NULL;
+        guint i = 0,
+                result = 0;
+
+        distinct = g_hash_table_new (g_direct_hash, g_direct_equal);
+        for (i = 0; i < a_this->kept_styles->len; i++) {
+                g_hash_table_insert (distinct,
+                                     g_ptr_array_index (a_this->kept_styles, i),
+                                     NULL);
+        }
+        result = g_hash_table_size (distinct);
+        for (i = 0; i < a_this->kept_styles->len; i++) {
+                cr_style_unref (g_ptr_array_index (a_this->kept_styles, i));
+        }
+        g_hash_table_destroy (distinct);
+        g_ptr_array_free (a_this->kept_styles, TRUE);
+        a_this->kept_styles = NULL;
+        return result;
+}
+
+/**
+ *Copies the body of a_doc NB_BODY_COPIES times and checks that
+ *cr_sel_eng_style_document_parallel() computes the same styles
+ *as cr_sel_eng_style_document(). Also dumps how many
+ *style instances the elements share.
+ *@param a_cascade the cascade to style the document with.
+ *@param a_doc the document to style.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_style_document_parallel (CRCascade * a_cascade, xmlDoc * a_doc)
+{
+        enum CRStatus status = CR_OK;
+        struct StyleRecord sequential,
+                parallel;
+        CRSelEng *selection_engine = NULL;
+        xmlNode *root = NULL,
+                *body = NULL,
+                *last = NULL,
+                *cur_node = NULL;
+        int i = 0;
+
+        root = xmlDocGetRootElement (a_doc);
+        body = root->children;
+        last = root->last;
+        for (i = 1; i < NB_BODY_COPIES; i++) {
+                for (cur_node = body; cur_node; cur_node = cur_node->next) {
+                        xmlAddChild (root, xmlCopyNode (cur_node, 1));
+                        if (cur_node == last)
+                                break;
+                }
+        }
+
+        sequential.styles = g_hash_table_new_full
+                (g_direct_hash, g_direct_equal, NULL, g_free);
+        g_mutex_init (&sequential.lock);
+        sequential.kept_styles = g_ptr_array_new ();
+        parallel.styles = g_hash_table_new_full
+                (g_direct_hash, g_direct_equal, NULL, g_free);
+        g_mutex_init (&parallel.lock);
+        parallel.kept_styles = NULL;
+
+        selection_engine = cr_sel_eng_new ();
+        status = cr_sel_eng_style_document (selection_engine, a_cascade,
+                                            a_doc, record_node_style,
+                                            &sequential);
+        if (status != CR_OK)
+                goto cleanup;
+        status = cr_sel_eng_style_document_parallel
+                (selection_engine, a_cascade, a_doc, 4,
+                 record_node_style, &parallel);
+        if (status != CR_OK)
+                goto cleanup;
+
+        g_print ("'\n");
+        g_print ("sequential walk: %u elements, %u style instances\n",
+                 g_hash_table_size (sequential.styles),
+                 release_kept_styles (&sequential));
+        g_print ("parallel walk: %u elements, styles %s\n",
+                 g_hash_table_size (parallel.styles),
+                 records_are_equal (&sequential, &parallel) == TRUE ?
+                 "identical" : "differ");
+
+ cleanup:
+        if (selection_engine) {
+                cr_sel_eng_destroy (selection_engine);
+                selection_engine = NULL;
+        }
+        if (sequential.kept_styles)
+                release_kept_styles (&sequential);
+        g_hash_table_destroy (sequential.styles);
+        g_mutex_clear (&sequential.lock);
+        g_hash_table_destroy (parallel.styles);
+        g_mutex_clear (&parallel.lock);
+        return status;
+}
+
+static enum CRStatus
+ignore_node_style (CRSelEng * a_sel_eng, xmlNode * a_node,
+                   CRStyle * a_style, gpointer a_user_data)
+{
+        return CR_OK;
+}
+
+/**
+ *Looks for the smallest power of two of match attempts the
+ *sequential walk of a_doc fits in, and checks that the parallel
+ *walk given a quarter of it stops: its worker threads spend the
+ *same max_match_attempts, not one each.
+ *@param a_cascade the cascade to style the document with.
+ *@param a_doc the document to style.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_style_document_limits (CRCascade * a_cascade, xmlDoc * a_doc)
+{
+        enum CRStatus status = CR_LIMIT_EXCEEDED_ERROR;
+        CRSelEng *selection_engine = NULL;
+        CRLimits limits;
+
+        selection_engine = cr_sel_eng_new ();
+        if (!selection_engine)
+                return CR_OUT_OF_MEMORY_ERROR;
+        memset (&limits, 0, sizeof (CRLimits));
+        limits.max_match_attempts = 1;
+        while (status == CR_LIMIT_EXCEEDED_ERROR) {
+                limits.max_match_attempts *= 2;
+                cr_sel_eng_set_limits (selection_engine, &limits);
+                status = cr_sel_eng_style_document
+                        (selection_engine, a_cascade, a_doc,
+                         ignore_node_style, NULL);
+        }
+        if (status != CR_OK)
+                goto cleanup;
+
+        limits.max_match_attempts /= 4;
+        cr_sel_eng_set_limits (selection_engine, &limits);
+        status = cr_sel_eng_style_document_parallel
+                (selection_engine, a_cascade, a_doc, 4,
+                 ignore_node_style, NULL);
+        g_print ("parallel walk: max_match_attempts %s\n",
+                 status == CR_LIMIT_EXCEEDED_ERROR ?
+                 "stops all the threads" : "wrong");
+        status = CR_OK;
+
+ cleanup:
+        cr_sel_eng_destroy (selection_engine);
+        return status;
+}
+
+/**
+ *Styles a_doc with a cascade made of two author sheets: a sheet
+ *whose rules are all overridden, followed by the author sheet of
+ *a_cascade. Checks that the styles are the same as with a_cascade.
+ *@param a_cascade the cascade to style the document with.
+ *@param a_doc the document to style.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_style_document_split (CRCascade * a_cascade, xmlDoc * a_doc)
+{
+        enum CRStatus status = CR_OK;
+        struct StyleRecord single,
+                split;
+        CRStyleSheet *first_sheet = NULL;
+        CRStatement *stmt = NULL;
+        CRCascade *cascade = NULL;
+        CRSelEng *selection_engine = NULL;
+        GPtrArray *rulesets = NULL;
+
+        single.styles = g_hash_table_new_full
+                (g_direct_hash, g_direct_equal, NULL, g_free);
+        g_mutex_init (&single.lock);
+        single.kept_styles = NULL;
+        split.styles = g_hash_table_new_full
+                (g_direct_hash, g_direct_equal, NULL, g_free);
+        g_mutex_init (&split.lock);
+        split.kept_styles = NULL;
+        rulesets = g_ptr_array_new ();
+
+        status = cr_om_parser_simply_parse_buf
+                ((const guchar *) "document {color: white; margin: 0px}",
+                 strlen ("document {color: white; margin: 0px}"),
+                 CR_ASCII, &first_sheet);
+        if (status != CR_OK || !first_sheet) {
+                cr_utils_trace_info ("Could not parse the stylesheet");
+                status = CR_ERROR;
+                goto cleanup;
+        }
+        cascade = cr_cascade_new (first_sheet, NULL, NULL);
+        if (!cascade) {
+                cr_stylesheet_destroy (first_sheet);
+                status = CR_ERROR;
+                goto cleanup;
+        }
+        status = cr_cascade_append_sheet
+                (cascade, cr_cascade_get_sheet (a_cascade, ORIGIN_AUTHOR),
+                 ORIGIN_AUTHOR);
+        if (status != CR_OK)
+                goto cleanup;
+
+        selection_engine = cr_sel_eng_new ();
+        status = cr_sel_eng_style_document (selection_engine, a_cascade,
+                                            a_doc, record_node_style,
+                                            &single);
+        if (status != CR_OK)
+                goto cleanup;
+        status = cr_sel_eng_style_document (selection_engine, cascade,
+                                            a_doc, record_node_style,
+                                            &split);
+        if (status != CR_OK)
+                goto cleanup;
+        status = cr_sel_eng_get_matched_rulesets_from_cascade
+                (selection_engine, cascade, xmlDocGetRootElement (a_doc),
+                 rulesets);
+        if (status != CR_OK)
+                goto cleanup;
+
+        g_print ("split cascade walk: %u sheets, %u elements, styles %s\n",
+                 cr_cascade_get_nb_sheets (cascade, ORIGIN_AUTHOR),
+                 g_hash_table_size (split.styles),
+                 records_are_equal (&single, &split) == TRUE ?
+                 "identical" : "differ");
+        g_print ("root element: %u matched rulesets\n", rulesets->len);
+
+        /*
+         *remove the rule of the first sheet behind the back of
+         *the cascade: the next match must not see it anymore.
+         */
+        stmt = first_sheet->statements;
+        cr_statement_unlink (stmt);
+        cr_statement_destroy (stmt);
+        status = cr_sel_eng_get_matched_rulesets_from_cascade
+                (selection_engine, cascade, xmlDocGetRootElement (a_doc),
+                 rulesets);
+        if (status != CR_OK)
+                goto cleanup;
+        g_print ("root element, first sheet emptied: "
+                 "%u matched rulesets\n", rulesets->len);
+
+ cleanup:
+        if (selection_engine) {
+                cr_sel_eng_destroy (selection_engine);
+                selection_engine = NULL;
+        }
+        if (cascade) {
+                cr_cascade_destroy (cascade);
+                cascade = NULL;
+        }
+        g_ptr_array_free (rulesets, TRUE);
+        g_hash_table_destroy (single.styles);
+        g_mutex_clear (&single.lock);
+        g_hash_table_destroy (split.styles);
+        g_mutex_clear (&split.lock);
+        return status;
+}
+
+/**
+ *Checks that the computed values read from the styles of a walk
+ *that resolves the inherited properties on demand, are the ones of
+ *a walk that resolves them eagerly. The lazy walk is a parallel one,
+ *so that several threads resolve properties of the same styles.
+ *@param a_cascade the cascade to style the document with.
+ *@param a_doc the document to style.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_style_document_lazy (CRCascade * a_cascade, xmlDoc * a_doc)
+{
+        enum CRStatus status = CR_OK;
+        struct StyleRecord eager,
+                lazy;
+        CRSelEng *selection_engine = NULL;
+
+        eager.styles = g_hash_table_new_full
+                (g_direct_hash, g_direct_equal, NULL, g_free);
+        g_mutex_init (&eager.lock);
+        eager.kept_styles = NULL;
+        lazy.styles = g_hash_table_new_full
+                (g_direct_hash, g_direct_equal, NULL, g_free);
+        g_mutex_init (&lazy.lock);
+        lazy.kept_styles = NULL;
+
+        selection_engine = cr_sel_eng_new ();
+        status = cr_sel_eng_style_document (selection_engine, a_cascade,
+                                            a_doc, record_computed_values,
+                                            &eager);
+        if (status != CR_OK)
+                goto cleanup;
+        cr_sel_eng_set_lazy_style_resolution (selection_engine, TRUE);
+        status = cr_sel_eng_style_document_parallel
+                (selection_engine, a_cascade, a_doc, 4,
+                 record_computed_values, &lazy);
+        if (status != CR_OK)
+                goto cleanup;
+
+        g_print ("lazy resolution walk: %u elements, computed values %s\n",
+                 g_hash_table_size (lazy.styles),
+                 records_are_equal (&eager, &lazy) == TRUE ?
+                 "identical" : "differ");
+
+ cleanup:
+        if (selection_engine) {
+                cr_sel_eng_destroy (selection_engine);
+                selection_engine = NULL;
+        }
+        g_hash_table_destroy (eager.styles);
+        g_mutex_clear (&eager.lock);
+        g_hash_table_destroy (lazy.styles);
+        g_mutex_clear (&lazy.lock);
+        return status;
+}
+
+/**
+ *The number of elements of the hardwired document
+ *(before the copies of its body) which resolved lengths are dumped.
+ */
+#define NB_UNITS_DUMPED_ELEMENTS 8
+
+/**
+ *The elements styled by a walk, in document order, with their style.
+ */
+struct UnitsRecord {
+        GPtrArray *nodes;
+        GPtrArray *styles;
+};
+
+static enum CRStatus
+keep_node_style (CRSelEng * a_sel_eng, xmlNode * a_node,
+                 CRStyle * a_style, gpointer a_user_data)
+{
+        struct UnitsRecord *record = a_user_data;
+
+        cr_style_ref (a_style);
+        g_ptr_array_add (record->nodes, a_node);
+        g_ptr_array_add (record->styles, a_style);
+        return CR_OK;
+}
+
+/**
+ *Dumps the actual values of the font size and of
+ *a few numerical properties of a resolved style.
+ */
+static void
+dump_resolved_units (const xmlChar * a_name, CRStyle * a_style)
+{
+        static const enum CRNumProp props[] = {
+                NUM_PROP_WIDTH, NUM_PROP_MARGIN_LEFT,
+                NUM_PROP_PADDING_TOP, NUM_PROP_TOP
+        };
+        static const gchar *names[] = {
+                "width", "margin-left", "padding-top", "top"
+        };
+        gchar *tmp_str = NULL;
+        guint i = 0;
+
+        g_print ("%s: font-size %gpx", a_name,
+                 a_style->font->font_size.av.value.absolute.val);
+        for (i = 0; i < G_N_ELEMENTS (props); i++) {
+                tmp_str = (gchar *) cr_num_to_string
+                        (&a_style->box->num_props[props[i]].av);
+                g_print (", %s %s", names[i], tmp_str);
+                g_free (tmp_str);
+        }
+        g_print ("\n");
+}
+
+/**
+ *Resolves the lengths of a chain of styles which properties
+ *use relative units, and dumps them.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_resolve_units_chain (void)
+{
+        static const char *decls[] = {
+                "width: 5in; font-size: large",
+                "width: 50%; font-size: 2em; margin-left: 1em; "
+                "padding-top: 12pt; top: 10%",
+                "font-size: smaller; margin-left: 2ex; width: 50%; "
+                "padding-top: inherit; top: 1cm",
+        };
+        enum CRStatus status = CR_OK;
+        CRStyle *styles[G_N_ELEMENTS (decls)];
+        CRDeclaration *list = NULL,
+                *cur = NULL;
+        CRUnitContext context;
+        gchar name[16];
+        guint i = 0;
+
+        memset (styles, 0, sizeof (styles));
+        for (i = 0; i < G_N_ELEMENTS (decls); i++) {
+                styles[i] = cr_style_new (i == 0);
+                list = cr_declaration_parse_list_from_buf
+                        ((const guchar *) decls[i], CR_UTF_8);
+                if (!styles[i] || !list) {
+                        status = CR_ERROR;
+                        goto cleanup;
+                }
+                for (cur = list; cur; cur = cur->next) {
+                        cr_style_set_style_from_decl (styles[i], cur);
+                }
+                cr_declaration_destroy (list);
+                list = NULL;
+                if (i) {
+                        styles[i]->parent_style = styles[i - 1];
+                        cr_style_resolve_inherited_properties (styles[i]);
+                }
+        }
+        cr_unit_context_set_defaults (&context);
+        status = cr_style_resolve_units (styles, G_N_ELEMENTS (styles),
+                                         &context);
+        if (status != CR_OK)
+                goto cleanup;
+        for (i = 0; i < G_N_ELEMENTS (styles); i++) {
+                g_snprintf (name, sizeof (name), "level%u", i);
+                dump_resolved_units ((const xmlChar *) name, styles[i]);
+        }
+
+ cleanup:
+        for (i = 0; i < G_N_ELEMENTS (styles); i++) {
+                if (styles[i])
+                        cr_style_destroy (styles[i]);
+        }
+        return status;
+}
+
+/**
+ *Resolves the lengths of the styles of a walk in one batch,
+ *and dumps the actual values of the first elements, and how
+ *many box groups the styles share.
+ *@param a_cascade the cascade to style the document with.
+ *@param a_doc the document to style.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_style_document_units (CRCascade * a_cascade, xmlDoc * a_doc)
+{
+        enum CRStatus status = CR_OK;
+        struct UnitsRecord record;
+        CRSelEng *selection_engine = NULL;
+        CRUnitContext context;
+        GHashTable *boxes = NULL;
+        CRStyle *style = NULL;
+        guint i = 0;
+
+        record.nodes = g_ptr_array_new ();
+        record.styles = g_ptr_array_new ();
+        boxes = g_hash_table_new (g_direct_hash, g_direct_equal);
+        selection_engine = cr_sel_eng_new ();
+        status = cr_sel_eng_style_document (selection_engine, a_cascade,
+                                            a_doc, keep_node_style,
+                                            &record);
+        if (status != CR_OK)
+                goto cleanup;
+        cr_unit_context_set_defaults (&context);
+        status = cr_style_resolve_units ((CRStyle **) record.styles->pdata,
+                                         record.styles->len, &context);
+        if (status != CR_OK)
+                goto cleanup;
+
+        for (i = 0; i < record.styles->len; i++) {
+                style = g_ptr_array_index (record.styles, i);
+                g_hash_table_insert (boxes, style->box, NULL);
+                if (i < NB_UNITS_DUMPED_ELEMENTS)
+                        dump_resolved_units
+                                (((xmlNode *) g_ptr_array_index
+                                  (record.nodes, i))->name, style);
+        }
+        g_print ("units resolution: %u elements, %u box groups\n",
+                 record.styles->len, g_hash_table_size (boxes));
+        status = test_resolve_units_chain ();
+
+ cleanup:
+        if (selection_engine) {
+                cr_sel_eng_destroy (selection_engine);
+                selection_engine = NULL;
+        }
+        for (i = 0; i < record.styles->len; i++) {
+                cr_style_unref (g_ptr_array_index (record.styles, i));
+        }
+        g_ptr_array_free (record.styles, TRUE);
+        g_ptr_array_free (record.nodes, TRUE);
+        g_hash_table_destroy (boxes);
+        return status;
+}
+
+/**
+ *Parses the stylesheet a_file_uri and styles the
+ *hardwired xml document with it, dumping the style
+ *of each element on stdout.
+ *@param a_file_uri the stylesheet to parse.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_style_document (guchar * a_file_uri)
+{
+        enum CRStatus status = CR_OK;
+        CRStyleSheet *stylesheet = NULL;
+        CRCascade *cascade = NULL;
+        xmlDoc *xml_doc = NULL;
+        CRSelEng *selection_engine = NULL;
+
+        g_return_val_if_fail (a_file_uri, CR_BAD_PARAM_ERROR);
+
+        status = cr_om_parser_simply_parse_file (a_file_uri, CR_ASCII,
+                                                 &stylesheet);
+        if (status != CR_OK || !stylesheet) {
+                cr_utils_trace_info ("Could not parse the stylesheet");
+                status = CR_ERROR;
+                goto cleanup;
+        }
+        cascade = cr_cascade_new (stylesheet, NULL, NULL);
+        if (!cascade) {
+                cr_stylesheet_destroy (stylesheet);
+                status = CR_ERROR;
+                goto cleanup;
+        }
+        xml_doc = xmlParseMemory ((const char *) xml_content,
+                                  strlen ((const char *) xml_content));
+        if (!xml_doc) {
+                cr_utils_trace_info ("Could not parse xml content");
+                status = CR_ERROR;
+                goto cleanup;
+        }
+
+        selection_engine = cr_sel_eng_new ();
+        status = cr_sel_eng_style_document (selection_engine, cascade,
+                                            xml_doc, dump_node_style,
+                                            NULL);
+        if (status != CR_OK)
+                goto cleanup;
+        status = test_style_document_parallel (cascade, xml_doc);
+        if (status != CR_OK)
+                goto cleanup;
+        status = test_style_document_limits (cascade, xml_doc);
+        if (status != CR_OK)
+                goto cleanup;
+        status = test_style_document_split (cascade, xml_doc);
+        if (status != CR_OK)
+                goto cleanup;
+        status = test_style_document_lazy (cascade, xml_doc);
+        if (status != CR_OK)
+                goto cleanup;
+        status = test_style_document_units (cascade, xml_doc);
+
+ cleanup:
+        if (selection_engine) {
+                cr_sel_eng_destroy (selection_engine);
+                selection_engine = NULL;
+        }
+        if (cascade) {
+                cr_cascade_destroy (cascade);
+                cascade = NULL;
+        }
+        if (xml_doc) {
+                xmlFreeDoc (xml_doc);
+                xml_doc = NULL;
+        }
+        xmlCleanupParser ();
+        return status;
+}
+
+/**
+ *The entry point of the testing routine.
+ */
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        enum CRStatus status = CR_OK;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        status = test_style_document ((guchar *) options.files_list[0]);
+
+        if (status != CR_OK) {
+                g_print ("\nKO\n");
+        }
+
+        return 0;
+}